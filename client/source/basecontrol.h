@@ -0,0 +1,39 @@
+#ifndef CLIENT_BASE_CONTROL_H_
+#define CLIENT_BASE_CONTROL_H_
+
+// Connection of a control client. Carries text commands and text replies.
+class AbstractControlChannel
+{
+public:
+	// Default virtual destructor.
+	virtual ~AbstractControlChannel() = default;
+
+	// Waits for the next command.
+	// @param command - received command.
+	// @returns ERROR_SUCCESS if success, an error if the client is gone or the listener is stopped.
+	virtual WinPipe::WinError Receive(_Out_ std::string& command) = 0;
+
+	// Sends the reply to the command.
+	// @param reply - reply text.
+	// @returns ERROR_SUCCESS if success.
+	virtual WinPipe::WinError Send(_In_ const std::string& reply) = 0;
+};
+
+// Local control endpoint. Accepts the control clients one by one.
+class AbstractControlListener
+{
+public:
+	// Default virtual destructor.
+	virtual ~AbstractControlListener() = default;
+
+	// Waits for a control client.
+	// @param channel - connection of the client.
+	// @returns ERROR_SUCCESS if a client is connected, an error if the listener is stopped or failed.
+	virtual WinPipe::WinError Accept(_Out_ std::unique_ptr<AbstractControlChannel>& channel) = 0;
+
+	// Stops the listener. The pending Accept and Receive calls return an error.
+	// May be called from any thread.
+	virtual void Stop() = 0;
+};
+
+#endif // !CLIENT_BASE_CONTROL_H_
@@ -14,9 +14,22 @@ public:
 	virtual void Wait(_In_opt_ DWORD timeout = INFINITE) = 0;
 	// Sends config update event.
 	// @param config - new configuration.
-	virtual void UpdateConfig(_In_ const BaseConfigManager::Config& config) = 0;
+	// @param rules - new routing rules.
+	virtual void UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules) = 0;
 	// Returns count of sessions.
 	virtual size_t GetSessionsCount() const = 0;
+	// Injects into the process with the running config.
+	// @param pid - process id.
+	// @returns true if the process is proxied.
+	virtual bool Attach(_In_ DWORD pid) = 0;
+	// Stops the session of the process, the redirector unloads itself.
+	// @param pid - process id.
+	// @returns false if there is no session of the process.
+	virtual bool Detach(_In_ DWORD pid) = 0;
+	// Returns statistics of the automatic injection of the started processes.
+	virtual InjectionQueue::Statistics GetInjectionStatistics() const = 0;
+	// Returns server instance.
+	virtual std::shared_ptr<AbstractServer> GetServer() const noexcept = 0;
 };
 
 #endif // !CLIENT_BASE_CORE_H_
@@ -0,0 +1,33 @@
+#ifndef CLIENT_BASE_EVENT_LOOP_H_
+#define CLIENT_BASE_EVENT_LOOP_H_
+
+// Event loop. Runs the callbacks of all sessions on a small fixed pool of threads,
+// so the count of threads does not grow with the count of proxied processes.
+// The sessions wait for their pipes and rings through the loop instead of
+// blocking a thread each. The loop only waits for objects and runs callbacks,
+// so it maps to a completion port as well as to epoll over file descriptors.
+class AbstractEventLoop
+{
+public:
+	// Loop callback.
+	// @param status - ERROR_SUCCESS if the object is signaled or the callback is posted, WAIT_TIMEOUT if the wait has timed out.
+	using Callback = std::function<void(WinPipe::WinError status)>;
+
+	// Default virtual destructor.
+	virtual ~AbstractEventLoop() = default;
+
+	// Runs the callback on a loop thread.
+	// @param callback - callback.
+	// @returns false if the callback is not queued.
+	virtual bool Post(_In_ Callback callback) = 0;
+
+	// Runs the callback on a loop thread once the object is signaled or the timeout elapses.
+	// The object must stay open until the callback runs.
+	// @param object - waitable object.
+	// @param timeout - time in milliseconds.
+	// @param callback - callback.
+	// @returns false if the wait is not started.
+	virtual bool Wait(_In_ HANDLE object, _In_ DWORD timeout, _In_ Callback callback) = 0;
+};
+
+#endif // !CLIENT_BASE_EVENT_LOOP_H_
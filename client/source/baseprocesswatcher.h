@@ -0,0 +1,25 @@
+#ifndef CLIENT_BASE_PROCESS_WATCHER_H_
+#define CLIENT_BASE_PROCESS_WATCHER_H_
+
+// Abstract process watcher.
+// Notifies of the started processes when they are created, without polling process snapshots.
+// A backend starts watching in its constructor.
+class AbstractProcessWatcher
+{
+public:
+	// Called from the watcher thread for every started process.
+	// @param pid - process id.
+	// @param created - process creation time.
+	using Callback = std::function<void(DWORD pid, std::chrono::system_clock::time_point created)>;
+
+	// Default virtual destructor.
+	virtual ~AbstractProcessWatcher() = default;
+	// Stops watching. The callback is not called after it returns.
+	virtual void Stop() = 0;
+	// Waits for the watcher to stop, by Stop or by a failure of the backend.
+	// @param timeout - time in milliseconds.
+	// @returns true if the watcher has stopped.
+	virtual bool Wait(_In_ DWORD timeout) = 0;
+};
+
+#endif // !CLIENT_BASE_PROCESS_WATCHER_H_
@@ -6,6 +6,13 @@
 class AbstractServer
 {
 public:
+	// Counters of the reaped sessions.
+	struct Totals
+	{
+		size_t	m_Sessions;	// Count of reaped sessions.
+		size_t	m_Reports;	// Count of connection reports of the reaped sessions.
+	};
+
 	virtual ~AbstractServer() = default;
 
 	// Stops all active sessions.
@@ -20,21 +27,43 @@ public:
 	virtual void DeleteSession(_In_ DWORD id) = 0;
 
 	// Updating client configurations.
-	virtual void UpdateConfig(_In_ const BaseConfigManager::Config& config) = 0;
+	// Returns after all sessions have acknowledged the config or the rollout deadline has expired.
+	virtual void UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules) = 0;
+
+	// Publishes the config to the config section without waiting for the sessions.
+	// @returns version of the published config, 0 if it is not published.
+	virtual DWORD PublishConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules) = 0;
 
-	// Waiting for all sessions to complete
+	// Waiting for all session processes to exit.
 	// @param timeout - waiting timeout. by default is INFINITE.
 	virtual void Wait(_In_opt_ DWORD timeout = INFINITE) = 0;
 
 	// Returns true if the specified session exists.
 	virtual bool SessionExists(_In_ DWORD id) const = 0;
 
-	// Returns session.
+	// Returns session or nullptr if it does not exist.
 	virtual std::shared_ptr<AbstractSession> GetSession(_In_ DWORD id) = 0;
 
 	// Returns count of sessions.
 	virtual size_t CountOfSessions() const noexcept = 0;
 
+	// Returns the sessions at the moment of the call.
+	virtual std::vector<std::shared_ptr<AbstractSession>> GetSessions() const = 0;
+
+	// Returns the running config.
+	// @param config - running config.
+	// @param rules - running routing rules.
+	virtual void GetConfig(_Out_ BaseConfigManager::Config& config, _Out_ BaseConfigManager::Rules& rules) = 0;
+
+	// Returns event loop of the sessions.
+	virtual AbstractEventLoop& GetEventLoop() noexcept = 0;
+
+	// Returns counters of the reaped sessions.
+	virtual Totals GetTotals() const = 0;
+
+	// Returns version of the last config rollout.
+	virtual DWORD GetConfigVersion() const noexcept = 0;
+
 	// Returns true if list of session are empty.
 	virtual bool Empty() const noexcept {
 		return CountOfSessions() == 0;
@@ -7,17 +7,21 @@ class AbstractSession
 {
 public:
 	// AbstractSession constructor.
-	// Throws runtime_error if the StopEvent event is not created.
+	// Throws runtime_error if the StopEvent event is not created or the process is not opened.
 	// @param id - session id.
 	// @param server - server instance.
 	// @param eventName - session stopEvent name.
 	AbstractSession(_In_ DWORD id, _In_ std::weak_ptr<AbstractServer> server, _In_ const std::wstring& eventName) :
 		m_Id{ id },
 		m_Server{ server },
-		m_StopEvent{ CreateEventW(nullptr, false, false, eventName.c_str()) }
+		m_StopEvent{ CreateEventW(nullptr, false, false, eventName.c_str()) },
+		m_Process{ OpenProcess(SYNCHRONIZE, FALSE, id) }
 	{
 		if (!m_StopEvent.get())
 			throw std::runtime_error("Failed to create termination event.");
+
+		if (!m_Process.get())
+			throw std::runtime_error("Failed to open session process.");
 	}
 
 	// Default destructor.
@@ -26,8 +30,21 @@ public:
 	// Stoppint client session.
 	virtual void Stop() = 0;
 
-	// Sends new config to client.
-	virtual void UpdateConfig(const BaseConfigManager::Config& config) = 0;
+	// Prepares the session for the config before it is published to the config section.
+	virtual void PrepareConfig(const BaseConfigManager::Config& config) = 0;
+
+	// Waits for the client to report that it is initialized.
+	// @returns true if the client is ready to apply the config.
+	virtual bool WaitReady() = 0;
+
+	// Waits for the client to apply the published config.
+	// @param version - published config version.
+	// @param timeout - waiting timeout in milliseconds. by default is INFINITE.
+	// @returns true if the client has acknowledged the config version or a newer one.
+	virtual bool WaitConfig(DWORD version, DWORD timeout = INFINITE) = 0;
+
+	// Returns version of the last config acknowledged by the client. 0 - none.
+	virtual DWORD GetConfigVersion() const noexcept = 0;
 
 	// Returns true if session are active.
 	virtual bool IsActive() noexcept {
@@ -44,10 +61,19 @@ public:
 		return m_StopEvent;
 	}
 
+	// Returns process handle, signaled when the process exits.
+	const WinPipe::WinHandle& GetProcess() const noexcept {
+		return m_Process;
+	}
+
+	// Returns count of received connection reports.
+	virtual size_t GetReportCount() const noexcept = 0;
+
 protected:
 	DWORD													m_Id;					// Session ID.
 	std::weak_ptr<AbstractServer>	m_Server;			// Server instance.
 	WinPipe::WinHandle						m_StopEvent;	// Stop event handle.
+	WinPipe::WinHandle						m_Process;		// Process handle.
 };
 
 #endif // !CLIENT_BASE_SESSION_H_
@@ -0,0 +1,38 @@
+#ifndef CLIENT_BASE_SESSION_TRACKER_H_
+#define CLIENT_BASE_SESSION_TRACKER_H_
+
+// Tracks the lifetime of the sessions.
+// A session is running until its object is signaled, e.g. until its process exits.
+class AbstractSessionTracker
+{
+public:
+	// Default virtual destructor.
+	virtual ~AbstractSessionTracker() = default;
+
+	// Starts tracking the session.
+	// @param id - session id.
+	// @param object - object signaled when the session completes, e.g. the session process.
+	// Must stay open until the session is untracked.
+	// @returns false if the session is already tracked or the wait is not registered.
+	virtual bool Track(_In_ DWORD id, _In_ HANDLE object) = 0;
+
+	// Stops tracking the session.
+	// @param id - session id.
+	virtual void Untrack(_In_ DWORD id) = 0;
+
+	// Waits for all tracked sessions to complete.
+	// @param timeout - time in milliseconds.
+	// @returns true if no tracked session is running.
+	virtual bool WaitAll(_In_opt_ DWORD timeout = INFINITE) = 0;
+
+	// Waits for any tracked session to complete and takes it from the completed queue.
+	// @param id - id of the completed session.
+	// @param timeout - time in milliseconds.
+	// @returns false if no session is completed in time.
+	virtual bool WaitAny(_Out_ DWORD& id, _In_opt_ DWORD timeout = INFINITE) = 0;
+
+	// Returns count of running sessions.
+	virtual size_t GetRunning() const = 0;
+};
+
+#endif // !CLIENT_BASE_SESSION_TRACKER_H_
@@ -0,0 +1,54 @@
+#include "global.h"
+
+namespace
+{
+	// Returns true if the objects have the same bytes.
+	// @param left - first object.
+	// @param right - second object.
+	template <typename T>
+	bool SameBytes(_In_ const T& left, _In_ const T& right) noexcept {
+		return std::memcmp(&left, &right, sizeof(T)) == 0;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ConfigDiff ConfigDiff::Compare(_In_ const BaseConfigManager::Config& oldConfig, _In_ const BaseConfigManager::Rules& oldRules, 
+	_In_ const BaseConfigManager::Config& newConfig, _In_ const BaseConfigManager::Rules& newRules) noexcept
+{
+	auto diff = ConfigDiff();
+
+	diff.m_Proxy			= oldConfig.m_ProxyType != newConfig.m_ProxyType || !SameBytes(oldConfig.m_ProxyV4, newConfig.m_ProxyV4) || 
+											!SameBytes(oldConfig.m_ProxyV6, newConfig.m_ProxyV6);
+	diff.m_Socks5			= oldConfig.m_Socks5Pipelining != newConfig.m_Socks5Pipelining;
+	diff.m_Upstreams	= oldConfig.m_UpstreamsCount != newConfig.m_UpstreamsCount || 
+											std::memcmp(oldConfig.m_Upstreams, newConfig.m_Upstreams, newConfig.m_UpstreamsCount * sizeof(BaseConfigManager::Upstream)) != 0;
+	diff.m_Logging		= oldConfig.m_LoggingEnable != newConfig.m_LoggingEnable || oldConfig.m_ReportPolicy != newConfig.m_ReportPolicy;
+	diff.m_Rules			= oldRules.size() != newRules.size() || 
+											(!newRules.empty() && std::memcmp(oldRules.data(), newRules.data(), newRules.size() * sizeof(BaseConfigManager::Rule)) != 0);
+
+	return diff;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ConfigDiff::ToString() const
+{
+	auto result = std::string();
+	auto append = [&result](_In_ bool changed, _In_ const char* name)
+	{
+		if (!changed)
+			return;
+
+		if (!result.empty())
+			result += ", ";
+
+		result += name;
+	};
+
+	append(m_Proxy,			"proxy");
+	append(m_Socks5,		"socks5");
+	append(m_Upstreams,	"upstreams");
+	append(m_Logging,		"logging");
+	append(m_Rules,			"rules");
+
+	return result;
+}
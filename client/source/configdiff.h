@@ -0,0 +1,31 @@
+#ifndef CLIENT_CONFIG_DIFF_H_
+#define CLIENT_CONFIG_DIFF_H_
+
+// Structural difference of two configs.
+// The config version is not compared, it changes with every rollout.
+struct ConfigDiff
+{
+	bool	m_Proxy;		// Proxy type or proxy addresses.
+	bool	m_Socks5;		// Socks5 options.
+	bool	m_Upstreams;	// Additional upstream proxy servers.
+	bool	m_Logging;		// Connection reports.
+	bool	m_Rules;		// Routing rules.
+
+	// Compares the configs.
+	// @param oldConfig - running config.
+	// @param oldRules - running routing rules.
+	// @param newConfig - new config.
+	// @param newRules - new routing rules.
+	static ConfigDiff Compare(_In_ const BaseConfigManager::Config& oldConfig, _In_ const BaseConfigManager::Rules& oldRules, 
+		_In_ const BaseConfigManager::Config& newConfig, _In_ const BaseConfigManager::Rules& newRules) noexcept;
+
+	// Returns true if the configs are the same.
+	bool Empty() const noexcept {
+		return !m_Proxy && !m_Socks5 && !m_Upstreams && !m_Logging && !m_Rules;
+	}
+
+	// Returns comma-separated names of the changed parts.
+	std::string ToString() const;
+};
+
+#endif // !CLIENT_CONFIG_DIFF_H_
@@ -0,0 +1,71 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ConfigWatcher::ConfigWatcher(_In_ const std::string& path, _In_ Callback callback) :
+	m_Path{ path },
+	m_Callback{ callback },
+	m_StopEvent{ CreateEventW(nullptr, true, false, nullptr) },
+	m_Attributes{ 0 }
+{
+	auto separator	= path.find_last_of("\\/");
+	auto directory	= separator == std::string::npos ? std::string(".") : path.substr(0, separator + 1);
+	auto change			= FindFirstChangeNotificationA(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE);
+
+	if (change == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Failed to watch config file directory.");
+
+	m_Change = std::unique_ptr<void, ChangeDeleter>(change);
+
+	if (!m_StopEvent.get())
+		throw std::runtime_error("Failed to create config watcher stop event.");
+
+	GetAttributes(m_Attributes);
+
+	m_Thread = std::thread(&ConfigWatcher::WatchThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ConfigWatcher::~ConfigWatcher()
+{
+	SetEvent(m_StopEvent.get());
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigWatcher::WatchThread()
+{
+	HANDLE objects[] = { m_StopEvent.get(), m_Change.get() };
+
+	while (WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+	{
+		if (!FindNextChangeNotification(m_Change.get()))
+		{
+			spdlog::error("Failed to watch config file {}. GetLastError={}.", m_Path, GetLastError());
+			break;
+		}
+
+		// The file may still be written, the next changes are merged into this one.
+		while (WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, FALSE, DEBOUNCE_TIMEOUT_) == WAIT_OBJECT_0 + 1)
+			FindNextChangeNotification(m_Change.get());
+
+		if (WaitForSingleObject(m_StopEvent.get(), 0) == WAIT_OBJECT_0)
+			break;
+
+		auto attributes = WIN32_FILE_ATTRIBUTE_DATA{ 0 };
+
+		// Other files of the directory are changed, or the file is being replaced.
+		if (!GetAttributes(attributes) || std::memcmp(&attributes, &m_Attributes, sizeof(attributes)) == 0)
+			continue;
+
+		m_Attributes = attributes;
+		m_Callback();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ConfigWatcher::GetAttributes(_Out_ WIN32_FILE_ATTRIBUTE_DATA& attributes) const
+{
+	return GetFileAttributesExA(m_Path.c_str(), GetFileExInfoStandard, &attributes) != FALSE;
+}
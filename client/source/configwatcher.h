@@ -0,0 +1,58 @@
+#ifndef CLIENT_CONFIG_WATCHER_H_
+#define CLIENT_CONFIG_WATCHER_H_
+
+// Watches the config file and calls the callback when it is changed.
+// The directory of the file is watched, so the file may be replaced by a rename.
+// The changes are debounced, and the callback is called only if the write time
+// or the size of the file is changed, so an editor saving the file in several
+// writes causes a single reload.
+class ConfigWatcher
+{
+	// Closes the change notification handle.
+	struct ChangeDeleter
+	{
+		void operator()(_In_ HANDLE change) {
+			FindCloseChangeNotification(change);
+		}
+	};
+
+	// Time in milliseconds the watcher waits for the file writes to settle.
+	static constexpr DWORD DEBOUNCE_TIMEOUT_ = 200;
+
+public:
+	// Called from the watcher thread when the config file is changed.
+	using Callback = std::function<void()>;
+
+	// Deleted default constructor.
+	ConfigWatcher() = delete;
+	// Stops the watcher thread.
+	~ConfigWatcher();
+	// Deleted copy constructor.
+	ConfigWatcher(const ConfigWatcher&) = delete;
+	// Deleted copy assigment.
+	ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+	// ConfigWatcher constructor.
+	// Throws runtime_error if the directory of the file is not watched.
+	// @param path - config file path.
+	// @param callback - change callback.
+	ConfigWatcher(_In_ const std::string& path, _In_ Callback callback);
+
+private:
+	// Watcher thread routine.
+	void WatchThread();
+
+	// Reads the write time and the size of the file.
+	// @param attributes - file attributes.
+	// @returns false if the file does not exist.
+	bool GetAttributes(_Out_ WIN32_FILE_ATTRIBUTE_DATA& attributes) const;
+
+	std::string													m_Path;				// Config file path.
+	Callback														m_Callback;		// Change callback.
+	std::unique_ptr<void, ChangeDeleter>	m_Change;			// Change notification of the file directory.
+	WinPipe::WinHandle									m_StopEvent;	// Stops the watcher thread.
+	WIN32_FILE_ATTRIBUTE_DATA						m_Attributes;	// Attributes of the last loaded file.
+	std::thread													m_Thread;			// Watcher thread.
+};
+
+#endif // !CLIENT_CONFIG_WATCHER_H_
@@ -0,0 +1,154 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ControlHandler::ControlHandler(_In_ AbstractCore& core, _In_ ConfigParser parser, _In_ ShutdownCallback shutdown) :
+	m_Core{ core },
+	m_Parser{ parser },
+	m_Shutdown{ shutdown }
+{ }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ControlHandler::Execute(_In_ const std::string& command)
+{
+	auto stream		= std::istringstream(command);
+	auto name			= std::string();
+	auto arguments	= Arguments();
+
+	stream >> name;
+
+	for (auto argument = std::string(); stream >> argument; )
+		arguments.push_back(argument);
+
+	if			(name == "attach")		return Attach(arguments);
+	else if (name == "detach")		return Detach(arguments);
+	else if (name == "config")		return Config(arguments);
+	else if (name == "sessions")	return Sessions();
+	else if (name == "stats")			return Stats();
+	else if (name == "shutdown")
+	{
+		m_Shutdown();
+		return "ok";
+	}
+
+	return "error\nunknown command " + name;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ControlHandler::Attach(_In_ const Arguments& arguments)
+{
+	auto result = std::string();
+	auto failed = arguments.empty();
+	auto pid		= DWORD{ 0 };
+
+	for (const auto& argument : arguments)
+	{
+		if (!ParsePid(argument, pid))
+		{
+			result += "\n" + argument + " invalid";
+			failed	= true;
+		}
+		else if (m_Core.GetServer()->SessionExists(pid))
+			result += "\n" + argument + " already attached";
+		else if (!m_Core.Attach(pid))
+		{
+			result += "\n" + argument + " failed";
+			failed	= true;
+		}
+		else
+			result += "\n" + argument + " attached";
+	}
+
+	return (failed ? "error" : "ok") + result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ControlHandler::Detach(_In_ const Arguments& arguments)
+{
+	auto result = std::string();
+	auto failed = arguments.empty();
+	auto pid		= DWORD{ 0 };
+
+	for (const auto& argument : arguments)
+	{
+		if (!ParsePid(argument, pid))
+		{
+			result += "\n" + argument + " invalid";
+			failed	= true;
+		}
+		else if (!m_Core.Detach(pid))
+		{
+			result += "\n" + argument + " not attached";
+			failed	= true;
+		}
+		else
+			result += "\n" + argument + " detached";
+	}
+
+	return (failed ? "error" : "ok") + result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ControlHandler::Config(_In_ const Arguments& arguments)
+{
+	auto config = BaseConfigManager::Config();
+	auto rules	= BaseConfigManager::Rules();
+
+	// The running config is kept if the new one is not valid.
+	if (!m_Parser(arguments, config, rules))
+		return "error\ninvalid config";
+
+	m_Core.UpdateConfig(config, rules);
+	return "ok\nconfig=" + std::to_string(m_Core.GetServer()->GetConfigVersion());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ControlHandler::Sessions()
+{
+	auto result = std::string("ok");
+
+	for (const auto& session : m_Core.GetServer()->GetSessions())
+	{
+		result += "\n" + std::to_string(session->GetId()) + 
+			" config=" + std::to_string(session->GetConfigVersion()) + 
+			" reports=" + std::to_string(session->GetReportCount());
+	}
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string ControlHandler::Stats()
+{
+	auto server			= m_Core.GetServer();
+	auto totals			= server->GetTotals();
+	auto injection	= m_Core.GetInjectionStatistics();
+
+	return "ok"
+		"\nsessions=" + std::to_string(server->CountOfSessions()) +
+		"\nconfig=" + std::to_string(server->GetConfigVersion()) +
+		"\nreaped=" + std::to_string(totals.m_Sessions) +
+		"\nreaped_reports=" + std::to_string(totals.m_Reports) +
+		"\nauto_injected=" + std::to_string(injection.m_Injected) +
+		"\nauto_failed=" + std::to_string(injection.m_Failed) +
+		"\nauto_dropped=" + std::to_string(injection.m_Dropped) +
+		"\nstart_to_proxy_p50_ms=" + std::to_string(injection.m_P50) +
+		"\nstart_to_proxy_p99_ms=" + std::to_string(injection.m_P99);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ControlHandler::ParsePid(_In_ const std::string& text, _Out_ DWORD& pid)
+{
+	auto value = 0ULL;
+
+	pid = 0;
+
+	if (text.empty() || text.size() > 10 || text.find_first_not_of("0123456789") != std::string::npos)
+		return false;
+
+	value = std::stoull(text);
+	if (value == 0 || value > MAXDWORD)
+		return false;
+
+	pid = static_cast<DWORD>(value);
+	return true;
+}
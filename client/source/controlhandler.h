@@ -0,0 +1,77 @@
+#ifndef CLIENT_CONTROL_HANDLER_H_
+#define CLIENT_CONTROL_HANDLER_H_
+
+// Executes the control commands against the running core.
+// A command is a line of whitespace-separated words. The reply starts with
+// "ok" or "error", the next lines hold the result:
+//   attach <pid>...         - injects into the processes with the running config.
+//   detach <pid>...         - stops the sessions, the redirectors unload themselves.
+//   config <argument>...    - replaces the config, the arguments are the command line ones.
+//   sessions                - lists the sessions with their config versions and report counts.
+//   stats                   - returns the server counters.
+//   shutdown                - stops the daemon.
+// The handler does not depend on the transport, so it may be driven by any channel.
+class ControlHandler
+{
+public:
+	// Parses the arguments of the config command.
+	// @param arguments - command line arguments.
+	// @param config - parsed config.
+	// @param rules - parsed routing rules.
+	// @returns false if the arguments are not valid.
+	using ConfigParser = std::function<bool(const std::vector<std::string>& arguments, BaseConfigManager::Config& config, BaseConfigManager::Rules& rules)>;
+
+	// Called by the shutdown command.
+	using ShutdownCallback = std::function<void()>;
+
+	// Deleted default constructor.
+	ControlHandler() = delete;
+	// Default destructor.
+	~ControlHandler() = default;
+	// Deleted copy constructor.
+	ControlHandler(const ControlHandler&) = delete;
+	// Deleted copy assigment.
+	ControlHandler& operator=(const ControlHandler&) = delete;
+
+	// ControlHandler constructor.
+	// @param core - running core.
+	// @param parser - parser of the config command arguments.
+	// @param shutdown - shutdown callback.
+	ControlHandler(_In_ AbstractCore& core, _In_ ConfigParser parser, _In_ ShutdownCallback shutdown);
+
+	// Executes the command.
+	// @param command - command line.
+	// @returns reply.
+	std::string Execute(_In_ const std::string& command);
+
+private:
+	// Command arguments, without the command name.
+	using Arguments = std::vector<std::string>;
+
+	// Executes the attach command.
+	std::string Attach(_In_ const Arguments& arguments);
+
+	// Executes the detach command.
+	std::string Detach(_In_ const Arguments& arguments);
+
+	// Executes the config command.
+	std::string Config(_In_ const Arguments& arguments);
+
+	// Executes the sessions command.
+	std::string Sessions();
+
+	// Executes the stats command.
+	std::string Stats();
+
+	// Parses the process id.
+	// @param text - decimal process id.
+	// @param pid - process id.
+	// @returns false if the text is not a process id.
+	static bool ParsePid(_In_ const std::string& text, _Out_ DWORD& pid);
+
+	AbstractCore&			m_Core;			// Running core.
+	ConfigParser			m_Parser;		// Parser of the config command arguments.
+	ShutdownCallback	m_Shutdown;	// Shutdown callback.
+};
+
+#endif // !CLIENT_CONTROL_HANDLER_H_
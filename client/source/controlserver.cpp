@@ -0,0 +1,59 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ControlServer::ControlServer(_In_ std::unique_ptr<AbstractControlListener> listener, _In_ AbstractCore& core, _In_ ControlHandler::ConfigParser parser) :
+	m_Listener{ std::move(listener) },
+	m_Handler{ core, parser, [this]() { m_Requested = true; } },
+	m_Requested{ false },
+	m_Shutdown{ false }
+{
+	m_Thread = std::thread(&ControlServer::ServeThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ControlServer::~ControlServer()
+{
+	m_Listener->Stop();
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ControlServer::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Condition.wait(lock, [this] { return m_Shutdown; });
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ControlServer::ServeThread()
+{
+	auto channel	= std::unique_ptr<AbstractControlChannel>();
+	auto command	= std::string();
+	auto status		= WinPipe::WinError{ ERROR_SUCCESS };
+
+	while (!m_Requested && (status = m_Listener->Accept(channel)) == ERROR_SUCCESS)
+	{
+		while (!m_Requested && channel->Receive(command) == ERROR_SUCCESS)
+		{
+			spdlog::info("Control command: {}.", command);
+
+			if (channel->Send(m_Handler.Execute(command)) != ERROR_SUCCESS)
+				break;
+		}
+
+		channel.reset();
+	}
+
+	// The listener is stopped by the destructor, otherwise the daemon must not run without the endpoint.
+	if (!m_Requested && status != ERROR_INVALID_HANDLE)
+		spdlog::error("Control endpoint failed. GetLastError={}.", status);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Shutdown = true;
+	}
+
+	m_Condition.notify_all();
+}
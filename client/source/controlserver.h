@@ -0,0 +1,41 @@
+#ifndef CLIENT_CONTROL_SERVER_H_
+#define CLIENT_CONTROL_SERVER_H_
+
+// Serves the local control endpoint of the daemon.
+// The clients are accepted one by one on a dedicated thread, and every
+// command is executed by the control handler against the live core.
+class ControlServer
+{
+public:
+	// Deleted default constructor.
+	ControlServer() = delete;
+	// Stops the listener and the serve thread.
+	~ControlServer();
+	// Deleted copy constructor.
+	ControlServer(const ControlServer&) = delete;
+	// Deleted copy assigment.
+	ControlServer& operator=(const ControlServer&) = delete;
+
+	// ControlServer constructor.
+	// @param listener - control endpoint.
+	// @param core - running core.
+	// @param parser - parser of the config command arguments.
+	ControlServer(_In_ std::unique_ptr<AbstractControlListener> listener, _In_ AbstractCore& core, _In_ ControlHandler::ConfigParser parser);
+
+	// Waits for the shutdown command.
+	void Wait();
+
+private:
+	// Serve thread routine.
+	void ServeThread();
+
+	std::unique_ptr<AbstractControlListener>	m_Listener;		// Control endpoint.
+	ControlHandler														m_Handler;		// Control commands.
+	bool																			m_Requested;	// true - the shutdown command is received. Used by the serve thread.
+	std::mutex																m_Mutex;			// Locks the shutdown flag.
+	std::condition_variable										m_Condition;	// Wakes Wait.
+	bool																			m_Shutdown;		// true - the shutdown reply is sent or the listener has failed.
+	std::thread																m_Thread;			// Serve thread.
+};
+
+#endif // !CLIENT_CONTROL_SERVER_H_
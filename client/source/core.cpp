@@ -3,99 +3,205 @@
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 Core::~Core()
 {
+	// The injections of the started processes need the server.
+	if (m_Watcher)
+		m_Watcher->Stop();
+
+	m_Queue.reset();
 	m_Server->Stop();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-Core::Core(const std::unordered_set<DWORD>& pids, const std::unordered_set<std::string>& names, const BaseConfigManager::Config& config) :
-	m_Server{ Server::Create() }
+Core::Core(const std::unordered_set<DWORD>& pids, const std::unordered_set<std::string>& names, const BaseConfigManager::Config& config, const BaseConfigManager::Rules& rules) :
+	m_Sink{ std::make_shared<ReportSink>(REPORT_SINK_CAPACITY_) },
+	m_Server{ Server::Create() },
+	m_PayloadPath{ GetPayloadFullPath() }
 {
+	m_Pipeline = std::make_unique<InjectionPipeline>(INJECTION_WORKERS_, [this](DWORD pid)
+	{
+		auto config = BaseConfigManager::Config();
+		auto rules	= BaseConfigManager::Rules();
+
+		// The config is read when the process is injected, the injection may be queued for a while.
+		m_Server->GetConfig(config, rules);
+
+		return std::make_unique<ProcessInjection>(pid, m_PayloadPath, m_Server, m_Sink, config);
+	});
+
+	// The watcher is started before the snapshot, so no process is missed between them.
+	WatchProcesses(names);
+
 	auto processIds = pids;
 	auto namesIds		= GetPidsFromNames(names);
 
 	processIds.insert(namesIds.begin(), namesIds.end());
 
-	auto injectedPids = InjectIntoProcesses(processIds, config);
-	if (injectedPids.empty())
+	// The redirectors read the config from the config section once they are loaded.
+	m_Server->PublishConfig(config, rules);
+
+	auto injectedPids = InjectIntoProcesses(processIds);
+	if (injectedPids.empty() && !processIds.empty())
 		spdlog::error("No one process is proxied.");
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::Wait(_In_opt_ DWORD timeout)
+{
+	// The processes started later are injected while the watcher runs, even if no session is left.
+	if (m_Watcher)
+	{
+		if (!m_Watcher->Wait(timeout))
+			return;
+
+		spdlog::warn("Process watcher has stopped, processes started later are not proxied.");
+	}
+
+	m_Server->Wait(timeout);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Core::Attach(_In_ DWORD pid)
+{
+	return !InjectIntoProcesses({ pid }).empty();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Core::Detach(_In_ DWORD pid)
+{
+	auto session = m_Server->GetSession(pid);
+	if (!session)
+		return false;
+
+	session->Stop();
+	m_Server->DeleteSession(pid);
+
+	spdlog::info("Session {} is detached. Reports={}.", pid, session->GetReportCount());
+	return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::unordered_set<DWORD> Core::GetPidsFromNames(_In_ const std::unordered_set<std::string>& names)
 {
-	auto result = std::unordered_set<DWORD>();
+	if (names.empty())
+		return { };
 
-	for (const auto& name : names)
-	{
-		auto pid = Process::GetProcessIdByName(name.c_str());
+	auto matcher	= ProcessMatcher(names);
+	auto matched	= std::vector<bool>();
+	auto result		= Process::GetProcessIdsByNames(matcher, matched);
 
-		if (pid == Process::G_INVALID_PROCESS_ID) 
-			spdlog::warn("Failed to get ID of process {}.", name);
-		else
-			result.insert(pid);
+	for (size_t i = 0; i < matched.size(); ++i)
+	{
+		if (!matched[i])
+			spdlog::warn("Failed to get ID of process {}.", matcher.GetPattern(i));
 	}
 
 	return result;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::unordered_set<DWORD> Core::InjectIntoProcesses(_In_ const std::unordered_set<DWORD>& pids, _In_ const BaseConfigManager::Config& config)
+void Core::WatchProcesses(_In_ const std::unordered_set<std::string>& names)
+{
+	if (names.empty())
+		return;
+
+	m_Matcher = std::make_unique<ProcessMatcher>(names);
+	m_Queue		= std::make_unique<InjectionQueue>(INJECTION_QUEUE_CAPACITY_, INJECTION_WORKERS_, [this](DWORD pid)
+	{
+		// The process is injected by the startup snapshot or by the control command.
+		return m_Server->GetSession(pid) != nullptr || Attach(pid);
+	});
+
+	try
+	{
+		m_Watcher = std::make_unique<EtwProcessWatcher>([this](DWORD pid, std::chrono::system_clock::time_point created)
+		{
+			OnProcessStarted(pid, created);
+		});
+	}
+	catch (const std::runtime_error& error)
+	{
+		spdlog::error("RuntimeError: {}.", error.what());
+		spdlog::warn("Processes started later are not proxied.");
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Core::OnProcessStarted(_In_ DWORD pid, _In_ std::chrono::system_clock::time_point created)
+{
+	auto name = std::string();
+
+	if (Process::GetProcessName(pid, name) && m_Matcher->Match(name.c_str()))
+		m_Queue->Push(pid, created);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::unordered_set<DWORD> Core::InjectIntoProcesses(_In_ const std::unordered_set<DWORD>& pids)
 {
 	auto	injectedPids	= std::unordered_set<DWORD>();
-	auto	payloadPath		= GetPayloadFullPath();
+	auto	claimedPids		= std::unordered_set<DWORD>();
+	auto	otherPids			= std::unordered_set<DWORD>();
 
-	if (!PathFileExistsW(payloadPath.c_str()))
+	if (!PathFileExistsW(m_PayloadPath.c_str()))
 	{
 		spdlog::error("Module redirector.dll not found.");
 		return {};
 	}
 
-	for (const auto& pid : pids)
+	// The session objects are named by the process id, so a process is injected by one call at once.
 	{
-		if (Process::GetRemoteLibraryBase(pid, PathFindFileNameW(const_cast<LPWSTR>(payloadPath.c_str()))))
-		{
-			spdlog::warn("Process {} already proxied.", pid);
-			continue;
-		}
+		std::lock_guard<std::mutex> lock(m_InjectingMutex);
 
-		try
+		for (auto pid : pids)
 		{
-			auto session = Session::Create(pid, m_Server);
-			if (DoInject(pid, payloadPath))
-			{
-				spdlog::info("Proxy module injection success into process {}.", pid);
-				session->UpdateConfig(config);
-				m_Server->AddSession(session);
-				injectedPids.insert(pid);
-			}
+			if (m_Injecting.insert(pid).second)
+				claimedPids.insert(pid);
+			else
+				otherPids.insert(pid);
 		}
-		catch (const std::runtime_error& error)
+	}
+
+	for (const auto& result : m_Pipeline->Run(claimedPids))
+	{
+		const auto& timings = result.m_Timings;
+
+		if (!result.m_Succeeded)
 		{
-			spdlog::error("RuntimeError: {}.", error.what());
+			spdlog::error("Proxy module injection into process {} failed at stage {}.", result.m_Pid, InjectionPipeline::GetStageName(result.m_Stage));
+			continue;
 		}
+
+		spdlog::info("Proxy module injection success into process {}. Stages open={}us load={}us ready={}us configured={}us.", 
+			result.m_Pid, timings[0], timings[1], timings[2], timings[3]);
+
+		injectedPids.insert(result.m_Pid);
 	}
 
-	return injectedPids;
-}
+	{
+		std::lock_guard<std::mutex> lock(m_InjectingMutex);
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool Core::DoInject(_In_ DWORD pid, _In_ const std::wstring& module)
-{
-	auto targetProcess = Process();
+		for (auto pid : claimedPids)
+			m_Injecting.erase(pid);
+	}
 
-	if (!targetProcess.Open(pid, PROCESS_ALL_ACCESS))
+	m_InjectingCondition.notify_all();
+
+	// A process injected by another call is proxied if that injection has succeeded.
+	if (!otherPids.empty())
 	{
-		spdlog::error("Failed to open process {}.", pid);
-		return false;
+		std::unique_lock<std::mutex> lock(m_InjectingMutex);
+
+		m_InjectingCondition.wait(lock, [&]() {
+			return std::none_of(otherPids.begin(), otherPids.end(), [&](DWORD pid) { return m_Injecting.count(pid) != 0; });
+		});
 	}
 
-	if (!targetProcess.RemoteLoadLibrary(module.c_str()))
+	for (auto pid : otherPids)
 	{
-		spdlog::error("Failed to load module into process {}.", pid);
-		return false;
+		if (m_Server->SessionExists(pid))
+			injectedPids.insert(pid);
 	}
 
-	return true;
+	return injectedPids;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
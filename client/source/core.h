@@ -8,6 +8,15 @@ class Core : public AbstractCore
 {
 	static constexpr wchar_t PAYLOAD_NAME_[] = L"redirector.dll";
 
+	// Count of connection reports queued in the report sink at most.
+	static constexpr size_t REPORT_SINK_CAPACITY_ = 65536;
+
+	// Count of started processes waiting for the injection at most.
+	static constexpr size_t INJECTION_QUEUE_CAPACITY_ = 256;
+
+	// Count of processes injected at once at most.
+	static constexpr size_t INJECTION_WORKERS_ = 8;
+
 public:
 	// Deleted default constructor.
 	Core() = delete;
@@ -15,21 +24,25 @@ public:
 	~Core();
 
 	// Core constructor.
+	// The processes started later and matching the names are injected while the core runs.
+	// Throws runtime_error if the server is not created.
 	// @param pids - target processess ids.
 	// @param names - target processess names.
 	// @param config - app base config.
-	Core(const std::unordered_set<DWORD>& pids, const std::unordered_set<std::string>& names, const BaseConfigManager::Config& config);
+	// @param rules - routing rules.
+	Core(const std::unordered_set<DWORD>& pids, const std::unordered_set<std::string>& names, const BaseConfigManager::Config& config, const BaseConfigManager::Rules& rules);
 
 	// Waiting for all sessions to be terminated.
+	// While the process watcher runs, waits for the watcher instead, as the processes
+	// started later are still injected.
 	// @param timeout - time in milliseconds. default INFINITE.
-	void Wait(_In_opt_ DWORD timeout = INFINITE) override {
-		m_Server->Wait(timeout);
-	}
+	void Wait(_In_opt_ DWORD timeout = INFINITE) override;
 
 	// Sends config update event.
 	// @param config - new configuration.
-	void UpdateConfig(const BaseConfigManager::Config& config) override {
-		m_Server->UpdateConfig(config);
+	// @param rules - new routing rules.
+	void UpdateConfig(const BaseConfigManager::Config& config, const BaseConfigManager::Rules& rules) override {
+		m_Server->UpdateConfig(config, rules);
 	}
 
 	// Returns count of sessions.
@@ -37,27 +50,60 @@ public:
 		return m_Server->CountOfSessions();
 	}
 
+	// Injects into the process with the running config.
+	// @param pid - process id.
+	// @returns true if the process is proxied.
+	bool Attach(_In_ DWORD pid) override;
+
+	// Stops the session of the process, the redirector unloads itself.
+	// @param pid - process id.
+	// @returns false if there is no session of the process.
+	bool Detach(_In_ DWORD pid) override;
+
+	// Returns statistics of the automatic injection of the started processes.
+	InjectionQueue::Statistics GetInjectionStatistics() const override {
+		return m_Queue ? m_Queue->GetStatistics() : InjectionQueue::Statistics{ };
+	}
+
+	// Returns server instance.
+	std::shared_ptr<AbstractServer> GetServer() const noexcept override {
+		return m_Server;
+	}
+
 private:
-	// Returns a list of process identifiers by process name.
-	// @param names - processes names.
+	// Returns identifiers of all processes matching the names.
+	// @param names - processes names with wildcards.
 	std::unordered_set<DWORD> GetPidsFromNames(_In_ const std::unordered_set<std::string>& names);
 
-	// Injects the proxy module into the process list.
+	// Starts watching the started processes matching the names.
+	// @param names - processes names with wildcards.
+	void WatchProcesses(_In_ const std::unordered_set<std::string>& names);
+
+	// Queues the started process if it matches the names.
+	// @param pid - process id.
+	// @param created - process creation time.
+	void OnProcessStarted(_In_ DWORD pid, _In_ std::chrono::system_clock::time_point created);
+
+	// Injects the proxy module into the processes concurrently with the running config.
+	// Called from several threads at once, a process being injected by another call is waited for
+	// and counted as injected if that call has proxied it.
 	// @param pids - processess ids.
-	// @param config - app base config.
 	// @returns list of injected processes ids.
-	std::unordered_set<DWORD> InjectIntoProcesses(_In_ const std::unordered_set<DWORD>& pids, _In_ const BaseConfigManager::Config& config);
-
-	// Injects the specified module into the specified process.
-	// @param pid - target process id.
-	// @param module - full path to module to be loaded.
-	// @returns true if success.
-	bool DoInject(_In_ DWORD pid, _In_ const std::wstring& module);
+	std::unordered_set<DWORD> InjectIntoProcesses(_In_ const std::unordered_set<DWORD>& pids);
 
 	// Returns full path to payload module.
 	std::wstring GetPayloadFullPath();
 
-	std::shared_ptr<AbstractServer> m_Server; // Server instance.
+	std::shared_ptr<ReportSink>							m_Sink;								// Sink of connection reports of all sessions.
+	std::shared_ptr<AbstractServer>					m_Server;							// Server instance.
+	std::wstring														m_PayloadPath;				// Full path to payload module.
+	std::unique_ptr<InjectionPipeline>			m_Pipeline;						// Injection pipeline shared by all injections.
+	std::mutex															m_InjectingMutex;			// Locks the injected processes.
+	std::condition_variable									m_InjectingCondition;	// Signaled when processes are not injected anymore.
+	std::unordered_set<DWORD>								m_Injecting;					// Processes being injected.
+	std::unique_ptr<ProcessMatcher>					m_Matcher;						// Names of the processes injected when started.
+	std::unique_ptr<InjectionQueue>					m_Queue;							// Started processes waiting for the injection.
+	std::unique_ptr<AbstractProcessWatcher>	m_Watcher;						// Watcher of the started processes.
 };
 
 #endif // !CLIENT_CORE_H_
@@ -0,0 +1,132 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EtwProcessWatcher::EtwProcessWatcher(_In_ Callback callback) :
+	m_Callback{ callback },
+	m_Name{ ObjectNames::GetProcessTraceName() },
+	m_Properties(sizeof(EVENT_TRACE_PROPERTIES) + (m_Name.size() + 1) * sizeof(wchar_t)),
+	m_Session{ 0 },
+	m_Trace{ INVALID_PROCESSTRACE_HANDLE },
+	m_StopEvent{ CreateEventW(nullptr, true, false, nullptr) },
+	m_StoppedEvent{ CreateEventW(nullptr, true, false, nullptr) }
+{
+	if (!m_StopEvent.get() || !m_StoppedEvent.get())
+		throw std::runtime_error("Failed to create process watcher stop event.");
+
+	auto properties = GetProperties();
+
+	// The session is global, a session left by a crashed client is stopped.
+	ControlTraceW(0, m_Name.c_str(), properties, EVENT_TRACE_CONTROL_STOP);
+
+	std::fill(m_Properties.begin(), m_Properties.end(), BYTE{ 0 });
+	properties->Wnode.BufferSize		= static_cast<ULONG>(m_Properties.size());
+	properties->Wnode.Flags					= WNODE_FLAG_TRACED_GUID;
+	properties->Wnode.ClientContext = 1;
+	properties->LogFileMode					= EVENT_TRACE_REAL_TIME_MODE;
+	properties->FlushTimer					= 1;
+	properties->LoggerNameOffset		= sizeof(EVENT_TRACE_PROPERTIES);
+
+	if (auto status = StartTraceW(&m_Session, m_Name.c_str(), properties); status != ERROR_SUCCESS)
+		throw std::runtime_error("Failed to start process trace session, status " + std::to_string(status));
+
+	if (EnableTraceEx2(m_Session, &PROVIDER_, EVENT_CONTROL_CODE_ENABLE_PROVIDER, TRACE_LEVEL_INFORMATION, PROCESS_KEYWORD_, 0, 0, nullptr) != ERROR_SUCCESS)
+	{
+		ControlTraceW(m_Session, nullptr, GetProperties(), EVENT_TRACE_CONTROL_STOP);
+		throw std::runtime_error("Failed to enable process provider");
+	}
+
+	auto logFile = EVENT_TRACE_LOGFILEW{ 0 };
+	logFile.LoggerName					= m_Name.data();
+	logFile.ProcessTraceMode		= PROCESS_TRACE_MODE_REAL_TIME | PROCESS_TRACE_MODE_EVENT_RECORD;
+	logFile.EventRecordCallback = &EtwProcessWatcher::OnEvent;
+	logFile.Context							= this;
+
+	m_Trace = OpenTraceW(&logFile);
+	if (m_Trace == INVALID_PROCESSTRACE_HANDLE)
+	{
+		ControlTraceW(m_Session, nullptr, GetProperties(), EVENT_TRACE_CONTROL_STOP);
+		throw std::runtime_error("Failed to open process trace session");
+	}
+
+	m_Thread	= std::thread([this]()
+	{
+		// ProcessTrace returns when the session is stopped or closed by the system.
+		ProcessTrace(&m_Trace, 1, nullptr, nullptr);
+		SetEvent(m_StoppedEvent.get());
+	});
+	m_Flusher = std::thread(&EtwProcessWatcher::FlushThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EtwProcessWatcher::~EtwProcessWatcher()
+{
+	Stop();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EtwProcessWatcher::Stop()
+{
+	SetEvent(m_StopEvent.get());
+
+	if (m_Flusher.joinable())
+		m_Flusher.join();
+
+	// ProcessTrace returns when the session is stopped.
+	if (m_Session != 0)
+	{
+		ControlTraceW(m_Session, nullptr, GetProperties(), EVENT_TRACE_CONTROL_STOP);
+		m_Session = 0;
+	}
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+
+	if (m_Trace != INVALID_PROCESSTRACE_HANDLE)
+	{
+		CloseTrace(m_Trace);
+		m_Trace = INVALID_PROCESSTRACE_HANDLE;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EtwProcessWatcher::Wait(_In_ DWORD timeout)
+{
+	return WaitForSingleObject(m_StoppedEvent.get(), timeout) == WAIT_OBJECT_0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EVENT_TRACE_PROPERTIES* EtwProcessWatcher::GetProperties() noexcept
+{
+	return reinterpret_cast<EVENT_TRACE_PROPERTIES*>(m_Properties.data());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void WINAPI EtwProcessWatcher::OnEvent(_In_ PEVENT_RECORD record)
+{
+	auto watcher = static_cast<EtwProcessWatcher*>(record->UserContext);
+	auto pid		 = DWORD{ 0 };
+	auto created = ULONGLONG{ 0 };
+
+	if (!IsEqualGUID(record->EventHeader.ProviderId, PROVIDER_) || record->EventHeader.EventDescriptor.Id != PROCESS_START_EVENT_)
+		return;
+
+	// ProcessID and CreateTime lead the event data of every ProcessStart version.
+	if (record->UserDataLength < sizeof(pid) + sizeof(created))
+		return;
+
+	std::memcpy(&pid, record->UserData, sizeof(pid));
+	std::memcpy(&created, static_cast<const BYTE*>(record->UserData) + sizeof(pid), sizeof(created));
+
+	// FILETIME counts 100 nanoseconds since 1601, the system clock counts since 1970.
+	auto sinceEpoch = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+		std::chrono::duration<long long, std::ratio<1, 10000000>>(static_cast<long long>(created) - 116444736000000000LL));
+
+	watcher->m_Callback(pid, std::chrono::system_clock::time_point(sinceEpoch));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EtwProcessWatcher::FlushThread()
+{
+	while (WaitForSingleObject(m_StopEvent.get(), FLUSH_INTERVAL_) == WAIT_TIMEOUT)
+		ControlTraceW(m_Session, nullptr, GetProperties(), EVENT_TRACE_CONTROL_FLUSH);
+}
@@ -0,0 +1,64 @@
+#ifndef CLIENT_ETW_PROCESS_WATCHER_H_
+#define CLIENT_ETW_PROCESS_WATCHER_H_
+
+// Process watcher over the real-time ETW session of the kernel process provider.
+// The session is flushed every FLUSH_INTERVAL_ milliseconds, otherwise the events
+// are delivered when the session buffers are full or once per second.
+// Requires the administrator rights, as the injection itself.
+class EtwProcessWatcher : public AbstractProcessWatcher
+{
+	// Microsoft-Windows-Kernel-Process provider.
+	static constexpr GUID PROVIDER_ = { 0x22FB2CD6, 0x0E7B, 0x422B, { 0xA0, 0xC7, 0x2F, 0xAD, 0x1F, 0xD0, 0xE7, 0x16 } };
+	// WINEVENT_KEYWORD_PROCESS keyword of the provider.
+	static constexpr ULONGLONG PROCESS_KEYWORD_ = 0x10;
+	// ProcessStart event id.
+	static constexpr USHORT PROCESS_START_EVENT_ = 1;
+	// Time in milliseconds between the session flushes.
+	static constexpr DWORD FLUSH_INTERVAL_ = 20;
+
+public:
+	// Deleted default constructor.
+	EtwProcessWatcher() = delete;
+	// Stops the trace session.
+	~EtwProcessWatcher();
+	// Deleted copy constructor.
+	EtwProcessWatcher(const EtwProcessWatcher&) = delete;
+	// Deleted copy assigment.
+	EtwProcessWatcher& operator=(const EtwProcessWatcher&) = delete;
+
+	// EtwProcessWatcher constructor.
+	// Throws runtime_error if the trace session is not started.
+	// @param callback - started process callback.
+	explicit EtwProcessWatcher(_In_ Callback callback);
+
+	// Stops the trace session and waits for the watcher threads.
+	void Stop() override;
+
+	// Waits for the trace thread to exit.
+	// @param timeout - time in milliseconds.
+	// @returns true if the trace session has stopped.
+	bool Wait(_In_ DWORD timeout) override;
+
+private:
+	// Returns trace session properties, followed by the session name.
+	EVENT_TRACE_PROPERTIES* GetProperties() noexcept;
+
+	// Event callback, called from the trace thread.
+	// @param record - event record.
+	static void WINAPI OnEvent(_In_ PEVENT_RECORD record);
+
+	// Flush thread routine.
+	void FlushThread();
+
+	Callback						m_Callback;			// Started process callback.
+	std::wstring				m_Name;					// Trace session name.
+	std::vector<BYTE>		m_Properties;		// Trace session properties.
+	TRACEHANDLE					m_Session;			// Trace session handle.
+	TRACEHANDLE					m_Trace;				// Consumer handle.
+	WinPipe::WinHandle	m_StopEvent;		// Stops the flush thread.
+	WinPipe::WinHandle	m_StoppedEvent;	// Set when the trace thread exits.
+	std::thread					m_Thread;				// Trace thread, processes the events.
+	std::thread					m_Flusher;			// Flush thread.
+};
+
+#endif // !CLIENT_ETW_PROCESS_WATCHER_H_
@@ -0,0 +1,121 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EventLoop::EventLoop(_In_ size_t threads) :
+	m_Port{ CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, static_cast<DWORD>(threads)) }
+{
+	if (!m_Port.get())
+		throw std::runtime_error("Failed to create event loop completion port.");
+
+	for (size_t i = 0; i < threads; ++i)
+		m_Threads.emplace_back(&EventLoop::LoopThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+EventLoop::~EventLoop()
+{
+	auto transferred	= DWORD{ 0 };
+	auto key					= ULONG_PTR{ 0 };
+	auto overlapped		= static_cast<OVERLAPPED*>(nullptr);
+
+	for (size_t i = 0; i < m_Threads.size(); ++i)
+		PostQueuedCompletionStatus(m_Port.get(), 0, STOP_KEY_, nullptr);
+
+	for (auto& thread : m_Threads)
+	{
+		if (thread.joinable())
+			thread.join();
+	}
+
+	// Dropping the callbacks queued after the stop packets.
+	while (GetQueuedCompletionStatus(m_Port.get(), &transferred, &key, &overlapped, 0) || overlapped)
+	{
+		auto task = std::unique_ptr<Task>(reinterpret_cast<Task*>(overlapped));
+
+		if (task->m_Wait)
+			UnregisterWaitEx(task->m_Wait, nullptr);
+
+		overlapped = nullptr;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EventLoop::Post(_In_ Callback callback)
+{
+	auto task = new Task{ std::move(callback), m_Port.get(), nullptr, ERROR_SUCCESS, 1 };
+
+	if (!PostQueuedCompletionStatus(m_Port.get(), 0, 0, reinterpret_cast<OVERLAPPED*>(task)))
+	{
+		delete task;
+		return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EventLoop::Wait(_In_ HANDLE object, _In_ DWORD timeout, _In_ Callback callback)
+{
+	// The task is queued when both the registration has returned and the wait has fired,
+	// so the loop thread always sees the wait handle it has to unregister.
+	auto task = new Task{ std::move(callback), m_Port.get(), nullptr, ERROR_SUCCESS, 2 };
+
+	if (!RegisterWaitForSingleObject(&task->m_Wait, object, &EventLoop::OnWait, task, timeout, WT_EXECUTEONLYONCE))
+	{
+		delete task;
+		return false;
+	}
+
+	if (task->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		Queue(task);
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EventLoop::LoopThread()
+{
+	for (;;)
+	{
+		auto transferred	= DWORD{ 0 };
+		auto key					= ULONG_PTR{ 0 };
+		auto overlapped		= static_cast<OVERLAPPED*>(nullptr);
+
+		if (!GetQueuedCompletionStatus(m_Port.get(), &transferred, &key, &overlapped, INFINITE) && !overlapped)
+			break;
+
+		if (key == STOP_KEY_)
+			break;
+
+		auto task = std::unique_ptr<Task>(reinterpret_cast<Task*>(overlapped));
+
+		// The wait is executed only once, but its registration must be released.
+		if (task->m_Wait)
+			UnregisterWaitEx(task->m_Wait, nullptr);
+
+		task->m_Callback(task->m_Status);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void EventLoop::Queue(_In_ Task* task) noexcept
+{
+	if (!PostQueuedCompletionStatus(task->m_Port, 0, 0, reinterpret_cast<OVERLAPPED*>(task)))
+	{
+		if (task->m_Wait)
+			UnregisterWaitEx(task->m_Wait, nullptr);
+
+		delete task;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VOID CALLBACK EventLoop::OnWait(_In_ PVOID context, _In_ BOOLEAN timedOut)
+{
+	auto task = static_cast<Task*>(context);
+
+	task->m_Status = timedOut ? WAIT_TIMEOUT : ERROR_SUCCESS;
+
+	if (task->m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		Queue(task);
+}
@@ -0,0 +1,62 @@
+#ifndef CLIENT_EVENT_LOOP_H_
+#define CLIENT_EVENT_LOOP_H_
+
+// Event loop over an I/O completion port.
+// The posted callbacks are queued to the port as completion packets. The object waits
+// are registered in the system thread pool, which waits for many objects per thread,
+// and the fired waits are queued to the port, so every callback runs on a loop thread.
+class EventLoop : public AbstractEventLoop
+{
+	// Queued callback.
+	struct Task
+	{
+		Callback						m_Callback;	// Callback.
+		HANDLE							m_Port;			// Completion port the task is queued to.
+		HANDLE							m_Wait;			// Wait registration. nullptr - the task is posted.
+		WinPipe::WinError		m_Status;		// Status passed to the callback.
+		std::atomic<int>		m_Pending;	// Count of steps left before the task is queued.
+	};
+
+	// Completion key of the packets that stop the loop threads.
+	static constexpr ULONG_PTR STOP_KEY_ = 1;
+
+public:
+	// Deleted default constructor.
+	EventLoop() = delete;
+	// Stops the loop threads and drops the queued callbacks.
+	// The waits must be finished, e.g. by stopping the sessions.
+	~EventLoop();
+	// Deleted copy constructor.
+	EventLoop(const EventLoop&) = delete;
+	// Deleted copy assigment.
+	EventLoop& operator=(const EventLoop&) = delete;
+
+	// EventLoop constructor.
+	// Throws runtime_error if the completion port is not created.
+	// @param threads - count of loop threads.
+	explicit EventLoop(_In_ size_t threads);
+
+	// Runs the callback on a loop thread.
+	bool Post(_In_ Callback callback) override;
+
+	// Runs the callback on a loop thread once the object is signaled or the timeout elapses.
+	bool Wait(_In_ HANDLE object, _In_ DWORD timeout, _In_ Callback callback) override;
+
+private:
+	// Loop thread routine.
+	void LoopThread();
+
+	// Queues the task to its completion port.
+	// @param task - task to queue. Released if it is not queued.
+	static void Queue(_In_ Task* task) noexcept;
+
+	// Queues the task of the fired wait. Called from the system thread pool.
+	// @param context - task.
+	// @param timedOut - true if the wait has timed out.
+	static VOID CALLBACK OnWait(_In_ PVOID context, _In_ BOOLEAN timedOut);
+
+	WinPipe::WinHandle				m_Port;			// Completion port.
+	std::vector<std::thread>	m_Threads;	// Loop threads.
+};
+
+#endif // !CLIENT_EVENT_LOOP_H_
@@ -5,28 +5,69 @@
 #include <Windows.h>
 #include <Shlwapi.h>
 #include <TlHelp32.h>
+#include <evntrace.h>
+#include <evntcons.h>
+#include <climits>
 #include <memory>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
 #include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
 #include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <unordered_set>
+#include <unordered_map>
 #include <stdexcept>
 
 #include "winpipe/basepipe.hpp"
 #include "winpipe/server.hpp"
+#include "winpipe/client.hpp"
 #include "common/baseconfig.hpp"
 #include "common/objectnames.hpp"
+#include "common/seqlock.hpp"
+#include "common/configformat.hpp"
+#include "common/configsection.hpp"
+#include "common/reportring.hpp"
+#include "common/reporttransport.hpp"
 
 #pragma warning(push)
 #pragma warning(disable: 4996)
 #include "spdlog/spdlog.h"
 #pragma warning(pop)
 
+#include "processmatcher.h"
 #include "process.h"
+#include "reportsink.h"
+#include "configdiff.h"
+#include "configwatcher.h"
+#include "injectionqueue.h"
+#include "baseprocesswatcher.h"
+#include "etwprocesswatcher.h"
+#include "baseeventloop.h"
 #include "basesession.h"
 #include "baseserver.h"
 #include "basecore.h"
+#include "eventloop.h"
+#include "basesessiontracker.h"
+#include "sessiontracker.h"
+#include "sessionregistry.h"
+#include "sessionreaper.h"
 #include "session.h"
 #include "server.h"
+#include "injectionpipeline.h"
+#include "processinjection.h"
 #include "core.h"
+#include "basecontrol.h"
+#include "pipecontrol.h"
+#include "controlhandler.h"
+#include "controlserver.h"
 
 #endif // !CLIENT_GLOBAL_H_
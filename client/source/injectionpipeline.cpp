@@ -0,0 +1,87 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+InjectionPipeline::InjectionPipeline(_In_ size_t workers, _In_ Factory factory) :
+	m_Workers{ (std::max)(workers, size_t{ 1 }) },
+	m_Factory{ factory }
+{ }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<InjectionPipeline::Result> InjectionPipeline::Run(_In_ const std::unordered_set<DWORD>& pids)
+{
+	auto queue		= std::vector<DWORD>(pids.begin(), pids.end());
+	auto results	= std::vector<Result>(queue.size());
+	auto skipped	= std::vector<bool>(queue.size(), false);
+	auto next			= std::atomic<size_t>{ 0 };
+	auto workers	= std::vector<std::thread>();
+
+	// Every worker takes the next process, so a slow process does not hold the others.
+	auto worker = [&]()
+	{
+		for (auto index = next++; index < queue.size(); index = next++)
+		{
+			auto& result = results[index];
+
+			result = Result{ queue[index], false, Stage::Open, { } };
+
+			auto injection = m_Factory(queue[index]);
+			if (!injection)
+			{
+				skipped[index] = true;
+				continue;
+			}
+
+			Inject(*injection, result);
+		}
+	};
+
+	for (size_t i = 1; i < (std::min)(m_Workers, queue.size()); ++i)
+		workers.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : workers)
+		thread.join();
+
+	auto kept = std::vector<Result>();
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		if (!skipped[i])
+			kept.push_back(results[i]);
+	}
+
+	return kept;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* InjectionPipeline::GetStageName(_In_ Stage stage) noexcept
+{
+	switch (stage)
+	{
+		case Stage::Open:				return "open";
+		case Stage::Load:				return "load";
+		case Stage::Ready:			return "ready";
+		case Stage::Configured: return "configured";
+	}
+
+	return "unknown";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void InjectionPipeline::Inject(_In_ AbstractInjection& injection, _Inout_ Result& result)
+{
+	for (size_t i = 0; i < STAGES_; ++i)
+	{
+		auto stage	= static_cast<Stage>(i);
+		auto start	= std::chrono::steady_clock::now();
+		auto passed = injection.Run(stage);
+
+		result.m_Stage			= stage;
+		result.m_Timings[i] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		if (!passed)
+			return;
+	}
+
+	result.m_Succeeded = true;
+}
@@ -0,0 +1,84 @@
+#ifndef CLIENT_INJECTION_PIPELINE_H_
+#define CLIENT_INJECTION_PIPELINE_H_
+
+// Injects the processes concurrently on a pool of worker threads.
+// Every process goes through the stages in order, a failed stage ends its injection,
+// and every stage is timed. The stages are run by the backend injection, so the
+// scheduling is the same for the real processes and for a mock backend.
+class InjectionPipeline
+{
+public:
+	// Injection stage.
+	enum class Stage : uint8_t
+	{
+		Open,				// The process is opened and its session is created.
+		Load,				// The redirector is loaded by the process.
+		Ready,			// The redirector has installed the hooks.
+		Configured	// The redirector has applied the config.
+	};
+
+	// Count of the stages.
+	static constexpr size_t STAGES_ = 4;
+
+	// Injection of a single process, created by the backend.
+	class AbstractInjection
+	{
+	public:
+		// Default virtual destructor.
+		virtual ~AbstractInjection() = default;
+
+		// Runs the stage. The stages are run in order on the same worker thread.
+		// @param stage - injection stage.
+		// @returns false if the stage failed.
+		virtual bool Run(_In_ Stage stage) = 0;
+	};
+
+	// Creates the injection of the process.
+	// @param pid - process id.
+	// @returns injection or nullptr if the process must not be injected.
+	using Factory = std::function<std::unique_ptr<AbstractInjection>(DWORD pid)>;
+
+	// Injection result of a process.
+	struct Result
+	{
+		DWORD											m_Pid;				// Process id.
+		bool											m_Succeeded;	// true - all stages succeeded.
+		Stage											m_Stage;			// The last run stage, the failed one if the injection failed.
+		std::array<long long, STAGES_>	m_Timings;		// Duration of every stage in microseconds. 0 - the stage was not run.
+	};
+
+	// Deleted default constructor.
+	InjectionPipeline() = delete;
+	// Default destructor.
+	~InjectionPipeline() = default;
+	// Deleted copy constructor.
+	InjectionPipeline(const InjectionPipeline&) = delete;
+	// Deleted copy assigment.
+	InjectionPipeline& operator=(const InjectionPipeline&) = delete;
+
+	// InjectionPipeline constructor.
+	// @param workers - count of processes injected at once at most.
+	// @param factory - injection factory. Called from the worker threads.
+	InjectionPipeline(_In_ size_t workers, _In_ Factory factory);
+
+	// Injects the processes and waits for all of them.
+	// May be called from several threads at once, every call runs its own workers.
+	// @param pids - processes ids.
+	// @returns results of the processes, the skipped processes are not included.
+	std::vector<Result> Run(_In_ const std::unordered_set<DWORD>& pids);
+
+	// Returns name of the stage.
+	// @param stage - injection stage.
+	static const char* GetStageName(_In_ Stage stage) noexcept;
+
+private:
+	// Runs all stages of the process injection.
+	// @param injection - process injection.
+	// @param result - injection result.
+	static void Inject(_In_ AbstractInjection& injection, _Inout_ Result& result);
+
+	size_t		m_Workers;	// Count of processes injected at once at most.
+	Factory		m_Factory;	// Injection factory.
+};
+
+#endif // !CLIENT_INJECTION_PIPELINE_H_
@@ -0,0 +1,124 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+InjectionQueue::InjectionQueue(_In_ size_t capacity, _In_ size_t workers, _In_ Injector injector) :
+	m_Capacity{ capacity },
+	m_Injector{ injector },
+	m_Next{ 0 },
+	m_Statistics{ },
+	m_Stop{ false }
+{
+	for (size_t i = 0; i < (std::max)(workers, size_t{ 1 }); ++i)
+		m_Threads.emplace_back(&InjectionQueue::WorkerThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+InjectionQueue::~InjectionQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+
+	m_Condition.notify_all();
+
+	for (auto& thread : m_Threads)
+		thread.join();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InjectionQueue::Push(_In_ DWORD pid, _In_ std::chrono::system_clock::time_point created)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_Stop)
+			return false;
+
+		auto pending = m_Pending.find(pid);
+		if (pending != m_Pending.end() && pending->second == created)
+			return false;
+
+		if (m_Items.size() >= m_Capacity)
+		{
+			++m_Statistics.m_Dropped;
+			spdlog::warn("Injection queue is full, process {} is dropped.", pid);
+			return false;
+		}
+
+		m_Pending[pid] = created;
+		m_Items.push_back(Item{ pid, created });
+	}
+
+	m_Condition.notify_one();
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+InjectionQueue::Statistics InjectionQueue::GetStatistics() const
+{
+	auto statistics = Statistics();
+	auto latencies	= std::vector<long long>();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		statistics	= m_Statistics;
+		latencies		= m_Latencies;
+	}
+
+	if (!latencies.empty())
+	{
+		std::sort(latencies.begin(), latencies.end());
+		statistics.m_P50 = latencies[latencies.size() * 50 / 100];
+		statistics.m_P99 = latencies[(std::min)(latencies.size() - 1, latencies.size() * 99 / 100)];
+	}
+
+	return statistics;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void InjectionQueue::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	for (;;)
+	{
+		m_Condition.wait(lock, [this]() { return m_Stop || !m_Items.empty(); });
+
+		if (m_Stop)
+			break;
+
+		auto item = m_Items.front();
+		m_Items.pop_front();
+
+		lock.unlock();
+
+		auto injected = m_Injector(item.m_Pid);
+		auto latency	= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - item.m_Created).count();
+
+		if (injected)
+			spdlog::info("Process {} is proxied {} ms after its start.", item.m_Pid, latency);
+
+		lock.lock();
+
+		// The id may be queued again for a newer process meanwhile.
+		auto pending = m_Pending.find(item.m_Pid);
+		if (pending != m_Pending.end() && pending->second == item.m_Created)
+			m_Pending.erase(pending);
+
+		if (!injected)
+		{
+			++m_Statistics.m_Failed;
+			continue;
+		}
+
+		++m_Statistics.m_Injected;
+
+		if (m_Latencies.size() < LATENCY_SAMPLES_)
+			m_Latencies.push_back(latency);
+		else
+			m_Latencies[m_Next] = latency;
+
+		m_Next = (m_Next + 1) % LATENCY_SAMPLES_;
+	}
+}
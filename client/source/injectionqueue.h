@@ -0,0 +1,78 @@
+#ifndef CLIENT_INJECTION_QUEUE_H_
+#define CLIENT_INJECTION_QUEUE_H_
+
+// Bounded queue of the processes waiting for the injection.
+// The worker threads inject the processes in order, several at once. A process that is queued or being
+// injected is not queued again. The process is identified by its id and creation time,
+// so a reused id is queued. The queue keeps the latency from the process creation to
+// the complete injection, after which the process connects through the proxy.
+class InjectionQueue
+{
+public:
+	// Injects the process. Called from the worker threads concurrently.
+	// @param pid - process id.
+	// @returns true if the process is proxied.
+	using Injector = std::function<bool(DWORD pid)>;
+
+	// Queue statistics.
+	struct Statistics
+	{
+		size_t		m_Injected;	// Count of proxied processes.
+		size_t		m_Failed;		// Count of processes failed to inject.
+		size_t		m_Dropped;	// Count of processes dropped by the full queue.
+		long long	m_P50;			// Median latency in milliseconds.
+		long long	m_P99;			// 99th percentile latency in milliseconds.
+	};
+
+	// Count of the latest latencies used for the percentiles.
+	static constexpr size_t LATENCY_SAMPLES_ = 1024;
+
+	// Deleted default constructor.
+	InjectionQueue() = delete;
+	// Stops the worker threads, the queued processes are dropped.
+	~InjectionQueue();
+	// Deleted copy constructor.
+	InjectionQueue(const InjectionQueue&) = delete;
+	// Deleted copy assigment.
+	InjectionQueue& operator=(const InjectionQueue&) = delete;
+
+	// InjectionQueue constructor.
+	// @param capacity - count of queued processes at most.
+	// @param workers - count of processes injected at once at most.
+	// @param injector - process injector.
+	InjectionQueue(_In_ size_t capacity, _In_ size_t workers, _In_ Injector injector);
+
+	// Queues the process.
+	// @param pid - process id.
+	// @param created - process creation time.
+	// @returns false if the process is already queued or the queue is full.
+	bool Push(_In_ DWORD pid, _In_ std::chrono::system_clock::time_point created);
+
+	// Returns queue statistics.
+	Statistics GetStatistics() const;
+
+private:
+	// Queued process.
+	struct Item
+	{
+		DWORD																	m_Pid;			// Process id.
+		std::chrono::system_clock::time_point	m_Created;	// Process creation time.
+	};
+
+	// Worker thread routine.
+	void WorkerThread();
+
+	size_t																										m_Capacity;		// Count of queued processes at most.
+	Injector																									m_Injector;		// Process injector.
+	mutable std::mutex																				m_Mutex;			// Locks the queue.
+	std::condition_variable																		m_Condition;	// Wakes the worker threads.
+	std::deque<Item>																					m_Items;			// Queued processes.
+	std::unordered_map<DWORD, std::chrono::system_clock::time_point>	m_Pending;		// Queued and injected processes.
+	std::vector<long long>																		m_Latencies;	// Latest latencies in milliseconds.
+	size_t																										m_Next;				// Next latency slot.
+	Statistics																								m_Statistics;	// Queue statistics, the percentiles are computed on request.
+	bool																											m_Stop;				// true - the worker threads must exit.
+	std::vector<std::thread>																	m_Threads;		// Worker threads.
+};
+
+#endif // !CLIENT_INJECTION_QUEUE_H_
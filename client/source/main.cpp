@@ -5,9 +5,25 @@
 static constexpr char G_ARGUMENT_PROC_PID_[]          = "--pid";
 static constexpr char G_ARGUMENT_PROC_NAME_[]         = "--name";
 static constexpr char G_ARGUMENT_LOG_ENABLE_[]        = "--enable-log";
+static constexpr char G_ARGUMENT_REPORT_POLICY_[]     = "--report-policy";
 static constexpr char G_ARGUMENT_PROXY_TYPE_[]        = "--proxy-type";
 static constexpr char G_ARGUMENT_PROXY_ADDRESS_V4_[]  = "--proxy-v4";
 static constexpr char G_ARGUMENT_PROXY_ADDRESS_V6_[]  = "--proxy-v6";
+static constexpr char G_ARGUMENT_SOCKS5_PIPELINING_[] = "--socks5-pipelining";
+static constexpr char G_ARGUMENT_UPSTREAM_[]          = "--upstream";
+static constexpr char G_ARGUMENT_RULE_[]              = "--rule";
+static constexpr char G_ARGUMENT_RULES_FILE_[]        = "--rules-file";
+static constexpr char G_ARGUMENT_CONFIG_FILE_[]       = "--config-file";
+static constexpr char G_ARGUMENT_DAEMON_[]            = "--daemon";
+static constexpr char G_ARGUMENT_CONTROL_[]           = "--control";
+
+// Arguments that select how the client runs.
+struct Options
+{
+  std::string m_ConfigFile; // Config file path. empty - the config is not watched.
+  bool        m_Daemon;     // true - the client runs until the shutdown control command.
+  std::string m_Control;    // Control command to send to the running daemon. empty - the client proxies the processes.
+};
 
 template <std::size_t S>
 constexpr std::size_t string_length(char const (&)[S]) { return S - 1; }
@@ -56,7 +72,159 @@ bool ExtractIPv6FromString(_In_ const std::string& address, _Out_ sockaddr_in6&
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool GetConfigFromArguments(_In_ int argc, _In_ const char** argv, _Out_ std::unordered_set<DWORD>& pids, _Out_ std::unordered_set<std::string>& names, _Out_ BaseConfigManager::Config& config)
+bool ExtractUpstreamFromString(_In_ const std::string& upstream, _Out_ BaseConfigManager::Upstream& buffer)
+{
+  // The upstream should be of the following form:
+  // 127.0.0.1:1080,5 or [::1]:1080,5, where 5 - optional weight.
+  static constexpr char weightDelimiter[] = ",";
+
+  auto weightPos  = upstream.find(weightDelimiter);
+  auto address    = upstream.substr(0, weightPos);
+  auto weight     = weightPos == std::string::npos ? 1 : std::atoi(upstream.substr(weightPos + string_length(weightDelimiter)).c_str());
+
+  if (weight <= 0 || weight > UCHAR_MAX)
+    return false;
+
+  std::memset(&buffer, 0, sizeof(buffer));
+  buffer.m_Weight = static_cast<BYTE>(weight);
+
+  if (!address.empty() && address.front() == '[')
+    return ExtractIPv6FromString(address, buffer.m_Address.Ipv6);
+
+  return ExtractIPv4FromString(address, buffer.m_Address.Ipv4);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ExtractRuleFromString(_In_ const std::string& rule, _Out_ BaseConfigManager::Rule& buffer)
+{
+  // The rule should be of the following form:
+  // 10.0.0.0/8=direct, fd00::/8,443=block or 0.0.0.0/0,8000-8080=proxy,
+  // where the port range is optional.
+  static constexpr char actionDelimiter[] = "=";
+  static constexpr char portDelimiter[]   = ",";
+  static constexpr char rangeDelimiter[]  = "-";
+  static constexpr char prefixDelimiter[] = "/";
+
+  auto actionPos  = rule.find(actionDelimiter);
+  if (actionPos == std::string::npos)
+    return false;
+
+  auto action     = rule.substr(actionPos + string_length(actionDelimiter));
+  auto target     = rule.substr(0, actionPos);
+  auto portPos    = target.find(portDelimiter);
+  auto ports      = portPos == std::string::npos ? std::string{} : target.substr(portPos + string_length(portDelimiter));
+  auto prefix     = target.substr(0, portPos);
+  auto prefixPos  = prefix.find(prefixDelimiter);
+  auto address    = prefix.substr(0, prefixPos);
+
+  std::memset(&buffer, 0, sizeof(buffer));
+
+  // Parsing action.
+  if      (action == "proxy")   buffer.m_Action = RuleAction::Proxy;
+  else if (action == "direct")  buffer.m_Action = RuleAction::Direct;
+  else if (action == "block")   buffer.m_Action = RuleAction::Block;
+  else
+    return false;
+
+  // Parsing prefix.
+  buffer.m_Family = address.find(':') == std::string::npos ? AF_INET : AF_INET6;
+
+  if (inet_pton(buffer.m_Family, address.c_str(), buffer.m_Address) != 1)
+    return false;
+
+  auto maxLength  = buffer.m_Family == AF_INET ? 32 : 128;
+  auto length     = prefixPos == std::string::npos ? maxLength : std::atoi(prefix.substr(prefixPos + string_length(prefixDelimiter)).c_str());
+
+  if (length < 0 || length > maxLength)
+    return false;
+
+  buffer.m_PrefixLength = static_cast<BYTE>(length);
+
+  // Parsing port range. All ports by default.
+  if (ports.empty())
+  {
+    buffer.m_PortFirst  = 0;
+    buffer.m_PortLast   = USHRT_MAX;
+    return true;
+  }
+
+  auto rangePos   = ports.find(rangeDelimiter);
+  auto first      = std::atoi(ports.substr(0, rangePos).c_str());
+  auto last       = rangePos == std::string::npos ? first : std::atoi(ports.substr(rangePos + string_length(rangeDelimiter)).c_str());
+
+  if (first < 0 || last > USHRT_MAX || first > last)
+    return false;
+
+  buffer.m_PortFirst  = static_cast<WORD>(first);
+  buffer.m_PortLast   = static_cast<WORD>(last);
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ExtractRulesFromFile(_In_ const std::string& path, _Inout_ BaseConfigManager::Rules& rules)
+{
+  // One rule per line, empty lines and lines starting with # are skipped.
+  auto file = std::ifstream(path);
+  auto line = std::string();
+  auto rule = BaseConfigManager::Rule();
+
+  if (!file.is_open())
+  {
+    std::cerr << "Failed to open rules file " << path << "." << std::endl;
+    return false;
+  }
+
+  for (size_t number = 1; std::getline(file, line); ++number)
+  {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    if (line.empty() || line.front() == '#')
+      continue;
+
+    if (!ExtractRuleFromString(line, rule))
+    {
+      std::cerr << "Failed to parse rule " << line << " at line " << number << "." << std::endl;
+      return false;
+    }
+
+    rules.push_back(rule);
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ExtractArgumentsFromFile(_In_ const std::string& path, _Inout_ std::vector<std::string>& arguments)
+{
+  // Arguments separated by whitespaces, empty lines and lines starting with # are skipped.
+  auto file = std::ifstream(path);
+  auto line = std::string();
+
+  if (!file.is_open())
+  {
+    std::cerr << "Failed to open config file " << path << "." << std::endl;
+    return false;
+  }
+
+  while (std::getline(file, line))
+  {
+    auto stream   = std::istringstream(line);
+    auto argument = std::string();
+
+    if (line.empty() || line.front() == '#')
+      continue;
+
+    while (stream >> argument)
+      arguments.push_back(argument);
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GetConfigFromArguments(_In_ const std::vector<std::string>& arguments, _Out_ std::unordered_set<DWORD>& pids, _Out_ std::unordered_set<std::string>& names, 
+  _Out_ BaseConfigManager::Config& config, _Out_ BaseConfigManager::Rules& rules, _Out_ Options& options, _In_opt_ bool withFile = true)
 {
   auto argumentParser = argparse::ArgumentParser("client.exe");
 
@@ -70,7 +238,7 @@ bool GetConfigFromArguments(_In_ int argc, _In_ const char** argv, _Out_ std::un
       .append();
 
     argumentParser.add_argument(G_ARGUMENT_PROC_NAME_)
-      .help("short filename of a process with wildcard matching to inject.")
+      .help("short filename of a process with wildcard matching to inject. processes started later are injected when they start.")
       .nargs(1, 6)
       .default_value(std::vector<std::string>{})
       .append();
@@ -80,6 +248,10 @@ bool GetConfigFromArguments(_In_ int argc, _In_ const char** argv, _Out_ std::un
       .default_value(false)
       .implicit_value(true);
 
+    argumentParser.add_argument(G_ARGUMENT_REPORT_POLICY_)
+      .help("behaviour of the full connection reports queue (drop-new, drop-oldest or block).")
+      .default_value(std::string{ "drop-new" });
+
     argumentParser.add_argument(G_ARGUMENT_PROXY_TYPE_)
       .help("proxy type (socks4 or socks5).")
       .default_value(std::string{ "socks4" });
@@ -91,12 +263,45 @@ bool GetConfigFromArguments(_In_ int argc, _In_ const char** argv, _Out_ std::un
     argumentParser.add_argument(G_ARGUMENT_PROXY_ADDRESS_V6_)
       .help("set a proxy IPv6 address for network connections.")
       .default_value(std::string{});
+
+    argumentParser.add_argument(G_ARGUMENT_SOCKS5_PIPELINING_)
+      .help("send socks5 greeting and connect request in one write.")
+      .default_value(false)
+      .implicit_value(true);
+
+    argumentParser.add_argument(G_ARGUMENT_UPSTREAM_)
+      .help("additional upstream proxy ip:port[,weight] or [ipv6]:port[,weight]. the fastest healthy upstream is used.")
+      .nargs(1, BaseConfigManager::MAX_UPSTREAMS_)
+      .default_value(std::vector<std::string>{})
+      .append();
+
+    argumentParser.add_argument(G_ARGUMENT_RULE_)
+      .help("routing rule cidr[,port[-port]]=proxy|direct|block. the longest prefix wins, rules of the same prefix are checked in order.")
+      .default_value(std::vector<std::string>{})
+      .append();
+
+    argumentParser.add_argument(G_ARGUMENT_RULES_FILE_)
+      .help("file with routing rules, one rule per line. the file rules follow the command line rules.")
+      .default_value(std::string{});
+
+    argumentParser.add_argument(G_ARGUMENT_CONFIG_FILE_)
+      .help("file with more arguments, the file arguments follow the command line arguments. the file is watched and the config is reloaded when it is changed.")
+      .default_value(std::string{});
+
+    argumentParser.add_argument(G_ARGUMENT_DAEMON_)
+      .help("keep running with the local control endpoint until the shutdown command, the processes may be attached later.")
+      .default_value(false)
+      .implicit_value(true);
+
+    argumentParser.add_argument(G_ARGUMENT_CONTROL_)
+      .help("send a command to the running daemon and print the reply: attach PID..., detach PID..., config ARGUMENTS..., sessions, stats or shutdown.")
+      .default_value(std::string{});
   }
 
   // Parsing arguments.
   try 
   { 
-    argumentParser.parse_args(argc, argv); 
+    argumentParser.parse_args(arguments); 
   }
   catch (const std::runtime_error& error)
   {
@@ -105,6 +310,24 @@ bool GetConfigFromArguments(_In_ int argc, _In_ const char** argv, _Out_ std::un
     return false;
   }
 
+  options.m_ConfigFile  = argumentParser.get<std::string>(G_ARGUMENT_CONFIG_FILE_);
+  options.m_Daemon      = argumentParser.get<bool>(G_ARGUMENT_DAEMON_);
+  options.m_Control     = argumentParser.get<std::string>(G_ARGUMENT_CONTROL_);
+
+  // The command is sent to the daemon, the config is not needed.
+  if (!options.m_Control.empty())
+    return true;
+
+  // The config file arguments are parsed together with the command line arguments.
+  if (withFile && !options.m_ConfigFile.empty())
+  {
+    auto extended = arguments;
+    if (!ExtractArgumentsFromFile(options.m_ConfigFile, extended))
+      return false;
+
+    return GetConfigFromArguments(extended, pids, names, config, rules, options, false);
+  }
+
   // Extracting arguments.
   auto processPids      = argumentParser.get<std::vector<int>>(G_ARGUMENT_PROC_PID_);
   auto processNames     = argumentParser.get<std::vector<std::string>>(G_ARGUMENT_PROC_NAME_);
@@ -112,12 +335,17 @@ bool GetConfigFromArguments(_In_ int argc, _In_ const char** argv, _Out_ std::un
   auto proxyAddressV6   = argumentParser.get<std::string>(G_ARGUMENT_PROXY_ADDRESS_V6_);
   auto proxyType        = argumentParser.get<std::string>(G_ARGUMENT_PROXY_TYPE_);
   auto logging          = argumentParser.get<bool>(G_ARGUMENT_LOG_ENABLE_);
+  auto reportPolicy     = argumentParser.get<std::string>(G_ARGUMENT_REPORT_POLICY_);
+  auto pipelining       = argumentParser.get<bool>(G_ARGUMENT_SOCKS5_PIPELINING_);
+  auto upstreams        = argumentParser.get<std::vector<std::string>>(G_ARGUMENT_UPSTREAM_);
+  auto ruleStrings      = argumentParser.get<std::vector<std::string>>(G_ARGUMENT_RULE_);
+  auto rulesFile        = argumentParser.get<std::string>(G_ARGUMENT_RULES_FILE_);
 
   pids.insert(processPids.begin(), processPids.end());
   names.insert(processNames.begin(), processNames.end());
 
   // Validating.
-  if ((pids.empty() && names.empty()) || proxyType.empty() || (proxyAddressV4.empty() && proxyAddressV6.empty()))
+  if ((pids.empty() && names.empty() && !options.m_Daemon) || proxyType.empty() || (proxyAddressV4.empty() && proxyAddressV6.empty()))
   {
     std::cerr << "The " << G_ARGUMENT_PROC_PID_ << " or " << G_ARGUMENT_PROC_NAME_ << " and " << G_ARGUMENT_PROXY_ADDRESS_V4_ <<
       " or " << G_ARGUMENT_PROXY_ADDRESS_V6_ << " parameters must be specified." << std::endl;
@@ -125,8 +353,16 @@ bool GetConfigFromArguments(_In_ int argc, _In_ const char** argv, _Out_ std::un
     return false;
   }
 
-  config.m_LoggingEnable  = logging;
-  config.m_ProxyType      = proxyType == "socks4" ? ProxyType::Socks4 : ProxyType::Socks5;
+  if (reportPolicy != "drop-new" && reportPolicy != "drop-oldest" && reportPolicy != "block")
+  {
+    std::cerr << "Unknown report policy " << reportPolicy << "." << std::endl;
+    return false;
+  }
+
+  config.m_LoggingEnable     = logging;
+  config.m_ReportPolicy      = reportPolicy == "block" ? ReportPolicy::Block : reportPolicy == "drop-oldest" ? ReportPolicy::DropOldest : ReportPolicy::DropNew;
+  config.m_Socks5Pipelining  = pipelining;
+  config.m_ProxyType         = proxyType == "socks4" ? ProxyType::Socks4 : ProxyType::Socks5;
 
   std::memset(&config.m_ProxyV4, 0, sizeof(config.m_ProxyV4));
   std::memset(&config.m_ProxyV6, 0, sizeof(config.m_ProxyV6));
@@ -147,23 +383,144 @@ bool GetConfigFromArguments(_In_ int argc, _In_ const char** argv, _Out_ std::un
     return false;
   }
 
+  // Parsing upstreams.
+  if (upstreams.size() > BaseConfigManager::MAX_UPSTREAMS_)
+  {
+    std::cerr << "Too many upstreams, maximum is " << BaseConfigManager::MAX_UPSTREAMS_ << "." << std::endl;
+    return false;
+  }
+
+  std::memset(config.m_Upstreams, 0, sizeof(config.m_Upstreams));
+  config.m_UpstreamsCount = static_cast<BYTE>(upstreams.size());
+
+  for (size_t i = 0; i < upstreams.size(); ++i) if (!ExtractUpstreamFromString(upstreams[i], config.m_Upstreams[i]))
+  {
+    std::cerr << "Failed to parse upstream " << upstreams[i] << "." << std::endl;
+    std::cerr << argumentParser << std::endl;
+    return false;
+  }
+
+  // Parsing routing rules.
+  rules.clear();
+
+  for (const auto& ruleString : ruleStrings)
+  {
+    auto rule = BaseConfigManager::Rule();
+    if (!ExtractRuleFromString(ruleString, rule))
+    {
+      std::cerr << "Failed to parse rule " << ruleString << "." << std::endl;
+      std::cerr << argumentParser << std::endl;
+      return false;
+    }
+
+    rules.push_back(rule);
+  }
+
+  if (!rulesFile.empty() && !ExtractRulesFromFile(rulesFile, rules))
+    return false;
+
   return true;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int SendControlCommand(_In_ const std::string& command)
+{
+  auto stopEvent  = WinPipe::WinHandle(CreateEventW(nullptr, true, false, nullptr));
+  auto pipe       = WinPipe::NamedPipeClient(stopEvent, ObjectNames::GetControlPipeName());
+  auto id         = WORD{ 0 };
+  auto data       = static_cast<BYTE*>(nullptr);
+  auto size       = DWORD{ 0 };
+
+  if (!pipe.IsOpen())
+  {
+    std::cerr << "The daemon is not running, GetLastError=" << GetLastError() << "." << std::endl;
+    return 1;
+  }
+
+  auto status = pipe.WriteMessage(PipeControlChannel::MESSAGE_ID_, reinterpret_cast<const BYTE*>(command.data()), static_cast<DWORD>(command.size()));
+  if (status == ERROR_SUCCESS)
+    status = pipe.ReadMessage(id, &data, size);
+
+  if (status != ERROR_SUCCESS)
+  {
+    std::cerr << "Failed to send control command, GetLastError=" << status << "." << std::endl;
+    return 1;
+  }
+
+  auto reply = std::string(reinterpret_cast<const char*>(data), size);
+  delete[] data;
+
+  std::cout << reply << std::endl;
+  return reply.compare(0, 2, "ok") == 0 ? 0 : 1;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char** argv)
 {
   BaseConfigManager::Config config;
+  BaseConfigManager::Rules  rules;
 
   std::unordered_set<DWORD>        pids;
   std::unordered_set<std::string>  names;
+  Options                          options{ };
 
-  if (!GetConfigFromArguments(argc, const_cast<const char**>(argv), pids, names, config))
+  auto arguments = std::vector<std::string>(argv, argv + argc);
+
+  if (!GetConfigFromArguments(arguments, pids, names, config, rules, options))
     return 1;
 
-  auto core = Core(pids, names, config);
+  if (!options.m_Control.empty())
+    return SendControlCommand(options.m_Control);
+
+  try
+  {
+    auto core     = Core(pids, names, config, rules);
+    auto watcher  = std::unique_ptr<ConfigWatcher>();
+
+    // The config is applied only if the whole file is valid, otherwise the running config is kept.
+    if (!options.m_ConfigFile.empty())
+    {
+      watcher = std::make_unique<ConfigWatcher>(options.m_ConfigFile, [&]()
+      {
+        auto newPids    = std::unordered_set<DWORD>();
+        auto newNames   = std::unordered_set<std::string>();
+        auto newConfig  = BaseConfigManager::Config();
+        auto newRules   = BaseConfigManager::Rules();
+        auto newOptions = Options{ };
+
+        if (GetConfigFromArguments(arguments, newPids, newNames, newConfig, newRules, newOptions))
+          core.UpdateConfig(newConfig, newRules);
+        else
+          spdlog::error("Config file {} is not valid, the running config is kept.", options.m_ConfigFile);
+      });
+    }
+
+    // The daemon config command replaces the config, its arguments are parsed as the command line of a daemon.
+    if (options.m_Daemon)
+    {
+      auto control = ControlServer(std::make_unique<PipeControlListener>(), core, [&](const std::vector<std::string>& commandArguments, BaseConfigManager::Config& newConfig, BaseConfigManager::Rules& newRules)
+      {
+        auto newArguments = std::vector<std::string>{ arguments.front(), G_ARGUMENT_DAEMON_ };
+        auto newPids      = std::unordered_set<DWORD>();
+        auto newNames     = std::unordered_set<std::string>();
+        auto newOptions   = Options{ };
+
+        newArguments.insert(newArguments.end(), commandArguments.begin(), commandArguments.end());
+        return GetConfigFromArguments(newArguments, newPids, newNames, newConfig, newRules, newOptions, false);
+      });
+
+      control.Wait();
+      return 0;
+    }
+
+    //Sleep(INFINITE);
+    core.Wait();
+  }
+  catch (const std::runtime_error& error)
+  {
+    std::cerr << "RuntimeError: " << error.what() << std::endl;
+    return 1;
+  }
 
-  //Sleep(INFINITE);
-  core.Wait();
   return 0;
 }
\ No newline at end of file
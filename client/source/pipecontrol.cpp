@@ -0,0 +1,57 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError PipeControlChannel::Receive(_Out_ std::string& command)
+{
+	auto id			= WORD{ 0 };
+	auto data		= static_cast<BYTE*>(nullptr);
+	auto size		= DWORD{ 0 };
+	auto status = m_Pipe->ReadMessage(id, &data, size);
+
+	command.clear();
+
+	if (status != ERROR_SUCCESS)
+		return status;
+
+	if (id == MESSAGE_ID_)
+		command.assign(reinterpret_cast<const char*>(data), size);
+	else
+		status = ERROR_INVALID_DATA;
+
+	delete[] data;
+	return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError PipeControlChannel::Send(_In_ const std::string& reply)
+{
+	return m_Pipe->WriteMessage(MESSAGE_ID_, reinterpret_cast<const BYTE*>(reply.data()), static_cast<DWORD>(reply.size()));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+PipeControlListener::PipeControlListener() :
+	m_StopEvent{ CreateEventW(nullptr, true, false, nullptr) }
+{
+	if (!m_StopEvent.get())
+		throw std::runtime_error("Failed to create control stop event.");
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError PipeControlListener::Accept(_Out_ std::unique_ptr<AbstractControlChannel>& channel)
+{
+	auto pipe = std::make_unique<WinPipe::NamedPipeServer>(m_StopEvent);
+
+	channel.reset();
+
+	// Every client gets its own pipe instance.
+	auto status = pipe->Create(ObjectNames::GetControlPipeName());
+	if (status != ERROR_SUCCESS)
+		return status;
+
+	status = pipe->Connect();
+	if (status != ERROR_SUCCESS && status != ERROR_PIPE_CONNECTED)
+		return status;
+
+	channel = std::make_unique<PipeControlChannel>(std::move(pipe));
+	return ERROR_SUCCESS;
+}
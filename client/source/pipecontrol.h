@@ -0,0 +1,64 @@
+#ifndef CLIENT_PIPE_CONTROL_H_
+#define CLIENT_PIPE_CONTROL_H_
+
+// Control client connected to the control named pipe.
+// Every command and every reply is a single pipe message.
+class PipeControlChannel final : public AbstractControlChannel
+{
+public:
+	// Id of the control pipe messages.
+	static constexpr WORD MESSAGE_ID_ = 1;
+
+	// Deleted default constructor.
+	PipeControlChannel() = delete;
+	// Default destructor.
+	~PipeControlChannel() = default;
+	// Deleted copy constructor.
+	PipeControlChannel(const PipeControlChannel&) = delete;
+	// Deleted copy assigment.
+	PipeControlChannel& operator=(const PipeControlChannel&) = delete;
+
+	// PipeControlChannel constructor.
+	// @param pipe - connected control pipe.
+	explicit PipeControlChannel(_In_ std::unique_ptr<WinPipe::NamedPipeServer> pipe) :
+		m_Pipe{ std::move(pipe) }
+	{ }
+
+	// Reads the command message.
+	WinPipe::WinError Receive(_Out_ std::string& command) override;
+
+	// Writes the reply message.
+	WinPipe::WinError Send(_In_ const std::string& reply) override;
+
+private:
+	std::unique_ptr<WinPipe::NamedPipeServer>	m_Pipe;	// Control pipe.
+};
+
+// Control endpoint over a local named pipe. Remote clients are rejected.
+class PipeControlListener final : public AbstractControlListener
+{
+public:
+	// Default destructor.
+	~PipeControlListener() = default;
+	// Deleted copy constructor.
+	PipeControlListener(const PipeControlListener&) = delete;
+	// Deleted copy assigment.
+	PipeControlListener& operator=(const PipeControlListener&) = delete;
+
+	// PipeControlListener constructor.
+	// Throws runtime_error if the stop event is not created.
+	PipeControlListener();
+
+	// Creates a pipe instance and waits for a client to connect to it.
+	WinPipe::WinError Accept(_Out_ std::unique_ptr<AbstractControlChannel>& channel) override;
+
+	// Signals the stop event.
+	void Stop() override {
+		SetEvent(m_StopEvent.get());
+	}
+
+private:
+	WinPipe::WinHandle	m_StopEvent;	// Stop event, manual-reset.
+};
+
+#endif // !CLIENT_PIPE_CONTROL_H_
@@ -14,7 +14,7 @@ bool Process::Open(_In_ DWORD _Pid, _In_ DWORD _DesiredAccess)
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-bool Process::RemoteLoadLibrary(_In_ const wchar_t* _Module)
+bool Process::RemoteLoadLibrary(_In_ const wchar_t* _Module, _In_opt_ DWORD _Timeout)
 {
 	// Allocate memory for the string containing the path to the module.
 	auto moduleLength = lstrlenW(_Module);
@@ -36,7 +36,18 @@ bool Process::RemoteLoadLibrary(_In_ const wchar_t* _Module)
 		return false;
 	}
 
-	return true;
+	// The string may still be read by the thread, it is left to the process.
+	if (WaitForSingleObject(thread.get(), _Timeout) != WAIT_OBJECT_0)
+		return false;
+
+	VirtualFreeEx(m_Process.get(), memory, 0, MEM_RELEASE);
+
+	// The exit code is the low part of the module base, so zero is checked with the module list.
+	auto exitCode = DWORD{ 0 };
+	if (GetExitCodeThread(thread.get(), &exitCode) && exitCode != 0)
+		return true;
+
+	return GetRemoteLibraryBase(GetProcessId(m_Process.get()), PathFindFileNameW(const_cast<LPWSTR>(_Module))) != nullptr;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -53,22 +64,43 @@ bool Process::IsWow64() const noexcept
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-DWORD Process::GetProcessIdByName(_In_ const char* _Name)
+std::unordered_set<DWORD> Process::GetProcessIdsByNames(_In_ const ProcessMatcher& _Matcher, _Out_ std::vector<bool>& _Matched)
 {
+	auto result = std::unordered_set<DWORD>();
+
+	_Matched.assign(_Matcher.GetCount(), false);
+
 	auto snapshot = WinPipe::WinHandle(CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0));
 	if (snapshot.get() == INVALID_HANDLE_VALUE)
-		return G_INVALID_PROCESS_ID;
+		return result;
 
 	PROCESSENTRY32 entry{ 0 };
 	entry.dwSize = sizeof(PROCESSENTRY32);
 
 	if (Process32First(snapshot.get(), &entry)) do
 	{
-		if (lstrcmpA(_Name, entry.szExeFile) == 0)
-			return entry.th32ProcessID;
+		if (_Matcher.Match(entry.szExeFile, &_Matched))
+			result.insert(entry.th32ProcessID);
 	} while (Process32Next(snapshot.get(), &entry));
 
-	return G_INVALID_PROCESS_ID;
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Process::GetProcessName(_In_ DWORD _Pid, _Out_ std::string& _Name)
+{
+	auto process	= WinPipe::WinHandle(OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, false, _Pid));
+	auto path			= std::string(MAX_PATH, '\0');
+	auto size			= static_cast<DWORD>(path.size());
+
+	_Name.clear();
+
+	if (!process.get() || !QueryFullProcessImageNameA(process.get(), 0, path.data(), &size))
+		return false;
+
+	path.resize(size);
+	_Name = PathFindFileNameA(path.c_str());
+	return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
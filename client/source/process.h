@@ -27,10 +27,11 @@ public:
 	// @returns true if opening success.
 	bool Open(_In_ DWORD _Pid, _In_ DWORD _DesiredAccess);
 
-	// Loads a module into a remote process.
+	// Loads a module into a remote process and waits for the load.
 	// @param _Module - full path to module to be loaded.
+	// @param _Timeout - time in milliseconds the load may take.
 	// @return true if success, false if module alredy loaded or other error.
-	bool RemoteLoadLibrary(_In_ const wchar_t*	_Module);
+	bool RemoteLoadLibrary(_In_ const wchar_t*	_Module, _In_opt_ DWORD _Timeout = INFINITE);
 
 	// Returns true if process under WOW64.
 	bool IsWow64() const noexcept;
@@ -40,10 +41,17 @@ public:
 		return m_Process;
 	}
 
-	// Searches for a process by name and returns its ID.
-	// @param _Name - process name.
-	// @returns Process id or G_INVALID_PROCESS_ID if process not found.
-	static DWORD GetProcessIdByName(_In_ const char* _Name);
+	// Searches for processes by name patterns with a single snapshot walk.
+	// @param _Matcher - compiled process name patterns.
+	// @param _Matched - set to true for every pattern matched by any process.
+	// @returns IDs of all matched processes.
+	static std::unordered_set<DWORD> GetProcessIdsByNames(_In_ const ProcessMatcher& _Matcher, _Out_ std::vector<bool>& _Matched);
+
+	// Returns short filename of the process executable.
+	// @param _Pid - process id.
+	// @param _Name - executable filename.
+	// @returns false if the process is not opened.
+	static bool GetProcessName(_In_ DWORD _Pid, _Out_ std::string& _Name);
 
 	// Searches for a loaded module in a remote process.
 	// @param _Process - target process id.
@@ -0,0 +1,104 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ProcessInjection::ProcessInjection(_In_ DWORD pid, _In_ const std::wstring& module, _In_ std::shared_ptr<AbstractServer> server, 
+	_In_ std::shared_ptr<ReportSink> sink, _In_ const BaseConfigManager::Config& config) :
+	m_Pid{ pid },
+	m_Module{ module },
+	m_Server{ server },
+	m_Sink{ sink },
+	m_Config{ config },
+	m_Added{ false }
+{ }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ProcessInjection::~ProcessInjection()
+{
+	if (m_Session && !m_Added)
+		m_Session->Stop();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProcessInjection::Run(_In_ InjectionPipeline::Stage stage)
+{
+	switch (stage)
+	{
+		case InjectionPipeline::Stage::Open:				return Open();
+		case InjectionPipeline::Stage::Load:				return Load();
+		case InjectionPipeline::Stage::Ready:				return Ready();
+		case InjectionPipeline::Stage::Configured:	return Configure();
+	}
+
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProcessInjection::Open()
+{
+	if (Process::GetRemoteLibraryBase(m_Pid, PathFindFileNameW(const_cast<LPWSTR>(m_Module.c_str()))))
+	{
+		spdlog::warn("Process {} already proxied.", m_Pid);
+		return false;
+	}
+
+	if (!m_Process.Open(m_Pid, PROCESS_ALL_ACCESS))
+	{
+		spdlog::error("Failed to open process {}.", m_Pid);
+		return false;
+	}
+
+	try
+	{
+		m_Session = Session::Create(m_Pid, m_Server, m_Sink);
+	}
+	catch (const std::runtime_error& error)
+	{
+		spdlog::error("RuntimeError: {}.", error.what());
+		return false;
+	}
+
+	// The report transport exists before the redirector reads the config.
+	m_Session->PrepareConfig(m_Config);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProcessInjection::Load()
+{
+	if (!m_Process.RemoteLoadLibrary(m_Module.c_str(), LOAD_TIMEOUT_))
+	{
+		spdlog::error("Failed to load module into process {}.", m_Pid);
+		return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProcessInjection::Ready()
+{
+	return m_Session->WaitReady();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProcessInjection::Configure()
+{
+	if (!m_Session->WaitConfig(m_Server->GetConfigVersion()))
+		return false;
+
+	m_Added = m_Server->AddSession(m_Session);
+	if (!m_Added)
+		return false;
+
+	auto config = BaseConfigManager::Config();
+	auto rules	= BaseConfigManager::Rules();
+
+	// The server prepares only the added sessions, so the transport is prepared again
+	// if the config was updated after it was prepared on open.
+	m_Server->GetConfig(config, rules);
+
+	if (config.m_Version != m_Config.m_Version)
+		m_Session->PrepareConfig(config);
+
+	return true;
+}
@@ -0,0 +1,59 @@
+#ifndef CLIENT_PROCESS_INJECTION_H_
+#define CLIENT_PROCESS_INJECTION_H_
+
+// Injection of the redirector into a process.
+// The session is added to the server only when the redirector has applied the config.
+class ProcessInjection : public InjectionPipeline::AbstractInjection
+{
+	// Time in milliseconds the remote LoadLibrary may take.
+	static constexpr DWORD LOAD_TIMEOUT_ = 10000;
+
+public:
+	// Deleted default constructor.
+	ProcessInjection() = delete;
+	// Stops the session if the injection failed, the redirector unloads itself.
+	~ProcessInjection();
+	// Deleted copy constructor.
+	ProcessInjection(const ProcessInjection&) = delete;
+	// Deleted copy assigment.
+	ProcessInjection& operator=(const ProcessInjection&) = delete;
+
+	// ProcessInjection constructor.
+	// @param pid - target process id.
+	// @param module - full path to the redirector module.
+	// @param server - server instance.
+	// @param sink - sink of connection reports.
+	// @param config - running config.
+	ProcessInjection(_In_ DWORD pid, _In_ const std::wstring& module, _In_ std::shared_ptr<AbstractServer> server, 
+		_In_ std::shared_ptr<ReportSink> sink, _In_ const BaseConfigManager::Config& config);
+
+	// Runs the injection stage.
+	// @param stage - injection stage.
+	// @returns false if the stage failed.
+	bool Run(_In_ InjectionPipeline::Stage stage) override;
+
+private:
+	// Opens the process and creates its session.
+	bool Open();
+
+	// Loads the redirector into the process.
+	bool Load();
+
+	// Waits for the redirector to install the hooks.
+	bool Ready();
+
+	// Waits for the redirector to apply the config and adds the session to the server.
+	// The report transport is prepared again from the config updated meanwhile.
+	bool Configure();
+
+	DWORD														m_Pid;			// Target process id.
+	const std::wstring&							m_Module;		// Full path to the redirector module.
+	std::shared_ptr<AbstractServer>	m_Server;		// Server instance.
+	std::shared_ptr<ReportSink>			m_Sink;			// Sink of connection reports.
+	BaseConfigManager::Config				m_Config;		// Running config.
+	Process													m_Process;	// Target process.
+	std::shared_ptr<Session>				m_Session;	// Session of the process.
+	bool														m_Added;		// true - the session is added to the server.
+};
+
+#endif // !CLIENT_PROCESS_INJECTION_H_
@@ -0,0 +1,134 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ProcessMatcher::ProcessMatcher(_In_ const std::unordered_set<std::string>& patterns) :
+	m_Patterns(patterns.begin(), patterns.end())
+{
+	for (size_t i = 0; i < m_Patterns.size(); ++i)
+	{
+		auto pattern = m_Patterns[i];
+		ToLower(pattern);
+
+		if (pattern.find_first_of("*?") == std::string::npos)
+		{
+			m_Literals[pattern].push_back(i);
+			continue;
+		}
+
+		auto glob		= Glob{ { }, 0, i };
+		auto begin	= size_t{ 0 };
+
+		for (;;)
+		{
+			auto end = pattern.find('*', begin);
+
+			glob.m_Segments.push_back(pattern.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+			glob.m_MinLength += glob.m_Segments.back().size();
+
+			if (end == std::string::npos)
+				break;
+
+			begin = end + 1;
+		}
+
+		m_Globs.push_back(std::move(glob));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProcessMatcher::Match(_In_ const char* name, _Inout_opt_ std::vector<bool>* matched) const
+{
+	auto lowerName	= std::string(name);
+	auto result			= false;
+
+	ToLower(lowerName);
+
+	if (matched)
+		matched->resize(m_Patterns.size());
+
+	auto literal = m_Literals.find(lowerName);
+	if (literal != m_Literals.end())
+	{
+		if (!matched)
+			return true;
+
+		for (auto index : literal->second)
+			(*matched)[index] = true;
+
+		result = true;
+	}
+
+	for (const auto& glob : m_Globs)
+	{
+		if (!MatchGlob(lowerName, glob))
+			continue;
+
+		if (!matched)
+			return true;
+
+		(*matched)[glob.m_Index] = true;
+		result = true;
+	}
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProcessMatcher::MatchSegment(_In_ const char* text, _In_ const std::string& segment) noexcept
+{
+	for (size_t i = 0; i < segment.size(); ++i)
+	{
+		if (segment[i] != '?' && segment[i] != text[i])
+			return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProcessMatcher::MatchGlob(_In_ const std::string& name, _In_ const Glob& glob) noexcept
+{
+	const auto& segments = glob.m_Segments;
+
+	if (name.size() < glob.m_MinLength)
+		return false;
+
+	// There is no '*', the name must have the same length.
+	if (segments.size() == 1)
+		return name.size() == segments.front().size() && MatchSegment(name.data(), segments.front());
+
+	const auto& first = segments.front();
+	const auto& last	= segments.back();
+
+	if (!MatchSegment(name.data(), first) || !MatchSegment(name.data() + name.size() - last.size(), last))
+		return false;
+
+	// The leftmost match of every middle segment leaves the most room for the next ones.
+	auto position = first.size();
+	auto end			= name.size() - last.size();
+
+	for (size_t i = 1; i + 1 < segments.size(); ++i)
+	{
+		const auto& segment = segments[i];
+
+		while (position + segment.size() <= end && !MatchSegment(name.data() + position, segment))
+			++position;
+
+		if (position + segment.size() > end)
+			return false;
+
+		position += segment.size();
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ProcessMatcher::ToLower(_Inout_ std::string& value) noexcept
+{
+	for (auto& symbol : value)
+	{
+		if (symbol >= 'A' && symbol <= 'Z')
+			symbol = static_cast<char>(symbol - 'A' + 'a');
+	}
+}
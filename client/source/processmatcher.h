@@ -0,0 +1,90 @@
+#ifndef CLIENT_PROCESS_MATCHER_H_
+#define CLIENT_PROCESS_MATCHER_H_
+
+// The matcher is portable, so the header includes what it uses.
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _WIN32
+#	include <sal.h>
+#else
+#	ifndef _In_
+#		define _In_
+#	endif
+#	ifndef _Inout_
+#		define _Inout_
+#	endif
+#	ifndef _Inout_opt_
+#		define _Inout_opt_
+#	endif
+#endif
+
+// Set of process name patterns compiled once and matched in a single pass.
+// Patterns are case-insensitive globs: '*' matches any sequence, '?' matches one character.
+// Patterns without wildcards are looked up in a hash table, every glob is split
+// into its literal segments, so a name is matched without backtracking.
+class ProcessMatcher
+{
+	// Compiled glob.
+	struct Glob
+	{
+		std::vector<std::string>	m_Segments;		// Segments between '*', the first and the last are anchored.
+		size_t										m_MinLength;	// Sum of the segments lengths.
+		size_t										m_Index;			// Pattern index.
+	};
+
+public:
+	// Deleted default constructor.
+	ProcessMatcher() = delete;
+	// Default destructor.
+	~ProcessMatcher() = default;
+	// Deleted copy constructor.
+	ProcessMatcher(const ProcessMatcher&) = delete;
+	// Deleted copy assigment.
+	ProcessMatcher& operator=(const ProcessMatcher&) = delete;
+
+	// Compiles the patterns.
+	// @param patterns - process name patterns.
+	explicit ProcessMatcher(_In_ const std::unordered_set<std::string>& patterns);
+
+	// Returns count of patterns.
+	size_t GetCount() const noexcept {
+		return m_Patterns.size();
+	}
+
+	// Returns the pattern.
+	// @param index - pattern index, less than GetCount.
+	const std::string& GetPattern(_In_ size_t index) const noexcept {
+		return m_Patterns[index];
+	}
+
+	// Matches the name against the patterns.
+	// @param name - process name.
+	// @param matched - if not nullptr, resized to GetCount and set to true for every matched pattern.
+	// Otherwise the match stops at the first matched pattern.
+	// @returns true if any pattern is matched.
+	bool Match(_In_ const char* name, _Inout_opt_ std::vector<bool>* matched = nullptr) const;
+
+private:
+	// Returns true if the text starts with the segment.
+	// @param text - text, at least as long as the segment.
+	// @param segment - literal segment, '?' matches any character.
+	static bool MatchSegment(_In_ const char* text, _In_ const std::string& segment) noexcept;
+
+	// Returns true if the name matches the glob.
+	// @param name - lowercase name.
+	// @param glob - compiled glob.
+	static bool MatchGlob(_In_ const std::string& name, _In_ const Glob& glob) noexcept;
+
+	// Converts the string to lowercase.
+	// @param value - string.
+	static void ToLower(_Inout_ std::string& value) noexcept;
+
+	std::vector<std::string>														m_Patterns;	// Source patterns.
+	std::unordered_map<std::string, std::vector<size_t>>	m_Literals;	// Lowercase patterns without wildcards and their indexes.
+	std::vector<Glob>																		m_Globs;		// Compiled globs.
+};
+
+#endif // !CLIENT_PROCESS_MATCHER_H_
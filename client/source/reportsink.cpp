@@ -0,0 +1,101 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ReportSink::ReportSink(_In_ size_t capacity) :
+	m_Capacity{ capacity },
+	m_Stop{ false },
+	m_Dropped{ 0 }
+{
+	m_Pending.reserve(m_Capacity);
+	m_Batch.reserve(m_Capacity);
+
+	m_Thread = std::thread(&ReportSink::SinkThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ReportSink::~ReportSink()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+
+	m_Condition.notify_one();
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+
+	if (auto dropped = GetDropped(); dropped != 0)
+		spdlog::warn("{} connection reports were dropped by the full report sink.", dropped);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ReportSink::Push(_In_ DWORD session, _In_ const ReportRecord* records, _In_ size_t count)
+{
+	auto queued = size_t{ 0 };
+	auto wake		= false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		wake		= m_Pending.empty();
+		queued	= (std::min)(count, m_Capacity - m_Pending.size());
+
+		for (size_t i = 0; i < queued; ++i)
+			m_Pending.push_back(Entry{ session, records[i] });
+	}
+
+	if (queued != count)
+		m_Dropped.fetch_add(count - queued, std::memory_order_relaxed);
+
+	// The sink thread sleeps only on the empty queue.
+	if (wake && queued != 0)
+		m_Condition.notify_one();
+
+	return queued;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ReportSink::SinkThread()
+{
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this] { return m_Stop || !m_Pending.empty(); });
+
+			// The queued reports are logged before the exit.
+			if (m_Pending.empty())
+				break;
+
+			m_Batch.clear();
+			m_Pending.swap(m_Batch);
+		}
+
+		for (const auto& entry : m_Batch)
+			Log(entry);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ReportSink::Log(_In_ const Entry& entry)
+{
+	char address[INET6_ADDRSTRLEN];
+
+	if (entry.m_Record.m_Id == AF_INET && entry.m_Record.m_Size >= sizeof(sockaddr_in)) 
+	{
+		auto ipv4 = sockaddr_in{ 0 };
+		std::memcpy(&ipv4, entry.m_Record.m_Data, sizeof(ipv4));
+
+		if (inet_ntop(AF_INET, &ipv4.sin_addr, address, sizeof(address)))
+			spdlog::info("Session {} connecting to IPv4 {}:{}", entry.m_Session, address, ntohs(ipv4.sin_port));
+	}
+	else if (entry.m_Record.m_Id == AF_INET6 && entry.m_Record.m_Size >= sizeof(sockaddr_in6))
+	{
+		auto ipv6 = sockaddr_in6{ 0 };
+		std::memcpy(&ipv6, entry.m_Record.m_Data, sizeof(ipv6));
+
+		if (inet_ntop(AF_INET6, &ipv6.sin6_addr, address, sizeof(address)))
+			spdlog::info("Session {} connecting to IPv6 [{}]:{}", entry.m_Session, address, ntohs(ipv6.sin6_port));
+	}
+}
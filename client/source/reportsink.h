@@ -0,0 +1,62 @@
+#ifndef CLIENT_REPORT_SINK_H_
+#define CLIENT_REPORT_SINK_H_
+
+// Formats and logs the connection reports of all sessions in background.
+// The sessions hand over a whole batch of reports with a single lock,
+// so reading the reports never waits for the formatting and the log output.
+// The sink thread swaps the queued reports with its own buffer and logs them.
+// Both buffers are allocated once, the reports that do not fit are dropped.
+class ReportSink
+{
+	// Queued report.
+	struct Entry
+	{
+		DWORD					m_Session;	// Session id.
+		ReportRecord	m_Record;		// Connection report.
+	};
+
+public:
+	// Deleted default constructor.
+	ReportSink() = delete;
+	// Logs the queued reports and stops the sink thread.
+	~ReportSink();
+	// Deleted copy constructor.
+	ReportSink(const ReportSink&) = delete;
+	// Deleted copy assigment.
+	ReportSink& operator=(const ReportSink&) = delete;
+
+	// ReportSink constructor.
+	// @param capacity - count of reports queued at most.
+	explicit ReportSink(_In_ size_t capacity);
+
+	// Queues the reports of the session.
+	// @param session - session id.
+	// @param records - connection reports.
+	// @param count - count of reports.
+	// @returns count of queued reports, the rest is dropped.
+	size_t Push(_In_ DWORD session, _In_ const ReportRecord* records, _In_ size_t count);
+
+	// Returns count of reports dropped because the queue was full.
+	size_t GetDropped() const noexcept {
+		return m_Dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	// Sink thread routine.
+	void SinkThread();
+
+	// Logs the connection report.
+	// @param entry - queued report.
+	static void Log(_In_ const Entry& entry);
+
+	size_t										m_Capacity;		// Count of reports queued at most.
+	std::vector<Entry>				m_Pending;		// Reports queued by the sessions.
+	std::vector<Entry>				m_Batch;			// Reports logged by the sink thread.
+	std::mutex								m_Mutex;			// Locks the queued reports.
+	std::condition_variable		m_Condition;	// Wakes the sink thread.
+	bool											m_Stop;				// true - the sink thread must exit.
+	std::atomic<size_t>				m_Dropped;		// Count of dropped reports.
+	std::thread								m_Thread;			// Sink thread.
+};
+
+#endif // !CLIENT_REPORT_SINK_H_
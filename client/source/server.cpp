@@ -1,36 +1,175 @@
 #include "global.h"
 
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	DWORD GetRemainingTime(_In_ std::chrono::steady_clock::time_point deadline)
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		return static_cast<DWORD>((std::max<long long>)(remaining, 0));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Server::Server() :
+	m_Loop{ std::make_unique<EventLoop>(EVENT_LOOP_THREADS_) },
+	m_Reaper{ m_Sessions, m_Tracker },
+	m_ConfigVersion{ 0 },
+	m_Config{ },
+	m_ConfigSection{ true },
+	m_Rollouts{ std::make_unique<EventLoop>(ROLLOUT_THREADS_) }
+{ }
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Server::Stop()
 {
-	for (const auto& [id, session] : m_Sessions)
+	for (const auto& session : m_Sessions.GetSnapshot())
 		session->Stop();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool Server::AddSession(_In_ std::shared_ptr<AbstractSession> session)
 {
-	if (SessionExists(session->GetId()) && m_Sessions[session->GetId()]->IsActive())
+	auto replace = [](const std::shared_ptr<AbstractSession>& registered) { return !registered->IsActive(); };
+
+	if (!m_Sessions.Insert(session, replace))
 		return false;
 
-	m_Sessions[session->GetId()] = session;
+	// The replaced session is not tracked anymore.
+	m_Tracker.Untrack(session->GetId());
+
+	if (!m_Tracker.Track(session->GetId(), session->GetProcess().get()))
+		spdlog::warn("Failed to track session {}. GetLastError={}.", session->GetId(), GetLastError());
+
 	return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Server::UpdateConfig(_In_ const BaseConfigManager::Config& config)
+void Server::UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules)
 {
-	for (const auto& [id, session] : m_Sessions)
-		session->UpdateConfig(config);
+	auto diff = ConfigDiff();
+	{
+		std::lock_guard<std::mutex> lock(m_ConfigMutex);
+		diff = ConfigDiff::Compare(m_Config, m_Rules, config, rules);
+	}
+
+	if (GetConfigVersion() != 0 && diff.Empty())
+	{
+		spdlog::info("Config is not changed, it is not published.");
+		return;
+	}
+
+	spdlog::info("Config changes: {}.", diff.ToString());
+
+	auto sessions = m_Sessions.GetSnapshot();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ROLLOUT_DEADLINE_);
+
+	// The report transports must exist before the redirectors read the config.
+	// The tasks may outlive the call after the deadline, so they share a copy of the config.
+	if (diff.m_Logging)
+	{
+		auto prepared = std::make_shared<const BaseConfigManager::Config>(config);
+		FanOut(sessions, [prepared](AbstractSession& session) { session.PrepareConfig(*prepared); return true; }, deadline);
+	}
+
+	auto version = PublishConfig(config, rules);
+	if (version == 0)
+		return;
+
+	// A session added after the snapshot may have checked the config version before
+	// the config was published, so the sessions added meanwhile are prepared here.
+	if (diff.m_Logging)
+	{
+		for (const auto& session : m_Sessions.GetSnapshot())
+		{
+			if (std::find(sessions.begin(), sessions.end(), session) == sessions.end())
+				session->PrepareConfig(config);
+		}
+	}
+
+	auto latencies = FanOut(sessions, [version, deadline](AbstractSession& session) { return session.WaitConfig(version, GetRemainingTime(deadline)); }, deadline);
+
+	spdlog::info("Config {} is applied by {} of {} sessions. Latency p50={}us p90={}us p99={}us.", 
+		version, latencies.size(), sessions.size(), 
+		Percentile(latencies, 50), Percentile(latencies, 90), Percentile(latencies, 99));
+
+	for (const auto& session : sessions)
+	{
+		if (session->GetConfigVersion() < version)
+			spdlog::warn("Session {} is on config {} instead of {}.", session->GetId(), session->GetConfigVersion(), version);
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Server::Wait(_In_opt_ DWORD timeout)
+DWORD Server::PublishConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules)
 {
-	auto handles = std::vector<HANDLE>();
+	std::lock_guard<std::mutex> lock(m_ConfigMutex);
+
+	auto stamped = config;
+	stamped.m_Version = m_ConfigVersion.load(std::memory_order_relaxed) + 1;
+
+	if (!m_ConfigSection.Write(stamped, rules))
+	{
+		spdlog::error("Failed to publish config, {} rules are more than {}.", rules.size(), ConfigSection::MAX_RULES_);
+		return 0;
+	}
 
-	for (const auto& [id, session] : m_Sessions)
-		handles.push_back(session->GetStopEvent().get());
+	m_Config	= stamped;
+	m_Rules		= rules;
+
+	m_ConfigVersion.store(stamped.m_Version, std::memory_order_relaxed);
+	return stamped.m_Version;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<long long> Server::FanOut(_In_ const std::vector<std::shared_ptr<AbstractSession>>& sessions, _In_ RolloutTask task, _In_ std::chrono::steady_clock::time_point deadline)
+{
+	auto rollout = std::make_shared<Rollout>();
+
+	rollout->m_Start		= std::chrono::steady_clock::now();
+	rollout->m_Pending	= sessions.size();
+
+	for (const auto& session : sessions)
+	{
+		auto posted = m_Rollouts->Post([rollout, session, task, deadline](WinPipe::WinError)
+		{
+			// The sessions queued behind stuck ones are skipped after the deadline, they are not awaited anymore.
+			auto succeeded	= std::chrono::steady_clock::now() < deadline && task(*session);
+			auto latency		= std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - rollout->m_Start);
+
+			std::lock_guard<std::mutex> lock(rollout->m_Mutex);
+
+			if (succeeded)
+				rollout->m_Latencies.push_back(latency.count());
+
+			if (--rollout->m_Pending == 0)
+				rollout->m_Condition.notify_all();
+		});
+
+		if (!posted)
+		{
+			std::lock_guard<std::mutex> lock(rollout->m_Mutex);
+			--rollout->m_Pending;
+		}
+	}
+
+	std::vector<long long> latencies;
+	{
+		std::unique_lock<std::mutex> lock(rollout->m_Mutex);
+
+		rollout->m_Condition.wait_until(lock, deadline, [&] { return rollout->m_Pending == 0; });
+		latencies = rollout->m_Latencies;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	return latencies;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+long long Server::Percentile(_In_ const std::vector<long long>& values, _In_ size_t percentile) noexcept
+{
+	if (values.empty())
+		return 0;
 
-	WaitForMultipleObjects(handles.size(), handles.data(), TRUE, timeout);
+	return values[(std::min)(values.size() - 1, values.size() * percentile / 100)];
 }
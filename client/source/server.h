@@ -3,16 +3,42 @@
 
 // Session Server. Implements functions for client interaction, 
 // such as adding, deleting, and updating configurations.
+// The sessions may be added, deleted and updated from different threads.
+// The session of an exited process is reaped in background: it is stopped,
+// its counters are added to the totals, and it is deleted.
+// A config update is written once to the config section shared by all redirectors,
+// and the acknowledgements of the sessions are awaited in parallel until the rollout
+// deadline, so a stuck session does not delay the others.
 class Server : public AbstractServer, public std::enable_shared_from_this<Server>
 {
-	// Default constructor.
-	Server() = default;
+	// Count of event loop threads.
+	static constexpr size_t EVENT_LOOP_THREADS_ = 2;
+	// Count of threads sending the config to the sessions.
+	static constexpr size_t ROLLOUT_THREADS_ = 8;
+	// Time in milliseconds the config update waits for the sessions.
+	static constexpr DWORD ROLLOUT_DEADLINE_ = 3000;
 
-public:
-	// Default destructor.
-	~Server() = default;
+	// Rollout step state, shared with the rollout tasks.
+	struct Rollout
+	{
+		std::chrono::steady_clock::time_point	m_Start;			// Step start time.
+		std::mutex														m_Mutex;			// Locks rollout state.
+		std::condition_variable								m_Condition;	// Signaled when a session is done.
+		size_t																m_Pending;		// Count of sessions in progress.
+		std::vector<long long>								m_Latencies;	// Latencies of the succeeded sessions in microseconds.
+	};
+
+	// Rollout step of a session.
+	// @returns true if the session has succeeded.
+	using RolloutTask = std::function<bool(AbstractSession& session)>;
+
+	// Server constructor.
+	// Throws runtime_error if the event loop or the config section is not created.
+	Server();
 
+public:
 	// Creates and returns server instance.
+	// Throws runtime_error if the event loop or the config section is not created.
 	static std::shared_ptr<Server> Create() {
 		return std::shared_ptr<Server>(new Server);
 	}
@@ -26,34 +52,98 @@ public:
 
 	// Deleting a session.
 	// @param id - session ID to be deleted.
-	void DeleteSession(_In_ DWORD id) override {
-		m_Sessions.erase(id);
+	void DeleteSession(_In_ DWORD id) override 
+	{
+		m_Tracker.Untrack(id);
+		m_Sessions.Erase(id);
 	}
 
 	// Updating client configurations.
-	void UpdateConfig(_In_ const BaseConfigManager::Config& config) override;
+	// Returns after all sessions have acknowledged the config or the rollout deadline has expired.
+	// The config is not published if it is the same as the running one, and the report
+	// transports of the sessions are prepared only if the logging is changed.
+	void UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules) override;
+
+	// Publishes the config to the config section without waiting for the sessions.
+	// @returns version of the published config, 0 if it is not published.
+	DWORD PublishConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules) override;
 
-	// Waiting for all sessions to complete
+	// Waiting for all session processes to exit.
 	// @param timeout - waiting timeout. by default is INFINITE.
-	void Wait(_In_opt_ DWORD timeout = INFINITE) override;
+	void Wait(_In_opt_ DWORD timeout = INFINITE) override {
+		m_Tracker.WaitAll(timeout);
+	}
 
 	// Returns true if the specified session exists.
 	bool SessionExists(_In_ DWORD id) const override {
-		return m_Sessions.find(id) != m_Sessions.end();
+		return m_Sessions.Contains(id);
 	}
 
-	// Returns session.
+	// Returns session or nullptr if it does not exist.
 	std::shared_ptr<AbstractSession> GetSession(_In_ DWORD id) override {
-		return m_Sessions[id];
+		return m_Sessions.Find(id);
 	}
 
 	// Returns count of sessions.
 	size_t CountOfSessions() const noexcept override {
-		return m_Sessions.size();
+		return m_Sessions.Size();
+	}
+
+	// Returns the sessions at the moment of the call.
+	std::vector<std::shared_ptr<AbstractSession>> GetSessions() const override {
+		return m_Sessions.GetSnapshot();
+	}
+
+	// Returns the running config.
+	// @param config - running config.
+	// @param rules - running routing rules.
+	void GetConfig(_Out_ BaseConfigManager::Config& config, _Out_ BaseConfigManager::Rules& rules) override
+	{
+		std::lock_guard<std::mutex> lock(m_ConfigMutex);
+
+		config	= m_Config;
+		rules		= m_Rules;
+	}
+
+	// Returns event loop of the sessions.
+	AbstractEventLoop& GetEventLoop() noexcept override {
+		return *m_Loop;
+	}
+
+	// Returns counters of the reaped sessions.
+	Totals GetTotals() const override {
+		return m_Reaper.GetTotals();
+	}
+
+	// Returns version of the last config rollout.
+	DWORD GetConfigVersion() const noexcept override {
+		return m_ConfigVersion.load(std::memory_order_relaxed);
 	}
 
 private:
-	std::unordered_map<DWORD, std::shared_ptr<AbstractSession>> m_Sessions; // List sessions.
+	// Runs the task for every session on the rollout threads and waits for them until the deadline.
+	// The tasks that start after the deadline are skipped, and the task must bound its own waits by it.
+	// @param sessions - sessions.
+	// @param task - rollout step.
+	// @param deadline - time after which the unfinished sessions are not awaited.
+	// @returns latencies of the succeeded sessions in microseconds, sorted.
+	std::vector<long long> FanOut(_In_ const std::vector<std::shared_ptr<AbstractSession>>& sessions, _In_ RolloutTask task, _In_ std::chrono::steady_clock::time_point deadline);
+
+	// Returns the percentile of the sorted values. 0 if there are no values.
+	// @param values - sorted values.
+	// @param percentile - percentile from 0 to 100.
+	static long long Percentile(_In_ const std::vector<long long>& values, _In_ size_t percentile) noexcept;
+
+	std::unique_ptr<AbstractEventLoop>	m_Loop;						// Event loop of the sessions.
+	SessionRegistry											m_Sessions;				// List sessions.
+	SessionTracker											m_Tracker;				// Lifetime of the sessions.
+	SessionReaper												m_Reaper;					// Reaps the sessions of the exited processes.
+	std::atomic<DWORD>									m_ConfigVersion;	// Version of the last config rollout.
+	std::mutex													m_ConfigMutex;		// Serializes the config section writes.
+	BaseConfigManager::Config						m_Config;					// Running config.
+	BaseConfigManager::Rules						m_Rules;					// Running routing rules.
+	ConfigSection												m_ConfigSection;	// Config section read by the redirectors.
+	std::unique_ptr<AbstractEventLoop>	m_Rollouts;				// Threads running the config rollout steps.
 };
 
 #endif // !CLIENT_SERVER_H_
@@ -1,90 +1,331 @@
 #include "global.h"
 
+namespace
+{
+	// Time in milliseconds after which a report wait checks the stop flag.
+	constexpr DWORD G_REPORTS_WAIT_ = 1000;
+
+	// Time in milliseconds the config pipe waits for the redirector to connect.
+	constexpr DWORD G_CONFIG_CONNECT_TIMEOUT_ = 10000;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-Session::Session(_In_ DWORD id, _In_ std::weak_ptr<AbstractServer> server) :
+Session::Session(_In_ DWORD id, _In_ std::weak_ptr<AbstractServer> server, _In_ std::shared_ptr<ReportSink> sink) :
 	AbstractSession{ id, server, ObjectNames::GetStopEventName(id) },
 	m_PipeConfig{ m_StopEvent, ObjectNames::GetConfigPipeName(m_Id) },
-	m_PipeReport{ nullptr }
+	m_ConfigVersion{ 0 },
+	m_ConfigConnected{ false },
+	m_Ready{ false },
+	m_PipeReport{ nullptr },
+	m_Sink{ sink },
+	m_Loop{ nullptr },
+	m_ReportStop{ false },
+	m_ReportCount{ 0 },
+	m_ReportActive{ false }
 { }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Session::Stop()
 {
 	SetEvent(m_StopEvent.get());
-
-	if (m_ReportThread.joinable())
-		m_ReportThread.join();
+	StopReports();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Session::UpdateConfig(const BaseConfigManager::Config& config)
+void Session::PrepareConfig(const BaseConfigManager::Config& config)
 {
-	// If logging is enabled, create a named pipe for reports.
-	if (config.m_LoggingEnable && !m_PipeReport.get()) 
+	std::lock_guard<std::mutex> lock(m_ConfigMutex);
+
+	// If logging is enabled, create a transport for reports.
+	// It is created before the config is published, so the redirector finds it.
+	if (config.m_LoggingEnable && !m_Reports.get()) 
 	{
-		m_PipeReport		= std::make_unique<WinPipe::NamedPipeServer>(m_StopEvent, ObjectNames::GetReportPipeName(m_Id));
-		m_ReportThread	= std::thread(&Session::ReportThread, this);
+		CreateReportTransport();
+		StartReports();
 	}
-	// If logging is disabled, close the named report pipe.
-	else if (!config.m_LoggingEnable) 
+	// If logging is disabled, close the report transport after the report callbacks finish.
+	else if (!config.m_LoggingEnable && m_Reports.get()) 
 	{
+		StopReports();
+
+		m_Reports.reset();
 		m_PipeReport.reset();
-		if (m_ReportThread.joinable()) m_ReportThread.join();
 	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Session::WaitReady()
+{
+	std::lock_guard<std::mutex> lock(m_ConfigMutex);
+
+	auto status = ConnectConfig();
+
+	while (status == ERROR_SUCCESS && !m_Ready)
+		status = ReadConfigMessage();
+
+	if (status != ERROR_SUCCESS)
+	{
+		spdlog::warn("Session {} is not ready. GetLastError={}.", m_Id, status);
+		return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Session::WaitConfig(DWORD version, DWORD timeout)
+{
+	std::lock_guard<std::mutex> lock(m_ConfigMutex);
+
+	auto status = ConnectConfig();
+	if (status != ERROR_SUCCESS)
+		return false;
+
+	status = WaitConfigAck(version, timeout);
+	if (status != ERROR_SUCCESS)
+	{
+		spdlog::warn("Session {} did not acknowledge config {}. GetLastError={}.", m_Id, version, status);
+		return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Session::CreateReportTransport()
+{
+	try
+	{
+		m_Reports = std::make_unique<SharedReportTransport>(m_StopEvent, m_Id, SharedReportTransport::RING_CAPACITY_);
+	}
+	catch (const std::runtime_error& error)
+	{
+		spdlog::warn("RuntimeError: {}. Session {} reports through the named pipe.", error.what(), m_Id);
+
+		m_PipeReport	= std::make_unique<WinPipe::NamedPipeServer>(m_StopEvent, ObjectNames::GetReportPipeName(m_Id));
+		m_Reports			= std::make_unique<PipeReportTransport>(*m_PipeReport);
+	}
+}
 
-	// Sending new config.
-	auto status = SendConfig(config);
-	if (status != ERROR_SUCCESS) 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Session::StartReports()
+{
+	auto server = m_Server.lock();
+
+	if (!server)
 	{
-		spdlog::error("Failed to send new configuration. GetLastError={}.", status);
+		spdlog::error("Failed to read reports of session {}, the server is gone.", m_Id);
 		return;
 	}
+
+	m_Loop				= &server->GetEventLoop();
+	m_ReportStop	= false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_ReportMutex);
+		m_ReportActive = true;
+	}
+
+	// The named pipe waits for the redirector to connect.
+	if (m_PipeReport.get())
+		ConnectReports();
+	else
+		ArmReports();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Session::StopReports()
+{
+	std::unique_lock<std::mutex> lock(m_ReportMutex);
+
+	m_ReportStop = true;
+
+	// The report callback runs at once instead of after the wait timeout.
+	if (m_ReportActive)
+		m_Reports->Wake();
+
+	m_ReportCondition.wait(lock, [this] { return !m_ReportActive; });
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Session::FinishReports()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_ReportMutex);
+		m_ReportActive = false;
+	}
+
+	m_ReportCondition.notify_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Session::ConnectReports()
+{
+	auto event	= HANDLE{ nullptr };
+	auto status = m_PipeReport->BeginConnect(event);
+
+	if (status == ERROR_IO_PENDING)
+	{
+		if (!ScheduleReports(event, &Session::OnReportsConnected))
+			FinishReports();
+	}
+	else if (status == ERROR_SUCCESS || status == ERROR_PIPE_CONNECTED)
+		ArmReports();
+	else
+	{
+		spdlog::error("Failed to connect report named pipe in session {}. GetLastError={}.", m_Id, status);
+		FinishReports();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Session::ArmReports()
+{
+	auto event	= HANDLE{ nullptr };
+	auto status = m_Reports->Arm(event);
+
+	if (status != ERROR_SUCCESS)
+	{
+		spdlog::error("Failed to wait for reports in session {}. GetLastError={}.", m_Id, status);
+		FinishReports();
+	}
+	else if (!ScheduleReports(event, &Session::OnReports))
+		FinishReports();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Session::ScheduleReports(_In_opt_ HANDLE event, _In_ ReportHandler handler)
+{
+	// The callback keeps the session alive until it runs.
+	auto callback = [self = shared_from_this(), handler](WinPipe::WinError status) {
+		(self.get()->*handler)(status);
+	};
+
+	if (event)
+		return m_Loop->Wait(event, G_REPORTS_WAIT_, std::move(callback));
+
+	return m_Loop->Post(std::move(callback));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void Session::OnReportsConnected(WinPipe::WinError status)
+{
+	if (m_ReportStop)
+		return FinishReports();
+
+	status = m_PipeReport->EndConnect();
+
+	// The wait has timed out, the connection is still awaited.
+	if (status == ERROR_IO_INCOMPLETE)
+		return ConnectReports();
+
+	if (status != ERROR_SUCCESS)
+	{
+		spdlog::error("Failed to connect report named pipe in session {}. GetLastError={}.", m_Id, status);
+		return FinishReports();
+	}
+
+	ArmReports();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void Session::ReportThread()
+void Session::OnReports(WinPipe::WinError status)
 {
-	auto status	= m_PipeReport->Connect();
+	auto count = size_t{ 0 };
+
+	if (m_ReportStop)
+		return FinishReports();
+
+	// The redirector is gone.
+	if ((status = m_Reports->Poll(m_Records.data(), m_Records.size(), count)) != ERROR_SUCCESS)
+		return FinishReports();
 
-	if (status == ERROR_SUCCESS || status == ERROR_PIPE_CONNECTED) do
+	if (count != 0)
 	{
-		WORD	messageId		= 0;
-		BYTE*	messageData = nullptr;
-		DWORD	messageSize = 0;
+		m_ReportCount.fetch_add(count, std::memory_order_relaxed);
+		m_Sink->Push(m_Id, m_Records.data(), count);
+	}
+
+	ArmReports();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError Session::ConnectConfig()
+{
+	if (m_ConfigConnected)
+		return ERROR_SUCCESS;
+
+	// The redirector connects once it is loaded.
+	auto status = m_PipeConfig.Connect(G_CONFIG_CONNECT_TIMEOUT_);
+	if (status != ERROR_SUCCESS && status != ERROR_PIPE_CONNECTED) 
+	{
+		spdlog::error("Failed to connect config pipe of session {}. GetLastError={}.", m_Id, status);
+		return status;
+	}
+
+	m_ConfigConnected = true;
+	return ERROR_SUCCESS;
+}
 
-		if ((status = m_PipeReport->ReadMessage(messageId, &messageData, messageSize)) == ERROR_SUCCESS)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError Session::ReadConfigMessage(DWORD timeout)
+{
+	auto id			= WORD{ 0 };
+	auto data		= static_cast<BYTE*>(nullptr);
+	auto size		= DWORD{ 0 };
+	auto status = m_PipeConfig.ReadMessage(id, &data, size, timeout);
+
+	if (status != ERROR_SUCCESS)
+		return status;
+
+	auto value = DWORD{ 0 };
+	if (size == sizeof(value))
+		std::memcpy(&value, data, sizeof(value));
+
+	delete[] data;
+
+	if (id == BaseConfigManager::ACK_MESSAGE_ID_ && size == sizeof(value))
+		m_ConfigVersion.store(value, std::memory_order_relaxed);
+	else if (id == BaseConfigManager::READY_MESSAGE_ID_ && size == sizeof(value))
+	{
+		// The redirector of another build would misread the config section.
+		if (value != ConfigFormat::FORMAT_VERSION_)
 		{
-			if (messageId == AF_INET) 
-			{
-				auto address = reinterpret_cast<const sockaddr_in*>(messageData);
-				spdlog::info("Session {} connecting to IPv4 {}:{}", m_Id, inet_ntoa(address->sin_addr), htons(address->sin_port));
-			}
-			else if (messageId == AF_INET6)
-			{
-				auto address = reinterpret_cast<const sockaddr_in6*>(messageData);
-				char ipv6[INET6_ADDRSTRLEN];
-				inet_ntop(AF_INET6, &address->sin6_addr, ipv6, INET6_ADDRSTRLEN);
-				spdlog::info("Session {} connecting to IPv6 [{}]:{}", m_Id, ipv6, htons(address->sin6_port));
-			}
-
-			delete[] messageData;
+			spdlog::error("Redirector of session {} reads config format {} instead of {}.", m_Id, value, ConfigFormat::FORMAT_VERSION_);
+			return ERROR_INVALID_DATA;
 		}
 
-	} while (status == ERROR_SUCCESS || status == WAIT_TIMEOUT);
-	else 
-		spdlog::error("Failed to connect report named pipe in session {}. GetLastError={}.", m_Id, status);
+		m_Ready = true;
+	}
+	else
+		spdlog::warn("Unexpected config message {} in session {}.", id, m_Id);
+
+	return ERROR_SUCCESS;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-WinPipe::WinError Session::SendConfig(const BaseConfigManager::Config& config)
+WinPipe::WinError Session::WaitConfigAck(DWORD version, DWORD timeout)
 {
-	auto status = m_PipeConfig.Write(config);
+	auto status		= WinPipe::WinError{ ERROR_SUCCESS };
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
 
-	if (status == ERROR_PIPE_LISTENING)
+	// The acknowledgements of the configs that timed out before may come first,
+	// and the redirector skips the configs replaced before it has read them.
+	while (status == ERROR_SUCCESS && m_ConfigVersion.load(std::memory_order_relaxed) < version)
 	{
-		status = m_PipeConfig.Connect();
-		if (status == ERROR_SUCCESS || status == ERROR_PIPE_CONNECTED)
-			status = m_PipeConfig.Write(config);
+		auto wait = WinPipe::BaseNamedPipe::PIPE_WAIT_TIMEOUT_;
+
+		// Every read is bounded by the remaining time, so a stuck redirector does not hold the caller.
+		if (timeout != INFINITE)
+		{
+			auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			if (remaining <= 0)
+				return WAIT_TIMEOUT;
+
+			wait = (std::min)(wait, static_cast<DWORD>(remaining));
+		}
+
+		status = ReadConfigMessage(wait);
 	}
 
 	return status;
@@ -1,13 +1,20 @@
 #ifndef CLIENT_SESSION_H_
 #define CLIENT_SESSION_H_
 
+// Client session of an injected process.
+// The reports are read by callbacks on the server event loop: every callback
+// takes the available reports and waits for the next ones again.
 class Session : public AbstractSession, public std::enable_shared_from_this<Session>
 {
+	// Count of reports read at once.
+	static constexpr size_t REPORTS_BATCH_ = 256;
+
 	// Session constructor.
 	// Throws runtime_error if the StopEvent event is not created.
 	// @param id - session id.
 	// @param server - server instance.
-	Session(_In_ DWORD id, _In_ std::weak_ptr<AbstractServer> server);
+	// @param sink - sink of connection reports.
+	Session(_In_ DWORD id, _In_ std::weak_ptr<AbstractServer> server, _In_ std::shared_ptr<ReportSink> sink);
 
 public:
 	// Deleted default constructor.
@@ -19,25 +26,108 @@ public:
 	// Throws runtime_error if the StopEvent event is not created.
 	// @param id - session id.
 	// @param server - server instance.
-	static std::shared_ptr<Session> Create(_In_ DWORD id, _In_ std::weak_ptr<AbstractServer> server) {
-		return std::shared_ptr<Session>(new Session(id, server));
+	// @param sink - sink of connection reports.
+	static std::shared_ptr<Session> Create(_In_ DWORD id, _In_ std::weak_ptr<AbstractServer> server, _In_ std::shared_ptr<ReportSink> sink) {
+		return std::shared_ptr<Session>(new Session(id, server, sink));
 	}
 
 	// Stopping client session.
+	// Waits for the report callbacks, so it must not be called from the event loop.
 	void Stop() override;
 
-	// Sends new config to client.
-	void UpdateConfig(const BaseConfigManager::Config& config) override;
+	// Creates or closes the report transport for the config before it is published,
+	// so the redirector finds the transport when it applies the config.
+	// Waits for the report callbacks if the logging is disabled, so it must not be called from the event loop.
+	void PrepareConfig(const BaseConfigManager::Config& config) override;
+
+	// Waits for the client to report that it is initialized.
+	// Connects the config pipe on the first call.
+	// @returns true if the client is ready and reads the config format of the server.
+	bool WaitReady() override;
+
+	// Waits for the client to apply the published config.
+	// Connects the config pipe on the first call. Concurrent waits run one after another.
+	// @param version - published config version.
+	// @param timeout - waiting timeout in milliseconds. INFINITE - every read waits for the pipe default timeout.
+	// @returns true if the client has acknowledged the config version or a newer one.
+	bool WaitConfig(DWORD version, DWORD timeout = INFINITE) override;
+
+	// Returns version of the last config acknowledged by the client. 0 - none.
+	DWORD GetConfigVersion() const noexcept override {
+		return m_ConfigVersion.load(std::memory_order_relaxed);
+	}
+
+	// Returns count of received connection reports.
+	size_t GetReportCount() const noexcept override {
+		return m_ReportCount.load(std::memory_order_relaxed);
+	}
 
 private:
-	// Report thread routine.
-	void ReportThread();
+	// Session report callback.
+	using ReportHandler = void (Session::*)(WinPipe::WinError status);
+
+	// Starts reading the reports on the server event loop.
+	void StartReports();
+
+	// Stops reading the reports, wakes the report wait and waits for the report callbacks.
+	void StopReports();
+
+	// Marks the reports as stopped and wakes StopReports.
+	void FinishReports();
+
+	// Waits for the redirector to connect to the report named pipe.
+	void ConnectReports();
+
+	// Waits for the reports.
+	void ArmReports();
+
+	// Runs the handler on the event loop once the event is signaled.
+	// @param event - event to wait. nullptr - runs the handler at once.
+	// @param handler - report callback.
+	// @returns false if the handler is not queued.
+	bool ScheduleReports(_In_opt_ HANDLE event, _In_ ReportHandler handler);
+
+	// Called when the redirector connects to the report named pipe or the wait times out.
+	// @param status - wait status.
+	void OnReportsConnected(WinPipe::WinError status);
+
+	// Called when the reports may be available or the wait times out.
+	// @param status - wait status.
+	void OnReports(WinPipe::WinError status);
+
+	// Creates the shared report ring or, if it fails, the report named pipe.
+	void CreateReportTransport();
+
+	// Waits for the redirector to connect to the config named pipe, once per session.
+	// @returns ERROR_SUCCESS if success.
+	WinPipe::WinError ConnectConfig();
+
+	// Reads a message of the redirector from the config named pipe.
+	// @param timeout - read timeout in milliseconds.
+	// @returns ERROR_SUCCESS if success.
+	WinPipe::WinError ReadConfigMessage(DWORD timeout = WinPipe::BaseNamedPipe::PIPE_WAIT_TIMEOUT_);
 
-	WinPipe::WinError SendConfig(const BaseConfigManager::Config& config);
+	// Reads the acknowledgements until the config version or a newer one is acknowledged.
+	// @param version - published config version.
+	// @param timeout - waiting timeout in milliseconds, see WaitConfig.
+	// @returns ERROR_SUCCESS if success, WAIT_TIMEOUT if the timeout has expired.
+	WinPipe::WinError WaitConfigAck(DWORD version, DWORD timeout);
 
 	WinPipe::NamedPipeServer									m_PipeConfig;
-	std::unique_ptr<WinPipe::NamedPipeServer> m_PipeReport;
-	std::thread																m_ReportThread;
+	std::mutex																m_ConfigMutex;
+	std::atomic<DWORD>												m_ConfigVersion;
+	bool																			m_ConfigConnected;
+	bool																			m_Ready;
+	std::unique_ptr<WinPipe::NamedPipeServer>	m_PipeReport;
+	std::unique_ptr<AbstractReportTransport>	m_Reports;
+	std::shared_ptr<ReportSink>								m_Sink;
+	AbstractEventLoop*												m_Loop;
+	std::array<ReportRecord, REPORTS_BATCH_>	m_Records;
+	std::atomic<bool>													m_ReportStop;
+	std::atomic<size_t>												m_ReportCount;
+	bool																			m_ReportActive;
+	std::mutex																m_ReportMutex;
+	std::condition_variable										m_ReportCondition;
 };
 
 #endif // !CLIENT_SESSION_H_
@@ -0,0 +1,72 @@
+#include "global.h"
+
+namespace
+{
+	// Time in milliseconds after which the reaper thread checks the stop flag.
+	constexpr DWORD G_REAP_INTERVAL_ = 500;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SessionReaper::SessionReaper(_In_ SessionRegistry& sessions, _In_ AbstractSessionTracker& tracker) :
+	m_Sessions{ sessions },
+	m_Tracker{ tracker },
+	m_Totals{ 0, 0 },
+	m_Stop{ false }
+{
+	m_Thread = std::thread(&SessionReaper::ReaperThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SessionReaper::~SessionReaper()
+{
+	m_Stop = true;
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+AbstractServer::Totals SessionReaper::GetTotals() const
+{
+	std::lock_guard<std::mutex> lock(m_TotalsMutex);
+	return m_Totals;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SessionReaper::ReaperThread()
+{
+	auto id = DWORD{ 0 };
+
+	while (!m_Stop)
+	{
+		if (m_Tracker.WaitAny(id, G_REAP_INTERVAL_))
+			Reap(id);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SessionReaper::Reap(_In_ DWORD id)
+{
+	auto session = m_Sessions.Find(id);
+
+	// The session is deleted or replaced by a session of a new process with the same id.
+	if (!session || WaitForSingleObject(session->GetProcess().get(), 0) != WAIT_OBJECT_0)
+		return;
+
+	session->Stop();
+
+	// The session is replaced while it was stopped.
+	if (!m_Sessions.Erase(id, session))
+		return;
+
+	m_Tracker.Untrack(id);
+
+	{
+		std::lock_guard<std::mutex> lock(m_TotalsMutex);
+
+		m_Totals.m_Sessions	+= 1;
+		m_Totals.m_Reports	+= session->GetReportCount();
+	}
+
+	spdlog::info("Session {} is reaped, the process has exited. Reports={}.", id, session->GetReportCount());
+}
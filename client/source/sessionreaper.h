@@ -0,0 +1,44 @@
+#ifndef CLIENT_SESSION_REAPER_H_
+#define CLIENT_SESSION_REAPER_H_
+
+// Reaps the sessions of the exited processes in background.
+// The completed sessions are taken from the tracker, stopped and deleted from the registry,
+// and their counters are added to the totals. A session replaced by the session of a new
+// process with the same id is not reaped.
+class SessionReaper
+{
+public:
+	// Deleted default constructor.
+	SessionReaper() = delete;
+	// Stops the reaper thread.
+	~SessionReaper();
+	// Deleted copy constructor.
+	SessionReaper(const SessionReaper&) = delete;
+	// Deleted copy assigment.
+	SessionReaper& operator=(const SessionReaper&) = delete;
+
+	// SessionReaper constructor. Starts the reaper thread.
+	// @param sessions - registered sessions. Must outlive the reaper.
+	// @param tracker - lifetime of the sessions. Must outlive the reaper.
+	SessionReaper(_In_ SessionRegistry& sessions, _In_ AbstractSessionTracker& tracker);
+
+	// Returns counters of the reaped sessions.
+	AbstractServer::Totals GetTotals() const;
+
+private:
+	// Reaper thread routine.
+	void ReaperThread();
+
+	// Stops and deletes the session of an exited process.
+	// @param id - session id.
+	void Reap(_In_ DWORD id);
+
+	SessionRegistry&				m_Sessions;			// Registered sessions.
+	AbstractSessionTracker&	m_Tracker;			// Lifetime of the sessions.
+	mutable std::mutex			m_TotalsMutex;	// Locks the totals.
+	AbstractServer::Totals	m_Totals;				// Counters of the reaped sessions.
+	std::atomic<bool>				m_Stop;					// true - the reaper thread must exit.
+	std::thread							m_Thread;				// Reaper thread.
+};
+
+#endif // !CLIENT_SESSION_REAPER_H_
@@ -0,0 +1,71 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SessionRegistry::SessionRegistry() :
+	m_Size{ 0 }
+{ }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<AbstractSession> SessionRegistry::Find(_In_ DWORD id) const
+{
+	auto& shard = GetShard(id);
+	std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+	auto iter = shard.m_Sessions.find(id);
+	return iter != shard.m_Sessions.end() ? iter->second : nullptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SessionRegistry::Erase(_In_ DWORD id)
+{
+	auto& shard = GetShard(id);
+	std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+	if (shard.m_Sessions.erase(id) == 0)
+		return false;
+
+	m_Size.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SessionRegistry::Erase(_In_ DWORD id, _In_ const std::shared_ptr<AbstractSession>& session)
+{
+	auto& shard = GetShard(id);
+	std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+	auto iter = shard.m_Sessions.find(id);
+	if (iter == shard.m_Sessions.end() || iter->second != session)
+		return false;
+
+	shard.m_Sessions.erase(iter);
+	m_Size.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SessionRegistry::Contains(_In_ DWORD id) const
+{
+	auto& shard = GetShard(id);
+	std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+	return shard.m_Sessions.find(id) != shard.m_Sessions.end();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SessionRegistry::Snapshot SessionRegistry::GetSnapshot() const
+{
+	auto snapshot = Snapshot();
+
+	snapshot.reserve(Size());
+
+	for (auto& shard : m_Shards)
+	{
+		std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+		for (const auto& [id, session] : shard.m_Sessions)
+			snapshot.push_back(session);
+	}
+
+	return snapshot;
+}
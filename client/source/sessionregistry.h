@@ -0,0 +1,99 @@
+#ifndef CLIENT_SESSION_REGISTRY_H_
+#define CLIENT_SESSION_REGISTRY_H_
+
+// Concurrent registry of the sessions.
+// Sessions are spread over shards by id, each with its own lock on its own cache line,
+// so lookups and inserts of different sessions rarely contend. Broadcasts iterate
+// a snapshot: every shard is locked only while its sessions are copied, and the
+// sessions are called without any lock, so a slow session never blocks an insert.
+class SessionRegistry
+{
+	// Sessions of a single shard.
+	struct alignas(64) Shard
+	{
+		std::mutex																									m_Mutex;		// Locks shard sessions.
+		std::unordered_map<DWORD, std::shared_ptr<AbstractSession>>	m_Sessions;	// Sessions by id.
+	};
+
+	// Count of shards, a power of two.
+	static constexpr size_t SHARDS_ = 16;
+
+public:
+	// Sessions taken at once.
+	using Snapshot = std::vector<std::shared_ptr<AbstractSession>>;
+
+	// Default constructor.
+	SessionRegistry();
+	// Default destructor.
+	~SessionRegistry() = default;
+	// Deleted copy constructor.
+	SessionRegistry(const SessionRegistry&) = delete;
+	// Deleted copy assigment.
+	SessionRegistry& operator=(const SessionRegistry&) = delete;
+
+	// Inserts the session. The registered session of the same id is replaced
+	// if the predicate, called under the shard lock, returns true for it.
+	// @param session - session to insert.
+	// @param replace - predicate called with const std::shared_ptr<AbstractSession>&.
+	// @returns false if the registered session is kept.
+	template <typename Predicate>
+	bool Insert(_In_ const std::shared_ptr<AbstractSession>& session, _In_ Predicate&& replace)
+	{
+		auto& shard = GetShard(session->GetId());
+		std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+		auto [iter, inserted] = shard.m_Sessions.try_emplace(session->GetId(), session);
+
+		if (!inserted)
+		{
+			if (!replace(iter->second))
+				return false;
+
+			iter->second = session;
+		}
+		else
+			m_Size.fetch_add(1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	// Returns the session or nullptr if it is not registered.
+	// @param id - session id.
+	std::shared_ptr<AbstractSession> Find(_In_ DWORD id) const;
+
+	// Removes the session.
+	// @param id - session id.
+	// @returns false if the session is not registered.
+	bool Erase(_In_ DWORD id);
+
+	// Removes the session if it is still registered.
+	// @param id - session id.
+	// @param session - registered session.
+	// @returns false if the session is not registered.
+	bool Erase(_In_ DWORD id, _In_ const std::shared_ptr<AbstractSession>& session);
+
+	// Returns true if the session is registered.
+	// @param id - session id.
+	bool Contains(_In_ DWORD id) const;
+
+	// Returns the registered sessions.
+	Snapshot GetSnapshot() const;
+
+	// Returns count of registered sessions.
+	size_t Size() const noexcept {
+		return m_Size.load(std::memory_order_relaxed);
+	}
+
+private:
+	// Returns the shard of the session.
+	// Process ids are multiples of 4, so the low bits are skipped.
+	// @param id - session id.
+	Shard& GetShard(_In_ DWORD id) const noexcept {
+		return m_Shards[(static_cast<size_t>(id) >> 2) & (SHARDS_ - 1)];
+	}
+
+	mutable Shard				m_Shards[SHARDS_];	// Registry shards.
+	std::atomic<size_t>	m_Size;							// Count of registered sessions.
+};
+
+#endif // !CLIENT_SESSION_REGISTRY_H_
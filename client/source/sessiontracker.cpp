@@ -0,0 +1,126 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SessionTracker::SessionTracker() :
+	m_Running{ 0 }
+{ }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SessionTracker::~SessionTracker()
+{
+	auto ids = std::vector<DWORD>();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		for (const auto& [id, entry] : m_Entries)
+			ids.push_back(id);
+	}
+
+	for (auto id : ids)
+		Untrack(id);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SessionTracker::Track(_In_ DWORD id, _In_ HANDLE object)
+{
+	auto entry	= std::make_unique<Entry>(Entry{ this, id, nullptr, false });
+	auto lock		= std::unique_lock<std::mutex>(m_Mutex);
+
+	if (m_Entries.find(id) != m_Entries.end())
+		return false;
+
+	// The callback locks the mutex, so it does not see the entry before it is registered.
+	if (!RegisterWaitForSingleObject(&entry->m_Wait, object, &SessionTracker::OnStop, entry.get(), INFINITE, WT_EXECUTEONLYONCE))
+		return false;
+
+	m_Entries.emplace(id, std::move(entry));
+	++m_Running;
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SessionTracker::Untrack(_In_ DWORD id)
+{
+	auto entry = std::unique_ptr<Entry>();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		auto it = m_Entries.find(id);
+		if (it == m_Entries.end())
+			return;
+
+		entry = std::move(it->second);
+		m_Entries.erase(it);
+	}
+
+	// Waiting for the running callback, so the entry may be released.
+	UnregisterWaitEx(entry->m_Wait, INVALID_HANDLE_VALUE);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (!entry->m_Completed)
+			--m_Running;
+
+		m_Completed.erase(std::remove(m_Completed.begin(), m_Completed.end(), id), m_Completed.end());
+	}
+
+	m_Condition.notify_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SessionTracker::WaitAll(_In_opt_ DWORD timeout)
+{
+	auto lock = std::unique_lock<std::mutex>(m_Mutex);
+	return WaitFor(lock, timeout, [this] { return m_Running == 0; });
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SessionTracker::WaitAny(_Out_ DWORD& id, _In_opt_ DWORD timeout)
+{
+	auto lock = std::unique_lock<std::mutex>(m_Mutex);
+
+	id = 0;
+
+	if (!WaitFor(lock, timeout, [this] { return !m_Completed.empty(); }))
+		return false;
+
+	id = m_Completed.front();
+	m_Completed.pop_front();
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t SessionTracker::GetRunning() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Running;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SessionTracker::Complete(_Inout_ Entry& entry)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (entry.m_Completed)
+			return;
+
+		entry.m_Completed = true;
+		--m_Running;
+		m_Completed.push_back(entry.m_Id);
+	}
+
+	m_Condition.notify_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VOID CALLBACK SessionTracker::OnStop(_In_ PVOID context, _In_ BOOLEAN timedOut)
+{
+	auto entry = static_cast<Entry*>(context);
+	entry->m_Tracker->Complete(*entry);
+}
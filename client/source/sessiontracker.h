@@ -0,0 +1,80 @@
+#ifndef CLIENT_SESSION_TRACKER_H_
+#define CLIENT_SESSION_TRACKER_H_
+
+// Tracks the lifetime of the sessions.
+// The process of every session is waited by the system thread pool, which waits
+// for many objects per thread, so the count of sessions is not limited by MAXIMUM_WAIT_OBJECTS.
+// The completions count the running sessions down like a latch, so waiting for all
+// sessions does not scan them, and the completed sessions are queued for the wait-any.
+class SessionTracker : public AbstractSessionTracker
+{
+	// Tracked session.
+	struct Entry
+	{
+		SessionTracker*	m_Tracker;		// Owner.
+		DWORD						m_Id;					// Session id.
+		HANDLE					m_Wait;				// Wait registration.
+		bool						m_Completed;	// true - the session is completed.
+	};
+
+public:
+	// Default constructor.
+	SessionTracker();
+	// Stops tracking all sessions.
+	~SessionTracker();
+	// Deleted copy constructor.
+	SessionTracker(const SessionTracker&) = delete;
+	// Deleted copy assigment.
+	SessionTracker& operator=(const SessionTracker&) = delete;
+
+	// Starts tracking the session.
+	bool Track(_In_ DWORD id, _In_ HANDLE object) override;
+
+	// Stops tracking the session. Waits for its completion callback,
+	// so it must not be called from the callback.
+	void Untrack(_In_ DWORD id) override;
+
+	// Waits for all tracked sessions to complete.
+	bool WaitAll(_In_opt_ DWORD timeout = INFINITE) override;
+
+	// Waits for any tracked session to complete and takes it from the completed queue.
+	bool WaitAny(_Out_ DWORD& id, _In_opt_ DWORD timeout = INFINITE) override;
+
+	// Returns count of running sessions.
+	size_t GetRunning() const override;
+
+private:
+	// Marks the session as completed.
+	// @param entry - tracked session.
+	void Complete(_Inout_ Entry& entry);
+
+	// Waits on the condition until the predicate is true or the timeout elapses.
+	// @param lock - locked mutex.
+	// @param timeout - time in milliseconds.
+	// @param predicate - wait predicate.
+	// @returns predicate result.
+	template <typename Predicate>
+	bool WaitFor(_In_ std::unique_lock<std::mutex>& lock, _In_ DWORD timeout, _In_ Predicate predicate)
+	{
+		if (timeout == INFINITE)
+		{
+			m_Condition.wait(lock, predicate);
+			return true;
+		}
+
+		return m_Condition.wait_for(lock, std::chrono::milliseconds(timeout), predicate);
+	}
+
+	// Called by the system thread pool when the session object is signaled.
+	// @param context - tracked session.
+	// @param timedOut - always false, the wait has no timeout.
+	static VOID CALLBACK OnStop(_In_ PVOID context, _In_ BOOLEAN timedOut);
+
+	mutable std::mutex																m_Mutex;			// Locks the tracker state.
+	std::condition_variable														m_Condition;	// Signaled when a session completes or is untracked.
+	std::unordered_map<DWORD, std::unique_ptr<Entry>>	m_Entries;		// Tracked sessions.
+	std::deque<DWORD>																	m_Completed;	// Completed sessions not taken by the wait-any.
+	size_t																						m_Running;		// Count of running sessions.
+};
+
+#endif // !CLIENT_SESSION_TRACKER_H_
@@ -8,13 +8,56 @@ enum class ProxyType : uint8_t
 	Socks5
 };
 
+// Routing rule action.
+enum class RuleAction : uint8_t
+{
+	Proxy,	// Connect through the proxy server.
+	Direct,	// Connect directly.
+	Block		// Refuse the connect.
+};
+
+// Behaviour of the connection reports queue when it is full.
+enum class ReportPolicy : uint8_t
+{
+	DropNew,		// Drop the new report.
+	DropOldest,	// Drop the oldest queued report.
+	Block				// Wait until the report is queued.
+};
+
 // Application Configuration Base Class.
 // It implements methods for checking the correctness of the configuration.
 class BaseConfigManager
 {
 public:
+	// Maximal count of additional upstream proxy servers.
+	static constexpr size_t MAX_UPSTREAMS_ = 8;
+	// Id of the config pipe message with the applied config version, sent by the redirector.
+	// The config itself is read from the config section.
+	static constexpr WORD ACK_MESSAGE_ID_ = 2;
+	// Id of the config pipe message sent by the redirector once its hooks are installed,
+	// before it reads the config section. Carries the config format version of the redirector.
+	static constexpr WORD READY_MESSAGE_ID_ = 3;
+
 #	pragma pack(push)
 #	pragma pack(1)
+	// Additional upstream proxy server.
+	struct Upstream
+	{
+		SOCKADDR_INET	m_Address;	// IPv4 or IPv6 address of proxy server.
+		BYTE					m_Weight;		// Selection weight. 0 - upstream is not used.
+	};
+
+	// Routing rule for the target addresses of a CIDR prefix and a port range.
+	struct Rule
+	{
+		ADDRESS_FAMILY	m_Family;					// AF_INET or AF_INET6.
+		BYTE						m_Address[16];		// Prefix address in network byte order.
+		BYTE						m_PrefixLength;		// Prefix length in bits.
+		WORD						m_PortFirst;			// First port of the range in host byte order.
+		WORD						m_PortLast;				// Last port of the range in host byte order.
+		RuleAction			m_Action;					// Action for the matched connects.
+	};
+
 	// Configuration data.
 	struct Config
 	{
@@ -22,16 +65,25 @@ public:
 		sockaddr_in		m_ProxyV4;				// IPv4 address of proxy server.
 		sockaddr_in6	m_ProxyV6;				// IPv6 address of proxy server.
 		bool					m_LoggingEnable;	// true - enable client logging.
+		bool					m_Socks5Pipelining;	// true - send socks5 greeting and request in one write.
+		Upstream			m_Upstreams[MAX_UPSTREAMS_];	// Additional upstream proxy servers.
+		BYTE					m_UpstreamsCount;		// Count of additional upstream proxy servers.
+		ReportPolicy	m_ReportPolicy;			// Behaviour of the full connection reports queue.
+		DWORD					m_Version;					// Config version, acknowledged by the redirector when it is applied.
 	};
 #	pragma pack(pop)
 
+	// Ordered routing rules.
+	using Rules = std::vector<Rule>;
+
 	// BaseConfigManager constructor.
 	// @param proxyType - proxy type. by default is unknown.
 	// @param proxyAddress - proxy address. by default is 0.
 	// @param proxyPort - proxy port. by default is 0.
 	// @param logginEnable - true - enable logging, false - disable. by default false.
-	BaseConfigManager(_In_opt_ ProxyType proxyType = ProxyType::Unknown, _In_opt_ sockaddr_in proxyV4 = { 0 }, _In_opt_ sockaddr_in6 proxyV6 = { 0 }, _In_opt_ bool loggingEnable = false) :
-		m_Config{ proxyType, proxyV4, proxyV6, loggingEnable }
+	// @param socks5Pipelining - true - enable socks5 pipelining. by default false.
+	BaseConfigManager(_In_opt_ ProxyType proxyType = ProxyType::Unknown, _In_opt_ sockaddr_in proxyV4 = { 0 }, _In_opt_ sockaddr_in6 proxyV6 = { 0 }, _In_opt_ bool loggingEnable = false, _In_opt_ bool socks5Pipelining = false) :
+		m_Config{ proxyType, proxyV4, proxyV6, loggingEnable, socks5Pipelining }
 	{ }
 
 	// BaseConfigManager constructor.
@@ -48,6 +100,11 @@ public:
 		return m_Config;
 	}
 
+	// Returns current routing rules.
+	const Rules& GetRules() const noexcept {
+		return m_Rules;
+	}
+
 	// Returns true if current config are valid.
 	bool IsValid() const noexcept {
 		return Validate(m_Config);
@@ -72,7 +129,8 @@ public:
 	}
 
 protected:
-	Config m_Config;
+	Config	m_Config;	// Current config.
+	Rules		m_Rules;	// Current routing rules.
 };
 
 #endif // !COMMON_BASE_CONFIG_H_
@@ -0,0 +1,188 @@
+#ifndef COMMON_CONFIG_FORMAT_H_
+#define COMMON_CONFIG_FORMAT_H_
+
+// Versioned binary format of the config and the routing rules.
+// The data starts with a header and a table of sections, every section is
+// length-prefixed by its table entry, and the arrays carry their element size.
+// A reader skips unknown sections and zero-fills or ignores the struct fields
+// it does not know, so fields and sections may be appended without breaking
+// older redirectors. The major version changes only for incompatible layouts.
+class ConfigFormat
+{
+public:
+	// Format signature.
+	static constexpr uint32_t FORMAT_MAGIC_ = 0x47464350;
+	// Format version, changed for incompatible layouts.
+	static constexpr uint16_t FORMAT_VERSION_ = 1;
+
+	// Section type.
+	enum class Section : uint16_t
+	{
+		Config	= 1,	// BaseConfigManager::Config.
+		Rules		= 2		// Array of BaseConfigManager::Rule.
+	};
+
+#	pragma pack(push)
+#	pragma pack(1)
+	// Format header.
+	struct Header
+	{
+		uint32_t	m_Magic;		// FORMAT_MAGIC_.
+		uint16_t	m_Version;	// FORMAT_VERSION_.
+		uint16_t	m_Count;		// Count of sections.
+		uint32_t	m_Size;			// Size of the data including the header.
+	};
+
+	// Section table entry.
+	struct Entry
+	{
+		uint16_t	m_Type;			// Section type.
+		uint16_t	m_Stride;		// Size of the section struct or of the array element.
+		uint32_t	m_Offset;		// Offset of the section from the beginning of the data.
+		uint32_t	m_Size;			// Size of the section.
+	};
+#	pragma pack(pop)
+
+	// Returns size of the encoded config.
+	// @param rules - count of routing rules.
+	static constexpr size_t GetSize(_In_ size_t rules) noexcept {
+		return sizeof(Header) + 2 * sizeof(Entry) + sizeof(BaseConfigManager::Config) + rules * sizeof(BaseConfigManager::Rule);
+	}
+
+	// Encodes the config and the routing rules.
+	// @param config - app config.
+	// @param rules - routing rules.
+	// @param buffer - encoded data. The buffer is reused, it is not shrunk.
+	static void Encode(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules, _Out_ std::vector<uint8_t>& buffer)
+	{
+		auto size		= GetSize(rules.size());
+		auto offset = static_cast<uint32_t>(sizeof(Header) + 2 * sizeof(Entry));
+
+		Header header{ FORMAT_MAGIC_, FORMAT_VERSION_, 2, static_cast<uint32_t>(size) };
+		Entry	 entries[] =
+		{
+			{ static_cast<uint16_t>(Section::Config), sizeof(BaseConfigManager::Config), offset, sizeof(BaseConfigManager::Config) },
+			{ static_cast<uint16_t>(Section::Rules), sizeof(BaseConfigManager::Rule), offset + static_cast<uint32_t>(sizeof(BaseConfigManager::Config)), static_cast<uint32_t>(rules.size() * sizeof(BaseConfigManager::Rule)) }
+		};
+
+		buffer.resize(size);
+
+		std::memcpy(buffer.data(), &header, sizeof(header));
+		std::memcpy(buffer.data() + sizeof(header), entries, sizeof(entries));
+		std::memcpy(buffer.data() + entries[0].m_Offset, &config, sizeof(config));
+
+		if (!rules.empty())
+			std::memcpy(buffer.data() + entries[1].m_Offset, rules.data(), entries[1].m_Size);
+	}
+
+	// Validated view of the encoded config. Reads the data in place, the data must outlive the view.
+	class View
+	{
+	public:
+		// Default constructor. Creates an empty view.
+		View() = default;
+
+		// Validates the data once. The getters do not check the data again.
+		// @param data - encoded data.
+		// @param size - size of the data.
+		// @returns false if the data is not a valid config of a known version.
+		bool Parse(_In_ const uint8_t* data, _In_ size_t size) noexcept
+		{
+			auto header = Header();
+
+			*this = View();
+
+			if (size < sizeof(header))
+				return false;
+
+			std::memcpy(&header, data, sizeof(header));
+
+			if (header.m_Magic != FORMAT_MAGIC_ || header.m_Version != FORMAT_VERSION_ || header.m_Size > size ||
+					header.m_Size < sizeof(header) + static_cast<size_t>(header.m_Count) * sizeof(Entry))
+				return false;
+
+			for (uint16_t i = 0; i < header.m_Count; ++i)
+			{
+				auto entry = Entry();
+				std::memcpy(&entry, data + sizeof(header) + i * sizeof(Entry), sizeof(entry));
+
+				if (entry.m_Offset > header.m_Size || entry.m_Size > header.m_Size - entry.m_Offset)
+					return false;
+
+				// Unknown sections are written by newer clients.
+				if (entry.m_Type == static_cast<uint16_t>(Section::Config))
+				{
+					if (m_Config.m_Stride != 0 || entry.m_Stride == 0 || entry.m_Size != entry.m_Stride)
+						return false;
+
+					m_Config = entry;
+				}
+				else if (entry.m_Type == static_cast<uint16_t>(Section::Rules))
+				{
+					if (m_Rules.m_Stride != 0 || entry.m_Stride == 0 || entry.m_Size % entry.m_Stride != 0)
+						return false;
+
+					m_Rules = entry;
+				}
+			}
+
+			if (m_Config.m_Stride == 0)
+				return false;
+
+			m_Data = data;
+			return true;
+		}
+
+		// Returns true if the view holds a parsed config.
+		bool IsValid() const noexcept {
+			return m_Data != nullptr;
+		}
+
+		// Copies the config. Fields missing in the data are zero.
+		// @param config - app config.
+		void GetConfig(_Out_ BaseConfigManager::Config& config) const noexcept
+		{
+			std::memset(&config, 0, sizeof(config));
+			std::memcpy(&config, m_Data + m_Config.m_Offset, (std::min<size_t>)(m_Config.m_Size, sizeof(config)));
+		}
+
+		// Returns count of routing rules.
+		size_t GetRuleCount() const noexcept {
+			return m_Rules.m_Stride != 0 ? m_Rules.m_Size / m_Rules.m_Stride : 0;
+		}
+
+		// Copies the routing rule. Fields missing in the data are zero.
+		// @param index - rule index, less than GetRuleCount.
+		// @param rule - routing rule.
+		void GetRule(_In_ size_t index, _Out_ BaseConfigManager::Rule& rule) const noexcept
+		{
+			std::memset(&rule, 0, sizeof(rule));
+			std::memcpy(&rule, m_Data + m_Rules.m_Offset + index * m_Rules.m_Stride, (std::min<size_t>)(m_Rules.m_Stride, sizeof(rule)));
+		}
+
+		// Copies the routing rules with a single copy if the rule layout is the same.
+		// @param rules - routing rules. The vector is reused, it is not shrunk.
+		void GetRules(_Out_ BaseConfigManager::Rules& rules) const
+		{
+			rules.resize(GetRuleCount());
+
+			if (m_Rules.m_Stride == sizeof(BaseConfigManager::Rule))
+			{
+				if (!rules.empty())
+					std::memcpy(rules.data(), m_Data + m_Rules.m_Offset, m_Rules.m_Size);
+
+				return;
+			}
+
+			for (size_t i = 0; i < rules.size(); ++i)
+				GetRule(i, rules[i]);
+		}
+
+	private:
+		const uint8_t*	m_Data{ nullptr };	// Encoded data.
+		Entry						m_Config{ };				// Config section.
+		Entry						m_Rules{ };					// Rules section. Stride 0 - there are no rules.
+	};
+};
+
+#endif // !COMMON_CONFIG_FORMAT_H_
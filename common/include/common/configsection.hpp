@@ -0,0 +1,109 @@
+#ifndef COMMON_CONFIG_SECTION_H_
+#define COMMON_CONFIG_SECTION_H_
+
+// Current config and routing rules in a named shared memory section.
+// The client writes the section once per config change, whatever the count of
+// injected processes, and every redirector maps it read-only and polls its generation.
+// The data is encoded with ConfigFormat.
+class ConfigSection
+{
+	// Unmaps section view.
+	struct ViewDeleter
+	{
+		void operator()(_In_ void* view) {
+			UnmapViewOfFile(view);
+		}
+	};
+
+public:
+	// Maximal count of routing rules.
+	static constexpr uint32_t MAX_RULES_ = 4096;
+	// Maximal size of the section data.
+	static constexpr uint32_t CAPACITY_ = static_cast<uint32_t>(ConfigFormat::GetSize(MAX_RULES_));
+
+	// Deleted default constructor.
+	ConfigSection() = delete;
+	// Default destructor.
+	~ConfigSection() = default;
+	// Deleted copy constructor.
+	ConfigSection(const ConfigSection&) = delete;
+	// Deleted copy assigment.
+	ConfigSection& operator=(const ConfigSection&) = delete;
+
+	// ConfigSection constructor.
+	// Throws runtime_error if the section is not created or opened.
+	// @param writer - true - create the section for writing, false - open the section created by the client for reading.
+	explicit ConfigSection(_In_ bool writer)
+	{
+		auto name = ObjectNames::GetConfigSectionName();
+		auto size = SharedSeqLock::GetSize(CAPACITY_);
+
+		if (writer)
+		{
+			m_Section = WinPipe::WinHandle(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), name.c_str()));
+
+			// The section of another client would be overwritten.
+			if (m_Section.get() && GetLastError() == ERROR_ALREADY_EXISTS)
+				throw std::runtime_error("Config section is owned by another client.");
+		}
+		else
+			m_Section = WinPipe::WinHandle(OpenFileMappingW(FILE_MAP_READ, FALSE, name.c_str()));
+
+		if (!m_Section.get())
+			throw std::runtime_error("Failed to create config section.");
+
+		m_View = std::unique_ptr<void, ViewDeleter>(MapViewOfFile(m_Section.get(), writer ? FILE_MAP_READ | FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+		if (!m_View.get())
+			throw std::runtime_error("Failed to map config section.");
+
+		auto information = MEMORY_BASIC_INFORMATION{ 0 };
+		VirtualQuery(m_View.get(), &information, sizeof(information));
+
+		m_Lock = std::make_unique<SharedSeqLock>(m_View.get(), information.RegionSize, writer ? CAPACITY_ : 0);
+	}
+
+	// Returns count of written configs. 0 - nothing is written yet.
+	uint64_t GetGeneration() const noexcept {
+		return m_Lock->GetGeneration();
+	}
+
+	// Replaces the config and the rules. Called by the client, there must be a single writer.
+	// @param config - app config.
+	// @param rules - routing rules.
+	// @returns false if there are more than MAX_RULES_ rules.
+	bool Write(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules)
+	{
+		if (rules.size() > MAX_RULES_)
+			return false;
+
+		ConfigFormat::Encode(config, rules, m_Buffer);
+		return m_Lock->Write(m_Buffer.data(), m_Buffer.size());
+	}
+
+	// Reads the config and the rules. Called by the redirector.
+	// @param config - app config.
+	// @param rules - routing rules.
+	// @param generation - generation of the read data, 0 if nothing is written yet.
+	// @returns false if nothing is written yet or the data is not a valid config.
+	bool Read(_Out_ BaseConfigManager::Config& config, _Out_ BaseConfigManager::Rules& rules, _Out_ uint64_t& generation)
+	{
+		auto view = ConfigFormat::View();
+
+		generation = m_Lock->Read(m_Buffer);
+
+		if (generation == 0 || !view.Parse(m_Buffer.data(), m_Buffer.size()))
+			return false;
+
+		view.GetConfig(config);
+		view.GetRules(rules);
+		return true;
+	}
+
+private:
+	WinPipe::WinHandle								m_Section;	// Section handle.
+	std::unique_ptr<void, ViewDeleter>	m_View;			// Section view.
+	std::unique_ptr<SharedSeqLock>			m_Lock;			// Sequence lock over the view.
+	std::vector<uint8_t>								m_Buffer;		// Reused data buffer.
+};
+
+#endif // !COMMON_CONFIG_SECTION_H_
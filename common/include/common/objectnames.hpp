@@ -15,11 +15,38 @@ namespace ObjectNames
 		return LR"(\\.\pipe\PROXY_CLIENT_CONFIG_)" + std::to_wstring(id);
 	}
 
+	// Returns config section name. There is a single section for all redirectors.
+	inline std::wstring GetConfigSectionName() {
+		return L"PROXY_CLIENT_CONFIG_SECTION";
+	}
+
+	// Returns control pipe name of the client daemon.
+	inline std::wstring GetControlPipeName() {
+		return LR"(\\.\pipe\PROXY_CLIENT_CONTROL)";
+	}
+
+	// Returns name of the trace session watching the started processes.
+	inline std::wstring GetProcessTraceName() {
+		return L"PROXY_CLIENT_PROCESS_TRACE";
+	}
+
 	// Returns report pipe name.
 	// @param id - pipe ID.
 	inline std::wstring GetReportPipeName(_In_ DWORD id) {
 		return LR"(\\.\pipe\PROXY_CLIENT_REPORT_)" + std::to_wstring(id);
 	}
+
+	// Returns report ring section name.
+	// @param id - section ID.
+	inline std::wstring GetReportRingName(_In_ DWORD id) {
+		return L"PROXY_CLIENT_REPORT_RING_" + std::to_wstring(id);
+	}
+
+	// Returns report ring wake up event name.
+	// @param id - event ID.
+	inline std::wstring GetReportRingEventName(_In_ DWORD id) {
+		return L"PROXY_CLIENT_REPORT_RING_EVENT_" + std::to_wstring(id);
+	}
 }
 
 #endif // !COMMON_OBJECT_NAMES_H_
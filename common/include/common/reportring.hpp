@@ -0,0 +1,154 @@
+#ifndef COMMON_REPORT_RING_H_
+#define COMMON_REPORT_RING_H_
+
+#pragma pack(push)
+#pragma pack(1)
+// Connection report record with a fixed layout.
+struct ReportRecord
+{
+	uint16_t	m_Id;					// Report id, the address family of the target.
+	uint8_t		m_Size;				// Size of the report data.
+	uint8_t		m_Reserved;		// Reserved, 0.
+	uint8_t		m_Data[28];		// Report data, sockaddr_in or sockaddr_in6 of the target.
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ReportRecord) == 32, "ReportRecord layout is shared by processes.");
+
+// Single-producer single-consumer ring of report records over shared memory.
+// The ring uses only lock-free atomics, so it works across processes and does
+// not depend on the platform. Waking the consumer is left to the transport:
+// the consumer marks itself waiting before it sleeps, and the producer checks
+// the mark after every push.
+class ReportRing
+{
+	// Ring header at the beginning of the memory. The positions are on their own cache lines.
+	struct Header
+	{
+		uint32_t											m_Magic;		// RING_MAGIC_.
+		uint32_t											m_Capacity;	// Count of records, a power of two.
+		alignas(64) std::atomic<uint64_t>	m_Tail;			// Count of pushed records. Written by the producer.
+		alignas(64) std::atomic<uint64_t>	m_Head;			// Count of popped records. Written by the consumer.
+		alignas(64) std::atomic<uint32_t>	m_Waiting;	// 1 - the consumer waits for a wake up.
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring positions must be address-free.");
+
+public:
+	// Ring signature.
+	static constexpr uint32_t RING_MAGIC_ = 0x52505243;
+
+	// Returns size of the memory for the ring.
+	// @param capacity - count of records, a power of two.
+	static constexpr size_t GetSize(_In_ uint32_t capacity) noexcept {
+		return sizeof(Header) + static_cast<size_t>(capacity) * sizeof(ReportRecord);
+	}
+
+	// Deleted default constructor.
+	ReportRing() = delete;
+	// Default destructor.
+	~ReportRing() = default;
+	// Deleted copy constructor.
+	ReportRing(const ReportRing&) = delete;
+	// Deleted copy assigment.
+	ReportRing& operator=(const ReportRing&) = delete;
+
+	// ReportRing constructor.
+	// Throws runtime_error if the memory does not hold a ring.
+	// @param memory - memory of GetSize bytes, aligned to the cache line.
+	// @param size - size of the memory.
+	// @param capacity - count of records, a power of two. 0 - open the ring initialized by the other side.
+	ReportRing(_In_ void* memory, _In_ size_t size, _In_opt_ uint32_t capacity = 0) :
+		m_Header{ static_cast<Header*>(memory) },
+		m_Records{ reinterpret_cast<ReportRecord*>(static_cast<uint8_t*>(memory) + sizeof(Header)) }
+	{
+		if (capacity != 0)
+		{
+			if ((capacity & (capacity - 1)) != 0 || size < GetSize(capacity))
+				throw std::runtime_error("Invalid report ring capacity.");
+
+			new (m_Header) Header{ RING_MAGIC_, capacity };
+		}
+		else if (size < sizeof(Header) || m_Header->m_Magic != RING_MAGIC_ || m_Header->m_Capacity == 0 ||
+						(m_Header->m_Capacity & (m_Header->m_Capacity - 1)) != 0 || size < GetSize(m_Header->m_Capacity))
+			throw std::runtime_error("Invalid report ring.");
+
+		m_Capacity = m_Header->m_Capacity;
+	}
+
+	// Returns count of records the ring holds.
+	uint32_t GetCapacity() const noexcept {
+		return m_Capacity;
+	}
+
+	// Pushes the records. Called by the producer.
+	// @param records - records to push.
+	// @param count - count of records.
+	// @returns count of pushed records, less than count if the ring is full.
+	size_t Push(_In_ const ReportRecord* records, _In_ size_t count) noexcept
+	{
+		auto tail		= m_Header->m_Tail.load(std::memory_order_relaxed);
+		auto head		= m_Header->m_Head.load(std::memory_order_acquire);
+		auto pushed = (std::min)(count, static_cast<size_t>(m_Capacity - (std::min<uint64_t>)(tail - head, m_Capacity)));
+
+		for (size_t i = 0; i < pushed; ++i)
+			m_Records[(tail + i) & (m_Capacity - 1)] = records[i];
+
+		m_Header->m_Tail.store(tail + pushed, std::memory_order_release);
+		return pushed;
+	}
+
+	// Returns true if the consumer waits for a wake up, and clears the mark. Called by the producer after Push.
+	bool TakeWaiting() noexcept
+	{
+		// Orders the pushed tail before the mark check, paired with PrepareWait.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		return m_Header->m_Waiting.load(std::memory_order_relaxed) != 0 && m_Header->m_Waiting.exchange(0, std::memory_order_seq_cst) != 0;
+	}
+
+	// Pops the records. Called by the consumer.
+	// @param records - buffer.
+	// @param count - count of records the buffer holds.
+	// @returns count of popped records.
+	size_t Pop(_Out_ ReportRecord* records, _In_ size_t count) noexcept
+	{
+		auto head		= m_Header->m_Head.load(std::memory_order_relaxed);
+		auto tail		= m_Header->m_Tail.load(std::memory_order_acquire);
+		auto popped = (std::min)(count, static_cast<size_t>((std::min<uint64_t>)(tail - head, m_Capacity)));
+
+		for (size_t i = 0; i < popped; ++i)
+			records[i] = m_Records[(head + i) & (m_Capacity - 1)];
+
+		m_Header->m_Head.store(head + popped, std::memory_order_release);
+		return popped;
+	}
+
+	// Marks the consumer waiting. Called by the consumer before it sleeps.
+	// @returns false if the ring is not empty, the mark is cleared and the consumer must not sleep.
+	bool PrepareWait() noexcept
+	{
+		m_Header->m_Waiting.store(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (m_Header->m_Tail.load(std::memory_order_acquire) != m_Header->m_Head.load(std::memory_order_relaxed))
+		{
+			m_Header->m_Waiting.store(0, std::memory_order_relaxed);
+			return false;
+		}
+
+		return true;
+	}
+
+	// Clears the waiting mark. Called by the consumer after it wakes up.
+	void CancelWait() noexcept {
+		m_Header->m_Waiting.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	Header*				m_Header;		// Ring header.
+	ReportRecord*	m_Records;	// Ring records.
+	uint32_t			m_Capacity;	// Count of records, a local copy the other process cannot change.
+};
+
+#endif // !COMMON_REPORT_RING_H_
@@ -0,0 +1,299 @@
+#ifndef COMMON_REPORT_TRANSPORT_H_
+#define COMMON_REPORT_TRANSPORT_H_
+
+// Transport of connection reports from the redirector to the client.
+// Records are written by a single producer and read by a single consumer.
+class AbstractReportTransport
+{
+public:
+	// Default virtual destructor.
+	virtual ~AbstractReportTransport() = default;
+
+	// Writes the records. Called by the producer.
+	// @param records - records to write.
+	// @param count - count of records.
+	// @returns ERROR_SUCCESS if all records are written.
+	virtual WinPipe::WinError Write(_In_ const ReportRecord* records, _In_ size_t count) = 0;
+
+	// Reads the records. Called by the consumer.
+	// Waits until at least one record is written.
+	// @param records - buffer.
+	// @param capacity - count of records the buffer holds.
+	// @param count - count of read records.
+	// @returns ERROR_SUCCESS if records are read, WAIT_TIMEOUT if there are no records yet.
+	virtual WinPipe::WinError Read(_Out_ ReportRecord* records, _In_ size_t capacity, _Out_ size_t& count) = 0;
+
+	// Starts waiting for the records without blocking, for the event loops. Called by the consumer.
+	// @param event - event signaled when records may be available. nullptr - records are available now.
+	// @returns ERROR_SUCCESS if success.
+	virtual WinPipe::WinError Arm(_Out_ HANDLE& event) = 0;
+
+	// Reads the available records without blocking. Called by the consumer
+	// after the armed event is signaled or its wait has timed out.
+	// @param records - buffer.
+	// @param capacity - count of records the buffer holds.
+	// @param count - count of read records, 0 if there are no records yet.
+	// @returns ERROR_SUCCESS if success.
+	virtual WinPipe::WinError Poll(_Out_ ReportRecord* records, _In_ size_t capacity, _Out_ size_t& count) = 0;
+
+	// Signals the armed event, so the consumer waiting for it stops waiting.
+	// May be called from any thread.
+	virtual void Wake() = 0;
+};
+
+// Reports sent as pipe messages. The pipe must be connected.
+class PipeReportTransport final : public AbstractReportTransport
+{
+public:
+	// Deleted default constructor.
+	PipeReportTransport() = delete;
+	// Default destructor.
+	~PipeReportTransport() = default;
+	// Deleted copy constructor.
+	PipeReportTransport(const PipeReportTransport&) = delete;
+	// Deleted copy assigment.
+	PipeReportTransport& operator=(const PipeReportTransport&) = delete;
+
+	// PipeReportTransport constructor.
+	// @param pipe - report pipe.
+	explicit PipeReportTransport(_In_ WinPipe::BaseNamedPipe& pipe) :
+		m_Pipe{ pipe },
+		m_Buffered{ false }
+	{ }
+
+	// Writes all records as messages with a single pipe write.
+	WinPipe::WinError Write(_In_ const ReportRecord* records, _In_ size_t count) override
+	{
+		m_Views.clear();
+
+		for (size_t i = 0; i < count; ++i)
+			m_Views.push_back(WinPipe::Codec::MessageView{ records[i].m_Id, records[i].m_Data, records[i].m_Size });
+
+		return m_Pipe.WriteMessages(m_Views.data(), m_Views.size());
+	}
+
+	// Reads the messages available in the pipe, up to capacity.
+	// The rest stays buffered for the next read.
+	WinPipe::WinError Read(_Out_ ReportRecord* records, _In_ size_t capacity, _Out_ size_t& count) override
+	{
+		count = 0;
+
+		if (capacity == 0)
+			return ERROR_SUCCESS;
+
+		return m_Pipe.ReadMessages([&](const WinPipe::Codec::MessageView& message) {
+			return Take(message, records, capacity, count);
+		});
+	}
+
+	// Starts reading the pipe, unless the last poll left messages in the read buffer.
+	WinPipe::WinError Arm(_Out_ HANDLE& event) override
+	{
+		event = nullptr;
+
+		if (m_Buffered)
+			return ERROR_SUCCESS;
+
+		return m_Pipe.BeginRead(event);
+	}
+
+	// Aborts the pending pipe I/O, including the connection awaited by the server, Poll then fails.
+	void Wake() override {
+		m_Pipe.AbortIo();
+	}
+
+	// Completes the pipe read and takes the read messages, up to capacity.
+	WinPipe::WinError Poll(_Out_ ReportRecord* records, _In_ size_t capacity, _Out_ size_t& count) override
+	{
+		count = 0;
+
+		if (!m_Buffered)
+		{
+			auto status = m_Pipe.EndRead();
+
+			if (status == ERROR_IO_INCOMPLETE)
+				return ERROR_SUCCESS;
+
+			if (status != ERROR_SUCCESS)
+				return status;
+		}
+
+		m_Pipe.DecodeMessages([&](const WinPipe::Codec::MessageView& message) {
+			return Take(message, records, capacity, count);
+		});
+
+		// The buffer is full, so there may be more messages.
+		m_Buffered = count == capacity;
+		return ERROR_SUCCESS;
+	}
+
+private:
+	// Copies the message to the next record.
+	// @param message - report message.
+	// @param records - buffer.
+	// @param capacity - count of records the buffer holds.
+	// @param count - count of taken records.
+	// @returns false if the buffer is full.
+	static bool Take(_In_ const WinPipe::Codec::MessageView& message, _Out_ ReportRecord* records, _In_ size_t capacity, _Inout_ size_t& count)
+	{
+		if (count == capacity)
+			return false;
+
+		auto& record = records[count++];
+
+		record = ReportRecord{ message.m_Id, static_cast<uint8_t>((std::min)(static_cast<size_t>(message.m_Size), sizeof(record.m_Data))) };
+		std::memcpy(record.m_Data, message.m_Data, record.m_Size);
+		return true;
+	}
+
+	WinPipe::BaseNamedPipe&									m_Pipe;			// Report pipe.
+	std::vector<WinPipe::Codec::MessageView>	m_Views;		// Views of the written records.
+	bool																			m_Buffered;	// true - the last poll may have left messages in the read buffer.
+};
+
+// Reports sent through a ring in a shared memory section.
+// Writing and reading do not enter the kernel, the event is signaled only
+// when the consumer sleeps on an empty ring.
+class SharedReportTransport final : public AbstractReportTransport
+{
+	// Unmaps the view of the section.
+	struct ViewDeleter
+	{
+		void operator()(_In_ void* view) {
+			UnmapViewOfFile(view);
+		}
+	};
+
+	// Time in milliseconds the consumer sleeps on an empty ring.
+	static constexpr DWORD READ_WAIT_TIMEOUT_ = 1000;
+	// Time in milliseconds the producer waits for free records in a full ring.
+	static constexpr DWORD WRITE_WAIT_TIMEOUT_ = 1000;
+
+public:
+	// Default count of ring records.
+	static constexpr uint32_t RING_CAPACITY_ = 4096;
+
+	// Deleted default constructor.
+	SharedReportTransport() = delete;
+	// Default destructor.
+	~SharedReportTransport() = default;
+	// Deleted copy constructor.
+	SharedReportTransport(const SharedReportTransport&) = delete;
+	// Deleted copy assigment.
+	SharedReportTransport& operator=(const SharedReportTransport&) = delete;
+
+	// SharedReportTransport constructor.
+	// Throws runtime_error if the section or the event is not created or opened.
+	// @param stopEvent - reference to stop event, waited by the consumer.
+	// @param id - session id.
+	// @param capacity - count of ring records. 0 - open the ring created by the consumer.
+	SharedReportTransport(_In_ WinPipe::WinHandle& stopEvent, _In_ DWORD id, _In_opt_ uint32_t capacity = 0) :
+		m_StopEvent{ stopEvent }
+	{
+		auto ringName		= ObjectNames::GetReportRingName(id);
+		auto eventName	= ObjectNames::GetReportRingEventName(id);
+		auto size				= ReportRing::GetSize(capacity);
+
+		if (capacity != 0)
+		{
+			m_Section = WinPipe::WinHandle(CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), ringName.c_str()));
+			m_Event		= WinPipe::WinHandle(CreateEventW(nullptr, FALSE, FALSE, eventName.c_str()));
+		}
+		else
+		{
+			m_Section = WinPipe::WinHandle(OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, ringName.c_str()));
+			m_Event		= WinPipe::WinHandle(OpenEventW(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, eventName.c_str()));
+		}
+
+		if (!m_Section.get() || !m_Event.get())
+			throw std::runtime_error("Failed to create report ring section.");
+
+		m_View = std::unique_ptr<void, ViewDeleter>(MapViewOfFile(m_Section.get(), FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0));
+		if (!m_View.get())
+			throw std::runtime_error("Failed to map report ring section.");
+
+		auto information = MEMORY_BASIC_INFORMATION{ 0 };
+		VirtualQuery(m_View.get(), &information, sizeof(information));
+
+		m_Ring = std::make_unique<ReportRing>(m_View.get(), information.RegionSize, capacity);
+	}
+
+	// Pushes the records. Waits while the ring is full.
+	WinPipe::WinError Write(_In_ const ReportRecord* records, _In_ size_t count) override
+	{
+		auto started = GetTickCount64();
+
+		while (count != 0)
+		{
+			auto pushed = m_Ring->Push(records, count);
+
+			records += pushed;
+			count		-= pushed;
+
+			if (pushed != 0 && m_Ring->TakeWaiting())
+				SetEvent(m_Event.get());
+
+			if (count == 0)
+				break;
+
+			// The consumer is slower than the producer or is gone.
+			if (GetTickCount64() - started >= WRITE_WAIT_TIMEOUT_)
+				return WAIT_TIMEOUT;
+
+			// The stop event is not waited, it is auto-reset and belongs to the session owner.
+			Sleep(1);
+		}
+
+		return ERROR_SUCCESS;
+	}
+
+	// Pops the records. Sleeps on the event while the ring is empty.
+	WinPipe::WinError Read(_Out_ ReportRecord* records, _In_ size_t capacity, _Out_ size_t& count) override
+	{
+		if ((count = m_Ring->Pop(records, capacity)) != 0)
+			return ERROR_SUCCESS;
+
+		if (m_Ring->PrepareWait())
+		{
+			HANDLE objects[] = { m_StopEvent.get(), m_Event.get() };
+
+			auto status = WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, FALSE, READ_WAIT_TIMEOUT_);
+			m_Ring->CancelWait();
+
+			if (status == WAIT_OBJECT_0)
+				return ERROR_INVALID_HANDLE;
+		}
+
+		return (count = m_Ring->Pop(records, capacity)) != 0 ? ERROR_SUCCESS : WAIT_TIMEOUT;
+	}
+
+	// Marks the consumer as sleeping, unless the ring has records.
+	WinPipe::WinError Arm(_Out_ HANDLE& event) override
+	{
+		event = m_Ring->PrepareWait() ? m_Event.get() : nullptr;
+		return ERROR_SUCCESS;
+	}
+
+	// Pops the records.
+	WinPipe::WinError Poll(_Out_ ReportRecord* records, _In_ size_t capacity, _Out_ size_t& count) override
+	{
+		m_Ring->CancelWait();
+
+		count = m_Ring->Pop(records, capacity);
+		return ERROR_SUCCESS;
+	}
+
+	// Signals the ring event.
+	void Wake() override {
+		SetEvent(m_Event.get());
+	}
+
+private:
+	WinPipe::WinHandle&							m_StopEvent;	// Stop event.
+	WinPipe::WinHandle							m_Section;		// Ring section.
+	WinPipe::WinHandle							m_Event;			// Wakes the consumer.
+	std::unique_ptr<void, ViewDeleter>	m_View;			// Ring section view.
+	std::unique_ptr<ReportRing>			m_Ring;				// Ring over the view.
+};
+
+#endif // !COMMON_REPORT_TRANSPORT_H_
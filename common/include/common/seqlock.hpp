@@ -0,0 +1,165 @@
+#ifndef COMMON_SEQ_LOCK_H_
+#define COMMON_SEQ_LOCK_H_
+
+// Buffer over shared memory guarded by a sequence lock.
+// A single writer makes the sequence odd, copies the data and makes it even again.
+// Readers never lock and never write the shared memory, so the memory may be mapped
+// read-only by them: a read copies the data and is valid only if the sequence was
+// even and did not change meanwhile. The data is copied as relaxed atomic words,
+// so a torn read is detected, not undefined. The buffer uses only lock-free atomics,
+// so it works across processes and does not depend on the platform.
+class SharedSeqLock
+{
+	// Data word.
+	using Word = std::atomic<uint64_t>;
+
+	// Buffer header at the beginning of the memory. The sequence is on its own cache line.
+	struct Header
+	{
+		uint32_t											m_Magic;		// LOCK_MAGIC_.
+		uint32_t											m_Capacity;	// Maximal size of the data in bytes.
+		alignas(64) std::atomic<uint64_t>	m_Sequence;	// Incremented before and after every write. Odd - write in progress.
+		std::atomic<uint64_t>							m_Size;			// Size of the data in bytes.
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Sequence and data words must be address-free.");
+
+	// Returns count of words holding the bytes.
+	// @param size - count of bytes.
+	static constexpr size_t GetWords(_In_ size_t size) noexcept {
+		return (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	}
+
+public:
+	// Buffer signature.
+	static constexpr uint32_t LOCK_MAGIC_ = 0x53514C4B;
+
+	// Returns size of the memory for the buffer.
+	// @param capacity - maximal size of the data in bytes.
+	static constexpr size_t GetSize(_In_ uint32_t capacity) noexcept {
+		return sizeof(Header) + GetWords(capacity) * sizeof(Word);
+	}
+
+	// Deleted default constructor.
+	SharedSeqLock() = delete;
+	// Default destructor.
+	~SharedSeqLock() = default;
+	// Deleted copy constructor.
+	SharedSeqLock(const SharedSeqLock&) = delete;
+	// Deleted copy assigment.
+	SharedSeqLock& operator=(const SharedSeqLock&) = delete;
+
+	// SharedSeqLock constructor.
+	// Throws runtime_error if the memory does not hold a buffer.
+	// @param memory - memory of GetSize bytes, aligned to the cache line.
+	// @param size - size of the memory.
+	// @param capacity - maximal size of the data in bytes. 0 - open the buffer initialized by the writer.
+	SharedSeqLock(_In_ void* memory, _In_ size_t size, _In_opt_ uint32_t capacity = 0) :
+		m_Header{ static_cast<Header*>(memory) },
+		m_Words{ reinterpret_cast<Word*>(static_cast<uint8_t*>(memory) + sizeof(Header)) }
+	{
+		if (capacity != 0)
+		{
+			if (size < GetSize(capacity))
+				throw std::runtime_error("Invalid sequence lock capacity.");
+
+			new (m_Header) Header{ LOCK_MAGIC_, capacity };
+			for (size_t i = 0, words = GetWords(capacity); i < words; ++i)
+				new (&m_Words[i]) Word{ 0 };
+		}
+		else if (size < sizeof(Header) || m_Header->m_Magic != LOCK_MAGIC_ || size < GetSize(m_Header->m_Capacity))
+			throw std::runtime_error("Invalid sequence lock.");
+
+		m_Capacity = m_Header->m_Capacity;
+	}
+
+	// Returns maximal size of the data in bytes.
+	uint32_t GetCapacity() const noexcept {
+		return m_Capacity;
+	}
+
+	// Returns count of complete writes. 0 - nothing is written yet.
+	uint64_t GetGeneration() const noexcept {
+		return m_Header->m_Sequence.load(std::memory_order_acquire) / 2;
+	}
+
+	// Replaces the data. There must be a single writer.
+	// @param data - new data.
+	// @param size - size of the data.
+	// @returns false if the data does not fit the capacity.
+	bool Write(_In_ const void* data, _In_ size_t size) noexcept
+	{
+		if (size > m_Capacity)
+			return false;
+
+		auto sequence = m_Header->m_Sequence.load(std::memory_order_relaxed);
+
+		m_Header->m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+
+		// Orders the odd sequence before the data, paired with the fence in TryRead.
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i = 0, words = GetWords(size); i < words; ++i)
+		{
+			auto word		= uint64_t{ 0 };
+			auto offset = i * sizeof(uint64_t);
+
+			std::memcpy(&word, static_cast<const uint8_t*>(data) + offset, (std::min)(sizeof(word), size - offset));
+			m_Words[i].store(word, std::memory_order_relaxed);
+		}
+
+		m_Header->m_Size.store(size, std::memory_order_relaxed);
+		m_Header->m_Sequence.store(sequence + 2, std::memory_order_release);
+		return true;
+	}
+
+	// Copies the data once, without waiting for the writer.
+	// @param data - data buffer, resized to the data size.
+	// @param generation - generation of the copied data.
+	// @returns false if the write was in progress, the copy must be retried.
+	bool TryRead(_Out_ std::vector<uint8_t>& data, _Out_ uint64_t& generation) const
+	{
+		auto sequence = m_Header->m_Sequence.load(std::memory_order_acquire);
+		auto size			= (std::min<uint64_t>)(m_Header->m_Size.load(std::memory_order_relaxed), m_Capacity);
+
+		generation = sequence / 2;
+
+		if ((sequence & 1) != 0)
+			return false;
+
+		data.resize(static_cast<size_t>(size));
+
+		for (size_t i = 0, words = GetWords(data.size()); i < words; ++i)
+		{
+			auto word		= m_Words[i].load(std::memory_order_relaxed);
+			auto offset = i * sizeof(uint64_t);
+
+			std::memcpy(data.data() + offset, &word, (std::min)(sizeof(word), data.size() - offset));
+		}
+
+		// Orders the data before the sequence check, paired with the fence in Write.
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		return m_Header->m_Sequence.load(std::memory_order_relaxed) == sequence;
+	}
+
+	// Copies the data, retrying while a write is in progress.
+	// @param data - data buffer, resized to the data size.
+	// @returns generation of the copied data.
+	uint64_t Read(_Out_ std::vector<uint8_t>& data) const
+	{
+		auto generation = uint64_t{ 0 };
+
+		while (!TryRead(data, generation))
+			std::this_thread::yield();
+
+		return generation;
+	}
+
+private:
+	Header*		m_Header;		// Buffer header.
+	Word*			m_Words;		// Data words.
+	uint32_t	m_Capacity;	// Maximal size of the data, a local copy the other process cannot change.
+};
+
+#endif // !COMMON_SEQ_LOCK_H_
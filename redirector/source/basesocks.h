@@ -1,48 +1,159 @@
 #ifndef REDIRECTOR_BASE_SOCKS_H_
 #define REDIRECTOR_BASE_SOCKS_H_
 
+// Fixed-size handshake frame. 
+// Frames live on the stack or inside the handshake state, so encoding 
+// and receiving a handshake does not allocate.
+// @tparam Capacity - frame capacity in bytes.
+template <size_t Capacity>
+class SocksFrame
+{
+public:
+	// Appends a trivial value to the frame.
+	// @param value - value to append.
+	template <typename T>
+	void Append(_In_ const T& value) noexcept
+	{
+		static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= Capacity, "Value does not fit the frame.");
+
+		std::memcpy(m_Data.data() + m_Size, &value, sizeof(value));
+		m_Size += sizeof(value);
+	}
+
+	// Sets the frame size. Used to receive a reply into the frame.
+	// @param size - new size, must not exceed the capacity.
+	void Resize(_In_ size_t size) noexcept {
+		m_Size = (std::min)(size, Capacity);
+	}
+
+	// Clears the frame.
+	void Clear() noexcept {
+		m_Size = 0;
+	}
+
+	// Returns true if the frame is empty.
+	bool Empty() const noexcept {
+		return m_Size == 0;
+	}
+
+	// Returns frame size.
+	size_t Size() const noexcept {
+		return m_Size;
+	}
+
+	// Returns frame data.
+	BYTE* Data() noexcept {
+		return m_Data.data();
+	}
+
+	// Returns frame data.
+	const BYTE* Data() const noexcept {
+		return m_Data.data();
+	}
+
+private:
+	std::array<BYTE, Capacity>	m_Data;				// Frame data.
+	size_t											m_Size = 0;		// Frame size.
+};
+
+// Base socks protocol class.
+// The protocol is implemented as a resumable state machine without any I/O:
+// Start returns the first frame, then each Expected reply bytes are passed
+// to OnReply until the handshake is complete. This way the same protocol code
+// is used by the blocking SocksProtocol::Request and by the HandshakeDriver.
+// Protocols are dispatched statically through SocksProtocol, so there are no virtual calls.
 class AbstractSocks
 {
 public:
+	// Maximal size of a handshake frame sent to the proxy server.
+	static constexpr size_t MAX_REQUEST_SIZE_ = 32;
+	// Maximal size of a reply step: bound domain name with port.
+	static constexpr size_t MAX_REPLY_SIZE_		= UCHAR_MAX + sizeof(WORD);
+
+	// Frame sent to the proxy server.
+	using RequestFrame	= SocksFrame<MAX_REQUEST_SIZE_>;
+	// Reply step received from the proxy server.
+	using ReplyFrame		= SocksFrame<MAX_REPLY_SIZE_>;
+
+	// Handshake status.
+	enum class HandshakeStatus
+	{
+		Pending,	// Waiting for next reply.
+		Complete,	// Request granted.
+		Failed		// Request rejected or protocol error.
+	};
+
 	// Deleted default constructor.
 	AbstractSocks() = delete;
-	// Default virtual destructor.
-	virtual ~AbstractSocks() = default;
+	// Default destructor.
+	~AbstractSocks() = default;
 
 	// AbstractSocks constructor.
 	// @param config - app config.
 	// @param socket - socket connected to the proxy server.
 	// @param address - target app address.
-	AbstractSocks(_In_ const BaseConfigManager::Config& config, _In_ SOCKET& socket, _In_ const sockaddr* address) :
+	// @param proxy - proxy server address. It is copied, so the upstream may be reconfigured during the handshake.
+	AbstractSocks(_In_ const BaseConfigManager::Config& config, _In_ SOCKET& socket, _In_ const sockaddr* address, _In_ const sockaddr* proxy) :
 		m_Config{ config },
 		m_Socket{ socket },
-		m_AddressProxy{ nullptr },
+		m_AddressProxy{ 0 },
 		m_AddressApp{ address }
-	{ 
-		if (m_Config.m_ProxyType == ProxyType::Socks4)
-			m_AddressProxy = reinterpret_cast<const sockaddr*>(&m_Config.m_ProxyV4);
-		else
-		{
-			if (BaseConfigManager::IsValidIPv4Address(config))
-				m_AddressProxy = reinterpret_cast<const sockaddr*>(&m_Config.m_ProxyV4);
-			else 
-				m_AddressProxy = reinterpret_cast<const sockaddr*>(&m_Config.m_ProxyV6);
-		}
+	{
+		std::memcpy(&m_AddressProxy, proxy, proxy->sa_family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6));
+	}
+
+	// Returns the proxy address used for the config.
+	// Socks4 supports only IPv4, socks5 prefers IPv4 if both are specified.
+	// @param config - app config.
+	static const sockaddr* SelectProxyAddress(_In_ const BaseConfigManager::Config& config) noexcept
+	{
+		if (config.m_ProxyType == ProxyType::Socks4 || BaseConfigManager::IsValidIPv4Address(config))
+			return reinterpret_cast<const sockaddr*>(&config.m_ProxyV4);
+
+		return reinterpret_cast<const sockaddr*>(&config.m_ProxyV6);
 	}
-	
-	// Sends request to socks server.
-	// @returns true if success.
-	virtual bool Request() = 0;
 
 	// Returns proxy address.
 	const sockaddr* GetProxyAddress() const noexcept {
-		return m_AddressProxy;
+		return reinterpret_cast<const sockaddr*>(&m_AddressProxy);
+	}
+
+	// Called when the proxy closes the connection before the handshake is complete.
+	// Protocols that keep per-proxy state override it.
+	void OnClosed() noexcept
+	{ }
+
+	// Sends the whole buffer to the socks server.
+	// @param data - data to send.
+	// @param size - size of data.
+	// @returns true if success.
+	bool Send(_In_ const BYTE* data, _In_ int size)
+	{
+		while (size > 0)
+		{
+			auto sent = send(m_Socket, reinterpret_cast<const char*>(data), size, 0);
+			if (sent == SOCKET_ERROR)
+				return false;
+
+			data += sent;
+			size -= sent;
+		}
+
+		return true;
+	}
+
+	// Receives available bytes from the socks server, but not more than the specified count.
+	// @param data - buffer.
+	// @param size - maximal count of bytes to receive.
+	// @returns count of received bytes, 0 if the connection is closed or SOCKET_ERROR.
+	int Receive(_Out_ BYTE* data, _In_ int size) {
+		return recv(m_Socket, reinterpret_cast<char*>(data), size, 0);
 	}
 
 protected:
 	const BaseConfigManager::Config&	m_Config;					// App configuration.
 	SOCKET														m_Socket;					// Socket connected to the proxy server.
-	const sockaddr*										m_AddressProxy;		// Proxy address.
+	sockaddr_storage									m_AddressProxy;		// Proxy address.
 	const sockaddr*										m_AddressApp;			// Target app address.
 };
 
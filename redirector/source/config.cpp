@@ -4,10 +4,16 @@
 ConfigManager::ConfigManager(_In_ AbstractCore* mediator, _In_ WinPipe::WinHandle& stopEvent) :
 	BaseConfigManager{ },
 	AbstractComponent{ mediator },
-	m_Pipe{ stopEvent, ObjectNames::GetConfigPipeName(GetCurrentProcessId()) },
-	m_Thread{ &ConfigManager::CommunicationThread, this }
+	m_StopEvent{ stopEvent },
+	m_Pipe{ stopEvent, ObjectNames::GetConfigPipeName(GetCurrentProcessId()) }
 { }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ConfigManager::Start()
+{
+	m_Thread = std::thread(&ConfigManager::CommunicationThread, this);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ConfigManager::~ConfigManager()
 {
@@ -18,19 +24,97 @@ ConfigManager::~ConfigManager()
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void ConfigManager::CommunicationThread()
 {
-	Config	newConfig;
-	auto		status = WinPipe::WinError(ERROR_SUCCESS);
+	auto status			= OpenSection();
+	auto generation = uint64_t{ 0 };
 
-	do
-	{
-		status = m_Pipe.Read(newConfig);
+	if (status == ERROR_SUCCESS)
+		status = SendReady();
 
-		if (status == ERROR_SUCCESS) 
+	while (status == ERROR_SUCCESS)
+	{
+		// The generation is a single shared load, the config is read only when it changes.
+		if (m_Section->GetGeneration() != generation)
 		{
-			m_Config = newConfig;
-			m_Mediator->Notify(this, m_Mediator->UpdateConfig);
+			auto newConfig	= Config{ };
+			auto newRules		= Rules();
+
+			if (!m_Section->Read(newConfig, newRules, generation))
+				spdlog::error("Invalid config {} in the config section.", generation);
+			else
+			{
+				m_Config	= newConfig;
+				m_Rules		= std::move(newRules);
+				m_Mediator->Notify(this, m_Mediator->UpdateConfig);
+
+				// The config is published, so the server may count it as applied.
+				status = Acknowledge(newConfig.m_Version);
+			}
 		}
-	} while (status == ERROR_SUCCESS || status == WAIT_TIMEOUT);
+
+		if (status == ERROR_SUCCESS)
+			status = WaitForChange();
+	}
 
 	m_Mediator->Notify(this, AbstractCore::Event::StopEvent);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError ConfigManager::OpenSection()
+{
+	try
+	{
+		m_Section = std::make_unique<ConfigSection>(false);
+	}
+	catch (const std::runtime_error& error)
+	{
+		spdlog::error("RuntimeError: {}.", error.what());
+		return ERROR_FILE_NOT_FOUND;
+	}
+
+	return ERROR_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError ConfigManager::WaitForChange()
+{
+	auto event = HANDLE{ nullptr };
+
+	// The pending read completes when the server closes the pipe.
+	auto status = m_Pipe.BeginRead(event);
+	if (status != ERROR_SUCCESS)
+		return status;
+
+	HANDLE objects[] = { m_StopEvent.get(), event };
+
+	switch (WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, FALSE, POLL_INTERVAL_))
+	{
+		case WAIT_OBJECT_0:			return ERROR_OPERATION_ABORTED;
+		case WAIT_TIMEOUT:			return ERROR_SUCCESS;
+		case WAIT_OBJECT_0 + 1: break;
+		default:								return GetLastError();
+	}
+
+	if ((status = m_Pipe.EndRead()) != ERROR_SUCCESS)
+		return status;
+
+	// The server does not send messages on the config pipe.
+	m_Pipe.DecodeMessages([](const WinPipe::Codec::MessageView& message)
+	{
+		spdlog::warn("Unexpected config message {}.", message.m_Id);
+		return true;
+	});
+	return ERROR_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError ConfigManager::SendReady()
+{
+	auto version = DWORD{ ConfigFormat::FORMAT_VERSION_ };
+	return m_Pipe.WriteMessage(READY_MESSAGE_ID_, reinterpret_cast<const BYTE*>(&version), sizeof(version));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+WinPipe::WinError ConfigManager::Acknowledge(_In_ DWORD version)
+{
+	return m_Pipe.WriteMessage(ACK_MESSAGE_ID_, reinterpret_cast<const BYTE*>(&version), sizeof(version));
 }
\ No newline at end of file
@@ -2,9 +2,14 @@
 #define REDIRECTOR_CONFIG_H_
 
 // Application Configuration Component.
-// Retrieves configuration from the server via named pipes.
+// Reads configuration from the config section shared by all redirectors,
+// polling its generation, and acknowledges the applied configs via the named pipe.
+// The named pipe also tells that the server is gone.
 class ConfigManager final : public BaseConfigManager, public AbstractComponent
 {
+	// Time in milliseconds between the config section generation checks.
+	static constexpr DWORD POLL_INTERVAL_ = 200;
+
 public:
 	// Deleter default constructor.
 	ConfigManager() = delete;
@@ -20,12 +25,35 @@ public:
 	// @param stopEvent - reference to stop event.
 	ConfigManager(_In_ AbstractCore* mediator, _In_ WinPipe::WinHandle& stopEvent);
 
+	// Starts the communication with the server. Called once the hooks are installed,
+	// so the server does not count the redirector as ready before it is.
+	void Start();
+
 private:
 	// The main flow of communication with the server.
 	void CommunicationThread();
 
-	WinPipe::NamedPipeClient	m_Pipe;		// Server named pipe.
-	std::thread								m_Thread;	// Server communication thread.
+	// Opens the config section created by the server.
+	// @returns ERROR_SUCCESS if success.
+	WinPipe::WinError OpenSection();
+
+	// Waits until the config may have changed: the poll interval elapses or an unexpected message comes.
+	// @returns ERROR_SUCCESS if the config section must be checked, an error if the server is gone or the stop event is signaled.
+	WinPipe::WinError WaitForChange();
+
+	// Tells the server that the redirector is initialized.
+	// @returns ERROR_SUCCESS if success.
+	WinPipe::WinError SendReady();
+
+	// Sends the version of the applied config to the server.
+	// @param version - config version.
+	// @returns ERROR_SUCCESS if success.
+	WinPipe::WinError Acknowledge(_In_ DWORD version);
+
+	WinPipe::WinHandle&							m_StopEvent;	// Stop event.
+	WinPipe::NamedPipeClient				m_Pipe;				// Server named pipe.
+	std::unique_ptr<ConfigSection>	m_Section;		// Config section.
+	std::thread											m_Thread;			// Server communication thread.
 
 };
 
@@ -0,0 +1,33 @@
+#ifndef REDIRECTOR_CONFIG_SNAPSHOT_H_
+#define REDIRECTOR_CONFIG_SNAPSHOT_H_
+
+// Immutable config published to the hooks.
+// The config and the routing rules compiled for it are replaced together,
+// so a connect never sees the rules of one config with the proxy of another.
+struct ConfigSnapshot
+{
+	// Deleted default constructor.
+	ConfigSnapshot() = delete;
+	// Default destructor.
+	~ConfigSnapshot() = default;
+	// Deleted copy constructor.
+	ConfigSnapshot(const ConfigSnapshot&) = delete;
+	// Deleted copy assigment.
+	ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+
+	// ConfigSnapshot constructor. Compiles the routing rules.
+	// @param config - app config.
+	// @param rules - routing rules.
+	// @param version - snapshot version.
+	ConfigSnapshot(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules, _In_ size_t version) :
+		m_Config{ config },
+		m_Routes{ rules },
+		m_Version{ version }
+	{ }
+
+	const BaseConfigManager::Config	m_Config;		// App config.
+	const RouteTable								m_Routes;		// Compiled routing rules.
+	const size_t										m_Version;	// Incremented on every config update.
+};
+
+#endif // !REDIRECTOR_CONFIG_SNAPSHOT_H_
@@ -8,6 +8,8 @@ Core::Core(_In_ HMODULE instance, _In_ WinPipe::WinHandle& stopEvent) :
 {
 	if (!SocketHook::Initialize())
 		spdlog::error("Failed to initialize SocketHook.");
+
+	m_Config->Start();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -26,6 +28,6 @@ void Core::Wait()
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Core::Notify(AbstractComponent* component, Event event)
 {
-	if			(event == Event::UpdateConfig)	SocketHook::UpdateConfig(m_Config->GetConfig(), m_StopEvent);
+	if			(event == Event::UpdateConfig)	SocketHook::UpdateConfig(m_Config->GetConfig(), m_Config->GetRules(), m_StopEvent);
 	else if (event == Event::StopEvent)			SetEvent(m_StopEvent.get());
 }
@@ -28,9 +28,9 @@ public:
 	void Notify(AbstractComponent* component, Event event) override;
 
 private:
-	HMODULE															m_Instance;		// Current module instance.
-	WinPipe::WinHandle&									m_StopEvent;	// Stop event.
-	std::unique_ptr<BaseConfigManager>	m_Config;			// Instance of config component.
+	HMODULE													m_Instance;		// Current module instance.
+	WinPipe::WinHandle&							m_StopEvent;	// Stop event.
+	std::unique_ptr<ConfigManager>	m_Config;			// Instance of config component.
 };
 
 #endif // !REDIRECTOR_CORE_H_
@@ -5,15 +5,34 @@
 #include <ws2tcpip.h>
 #include <Windows.h>
 #include <memory>
+#include <array>
+#include <climits>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <variant>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <string>
 #include <stdexcept>
 #include <map>
 #include <unordered_map>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <cstring>
 
 #include "winpipe/basepipe.hpp"
 #include "winpipe/client.hpp"
 #include "common/baseconfig.hpp"
 #include "common/objectnames.hpp"
+#include "common/seqlock.hpp"
+#include "common/configformat.hpp"
+#include "common/configsection.hpp"
+#include "common/reportring.hpp"
+#include "common/reporttransport.hpp"
 #include "MinHook.h"
 
 #pragma warning(push)
@@ -28,6 +47,14 @@
 #include "basesocks.h"
 #include "socks4.hpp"
 #include "socks5.hpp"
+#include "socksprotocol.hpp"
+#include "rcu.hpp"
+#include "routetable.h"
+#include "configsnapshot.h"
+#include "upstreambalancer.h"
+#include "handshakedriver.h"
+#include "reportqueue.h"
+#include "sockettable.hpp"
 #include "sockethook.h"
 #include "config.h"
 #include "core.h"
@@ -0,0 +1,188 @@
+#include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HandshakeDriver::HandshakeDriver(_In_ Callback callback, _In_ EnumNetworkEvents enumNetworkEvents) :
+	m_Callback{ std::move(callback) },
+	m_EnumEvents{ enumNetworkEvents },
+	m_StopEvent{ CreateEventW(nullptr, true, false, nullptr) },
+	m_SocketEvent{ CreateEventW(nullptr, false, false, nullptr) }
+{
+	if (!m_StopEvent.get() || !m_SocketEvent.get())
+		throw std::runtime_error("Failed to create handshake driver events.");
+
+	m_Thread = std::thread(&HandshakeDriver::DriverThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HandshakeDriver::~HandshakeDriver()
+{
+	SetEvent(m_StopEvent.get());
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+
+	for (const auto& handshake : m_Handshakes)
+		m_Callback(*handshake, WSAECONNABORTED);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void HandshakeDriver::Add(_In_ std::unique_ptr<Handshake> handshake)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Handshakes.push_back(std::move(handshake));
+	}
+
+	// The connect may already be completed, so wake up the driver to check it.
+	SetEvent(m_SocketEvent.get());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void HandshakeDriver::Remove(_In_ SOCKET socket)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	m_Handshakes.erase(std::remove_if(m_Handshakes.begin(), m_Handshakes.end(), [socket](const std::unique_ptr<Handshake>& handshake) {
+		return handshake->m_Socket == socket;
+	}), m_Handshakes.end());
+
+	// The callback itself may close the socket, it must not wait for itself.
+	if (std::this_thread::get_id() == m_Thread.get_id())
+		return;
+
+	m_Completed.wait(lock, [this, socket]
+	{
+		return std::none_of(m_Finished.begin(), m_Finished.end(), [socket](const auto& finished) {
+			return finished.first->m_Socket == socket;
+		});
+	});
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void HandshakeDriver::DriverThread()
+{
+	HANDLE objects[] = { m_StopEvent.get(), m_SocketEvent.get() };
+
+	while (WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, FALSE, INFINITE) == (WAIT_OBJECT_0 + 1))
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			// The event is shared by all sockets, so every pending handshake is checked.
+			for (auto iter = m_Handshakes.begin(); iter != m_Handshakes.end();)
+			{
+				auto events = WSANETWORKEVENTS{ 0 };
+				auto error	= 0;
+				auto done		= false;
+
+				if (m_EnumEvents((*iter)->m_Socket, nullptr, &events) == SOCKET_ERROR)
+				{
+					error = WSAGetLastError();
+					done	= true;
+				}
+				else
+					done = Advance(**iter, events, error);
+
+				if (done)
+				{
+					m_Finished.emplace_back(std::move(*iter), error);
+					iter = m_Handshakes.erase(iter);
+				}
+				else
+					++iter;
+			}
+		}
+
+		// Callbacks are called without the lock, so they can add new handshakes.
+		// Only this thread changes the finished list, so it is read without the lock.
+		for (const auto& [handshake, error] : m_Finished)
+			m_Callback(*handshake, error);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Finished.clear();
+		}
+
+		m_Completed.notify_all();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HandshakeDriver::Advance(_Inout_ Handshake& handshake, _In_ const WSANETWORKEVENTS& events, _Out_ int& error)
+{
+	error = 0;
+
+	// Waiting for connection to the proxy server.
+	if (!handshake.m_Connected)
+	{
+		if (!(events.lNetworkEvents & FD_CONNECT))
+			return false;
+
+		if ((error = events.iErrorCode[FD_CONNECT_BIT]) != 0)
+			return true;
+
+		if (!handshake.m_Socks.Start(handshake.m_Output))
+		{
+			error = WSAEAFNOSUPPORT;
+			return true;
+		}
+
+		handshake.m_Connected = true;
+	}
+
+	for (;;)
+	{
+		// Sending pending frame.
+		while (handshake.m_Sent < handshake.m_Output.Size())
+		{
+			auto sent = send(
+				handshake.m_Socket, 
+				reinterpret_cast<const char*>(handshake.m_Output.Data() + handshake.m_Sent), 
+				static_cast<int>(handshake.m_Output.Size() - handshake.m_Sent), 
+				0
+			);
+
+			if (sent == SOCKET_ERROR)
+			{
+				error = WSAGetLastError();
+				return error != WSAEWOULDBLOCK;
+			}
+
+			handshake.m_Sent += sent;
+		}
+
+		handshake.m_Output.Clear();
+		handshake.m_Sent = 0;
+
+		// Receiving reply. Not more than the parser misses is read,
+		// so the data following the final reply stays in the socket for the app.
+		auto input		= AbstractSocks::ReplyFrame();
+		auto status		= AbstractSocks::HandshakeStatus::Pending;
+		auto received = recv(handshake.m_Socket, reinterpret_cast<char*>(input.Data()), static_cast<int>(handshake.m_Socks.Missing()), 0);
+
+		if (received == 0)
+		{
+			error = WSAECONNRESET;
+			handshake.m_Socks.OnClosed();
+			return true;
+		}
+
+		if (received == SOCKET_ERROR)
+		{
+			error = WSAGetLastError();
+			if (error == WSAEWOULDBLOCK)
+				return false;
+
+			handshake.m_Socks.OnClosed();
+			return true;
+		}
+
+		handshake.m_Socks.Feed(input.Data(), received, handshake.m_Output, status);
+
+		switch (status)
+		{
+			case AbstractSocks::HandshakeStatus::Complete:	return true;
+			case AbstractSocks::HandshakeStatus::Failed:		error = WSAECONNREFUSED; return true;
+		}
+	}
+}
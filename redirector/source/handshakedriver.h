@@ -0,0 +1,107 @@
+#ifndef REDIRECTOR_HANDSHAKE_DRIVER_H_
+#define REDIRECTOR_HANDSHAKE_DRIVER_H_
+
+// Drives socks handshakes of non-blocking sockets on a background thread.
+// Every socket is selected with the single driver event, and its handshake
+// is advanced when the socket becomes readable or writable, so the app
+// thread that called connect is never blocked.
+class HandshakeDriver
+{
+public:
+	// Proxy handshake of a single socket.
+	struct Handshake
+	{
+		// Handshake constructor.
+		// Copies the target app address, because the app may release it after connect returns.
+		// @param socket - app socket.
+		// @param address - target app address.
+		// @param length - target app address length.
+		Handshake(_In_ SOCKET socket, _In_ const sockaddr* address, _In_ int length) :
+			m_Socket{ socket },
+			m_Address{ 0 },
+			m_Sent{ 0 },
+			m_Connected{ false },
+			m_Started{ std::chrono::steady_clock::now() }
+		{
+			std::memcpy(&m_Address, address, (std::min)(static_cast<size_t>(length), sizeof(m_Address)));
+		}
+
+		// Returns target app address.
+		const sockaddr* GetAddress() const noexcept {
+			return reinterpret_cast<const sockaddr*>(&m_Address);
+		}
+
+		SOCKET																						m_Socket;			// App socket.
+		sockaddr_storage																	m_Address;		// Target app address.
+		SocksProtocol																			m_Socks;			// Socks protocol state.
+		AbstractSocks::RequestFrame												m_Output;			// Frame to send.
+		size_t																						m_Sent;				// Count of sent frame bytes.
+		bool																							m_Connected;	// true - connected to the proxy server.
+		std::shared_ptr<const UpstreamBalancer::Upstream>	m_Upstream;		// Upstream of the handshake. nullptr if there are no upstreams.
+		std::shared_ptr<const ConfigSnapshot>							m_Snapshot;		// Config snapshot of the handshake, referenced by the protocol.
+		std::chrono::steady_clock::time_point							m_Started;		// Time when the handshake was started.
+	};
+
+	// Handshake completion callback.
+	// @param handshake - finished handshake.
+	// @param error - 0 if the handshake is complete, otherwise WSA error code.
+	using Callback = std::function<void(const Handshake& handshake, int error)>;
+
+	// WSAEnumNetworkEvents used by the driver.
+	using EnumNetworkEvents = decltype(&WSAEnumNetworkEvents);
+
+	// Deleted default constructor.
+	HandshakeDriver() = delete;
+	// Stops the driver thread. Pending handshakes are completed with WSAECONNABORTED.
+	~HandshakeDriver();
+	// Deleted copy constructor.
+	HandshakeDriver(const HandshakeDriver&) = delete;
+	// Deleted copy assigment.
+	HandshakeDriver& operator=(const HandshakeDriver&) = delete;
+
+	// HandshakeDriver constructor.
+	// Throws runtime_error if events are not created.
+	// @param callback - handshake completion callback. Called from the driver thread.
+	// @param enumNetworkEvents - original WSAEnumNetworkEvents, so the driver does not take the app events.
+	HandshakeDriver(_In_ Callback callback, _In_ EnumNetworkEvents enumNetworkEvents);
+
+	// Returns the event that must be selected for the handshake sockets
+	// with FD_CONNECT | FD_READ | FD_WRITE | FD_CLOSE.
+	HANDLE GetEvent() const noexcept {
+		return m_SocketEvent.get();
+	}
+
+	// Adds the handshake. The socket must be selected with the driver event
+	// and must have a pending connect to the proxy server.
+	// @param handshake - socket handshake.
+	void Add(_In_ std::unique_ptr<Handshake> handshake);
+
+	// Cancels the socket handshake without calling the callback.
+	// If the handshake is being completed, waits for its callback to return,
+	// so the driver does not touch the socket handle after it is closed.
+	// @param socket - app socket.
+	void Remove(_In_ SOCKET socket);
+
+private:
+	// Driver thread routine.
+	void DriverThread();
+
+	// Advances the handshake as far as the socket allows without blocking.
+	// @param handshake - socket handshake.
+	// @param events - socket network events.
+	// @param error - 0 if the handshake is complete, otherwise WSA error code.
+	// @returns true if the handshake is finished.
+	bool Advance(_Inout_ Handshake& handshake, _In_ const WSANETWORKEVENTS& events, _Out_ int& error);
+
+	Callback																								m_Callback;			// Completion callback.
+	EnumNetworkEvents																				m_EnumEvents;		// Original WSAEnumNetworkEvents.
+	WinPipe::WinHandle																			m_StopEvent;		// Driver stop event.
+	WinPipe::WinHandle																			m_SocketEvent;	// Handshake sockets event.
+	std::mutex																							m_Mutex;				// Locks handshakes lists.
+	std::condition_variable																	m_Completed;		// Notified when finished callbacks return.
+	std::vector<std::unique_ptr<Handshake>>									m_Handshakes;		// Pending handshakes.
+	std::vector<std::pair<std::unique_ptr<Handshake>, int>>	m_Finished;			// Handshakes whose callbacks are being called.
+	std::thread																							m_Thread;				// Driver thread.
+};
+
+#endif // !REDIRECTOR_HANDSHAKE_DRIVER_H_
@@ -0,0 +1,142 @@
+#ifndef REDIRECTOR_RCU_HPP_
+#define REDIRECTOR_RCU_HPP_
+
+// Pointer to an immutable value, published with read-copy-update.
+// Readers enter a read section with one counter increment on their own stripe
+// and one acquire load of the pointer, so they never wait and never write a shared
+// cache line. The writer swaps the pointer and waits for the readers of the previous
+// epoch before releasing the previous value. A reader may also share the value
+// to keep it after the read section, e.g. for a handshake that continues on another thread.
+// @tparam T - value type.
+template <typename T>
+class RcuPointer
+{
+	// Published value.
+	struct Node
+	{
+		std::shared_ptr<const T> m_Value;	// Shared value.
+	};
+
+	// Reader counter, one per cache line.
+	struct alignas(64) Counter
+	{
+		std::atomic<size_t> m_Readers{ 0 };	// Count of readers in the read section.
+	};
+
+	// Count of reader stripes.
+	static constexpr size_t STRIPES_ = 32;
+
+public:
+	// Read section. The value stays valid until the section is destroyed.
+	class ReadScope
+	{
+	public:
+		// Deleted default constructor.
+		ReadScope() = delete;
+		// Deleted copy constructor.
+		ReadScope(const ReadScope&) = delete;
+		// Deleted copy assigment.
+		ReadScope& operator=(const ReadScope&) = delete;
+
+		// Leaves the read section.
+		~ReadScope() {
+			m_Counter.m_Readers.fetch_sub(1, std::memory_order_release);
+		}
+
+		// Returns the value or nullptr if nothing is published.
+		const T* Get() const noexcept {
+			return m_Node ? m_Node->m_Value.get() : nullptr;
+		}
+
+		// Returns the value.
+		const T* operator->() const noexcept {
+			return Get();
+		}
+
+		// Returns the value that stays valid after the read section.
+		std::shared_ptr<const T> Share() const {
+			return m_Node ? m_Node->m_Value : nullptr;
+		}
+
+	private:
+		friend class RcuPointer;
+
+		// Enters the read section.
+		// @param owner - pointer to read.
+		explicit ReadScope(_In_ const RcuPointer& owner) :
+			m_Counter{ owner.Enter() },
+			m_Node{ owner.m_Node.load(std::memory_order_acquire) }
+		{ }
+
+		Counter&		m_Counter;	// Counter of the entered epoch.
+		const Node* m_Node;			// Published value.
+	};
+
+	// Default constructor. Nothing is published.
+	RcuPointer() = default;
+	// Deleted copy constructor.
+	RcuPointer(const RcuPointer&) = delete;
+	// Deleted copy assigment.
+	RcuPointer& operator=(const RcuPointer&) = delete;
+
+	// Releases the published value. There must be no readers.
+	~RcuPointer() {
+		delete m_Node.load(std::memory_order_relaxed);
+	}
+
+	// Enters the read section.
+	ReadScope Read() const {
+		return ReadScope(*this);
+	}
+
+	// Publishes the new value and waits for the readers of the previous one.
+	// Must not be called inside a read section of the same pointer.
+	// @param value - new value.
+	void Publish(_In_ std::shared_ptr<const T> value)
+	{
+		std::lock_guard<std::mutex> lock(m_WriterMutex);
+
+		auto previous = m_Node.exchange(new Node{ std::move(value) }, std::memory_order_acq_rel);
+		auto epoch		= m_Epoch.load(std::memory_order_relaxed);
+
+		// New readers enter the other counters, the readers of the previous value are drained.
+		m_Epoch.store(epoch + 1, std::memory_order_seq_cst);
+
+		for (auto& counter : m_Counters[epoch & 1])
+		{
+			while (counter.m_Readers.load(std::memory_order_acquire) != 0)
+				std::this_thread::yield();
+		}
+
+		delete previous;
+	}
+
+private:
+	// Increments the reader counter of the current epoch.
+	// @returns the incremented counter.
+	Counter& Enter() const noexcept
+	{
+		auto stripe = static_cast<size_t>(GetCurrentThreadId()) % STRIPES_;
+
+		for (;;)
+		{
+			auto	epoch		= m_Epoch.load(std::memory_order_seq_cst);
+			auto& counter = m_Counters[epoch & 1][stripe];
+
+			counter.m_Readers.fetch_add(1, std::memory_order_seq_cst);
+
+			// The writer flipped the epoch after it was loaded and may not wait for this reader.
+			if (m_Epoch.load(std::memory_order_seq_cst) == epoch)
+				return counter;
+
+			counter.m_Readers.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	std::atomic<const Node*>	m_Node{ nullptr };		// Published value.
+	std::atomic<size_t>				m_Epoch{ 0 };					// Incremented on every publication.
+	mutable Counter						m_Counters[2][STRIPES_];	// Reader counters of the even and odd epochs.
+	std::mutex								m_WriterMutex;				// Serializes writers.
+};
+
+#endif // !REDIRECTOR_RCU_HPP_
@@ -0,0 +1,193 @@
+#include "global.h"
+
+namespace
+{
+	// Maximal count of reports in a single batch write.
+	constexpr size_t G_MAX_BATCH_ = 1024;
+
+	// Time after which the drain thread checks the ring without a wake up.
+	constexpr DWORD G_DRAIN_INTERVAL_ = 100;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ReportQueue::ReportQueue(_In_ size_t capacity, _In_ Writer writer) :
+	m_Mask{ 0 },
+	m_Policy{ ReportPolicy::DropNew },
+	m_Sleeping{ false },
+	m_Stop{ false },
+	m_Dropped{ 0 },
+	m_Lost{ 0 },
+	m_Written{ 0 },
+	m_Writer{ std::move(writer) },
+	m_Event{ CreateEventW(nullptr, FALSE, FALSE, nullptr) }
+{
+	if (!m_Event.get())
+		throw std::runtime_error("Failed to create report queue event.");
+
+	auto size = size_t{ 2 };
+	while (size < capacity)
+		size <<= 1;
+
+	m_Cells = std::make_unique<Cell[]>(size);
+	m_Mask	= size - 1;
+
+	for (size_t i = 0; i < size; ++i)
+		m_Cells[i].m_Sequence.store(i, std::memory_order_relaxed);
+
+	m_Batch.reserve(G_MAX_BATCH_);
+	m_Thread = std::thread(&ReportQueue::DrainThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+ReportQueue::~ReportQueue()
+{
+	m_Stop.store(true, std::memory_order_seq_cst);
+	SetEvent(m_Event.get());
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ReportQueue::Push(_In_ WORD id, _In_ const BYTE* data, _In_ size_t size) noexcept
+{
+	auto report = ReportRecord{ id, static_cast<uint8_t>((std::min)(size, sizeof(ReportRecord::m_Data))) };
+	std::memcpy(report.m_Data, data, report.m_Size);
+
+	while (!TryPush(report))
+	{
+		auto policy = m_Policy.load(std::memory_order_relaxed);
+
+		if (policy == ReportPolicy::DropOldest)
+		{
+			auto oldest = ReportRecord();
+			if (TryPop(oldest))
+				m_Dropped.fetch_add(1, std::memory_order_relaxed);
+
+			continue;
+		}
+
+		// Waiting for the drain thread to free a cell. Nothing is drained after the stop.
+		if (policy == ReportPolicy::Block && !m_Stop.load(std::memory_order_relaxed))
+		{
+			Wake();
+			std::this_thread::yield();
+			continue;
+		}
+
+		m_Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Wake();
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ReportQueue::DrainThread()
+{
+	for (;;)
+	{
+		if (Drain() != 0)
+			continue;
+
+		if (m_Stop.load(std::memory_order_seq_cst))
+			break;
+
+		// The ring is checked again after the flag is set, so a push between
+		// the checks either is drained now or sees the flag and wakes the thread.
+		m_Sleeping.store(true, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (Drain() == 0)
+			WaitForSingleObject(m_Event.get(), G_DRAIN_INTERVAL_);
+
+		m_Sleeping.store(false, std::memory_order_relaxed);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t ReportQueue::Drain()
+{
+	auto report = ReportRecord();
+
+	m_Batch.clear();
+
+	while (m_Batch.size() < G_MAX_BATCH_ && TryPop(report))
+		m_Batch.push_back(report);
+
+	if (!m_Batch.empty())
+	{
+		if (m_Writer(m_Batch.data(), m_Batch.size()))
+			m_Written.fetch_add(m_Batch.size(), std::memory_order_relaxed);
+		else
+			m_Lost.fetch_add(m_Batch.size(), std::memory_order_relaxed);
+	}
+
+	return m_Batch.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ReportQueue::TryPush(_In_ const ReportRecord& report) noexcept
+{
+	auto position = m_Tail.m_Value.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		auto& cell			= m_Cells[position & m_Mask];
+		auto	sequence	= cell.m_Sequence.load(std::memory_order_acquire);
+		auto	distance	= static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+		if (distance == 0)
+		{
+			if (m_Tail.m_Value.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				cell.m_Report = report;
+				cell.m_Sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (distance < 0)
+			return false;
+		else
+			position = m_Tail.m_Value.load(std::memory_order_relaxed);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ReportQueue::TryPop(_Out_ ReportRecord& report) noexcept
+{
+	auto position = m_Head.m_Value.load(std::memory_order_relaxed);
+
+	// The producers also take reports with the drop-oldest policy, so the head is taken with CAS.
+	for (;;)
+	{
+		auto& cell			= m_Cells[position & m_Mask];
+		auto	sequence	= cell.m_Sequence.load(std::memory_order_acquire);
+		auto	distance	= static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+		if (distance == 0)
+		{
+			if (m_Head.m_Value.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				report = cell.m_Report;
+				cell.m_Sequence.store(position + m_Mask + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (distance < 0)
+			return false;
+		else
+			position = m_Head.m_Value.load(std::memory_order_relaxed);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void ReportQueue::Wake() noexcept
+{
+	// Orders the pushed report before the flag check, paired with the drain thread fence.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (m_Sleeping.load(std::memory_order_seq_cst) && m_Sleeping.exchange(false, std::memory_order_seq_cst))
+		SetEvent(m_Event.get());
+}
@@ -0,0 +1,110 @@
+#ifndef REDIRECTOR_REPORT_QUEUE_H_
+#define REDIRECTOR_REPORT_QUEUE_H_
+
+// Queue of connection reports sent to the client in background.
+// The app threads push reports into a bounded lock-free ring, so a slow client
+// never delays a connect. The drain thread takes all queued reports and writes
+// them to the report transport as a single batch.
+class ReportQueue
+{
+	// Ring cell. The sequence tells whether the cell is free or holds a report of the current lap.
+	struct alignas(64) Cell
+	{
+		std::atomic<size_t>	m_Sequence;	// Cell sequence.
+		ReportRecord				m_Report;		// Queued report.
+	};
+
+	// Index of the ring cell, on its own cache line.
+	struct alignas(64) Position
+	{
+		std::atomic<size_t>	m_Value{ 0 };	// Position.
+	};
+
+public:
+	// Writes the batch of reports.
+	// @param records - reports.
+	// @param count - count of reports.
+	// @returns true if the batch is written.
+	using Writer = std::function<bool(const ReportRecord* records, size_t count)>;
+
+	// Deleted default constructor.
+	ReportQueue() = delete;
+	// Writes the queued reports and stops the drain thread.
+	~ReportQueue();
+	// Deleted copy constructor.
+	ReportQueue(const ReportQueue&) = delete;
+	// Deleted copy assigment.
+	ReportQueue& operator=(const ReportQueue&) = delete;
+
+	// ReportQueue constructor.
+	// Throws runtime_error if the event is not created.
+	// @param capacity - count of reports the ring holds, rounded up to a power of two.
+	// @param writer - batch writer. Called from the drain thread.
+	ReportQueue(_In_ size_t capacity, _In_ Writer writer);
+
+	// Sets the behaviour when the ring is full.
+	// @param policy - full ring policy.
+	void SetPolicy(_In_ ReportPolicy policy) noexcept {
+		m_Policy.store(policy, std::memory_order_relaxed);
+	}
+
+	// Queues the report.
+	// @param id - message id.
+	// @param data - report data, truncated to the size of the record data.
+	// @param size - size of data.
+	// @returns false if the report is dropped.
+	bool Push(_In_ WORD id, _In_ const BYTE* data, _In_ size_t size) noexcept;
+
+	// Returns count of reports dropped because the ring was full.
+	size_t GetDropped() const noexcept {
+		return m_Dropped.load(std::memory_order_relaxed);
+	}
+
+	// Returns count of reports lost because the batch was not written.
+	size_t GetLost() const noexcept {
+		return m_Lost.load(std::memory_order_relaxed);
+	}
+
+	// Returns count of written reports.
+	size_t GetWritten() const noexcept {
+		return m_Written.load(std::memory_order_relaxed);
+	}
+
+private:
+	// Drain thread routine.
+	void DrainThread();
+
+	// Writes all queued reports.
+	// @returns count of taken reports.
+	size_t Drain();
+
+	// Puts the report into the ring.
+	// @param report - report.
+	// @returns false if the ring is full.
+	bool TryPush(_In_ const ReportRecord& report) noexcept;
+
+	// Takes the oldest report from the ring.
+	// @param report - taken report.
+	// @returns false if the ring is empty.
+	bool TryPop(_Out_ ReportRecord& report) noexcept;
+
+	// Wakes the drain thread if it sleeps.
+	void Wake() noexcept;
+
+	std::unique_ptr<Cell[]>		m_Cells;			// Ring cells.
+	size_t										m_Mask;				// Ring capacity - 1.
+	Position									m_Tail;				// Position of the next pushed report.
+	Position									m_Head;				// Position of the next taken report.
+	std::atomic<ReportPolicy>	m_Policy;			// Full ring policy.
+	std::atomic<bool>					m_Sleeping;		// true - the drain thread waits for the event.
+	std::atomic<bool>					m_Stop;				// true - the drain thread must exit.
+	std::atomic<size_t>				m_Dropped;		// Count of dropped reports.
+	std::atomic<size_t>				m_Lost;				// Count of lost reports.
+	std::atomic<size_t>				m_Written;		// Count of written reports.
+	std::vector<ReportRecord>	m_Batch;			// Batch buffer, reused by the drain thread.
+	Writer										m_Writer;			// Batch writer.
+	WinPipe::WinHandle				m_Event;			// Wakes the drain thread.
+	std::thread								m_Thread;			// Drain thread.
+};
+
+#endif // !REDIRECTOR_REPORT_QUEUE_H_
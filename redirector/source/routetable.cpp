@@ -0,0 +1,184 @@
+#include "global.h"
+
+namespace
+{
+	// Size of the address family prefix in bits.
+	constexpr BYTE G_PREFIX_V4_ = 32;
+	constexpr BYTE G_PREFIX_V6_ = 128;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	bool IsValidRule(_In_ const BaseConfigManager::Rule& rule)
+	{
+		return	((rule.m_Family == AF_INET && rule.m_PrefixLength <= G_PREFIX_V4_) || (rule.m_Family == AF_INET6 && rule.m_PrefixLength <= G_PREFIX_V6_)) &&
+						rule.m_PortFirst <= rule.m_PortLast && rule.m_Action <= RuleAction::Block;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	bool IsV4Mapped(_In_ const in6_addr& address)
+	{
+		static constexpr BYTE prefix[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+		return std::memcmp(address.u.Byte, prefix, sizeof(prefix)) == 0;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RouteTable::RouteTable(_In_ const BaseConfigManager::Rules& rules)
+{
+	// Loopback rules are the last ones, so the rules of the same prefix override them.
+	static const BaseConfigManager::Rule loopbackV4 = { AF_INET, { 127 }, 8, 0, USHRT_MAX, RuleAction::Direct };
+	static const BaseConfigManager::Rule loopbackV6 = { AF_INET6, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }, G_PREFIX_V6_, 0, USHRT_MAX, RuleAction::Direct };
+
+	auto rulesV4 = std::vector<const BaseConfigManager::Rule*>();
+	auto rulesV6 = std::vector<const BaseConfigManager::Rule*>();
+
+	for (const auto& rule : rules)
+	{
+		if (!IsValidRule(rule))
+			continue;
+
+		(rule.m_Family == AF_INET ? rulesV4 : rulesV6).push_back(&rule);
+	}
+
+	rulesV4.push_back(&loopbackV4);
+	rulesV6.push_back(&loopbackV6);
+
+	m_Entries.reserve(rulesV4.size() + rulesV6.size());
+
+	Compile(rulesV4, m_V4);
+	Compile(rulesV6, m_V6);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RuleAction RouteTable::Match(_In_ const sockaddr* address) const noexcept
+{
+	auto prefix = Prefix{ 0 };
+	auto action = RuleAction::Proxy;
+
+	if (address->sa_family == AF_INET)
+	{
+		auto v4 = reinterpret_cast<const sockaddr_in*>(address);
+
+		std::memcpy(prefix.data(), &v4->sin_addr, sizeof(v4->sin_addr));
+		Lookup(m_V4, prefix, ntohs(v4->sin_port), action);
+	}
+	else if (address->sa_family == AF_INET6)
+	{
+		auto v6 = reinterpret_cast<const sockaddr_in6*>(address);
+
+		if (IsV4Mapped(v6->sin6_addr))
+		{
+			std::memcpy(prefix.data(), v6->sin6_addr.u.Byte + 12, sizeof(in_addr));
+			Lookup(m_V4, prefix, ntohs(v6->sin6_port), action);
+		}
+		else
+		{
+			std::memcpy(prefix.data(), v6->sin6_addr.u.Byte, sizeof(v6->sin6_addr));
+			Lookup(m_V6, prefix, ntohs(v6->sin6_port), action);
+		}
+	}
+
+	return action;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void RouteTable::Compile(_In_ const std::vector<const BaseConfigManager::Rule*>& rules, _Out_ Family& family)
+{
+	// Grouping the rules by prefix, keeping their order.
+	auto groups = std::map<std::pair<BYTE, Prefix>, std::vector<const BaseConfigManager::Rule*>>();
+
+	for (auto rule : rules)
+	{
+		auto address = Prefix{ 0 };
+		std::memcpy(address.data(), rule->m_Address, address.size());
+
+		groups[{ rule->m_PrefixLength, Mask(address, rule->m_PrefixLength) }].push_back(rule);
+	}
+
+	// The table is at most half full, so the probe sequences stay short.
+	auto capacity = size_t{ 1 };
+	while (capacity < groups.size() * 2)
+		capacity <<= 1;
+
+	family.m_Slots.assign(capacity, Slot{});
+	family.m_Lengths.clear();
+
+	for (const auto& [key, group] : groups)
+	{
+		const auto& [length, prefix] = key;
+
+		auto index = Hash(prefix, length) & (capacity - 1);
+		while (family.m_Slots[index].m_Count)
+			index = (index + 1) & (capacity - 1);
+
+		family.m_Slots[index] = Slot{ prefix, length, static_cast<DWORD>(m_Entries.size()), static_cast<DWORD>(group.size()) };
+
+		for (auto rule : group)
+			m_Entries.push_back(Entry{ rule->m_PortFirst, rule->m_PortLast, rule->m_Action });
+
+		if (family.m_Lengths.empty() || family.m_Lengths.back() != length)
+			family.m_Lengths.push_back(length);
+	}
+
+	// Groups are ordered by the length, the longest prefix must be checked first.
+	std::reverse(family.m_Lengths.begin(), family.m_Lengths.end());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RouteTable::Lookup(_In_ const Family& family, _In_ const Prefix& address, _In_ WORD port, _Out_ RuleAction& action) const noexcept
+{
+	auto mask = family.m_Slots.size() - 1;
+
+	for (auto length : family.m_Lengths)
+	{
+		auto prefix = Mask(address, length);
+
+		for (auto index = Hash(prefix, length) & mask; family.m_Slots[index].m_Count; index = (index + 1) & mask)
+		{
+			const auto& slot = family.m_Slots[index];
+			if (slot.m_Length != length || slot.m_Prefix != prefix)
+				continue;
+
+			for (auto entry = m_Entries.data() + slot.m_First; entry != m_Entries.data() + slot.m_First + slot.m_Count; ++entry)
+			{
+				if (port >= entry->m_PortFirst && port <= entry->m_PortLast)
+				{
+					action = entry->m_Action;
+					return true;
+				}
+			}
+
+			// The port is out of the prefix ranges, trying the shorter prefixes.
+			break;
+		}
+	}
+
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RouteTable::Prefix RouteTable::Mask(_In_ const Prefix& address, _In_ BYTE length) noexcept
+{
+	auto result = Prefix{ 0 };
+	auto bytes	= length / CHAR_BIT;
+
+	std::memcpy(result.data(), address.data(), bytes);
+
+	if (length % CHAR_BIT)
+		result[bytes] = address[bytes] & static_cast<BYTE>(0xFF << (CHAR_BIT - length % CHAR_BIT));
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t RouteTable::Hash(_In_ const Prefix& prefix, _In_ BYTE length) noexcept
+{
+	// 64-bit FNV-1a over the prefix length and the significant prefix bytes,
+	// folded to size_t on 32-bit targets.
+	auto hash	= uint64_t{ 14695981039346656037ull } ^ length;
+	auto bytes	= (static_cast<size_t>(length) + CHAR_BIT - 1) / CHAR_BIT;
+
+	for (size_t i = 0; i < bytes; ++i)
+		hash = (hash ^ prefix[i]) * 1099511628211ull;
+
+	return static_cast<size_t>(hash ^ (hash >> 32));
+}
@@ -0,0 +1,96 @@
+#ifndef REDIRECTOR_ROUTE_TABLE_H_
+#define REDIRECTOR_ROUTE_TABLE_H_
+
+// Compiled routing rules.
+// The most specific prefix wins. Rules of the same prefix are checked in their
+// order, and the first one whose port range contains the target port is applied.
+// If the port is out of all ranges, the shorter prefixes are checked.
+// The connect is proxied if no rule matches.
+//
+// Every prefix length used by the rules has its prefixes in a flat open addressing
+// hash table, so the lookup costs one probe per distinct prefix length,
+// regardless of the count of rules. IPv4-mapped IPv6 addresses are matched with IPv4 rules.
+class RouteTable
+{
+	// Prefix address in network byte order.
+	using Prefix = std::array<BYTE, 16>;
+
+	// Rules of a single prefix.
+	struct Slot
+	{
+		Prefix	m_Prefix;		// Masked prefix address.
+		BYTE		m_Length;		// Prefix length.
+		DWORD		m_First;		// Index of the first prefix rule.
+		DWORD		m_Count;		// Count of prefix rules. 0 - slot is empty.
+	};
+
+	// Compiled rule.
+	struct Entry
+	{
+		WORD				m_PortFirst;	// First port of the range.
+		WORD				m_PortLast;		// Last port of the range.
+		RuleAction	m_Action;			// Rule action.
+	};
+
+	// Rules of a single address family.
+	struct Family
+	{
+		std::vector<Slot>		m_Slots;		// Hash table of prefixes, the size is a power of two.
+		std::vector<BYTE>		m_Lengths;	// Used prefix lengths, the longest first.
+	};
+
+public:
+	// Deleted default constructor.
+	RouteTable() = delete;
+	// Default destructor.
+	~RouteTable() = default;
+	// Deleted copy constructor.
+	RouteTable(const RouteTable&) = delete;
+	// Deleted copy assigment.
+	RouteTable& operator=(const RouteTable&) = delete;
+
+	// RouteTable constructor. Compiles the rules.
+	// Loopback addresses go directly unless the rules say otherwise.
+	// Invalid rules are skipped.
+	// @param rules - ordered routing rules.
+	explicit RouteTable(_In_ const BaseConfigManager::Rules& rules);
+
+	// Returns the action for the target address.
+	// @param address - target app address.
+	RuleAction Match(_In_ const sockaddr* address) const noexcept;
+
+	// Returns count of compiled rules.
+	size_t Size() const noexcept {
+		return m_Entries.size();
+	}
+
+private:
+	// Compiles the rules of the address family.
+	// @param rules - rules of the family.
+	// @param family - compiled rules.
+	void Compile(_In_ const std::vector<const BaseConfigManager::Rule*>& rules, _Out_ Family& family);
+
+	// Looks for the rule of the address and port.
+	// @param family - compiled rules.
+	// @param address - target address in network byte order.
+	// @param port - target port in host byte order.
+	// @param action - action of the matched rule.
+	// @returns true if a rule is matched.
+	bool Lookup(_In_ const Family& family, _In_ const Prefix& address, _In_ WORD port, _Out_ RuleAction& action) const noexcept;
+
+	// Returns the address masked by the prefix length.
+	// @param address - address.
+	// @param length - prefix length.
+	static Prefix Mask(_In_ const Prefix& address, _In_ BYTE length) noexcept;
+
+	// Returns hash of the prefix.
+	// @param prefix - masked prefix address.
+	// @param length - prefix length.
+	static size_t Hash(_In_ const Prefix& prefix, _In_ BYTE length) noexcept;
+
+	std::vector<Entry>	m_Entries;	// Compiled rules grouped by prefix.
+	Family							m_V4;				// IPv4 rules.
+	Family							m_V6;				// IPv6 rules.
+};
+
+#endif // !REDIRECTOR_ROUTE_TABLE_H_
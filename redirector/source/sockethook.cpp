@@ -2,33 +2,18 @@
 
 namespace
 {
+	// Timeout of the redirector own connects to the proxy server in milliseconds.
+	constexpr DWORD G_PROBE_TIMEOUT_ = 3000;
+
+	// Count of connection reports queued for the report pipe.
+	constexpr size_t G_REPORTS_CAPACITY_ = 1024;
+
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	bool IsInet(_In_ const sockaddr* address) 
 	{
 		return address->sa_family == AF_INET || address->sa_family == AF_INET6;
 	}
 
-	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	bool IsLocalHost(_In_ const sockaddr* address)
-	{
-		if (address->sa_family == AF_INET)
-		{
-			auto v4 = (const sockaddr_in*)address;
-			return v4->sin_addr.s_net == 0x7f;
-		}
-		else if (address->sa_family == AF_INET6)
-		{
-			auto v6 = (const sockaddr_in6*)address;
-			return	v6->sin6_addr.u.Word[0] == 0 && v6->sin6_addr.u.Word[1] == 0 &&
-							v6->sin6_addr.u.Word[2] == 0 && v6->sin6_addr.u.Word[3] == 0 &&
-							v6->sin6_addr.u.Word[4] == 0 && v6->sin6_addr.u.Word[5] == 0 &&
-							v6->sin6_addr.u.Word[6] == 0 && v6->sin6_addr.u.Byte[14] == 0 &&
-							v6->sin6_addr.u.Byte[15] == 1;
-		}
-
-		return false;
-	}
-	
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	bool IsAddressEquals(_In_ const sockaddr* address1, _In_ const sockaddr* address2) 
 	{
@@ -61,8 +46,16 @@ std::mutex							SocketHook::s_UsersMutex;
 std::condition_variable	SocketHook::s_UsersCondition;
 
 std::unique_ptr<WinPipe::NamedPipeClient>	SocketHook::s_Pipe;
-BaseConfigManager::Config									SocketHook::s_Config;
-std::unordered_map<SOCKET, bool>					SocketHook::s_BlockIO;
+std::unique_ptr<ReportQueue>							SocketHook::s_Reports;
+std::unique_ptr<AbstractReportTransport>	SocketHook::s_Transport;
+std::mutex																SocketHook::s_TransportMutex;
+RcuPointer<ConfigSnapshot>								SocketHook::s_Snapshot;
+size_t																		SocketHook::s_Version = 0;
+SocketTable<SocketHook::SocketState>			SocketHook::s_Sockets;
+
+std::unique_ptr<HandshakeDriver>								SocketHook::s_Handshakes;
+
+std::unique_ptr<UpstreamBalancer>								SocketHook::s_Balancer;
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 bool SocketHook::Initialize()
@@ -72,6 +65,39 @@ bool SocketHook::Initialize()
 	if (s_HookIoctlsocket.CreateAndEnable()			!= MH_OK) spdlog::warn("Failed to create hook ioctlsocket function.");
 	if (s_HookWSAAsyncSelect.CreateAndEnable()	!= MH_OK) spdlog::warn("Failed to create hook WSAAsyncSelect function.");
 	if (s_HookWSAEventSelect.CreateAndEnable()	!= MH_OK) spdlog::warn("Failed to create hook WSAEventSelect function.");
+	if (s_HookWSAEnumNetworkEvents.CreateAndEnable() != MH_OK) spdlog::warn("Failed to create hook WSAEnumNetworkEvents function.");
+	if (s_HookCloseSocket.CreateAndEnable()			!= MH_OK) spdlog::warn("Failed to create hook closesocket function.");
+
+	s_Balancer = std::make_unique<UpstreamBalancer>(&SocketHook::ProbeUpstream);
+
+	try
+	{
+		s_Reports = std::make_unique<ReportQueue>(G_REPORTS_CAPACITY_, [](const ReportRecord* records, size_t count)
+		{
+			std::lock_guard<std::mutex> lock(s_TransportMutex);
+			return s_Transport.get() && s_Transport->Write(records, count) == ERROR_SUCCESS;
+		});
+	}
+	catch (const std::runtime_error& error)
+	{
+		spdlog::warn("RuntimeError: {}. Connections are not reported.", error.what());
+	}
+
+	try
+	{
+		s_Handshakes = std::make_unique<HandshakeDriver>([](const HandshakeDriver::Handshake& handshake, int error)
+		{
+			// Aborted handshakes are not the proxy server failures.
+			if (error != WSAECONNABORTED)
+				ReportUpstream(handshake.m_Upstream, handshake.m_Started, handshake.m_Connected, error == 0);
+
+			RestoreAsyncSelect(handshake.m_Socket, error, true);
+		}, s_HookWSAEnumNetworkEvents.s_Original ? s_HookWSAEnumNetworkEvents.s_Original : &WSAEnumNetworkEvents);
+	}
+	catch (const std::runtime_error& error)
+	{
+		spdlog::warn("RuntimeError: {}. Non-blocking sockets are proxied synchronously.", error.what());
+	}
 
 	return true;
 }
@@ -81,6 +107,8 @@ void SocketHook::Uninitialize()
 {
 	std::unique_lock<std::mutex> usersLock(s_UsersMutex);
 
+	s_HookCloseSocket.Disable();
+	s_HookWSAEnumNetworkEvents.Disable();
 	s_HookWSAEventSelect.Disable();
 	s_HookWSAAsyncSelect.Disable();
 	s_HookIoctlsocket.Disable();
@@ -89,91 +117,364 @@ void SocketHook::Uninitialize()
 
 	s_UsersCondition.wait(usersLock, [] { return s_UsersCount.load(std::memory_order_relaxed) == 0; });
 
+	if (s_Reports.get() && s_Reports->GetWritten() + s_Reports->GetDropped() + s_Reports->GetLost() != 0)
+		spdlog::info("Connection reports written={} dropped={} lost={}.", s_Reports->GetWritten(), s_Reports->GetDropped(), s_Reports->GetLost());
+
+	s_Handshakes.reset();
+	s_Balancer.reset();
+
+	// Writing the queued reports before the pipe is closed.
+	s_Reports.reset();
+	s_Transport.reset();
 	s_Pipe.reset();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void SocketHook::UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ WinPipe::WinHandle& stopEvent)
+void SocketHook::UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules, _In_ WinPipe::WinHandle& stopEvent)
 {
-	s_Config = config;
+	// Publishing the config with the compiled routing rules. Proxied connects
+	// in progress keep the previous snapshot until their handshakes are finished.
+	auto snapshot = std::make_shared<const ConfigSnapshot>(config, rules, ++s_Version);
+	spdlog::info("Config version {} with {} routing rules.", snapshot->m_Version, snapshot->m_Routes.Size());
 
-	// Creating report named pipe.
-	if (s_Config.m_LoggingEnable) 
+	s_Snapshot.Publish(std::move(snapshot));
+
+	if (s_Balancer.get())
+		s_Balancer->Configure(config);
+
+	if (s_Reports.get())
+		s_Reports->SetPolicy(config.m_ReportPolicy);
+
+	// Opening report transport.
+	if (config.m_LoggingEnable) 
 	{
-		if (!s_Pipe.get()) s_Pipe = std::make_unique<WinPipe::NamedPipeClient>(stopEvent);
+		std::lock_guard<std::mutex> lock(s_TransportMutex);
 
-		if (!s_Pipe->IsOpen()) 
-		{
-			if (auto status = s_Pipe->Connect(ObjectNames::GetReportPipeName(GetCurrentProcessId())); status != ERROR_SUCCESS)
-				spdlog::warn("Failed to create report named pipe. GetLastError={}", status);
-		}
+		if (!s_Transport.get())
+			s_Transport = OpenReportTransport(stopEvent);
 	}
-	else if (!s_Config.m_LoggingEnable)
+	else if (!config.m_LoggingEnable)
 	{
+		std::lock_guard<std::mutex> lock(s_TransportMutex);
+
+		s_Transport.reset();
+
 		if (s_Pipe.get())
 			s_Pipe->Close();
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-const sockaddr* SocketHook::GetProxyAddress(ADDRESS_FAMILY family)
+std::unique_ptr<AbstractReportTransport> SocketHook::OpenReportTransport(_In_ WinPipe::WinHandle& stopEvent)
 {
-	switch (family) 
+	// The shared ring of the client is preferred.
+	try
 	{
-		case AF_INET:		return reinterpret_cast<const sockaddr*>(&s_Config.m_ProxyV4);
-		case AF_INET6:	return reinterpret_cast<const sockaddr*>(&s_Config.m_ProxyV6);
+		return std::make_unique<SharedReportTransport>(stopEvent, GetCurrentProcessId());
 	}
+	catch (const std::runtime_error&)
+	{ }
+
+	// The client has no ring, the reports are sent through the named pipe.
+	if (!s_Pipe.get()) s_Pipe = std::make_unique<WinPipe::NamedPipeClient>(stopEvent);
+
+	if (!s_Pipe->IsOpen()) 
+	{
+		if (auto status = s_Pipe->Connect(ObjectNames::GetReportPipeName(GetCurrentProcessId())); status != ERROR_SUCCESS)
+		{
+			spdlog::warn("Failed to create report named pipe. GetLastError={}", status);
+			return nullptr;
+		}
+	}
+
+	return std::make_unique<PipeReportTransport>(*s_Pipe);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const ConfigSnapshot> SocketHook::Route(_In_ const sockaddr* address, _Out_ RuleAction& action)
+{
+	action = RuleAction::Direct;
+
+	if (!IsInet(address))
+		return nullptr;
+
+	auto snapshot = s_Snapshot.Read();
+
+	// There is no config yet.
+	if (!snapshot.Get())
+		return nullptr;
+
+	action = snapshot->m_Routes.Match(address);
+
+	if (action != RuleAction::Proxy || !BaseConfigManager::Validate(snapshot->m_Config))
+		return nullptr;
+
+	return snapshot.Share();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SocketHook::GetProxyInstance(_In_ const ConfigSnapshot& snapshot, _Out_ SocksProtocol& socks, _Out_ std::shared_ptr<const UpstreamBalancer::Upstream>& upstream, _In_ SOCKET& socket, _In_ const sockaddr* address)
+{
+	const auto& config = snapshot.m_Config;
+
+	upstream.reset();
+
+	if (s_Balancer.get() && (upstream = s_Balancer->Select(address->sa_family)))
+		return socks.Create(config, socket, address, upstream->GetAddress());
+
+	return socks.Create(config, socket, address, AbstractSocks::SelectProxyAddress(config));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SocketHook::ReportUpstream(_In_ const std::shared_ptr<const UpstreamBalancer::Upstream>& upstream, _In_ std::chrono::steady_clock::time_point started, _In_ bool connected, _In_ bool success)
+{
+	if (!upstream.get() || (connected && !success))
+		return;
+
+	UpstreamBalancer::Report(*upstream, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started), success);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SocketHook::IsAsyncSelected(_In_ SOCKET socket)
+{
+	auto selected = false;
+
+	s_Sockets.Find(socket, [&](const SocketState& state) { selected = state.m_Select.m_Window || state.m_Select.m_Event; });
+	return selected;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int SocketHook::ConnectAsync(_In_ std::shared_ptr<const ConfigSnapshot> snapshot, _In_ SOCKET socket, _In_ const sockaddr* address, _In_ int length)
+{
+	// A connect during the handshake of the socket fails as a connect in progress,
+	// the pending flag is checked and set at once, so only one handshake is started.
+	if (s_Sockets.Update(socket, [](SocketState& state) { return std::exchange(state.m_Select.m_Pending, true); }))
+	{
+		WSASetLastError(WSAEALREADY);
+		return SOCKET_ERROR;
+	}
+
+	auto handshake = std::make_unique<HandshakeDriver::Handshake>(socket, address, length);
+
+	// The protocol references the snapshot config, so the handshake keeps it.
+	handshake->m_Snapshot = std::move(snapshot);
+
+	if (!GetProxyInstance(*handshake->m_Snapshot, handshake->m_Socks, handshake->m_Upstream, handshake->m_Socket, handshake->GetAddress()))
+	{
+		s_Sockets.Update(socket, [](SocketState& state) { state.m_Select.m_Pending = false; });
+
+		WSASetLastError(WSAEAFNOSUPPORT);
+		return SOCKET_ERROR;
+	}
+
+	// The socket is selected with the driver event until the handshake is complete,
+	// so the app is not notified about the connection to the proxy server.
+	s_HookWSAEventSelect.s_Original(socket, s_Handshakes->GetEvent(), FD_CONNECT | FD_READ | FD_WRITE | FD_CLOSE);
+
+	auto status = s_HookConnect.s_Original(socket, handshake->m_Socks.GetProxyAddress(), length);
+	auto error	= status == 0 ? WSAEWOULDBLOCK : WSAGetLastError();
+
+	if (error != WSAEWOULDBLOCK)
+	{
+		ReportUpstream(handshake->m_Upstream, handshake->m_Started, false, false);
+		RestoreAsyncSelect(socket, error, false);
+		shutdown(socket, SD_BOTH);
+
+		WSASetLastError(error);
+		return SOCKET_ERROR;
+	}
+
+	s_Handshakes->Add(std::move(handshake));
 
-	return nullptr;
+	WSASetLastError(WSAEWOULDBLOCK);
+	return SOCKET_ERROR;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::unique_ptr<AbstractSocks> SocketHook::GetProxyInstance(_In_ SOCKET& socket, _In_ const sockaddr* address)
+void SocketHook::RestoreAsyncSelect(_In_ SOCKET socket, _In_ int error, _In_ bool notify)
 {
-	switch (s_Config.m_ProxyType)
+	auto select		= AsyncSelect();
+	auto applied	= false;
+
+	// Winsock is called without the shard lock. The socket stays pending meanwhile,
+	// so a selection changed by the app is only stored, and it is applied by the next iteration.
+	if (!s_Sockets.Find(socket, [&](const SocketState& state) { select = state.m_Select; }))
+		return;
+
+	if (notify && error)
+		shutdown(socket, SD_BOTH);
+
+	while (!applied)
 	{
-		case ProxyType::Socks4: return std::make_unique<Socks4>(s_Config, socket, address);
-		case ProxyType::Socks5: return std::make_unique<Socks5>(s_Config, socket, address);
+		if (select.m_Window)			s_HookWSAAsyncSelect.s_Original(socket, select.m_Window, select.m_Message, select.m_Events);
+		else if (select.m_Event)	s_HookWSAEventSelect.s_Original(socket, select.m_Event, select.m_Events);
+		else											s_HookWSAEventSelect.s_Original(socket, nullptr, 0);
+
+		auto events = notify ? (FD_CONNECT | (error ? 0 : FD_WRITE)) & select.m_Events : 0;
+
+		auto found = s_Sockets.Find(socket, [&](SocketState& state)
+		{
+			auto& current = state.m_Select;
+
+			if (current.m_Window != select.m_Window || current.m_Message != select.m_Message || 
+					current.m_Event != select.m_Event || current.m_Events != select.m_Events)
+			{
+				select = current;
+				return;
+			}
+
+			current.m_Pending = false;
+			applied						= true;
+
+			// Completion events are merged into the next WSAEnumNetworkEvents result.
+			if (current.m_Event && events)
+			{
+				current.m_Posted	= events;
+				current.m_Error		= error;
+			}
+		});
+
+		// The socket is closed.
+		if (!found)
+			return;
+
+		if (applied)
+		{
+			if (select.m_Window)
+			{
+				if (events & FD_CONNECT)	PostMessageW(select.m_Window, select.m_Message, socket, WSAMAKESELECTREPLY(FD_CONNECT, error));
+				if (events & FD_WRITE)		PostMessageW(select.m_Window, select.m_Message, socket, WSAMAKESELECTREPLY(FD_WRITE, 0));
+			}
+			else if (select.m_Event && events)
+				WSASetEvent(select.m_Event);
+		}
 	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SOCKET SocketHook::ConnectProxy(_In_ const sockaddr* address, _In_ ProxyType type, _In_ DWORD timeout)
+{
+	auto length = address->sa_family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+	auto socket = WSASocketW(address->sa_family, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED);
 
-	return nullptr;
+	if (socket == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	// Connecting in the non-blocking mode, so an unreachable server is given up after the timeout.
+	auto nb				= u_long{ TRUE };
+	auto success	= s_HookIoctlsocket.s_Original(socket, FIONBIO, &nb) == 0;
+
+	if (success && s_HookConnect.s_Original(socket, address, static_cast<int>(length)) != 0)
+	{
+		auto writable = fd_set{ 0 };
+		auto failed		= fd_set{ 0 };
+		auto wait			= timeval{ static_cast<long>(timeout / 1000), static_cast<long>(timeout % 1000 * 1000) };
+
+		FD_SET(socket, &writable);
+		FD_SET(socket, &failed);
+
+		success = WSAGetLastError() == WSAEWOULDBLOCK && select(0, nullptr, &writable, &failed, &wait) == 1 && FD_ISSET(socket, &writable);
+	}
+
+	nb = FALSE;
+	success = success && s_HookIoctlsocket.s_Original(socket, FIONBIO, &nb) == 0;
+
+	// Bounding the socks5 greeting, then restoring the default timeouts for the app.
+	if (success && type == ProxyType::Socks5)
+	{
+		auto noTimeout = DWORD{ 0 };
+
+		setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+		setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+		success = Socks5::Authorize(socket);
+
+		setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&noTimeout), sizeof(noTimeout));
+		setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&noTimeout), sizeof(noTimeout));
+	}
+
+	if (!success)
+	{
+		closesocket(socket);
+		return INVALID_SOCKET;
+	}
+
+	return socket;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SocketHook::ProbeUpstream(_In_ const sockaddr* address)
+{
+	auto type = ProxyType::Socks5;
+
+	// The read section is left before connecting, so the config update does not wait for the probe.
+	{
+		auto snapshot = s_Snapshot.Read();
+		if (!snapshot.Get())
+			return false;
+
+		type = snapshot->m_Config.m_ProxyType;
+	}
+
+	auto socket = ConnectProxy(address, type, G_PROBE_TIMEOUT_);
+	if (socket == INVALID_SOCKET)
+		return false;
+
+	closesocket(socket);
+	return true;
+}
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int WSAAPI SocketHook::hook_connect(SOCKET s, const sockaddr* name, int namelen)
 {
-	auto hookScope = UserHookScope(s_UsersCount, s_UsersCondition);
+	auto hookScope	= UserHookScope(s_UsersCount, s_UsersCondition);
+	auto socks			= SocksProtocol();
+	auto upstream		= std::shared_ptr<const UpstreamBalancer::Upstream>();
+	auto action			= RuleAction::Direct;
+	auto snapshot		= Route(name, action);
 
-	if (IsInet(name) && !IsLocalHost(name) && BaseConfigManager::Validate(s_Config))
+	if (action == RuleAction::Block)
 	{
-		auto socks				= GetProxyInstance(s, name);
-		auto socksAddress = socks->GetProxyAddress();
+		WSASetLastError(WSAEACCES);
+		return SOCKET_ERROR;
+	}
 
-		// Sending report to named channel if logging is specified.
-		if (s_Config.m_LoggingEnable && s_Pipe.get() && s_Pipe->IsOpen())
-			s_Pipe->WriteMessage(name->sa_family, reinterpret_cast<const BYTE*>(name), namelen);
+	if (snapshot.get() && GetProxyInstance(*snapshot, socks, upstream, s, name))
+	{
+		auto socksAddress = socks.GetProxyAddress();
+
+		// Queuing report to named channel if logging is specified.
+		if (snapshot->m_Config.m_LoggingEnable && s_Reports.get())
+			s_Reports->Push(name->sa_family, reinterpret_cast<const BYTE*>(name), namelen);
 
 		// If the address of the target application is not equal to the
 		// address of the proxy server, start proxying
 		if (!IsAddressEquals(socksAddress, name))
 		{
-			auto socketScope = SocketLockScope(s);
+			// Non-blocking sockets selected by the app are proxied in background.
+			if (s_Handshakes.get() && IsAsyncSelected(s))
+				return ConnectAsync(std::move(snapshot), s, name, namelen);
+
+			auto socketScope	= SocketLockScope(s);
+			auto started			= std::chrono::steady_clock::now();
 
 			// Connecting to proxy server.
 			if (auto status = s_HookConnect.s_Original(s, socksAddress, namelen); status != 0) 
 			{
+				ReportUpstream(upstream, started, false, false);
 				shutdown(s, SD_BOTH);
 				return status;
 			}
 
 			// Sending request to server.
-			if (!socks->Request()) 
+			if (!socks.Request()) 
 			{
+				ReportUpstream(upstream, started, true, false);
 				shutdown(s, SD_BOTH);
 				return SOCKET_ERROR;
 			}
 
+			ReportUpstream(upstream, started, true, true);
 			return 0;
 		}
 	}
@@ -184,37 +485,55 @@ int WSAAPI SocketHook::hook_connect(SOCKET s, const sockaddr* name, int namelen)
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int WSAAPI SocketHook::hook_WSAConnect(SOCKET s, const sockaddr* name, int namelen, LPWSABUF lpCallerData, LPWSABUF lpCalleeData, LPQOS lpSQOS, LPQOS lpGQOS)
 {
-	auto hookScope = UserHookScope(s_UsersCount, s_UsersCondition);
+	auto hookScope	= UserHookScope(s_UsersCount, s_UsersCondition);
+	auto socks			= SocksProtocol();
+	auto upstream		= std::shared_ptr<const UpstreamBalancer::Upstream>();
+	auto action			= RuleAction::Direct;
+	auto snapshot		= Route(name, action);
+
+	if (action == RuleAction::Block)
+	{
+		WSASetLastError(WSAEACCES);
+		return SOCKET_ERROR;
+	}
 
-	if (IsInet(name) && !IsLocalHost(name) && BaseConfigManager::Validate(s_Config))
+	if (snapshot.get() && GetProxyInstance(*snapshot, socks, upstream, s, name))
 	{
-		auto socks				= GetProxyInstance(s, name);
-		auto socksAddress = socks->GetProxyAddress();
+		auto socksAddress = socks.GetProxyAddress();
 
-		// Sending report to named channel if logging is specified.
-		if (s_Config.m_LoggingEnable && s_Pipe.get() && s_Pipe->IsOpen())
-			s_Pipe->WriteMessage(name->sa_family, reinterpret_cast<const BYTE*>(name), namelen);
+		// Queuing report to named channel if logging is specified.
+		if (snapshot->m_Config.m_LoggingEnable && s_Reports.get())
+			s_Reports->Push(name->sa_family, reinterpret_cast<const BYTE*>(name), namelen);
 
 		// If the address of the target application is not equal to the
 		// address of the proxy server, start proxying.
 		if (!IsAddressEquals(socksAddress, name))
 		{
-			auto socketScope = SocketLockScope(s);
+			// Non-blocking sockets selected by the app are proxied in background.
+			// Caller data and QOS are not used for TCP, so connect is enough.
+			if (s_Handshakes.get() && IsAsyncSelected(s))
+				return ConnectAsync(std::move(snapshot), s, name, namelen);
+
+			auto socketScope	= SocketLockScope(s);
+			auto started			= std::chrono::steady_clock::now();
 
 			// Connecting to proxy server.
 			if (auto status = s_HookWSAConnect.s_Original(s, socksAddress, namelen, lpCallerData, lpCalleeData, lpSQOS, lpGQOS); status != 0) 
 			{
+				ReportUpstream(upstream, started, false, false);
 				shutdown(s, SD_BOTH);
 				return status;
 			}
 
 			// Sending request to server.
-			if (!socks->Request()) 
+			if (!socks.Request()) 
 			{
+				ReportUpstream(upstream, started, true, false);
 				shutdown(s, SD_BOTH);
 				return SOCKET_ERROR;
 			}
 
+			ReportUpstream(upstream, started, true, true);
 			return 0;
 		}
 	}
@@ -226,7 +545,7 @@ int WSAAPI SocketHook::hook_WSAConnect(SOCKET s, const sockaddr* name, int namel
 int WSAAPI SocketHook::hook_ioctlsocket(SOCKET s, long cmd, u_long* argp)
 {
 	if (cmd == FIONBIO)
-		s_BlockIO[s] = *argp;
+		s_Sockets.Update(s, [&](SocketState& state) { state.m_NonBlocking = *argp != 0; });
 
 	return s_HookIoctlsocket.s_Original(s, cmd, argp);
 }
@@ -234,7 +553,24 @@ int WSAAPI SocketHook::hook_ioctlsocket(SOCKET s, long cmd, u_long* argp)
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int WSAAPI SocketHook::hook_WSAAsyncSelect(SOCKET s, HWND hWnd, u_int wMsg, long lEvent)
 {
-	s_BlockIO[s] = true;
+	auto pending = s_Sockets.Update(s, [&](SocketState& state)
+	{
+		auto& select = state.m_Select;
+
+		state.m_NonBlocking = true;
+
+		select.m_Window		= lEvent ? hWnd : nullptr;
+		select.m_Message	= wMsg;
+		select.m_Event		= nullptr;
+		select.m_Events		= lEvent;
+		select.m_Posted		= 0;
+
+		return select.m_Pending;
+	});
+
+	// The selection will be applied when the handshake is complete.
+	if (pending)
+		return 0;
 
 	return s_HookWSAAsyncSelect.s_Original(s, hWnd, wMsg, lEvent);
 }
@@ -242,7 +578,61 @@ int WSAAPI SocketHook::hook_WSAAsyncSelect(SOCKET s, HWND hWnd, u_int wMsg, long
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int WSAAPI SocketHook::hook_WSAEventSelect(SOCKET s, WSAEVENT hEventObject, long lNetworkEvents)
 {
-	s_BlockIO[s] = true;
+	auto pending = s_Sockets.Update(s, [&](SocketState& state)
+	{
+		auto& select = state.m_Select;
+
+		state.m_NonBlocking = true;
+
+		select.m_Window		= nullptr;
+		select.m_Message	= 0;
+		select.m_Event		= lNetworkEvents ? hEventObject : nullptr;
+		select.m_Events		= lNetworkEvents;
+		select.m_Posted		= 0;
+
+		return select.m_Pending;
+	});
+
+	// The selection will be applied when the handshake is complete.
+	if (pending)
+		return 0;
 
 	return s_HookWSAEventSelect.s_Original(s, hEventObject, lNetworkEvents);
 }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int WSAAPI SocketHook::hook_WSAEnumNetworkEvents(SOCKET s, WSAEVENT hEventObject, LPWSANETWORKEVENTS lpNetworkEvents)
+{
+	auto status = s_HookWSAEnumNetworkEvents.s_Original(s, hEventObject, lpNetworkEvents);
+
+	if (status == 0)
+	{
+		// Merging proxy handshake completion events.
+		s_Sockets.Find(s, [&](SocketState& state)
+		{
+			auto& select = state.m_Select;
+
+			if (select.m_Posted & FD_CONNECT)
+				lpNetworkEvents->iErrorCode[FD_CONNECT_BIT] = select.m_Error;
+
+			lpNetworkEvents->lNetworkEvents |= select.m_Posted;
+			select.m_Posted = 0;
+		});
+	}
+
+	return status;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int WSAAPI SocketHook::hook_closesocket(SOCKET s)
+{
+	auto hookScope = UserHookScope(s_UsersCount, s_UsersCondition);
+
+	// The handle may be reused by the next socket, so its handshake and state are evicted first.
+	if (s_Handshakes.get())
+		s_Handshakes->Remove(s);
+
+	s_Sockets.Erase(s);
+
+	return s_HookCloseSocket.s_Original(s);
+}
\ No newline at end of file
@@ -18,9 +18,7 @@ class SocketHook
 		{
 			u_long nb = FALSE;
 
-			if (auto iter = s_BlockIO.find(m_Socket); iter != s_BlockIO.end())
-				nb = (u_long)iter->second;
-
+			s_Sockets.Find(m_Socket, [&](const SocketState& state) { nb = state.m_NonBlocking; });
 			s_HookIoctlsocket.s_Original(m_Socket, FIONBIO, &nb);
 		}
 
@@ -31,6 +29,27 @@ class SocketHook
 		SOCKET m_Socket;
 	};
 
+	// Asynchronous selection of the app socket.
+	// While a proxy handshake is in progress the socket is selected by the
+	// HandshakeDriver, and the app selection is restored when it completes.
+	struct AsyncSelect
+	{
+		HWND			m_Window;		// WSAAsyncSelect window.
+		u_int			m_Message;	// WSAAsyncSelect message.
+		WSAEVENT	m_Event;		// WSAEventSelect event object.
+		long			m_Events;		// Selected network events.
+		bool			m_Pending;	// true - proxy handshake in progress.
+		long			m_Posted;		// Completion events not yet taken by WSAEnumNetworkEvents.
+		int				m_Error;		// Completion FD_CONNECT error code.
+	};
+
+	// State of the app socket.
+	struct SocketState
+	{
+		bool					m_NonBlocking;	// true - the app switched the socket to the non-blocking mode.
+		AsyncSelect		m_Select;				// App asynchronous selection.
+	};
+
 	// Wrapper over the number of users of the hooked functions.
 	struct UserHookScope
 	{
@@ -65,20 +84,75 @@ public:
 	static void Uninitialize();
 
 	// Updates the configuration.
+	// Publishes the new config snapshot and waits until no hook reads the previous one.
 	// Also creates a named report pipe if logging is specified.
 	// @param config - config to update.
+	// @param rules - routing rules to compile.
 	// @param stopEvent - stop event for report named pipe.
-	static void UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ WinPipe::WinHandle& stopEvent);
+	static void UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules, _In_ WinPipe::WinHandle& stopEvent);
 
 private:
-	// Returns the address of the proxy server for the specified address type.
-	// @param family - address family.
-	static const sockaddr* GetProxyAddress(ADDRESS_FAMILY family);
+	// Opens the shared report ring of the client or, if there is none, connects the report pipe.
+	// @param stopEvent - stop event for report named pipe.
+	// @returns report transport or nullptr if the client is not reachable.
+	static std::unique_ptr<AbstractReportTransport> OpenReportTransport(_In_ WinPipe::WinHandle& stopEvent);
 
-	// Creates an instance of the proxy client
+	// Routes the connect with the current config snapshot.
+	// Addresses of the other families are connected directly.
+	// The snapshot is shared only for a proxied connect, so direct connects
+	// never touch its reference count and never outlive the read section.
+	// @param address - target app address.
+	// @param action - routing action.
+	// @returns snapshot to proxy the connect with or nullptr if the connect is not proxied.
+	static std::shared_ptr<const ConfigSnapshot> Route(_In_ const sockaddr* address, _Out_ RuleAction& action);
+
+	// Creates an instance of the proxy client in place for the upstream selected by the balancer.
+	// @param snapshot - config snapshot of the connect.
+	// @param socks - protocol to create.
+	// @param upstream - selected upstream. nullptr if there are no upstreams.
 	// @param socket - socks socket.
 	// @param address - target app address.
-	static std::unique_ptr<AbstractSocks> GetProxyInstance(_In_ SOCKET& socket, _In_ const sockaddr* address);
+	// @returns false if the proxy type is unknown.
+	static bool GetProxyInstance(_In_ const ConfigSnapshot& snapshot, _Out_ SocksProtocol& socks, _Out_ std::shared_ptr<const UpstreamBalancer::Upstream>& upstream, _In_ SOCKET& socket, _In_ const sockaddr* address);
+
+	// Reports the handshake result to the upstream balancer.
+	// Only the proxy server failures are reported, the rejected requests are the target failures.
+	// @param upstream - upstream of the handshake. Nothing is reported if nullptr.
+	// @param started - time when the handshake was started.
+	// @param connected - true if the socket is connected to the proxy server.
+	// @param success - true if the handshake is complete.
+	static void ReportUpstream(_In_ const std::shared_ptr<const UpstreamBalancer::Upstream>& upstream, _In_ std::chrono::steady_clock::time_point started, _In_ bool connected, _In_ bool success);
+
+	// Returns true if the app uses WSAAsyncSelect or WSAEventSelect on the socket.
+	// @param socket - app socket.
+	static bool IsAsyncSelected(_In_ SOCKET socket);
+
+	// Starts a non-blocking connection through the proxy server.
+	// Returns WSAEWOULDBLOCK like a regular non-blocking connect,
+	// FD_CONNECT is delivered to the app when the handshake is complete.
+	// @param snapshot - config snapshot of the connect, kept until the handshake is finished.
+	// @param socket - app socket.
+	// @param address - target app address.
+	// @param length - target app address length.
+	static int ConnectAsync(_In_ std::shared_ptr<const ConfigSnapshot> snapshot, _In_ SOCKET socket, _In_ const sockaddr* address, _In_ int length);
+
+	// Restores the app selection of the socket.
+	// @param socket - app socket.
+	// @param error - FD_CONNECT error code.
+	// @param notify - true - deliver FD_CONNECT to the app.
+	static void RestoreAsyncSelect(_In_ SOCKET socket, _In_ int error, _In_ bool notify);
+
+	// Creates a blocking socket connected to the proxy server. Socks5 socket is also authorized.
+	// @param address - proxy server address.
+	// @param type - proxy server type.
+	// @param timeout - connect and authorization timeout in milliseconds.
+	// @returns connected socket or INVALID_SOCKET.
+	static SOCKET ConnectProxy(_In_ const sockaddr* address, _In_ ProxyType type, _In_ DWORD timeout);
+
+	// Checks the upstream reachability. Used as the balancer health probe.
+	// @param address - proxy server address.
+	// @returns true if the proxy server is reachable.
+	static bool ProbeUpstream(_In_ const sockaddr* address);
 
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	/// Hooks
@@ -88,20 +162,32 @@ private:
 	static int WSAAPI hook_ioctlsocket(SOCKET s, long cmd, u_long FAR* argp);
 	static int WSAAPI hook_WSAAsyncSelect(SOCKET s, HWND hWnd, u_int wMsg, long lEvent);
 	static int WSAAPI hook_WSAEventSelect(SOCKET s, WSAEVENT hEventObject, long lNetworkEvents);
+	static int WSAAPI hook_WSAEnumNetworkEvents(SOCKET s, WSAEVENT hEventObject, LPWSANETWORKEVENTS lpNetworkEvents);
+	static int WSAAPI hook_closesocket(SOCKET s);
 
 	static MinHook::FunctionHook<connect, hook_connect>								s_HookConnect;
 	static MinHook::FunctionHook<WSAConnect, hook_WSAConnect>					s_HookWSAConnect;
 	static MinHook::FunctionHook<ioctlsocket, hook_ioctlsocket>				s_HookIoctlsocket;
 	static MinHook::FunctionHook<WSAAsyncSelect, hook_WSAAsyncSelect> s_HookWSAAsyncSelect;
 	static MinHook::FunctionHook<WSAEventSelect, hook_WSAEventSelect> s_HookWSAEventSelect;
+	static MinHook::FunctionHook<WSAEnumNetworkEvents, hook_WSAEnumNetworkEvents> s_HookWSAEnumNetworkEvents;
+	static MinHook::FunctionHook<closesocket, hook_closesocket>				s_HookCloseSocket;
 
 	static std::atomic<size_t>												s_UsersCount;			// Count of users of hooked functions.
 	static std::mutex																	s_UsersMutex;			// Locks of users of hooked functions.
 	static std::condition_variable										s_UsersCondition;	// CV of users of hooked functions.
 
 	static std::unique_ptr<WinPipe::NamedPipeClient>	s_Pipe;						// Report named pipe.
-	static BaseConfigManager::Config									s_Config;					// App config.
-	static std::unordered_map<SOCKET, bool>						s_BlockIO;				// List of block/unlock sockets.
+	static std::unique_ptr<ReportQueue>								s_Reports;				// Connection reports sent in background.
+	static std::unique_ptr<AbstractReportTransport>		s_Transport;			// Transport of the connection reports.
+	static std::mutex																	s_TransportMutex;	// Locks transport of the connection reports.
+	static RcuPointer<ConfigSnapshot>									s_Snapshot;				// Current config snapshot.
+	static size_t																			s_Version;				// Version of the last config snapshot.
+	static SocketTable<SocketState>										s_Sockets;				// App sockets state. Evicted on closesocket.
+
+	static std::unique_ptr<HandshakeDriver>						s_Handshakes;			// Non-blocking handshakes driver.
+
+	static std::unique_ptr<UpstreamBalancer>					s_Balancer;				// Upstream proxy servers balancer.
 };
 
 #endif // !REDIRECTOR_SOCKET_HOOK_H_
\ No newline at end of file
@@ -0,0 +1,100 @@
+#ifndef REDIRECTOR_SOCKET_TABLE_HPP_
+#define REDIRECTOR_SOCKET_TABLE_HPP_
+
+// Concurrent table of per-socket state.
+// Sockets are spread over shards, each with its own lock on its own cache line,
+// so hooks called from different threads for different sockets rarely contend.
+// Entries live until the socket is closed, so the table is bounded by the count of open sockets.
+// @tparam T - socket state, default constructed for a new socket.
+template <typename T>
+class SocketTable
+{
+	// Sockets of a single shard.
+	struct alignas(64) Shard
+	{
+		std::mutex										m_Mutex;		// Locks shard entries.
+		std::unordered_map<SOCKET, T>	m_Entries;	// Socket states.
+	};
+
+	// Count of shards, a power of two.
+	static constexpr size_t SHARDS_ = 64;
+
+public:
+	// Default constructor.
+	SocketTable() = default;
+	// Default destructor.
+	~SocketTable() = default;
+	// Deleted copy constructor.
+	SocketTable(const SocketTable&) = delete;
+	// Deleted copy assigment.
+	SocketTable& operator=(const SocketTable&) = delete;
+
+	// Calls the function with the socket state under the shard lock.
+	// The state is created if the socket has none.
+	// @param socket - socket.
+	// @param function - function called with T&.
+	// @returns result of the function.
+	template <typename Function>
+	decltype(auto) Update(_In_ SOCKET socket, _In_ Function&& function)
+	{
+		auto& shard = GetShard(socket);
+		std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+		return function(shard.m_Entries[socket]);
+	}
+
+	// Calls the function with the socket state under the shard lock if the socket has one.
+	// @param socket - socket.
+	// @param function - function called with T&.
+	// @returns false if the socket has no state.
+	template <typename Function>
+	bool Find(_In_ SOCKET socket, _In_ Function&& function)
+	{
+		auto& shard = GetShard(socket);
+		std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+		auto iter = shard.m_Entries.find(socket);
+		if (iter == shard.m_Entries.end())
+			return false;
+
+		function(iter->second);
+		return true;
+	}
+
+	// Removes the socket state.
+	// @param socket - socket.
+	// @returns false if the socket has no state.
+	bool Erase(_In_ SOCKET socket)
+	{
+		auto& shard = GetShard(socket);
+		std::lock_guard<std::mutex> lock(shard.m_Mutex);
+
+		return shard.m_Entries.erase(socket) != 0;
+	}
+
+	// Returns count of sockets with a state.
+	size_t Size()
+	{
+		auto size = size_t{ 0 };
+
+		for (auto& shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.m_Mutex);
+			size += shard.m_Entries.size();
+		}
+
+		return size;
+	}
+
+private:
+	// Returns the shard of the socket.
+	// Socket handles are multiples of 4, so the low bits are skipped.
+	// @param socket - socket.
+	Shard& GetShard(_In_ SOCKET socket) noexcept {
+		return m_Shards[(static_cast<size_t>(socket) >> 2) & (SHARDS_ - 1)];
+	}
+
+	Shard m_Shards[SHARDS_];	// Table shards.
+};
+
+#endif // !REDIRECTOR_SOCKET_TABLE_HPP_
@@ -50,46 +50,53 @@ public:
 	// @param config - app config.
 	// @param socket - connected socket.
 	// @param address - target app address.
-	Socks4(_In_ const BaseConfigManager::Config& config, _In_ SOCKET& socket, _In_ const sockaddr* address) :
-		AbstractSocks{ config, socket, address }
+	// @param proxy - proxy server address.
+	Socks4(_In_ const BaseConfigManager::Config& config, _In_ SOCKET& socket, _In_ const sockaddr* address, _In_ const sockaddr* proxy) :
+		AbstractSocks{ config, socket, address, proxy }
 	{ }
 
-	// Sends request to socks server.
-	// @returns true if success.
-	bool Request() override
+	// Maximal size of the request frame.
+	static constexpr size_t REQUEST_SIZE_ = sizeof(Message) + 1/*user-id*/;
+	static_assert(REQUEST_SIZE_ <= MAX_REQUEST_SIZE_, "Socks4 request does not fit the frame.");
+
+	// Writes the socks4 CONNECT request.
+	// @param output - frame to send.
+	// @returns false if the target address is not IPv4.
+	bool Start(_Out_ RequestFrame& output)
 	{
+		output.Clear();
+
 		if (m_AddressApp->sa_family != AF_INET) 
 		{
 			spdlog::error("Unsupported socks4 address type.");
 			return false;
 		}
 
-		auto ipv4				= reinterpret_cast<const sockaddr_in*>(m_AddressApp);
-		auto message		= Message{ VERSION_, static_cast<BYTE>(Command::Connect), ipv4->sin_port, ipv4->sin_addr.S_un.S_addr };
-		auto dataToSend = std::vector<BYTE>(sizeof(message) + 1/*user-id*/);
+		auto ipv4 = reinterpret_cast<const sockaddr_in*>(m_AddressApp);
 
-		// Insert socks request structure.
-		dataToSend.insert(
-			dataToSend.begin(), 
-			reinterpret_cast<const BYTE*>(&message),
-			reinterpret_cast<const BYTE*>(&message) + sizeof(message)
-		);
+		// Socks request structure with empty null-terminated user-id.
+		output.Append(Message{ VERSION_, static_cast<BYTE>(Command::Connect), ipv4->sin_port, ipv4->sin_addr.S_un.S_addr });
+		output.Append(BYTE{ 0 });
 
-		// Sending request to socks server.
-		if (send(m_Socket, reinterpret_cast<const char*>(dataToSend.data()), static_cast<int>(dataToSend.size()), 0) != dataToSend.size())
-		{
-			spdlog::error("Failed to send socks4 request message. WSAGetLastError={}", WSAGetLastError());
-			return false;
-		}
+		return true;
+	}
 
-		// Receiving response from socks server.
-		if (recv(m_Socket, reinterpret_cast<char*>(&message), sizeof(message), 0) == SOCKET_ERROR) 
-		{
-			spdlog::error("Failed to read socks4 response. WSAGetLastError={}", WSAGetLastError());
-			return false;
-		}
+	// Returns count of reply bytes required for the next step.
+	size_t Expected() const noexcept {
+		return sizeof(Message);
+	}
+
+	// Processes the socks4 reply.
+	// @param data - reply message.
+	// @param output - not used, socks4 has a single request.
+	// @returns handshake status.
+	HandshakeStatus OnReply(_In_ const BYTE* data, _Out_ RequestFrame& output)
+	{
+		auto message = reinterpret_cast<const Message*>(data);
+
+		output.Clear();
 
-		return message.status == static_cast<BYTE>(ReplyCode::Granted);
+		return message->status == static_cast<BYTE>(ReplyCode::Granted) ? HandshakeStatus::Complete : HandshakeStatus::Failed;
 	}
 };
 
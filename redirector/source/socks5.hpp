@@ -102,113 +102,268 @@ public:
 	// @param config - app config.
 	// @param socket - connected socket.
 	// @param address - target app address.
-	Socks5(_In_ const BaseConfigManager::Config& config, _In_ SOCKET& socket, _In_ const sockaddr* address) :
-		AbstractSocks{ config, socket, address }
+	// @param proxy - proxy server address.
+	Socks5(_In_ const BaseConfigManager::Config& config, _In_ SOCKET& socket, _In_ const sockaddr* address, _In_ const sockaddr* proxy) :
+		AbstractSocks{ config, socket, address, proxy }
 	{ }
 
-	// Sends request to socks server.
+	// Maximal size of the pipelined greeting and CONNECT request.
+	static constexpr size_t REQUEST_SIZE_ = sizeof(AuthorizationMessage) + 1/*methods*/ + sizeof(Message) + sizeof(AddressV6);
+	static_assert(REQUEST_SIZE_ <= MAX_REQUEST_SIZE_, "Socks5 request does not fit the frame.");
+
+	// Writes the socks5 greeting. If pipelining is enabled, the CONNECT 
+	// request is written right after it, so both are sent with one write.
+	// @param output - frame to send.
 	// @returns true if success.
-	bool Request() override
+	bool Start(_Out_ RequestFrame& output)
 	{
-		// Process server authorization.
-		if (!DoAuthorization())
-			return false;
+		m_Pipelined = m_Config.m_Socks5Pipelining && IsPipeliningSupported();
+		m_Stage			= Stage::Method;
 
-		auto message	= Message{ VERSION_, static_cast<BYTE>(Command::Connect), 0x0,  static_cast<BYTE>(m_AddressApp->sa_family == AF_INET ? AddressType::IPv4 : AddressType::IPv6)};
-		auto buffer		= std::vector<BYTE>();
+		output.Clear();
+		AppendGreeting(output);
 
-		// Inserting message header.
-		buffer.insert(
-			buffer.begin(),
-			reinterpret_cast<const BYTE*>(&message),
-			reinterpret_cast<const BYTE*>(&message) + sizeof(message)
-		);
+		if (m_Pipelined)
+			AppendConnectRequest(output);
 
-		// Insering address.
-		if (m_AddressApp->sa_family == AF_INET)
-		{
-			auto ipv4			= reinterpret_cast<const sockaddr_in*>(m_AddressApp);
-			auto address	= AddressV4{ ipv4->sin_addr.S_un.S_addr, ipv4->sin_port };
-
-			buffer.insert(
-				buffer.end(),
-				reinterpret_cast<const BYTE*>(&address),
-				reinterpret_cast<const BYTE*>(&address) + sizeof(address)
-			);
-		}
-		else if (m_AddressApp->sa_family == AF_INET6)
-		{
-			auto ipv6			= reinterpret_cast<const sockaddr_in6*>(m_AddressApp);
-			auto address	= AddressV6{};
+		return true;
+	}
 
-			std::memcpy(address.address, ipv6->sin6_addr.u.Byte, sizeof(address.address));
-			address.port = ipv6->sin6_port;
+	// Performs the greeting on a connected blocking socket.
+	// Used to probe upstreams, so an upstream that rejects our auth method is not selected.
+	// @param socket - socket connected to the proxy server.
+	// @returns true if the server accepted our auth method.
+	static bool Authorize(_In_ SOCKET socket)
+	{
+		auto output		= RequestFrame();
+		auto reply		= AuthorizationMessage{};
+		auto received = 0;
+
+		AppendGreeting(output);
 
-			buffer.insert(
-				buffer.end(),
-				reinterpret_cast<const BYTE*>(&address),
-				reinterpret_cast<const BYTE*>(&address) + sizeof(address)
-			);
+		if (send(socket, reinterpret_cast<const char*>(output.Data()), static_cast<int>(output.Size()), 0) != static_cast<int>(output.Size()))
+			return false;
+
+		while (received < sizeof(reply))
+		{
+			auto status = recv(socket, reinterpret_cast<char*>(&reply) + received, sizeof(reply) - received, 0);
+			if (status == SOCKET_ERROR || status == 0)
+				return false;
+
+			received += status;
 		}
 
-		// Sending request to socks server.
-		if (send(m_Socket, reinterpret_cast<const char*>(buffer.data()), buffer.size(), 0) != buffer.size())
+		return reply.method == static_cast<BYTE>(AuthorizationMethod::NoAuth);
+	}
+
+	// Returns count of reply bytes required for the next step.
+	size_t Expected() const noexcept
+	{
+		switch (m_Stage)
 		{
-			spdlog::error("Failed to send socks5 request message. WSAGetLastError={}", WSAGetLastError());
-			return false;
+			case Stage::Method:				return sizeof(AuthorizationMessage);
+			case Stage::Reply:				return sizeof(Message);
+			case Stage::DomainLength: return sizeof(BYTE);
+			case Stage::Address:			return m_AddressLength;
 		}
 
-		// Receiving response from socks server.
-		if (recv(m_Socket, reinterpret_cast<char*>(buffer.data()), buffer.size(), 0) == SOCKET_ERROR)
+		return 0;
+	}
+
+	// Processes the socks5 reply.
+	// @param data - reply bytes.
+	// @param output - frame for the CONNECT request in the sequential mode, or for the greeting sent again alone.
+	// @returns handshake status.
+	HandshakeStatus OnReply(_In_ const BYTE* data, _Out_ RequestFrame& output)
+	{
+		output.Clear();
+
+		switch (m_Stage)
 		{
-			spdlog::error("Failed to read socks5 response. WSAGetLastError={}", WSAGetLastError());
-			return false;
+			// Server selected auth method.
+			case Stage::Method:
+			{
+				auto message = reinterpret_cast<const AuthorizationMessage*>(data);
+				if (message->method != static_cast<BYTE>(AuthorizationMethod::NoAuth))
+				{
+					// The proxy may reject the greeting because of the CONNECT request sent with it.
+					// The greeting is sent once more alone on the same connection, so the connect is not lost.
+					if (m_Pipelined)
+					{
+						DisablePipelining();
+
+						m_Pipelined = false;
+						AppendGreeting(output);
+						return HandshakeStatus::Pending;
+					}
+
+					spdlog::error("No acceptable socks5 authorization methods.");
+					return HandshakeStatus::Failed;
+				}
+
+				if (!m_Pipelined)
+					AppendConnectRequest(output);
+
+				m_Stage = Stage::Reply;
+				return HandshakeStatus::Pending;
+			}
+			// CONNECT reply header.
+			case Stage::Reply:
+			{
+				auto message = reinterpret_cast<const Message*>(data);
+
+				// The proxy accepted the greeting, but did not parse the CONNECT request sent with it.
+				if (message->version != VERSION_)
+				{
+					spdlog::error("Invalid socks5 reply version {}.", message->version);
+
+					if (m_Pipelined)
+						DisablePipelining();
+
+					return HandshakeStatus::Failed;
+				}
+
+				if (message->status != static_cast<BYTE>(ReplyCode::Ok))
+					return HandshakeStatus::Failed;
+
+				// Skipping bound address, so it will not be read by the app.
+				switch (static_cast<AddressType>(message->addressType))
+				{
+					case AddressType::IPv4:				m_AddressLength = sizeof(AddressV4);	m_Stage = Stage::Address;				break;
+					case AddressType::IPv6:				m_AddressLength = sizeof(AddressV6);	m_Stage = Stage::Address;				break;
+					case AddressType::DomainName:																				m_Stage = Stage::DomainLength;	break;
+					default:
+						spdlog::error("Unknown socks5 bound address type {}.", message->addressType);
+						return HandshakeStatus::Failed;
+				}
+
+				return HandshakeStatus::Pending;
+			}
+			// Bound domain name length.
+			case Stage::DomainLength:
+			{
+				m_AddressLength = *data + sizeof(WORD);
+				m_Stage					= Stage::Address;
+				return HandshakeStatus::Pending;
+			}
+			// Bound address.
+			case Stage::Address:
+				return HandshakeStatus::Complete;
 		}
 
-		return reinterpret_cast<Message*>(buffer.data())->status == static_cast<BYTE>(ReplyCode::Ok);
+		return HandshakeStatus::Failed;
+	}
+
+	// Called when the proxy closes the connection before the handshake is complete.
+	// A proxy that accepted the greeting and then dropped the connection has discarded
+	// the pipelined CONNECT request, so next handshakes with it use the sequential path.
+	void OnClosed()
+	{
+		if (m_Pipelined && m_Stage == Stage::Reply)
+			DisablePipelining();
 	}
 
 private:
-	// Performs authorization with the server.
-	// @reutrns true if success.
-	bool DoAuthorization()
-	{
-		auto message		= AuthorizationMessage{ VERSION_, 1 };
-		auto buffer			= std::vector<BYTE>();
-		auto authMethod	= static_cast<BYTE>(AuthorizationMethod::NoAuth);
-
-		// Insert request header.
-		buffer.insert(
-			buffer.begin(),
-			reinterpret_cast<const BYTE*>(&message),
-			reinterpret_cast<const BYTE*>(&message) + sizeof(message)
-		);
-
-		// Insert auth methods.
-		buffer.push_back(authMethod);
-
-		// Sending supported auth methods to server.
-		if (send(m_Socket, reinterpret_cast<const char*>(buffer.data()), buffer.size(), 0) != buffer.size())
-		{
-			spdlog::error("Failed to send socks5 authorization message. WSAGetLastError={}", WSAGetLastError());
+	// Handshake stages.
+	enum class Stage
+	{
+		Method,				// Waiting for selected auth method.
+		Reply,				// Waiting for CONNECT reply header.
+		DomainLength,	// Waiting for bound domain name length.
+		Address				// Waiting for bound address.
+	};
+
+	// Proxy servers that do not support pipelining. Shared by all handshakes of the process,
+	// so only the upstreams that rejected or lost a pipelined CONNECT request use the sequential path.
+	static inline std::mutex										s_SequentialMutex;
+	static inline std::vector<sockaddr_storage>	s_Sequential;
+	static inline std::atomic<size_t>						s_SequentialCount = 0;
+
+	// Returns true if the proxy servers addresses are equal.
+	// @param left - first address.
+	// @param right - second address.
+	static bool IsSameProxy(_In_ const sockaddr_storage& left, _In_ const sockaddr_storage& right) noexcept
+	{
+		if (left.ss_family != right.ss_family)
 			return false;
-		}
 
-		// Receiving server selected auth method.
-		if (recv(m_Socket, reinterpret_cast<char*>(&message), sizeof(message), 0) == SOCKET_ERROR)
+		if (left.ss_family == AF_INET)
 		{
-			spdlog::error("Failed to receive socks5 authorization message header. WSAGetLastError={}", WSAGetLastError());
-			return false;
+			auto l4 = reinterpret_cast<const sockaddr_in*>(&left);
+			auto r4 = reinterpret_cast<const sockaddr_in*>(&right);
+
+			return l4->sin_addr.S_un.S_addr == r4->sin_addr.S_un.S_addr && l4->sin_port == r4->sin_port;
 		}
 
-		if (message.method != authMethod)
+		auto l6 = reinterpret_cast<const sockaddr_in6*>(&left);
+		auto r6 = reinterpret_cast<const sockaddr_in6*>(&right);
+
+		return l6->sin6_port == r6->sin6_port && std::equal(l6->sin6_addr.u.Byte, l6->sin6_addr.u.Byte + 16, r6->sin6_addr.u.Byte);
+	}
+
+	// Returns true if the handshake proxy server was not marked as sequential.
+	bool IsPipeliningSupported() const
+	{
+		// Fast path, all proxies support pipelining.
+		if (s_SequentialCount.load(std::memory_order_acquire) == 0)
+			return true;
+
+		std::lock_guard<std::mutex> lock(s_SequentialMutex);
+
+		return std::none_of(s_Sequential.begin(), s_Sequential.end(), [this](const sockaddr_storage& proxy) {
+			return IsSameProxy(proxy, m_AddressProxy);
+		});
+	}
+
+	// Marks the handshake proxy server as sequential.
+	void DisablePipelining()
+	{
+		std::lock_guard<std::mutex> lock(s_SequentialMutex);
+
+		if (std::any_of(s_Sequential.begin(), s_Sequential.end(), [this](const sockaddr_storage& proxy) { return IsSameProxy(proxy, m_AddressProxy); }))
+			return;
+
+		spdlog::warn("Socks5 proxy does not support pipelined handshake, falling back to sequential handshake.");
+
+		s_Sequential.push_back(m_AddressProxy);
+		s_SequentialCount.store(s_Sequential.size(), std::memory_order_release);
+	}
+
+	// Appends greeting with supported auth methods to the frame.
+	// @param output - frame to send.
+	static void AppendGreeting(_Inout_ RequestFrame& output)
+	{
+		output.Append(AuthorizationMessage{ VERSION_, 1 });
+		output.Append(AuthorizationMethod::NoAuth);
+	}
+
+	// Appends CONNECT request for the target app address to the frame.
+	// @param output - frame to send.
+	void AppendConnectRequest(_Inout_ RequestFrame& output)
+	{
+		output.Append(Message{ VERSION_, static_cast<BYTE>(Command::Connect), 0x0,  static_cast<BYTE>(m_AddressApp->sa_family == AF_INET ? AddressType::IPv4 : AddressType::IPv6)});
+
+		// Insering address.
+		if (m_AddressApp->sa_family == AF_INET)
 		{
-			spdlog::error("No acceptable socks5 authorization methods.");
-			return false;
+			auto ipv4 = reinterpret_cast<const sockaddr_in*>(m_AddressApp);
+			output.Append(AddressV4{ ipv4->sin_addr.S_un.S_addr, ipv4->sin_port });
 		}
+		else if (m_AddressApp->sa_family == AF_INET6)
+		{
+			auto ipv6			= reinterpret_cast<const sockaddr_in6*>(m_AddressApp);
+			auto address	= AddressV6{};
 
-		return true;
+			std::memcpy(address.address, ipv6->sin6_addr.u.Byte, sizeof(address.address));
+			address.port = ipv6->sin6_port;
+
+			output.Append(address);
+		}
 	}
+
+	Stage		m_Stage					= Stage::Method;	// Current handshake stage.
+	bool		m_Pipelined			= false;					// true - greeting and request were sent together.
+	size_t	m_AddressLength = 0;							// Length of bound address with port.
 };
 
 
@@ -0,0 +1,184 @@
+#ifndef REDIRECTOR_SOCKS_PROTOCOL_HPP_
+#define REDIRECTOR_SOCKS_PROTOCOL_HPP_
+
+// Statically dispatched socks protocol.
+// Holds the protocol selected by the config in place, so creating
+// a proxy instance on the connect path does not allocate.
+class SocksProtocol
+{
+	using Protocol = std::variant<std::monostate, Socks4, Socks5>;
+
+public:
+	// Default constructor. Creates an empty protocol.
+	SocksProtocol() = default;
+	// Default destructor.
+	~SocksProtocol() = default;
+	// Deleted copy constructor.
+	SocksProtocol(const SocksProtocol&) = delete;
+	// Deleted copy assigment.
+	SocksProtocol& operator=(const SocksProtocol&) = delete;
+
+	// Creates the protocol for the config proxy type.
+	// @param config - app config.
+	// @param socket - socket connected to the proxy server.
+	// @param address - target app address.
+	// @param proxy - proxy server address.
+	// @returns false if the proxy type is unknown.
+	bool Create(_In_ const BaseConfigManager::Config& config, _In_ SOCKET& socket, _In_ const sockaddr* address, _In_ const sockaddr* proxy)
+	{
+		switch (config.m_ProxyType)
+		{
+			case ProxyType::Socks4: m_Protocol.emplace<Socks4>(config, socket, address, proxy); return true;
+			case ProxyType::Socks5: m_Protocol.emplace<Socks5>(config, socket, address, proxy); return true;
+		}
+
+		m_Protocol.emplace<std::monostate>();
+		return false;
+	}
+
+	// Returns true if the protocol is created.
+	bool IsValid() const noexcept {
+		return !std::holds_alternative<std::monostate>(m_Protocol);
+	}
+
+	// Returns proxy address.
+	const sockaddr* GetProxyAddress() const noexcept {
+		return Visit([](const auto& socks) { return socks.GetProxyAddress(); }, static_cast<const sockaddr*>(nullptr));
+	}
+
+	// Writes the first handshake frame and resets the reply parser.
+	// @param output - frame to send.
+	// @returns false if the request cannot be built for the target address.
+	bool Start(_Out_ AbstractSocks::RequestFrame& output) 
+	{
+		m_Reply.Clear();
+		return Visit([&](auto& socks) { return socks.Start(output); }, false);
+	}
+
+	// Returns count of bytes missing to complete the current reply step.
+	// Reading not more than this count never reads past the replies.
+	size_t Missing() const noexcept {
+		return Visit([&](const auto& socks) { return socks.Expected() - m_Reply.Size(); }, size_t{ 0 });
+	}
+
+	// Feeds received bytes to the reply parser. 
+	// Short reads are accumulated until the reply step is complete. Parsing stops when a new request 
+	// must be sent or the handshake is finished, the bytes after that point are not consumed,
+	// so bytes read past the final reply can be handed back to the app.
+	// @param data - received bytes.
+	// @param size - count of received bytes.
+	// @param output - frame for the next request. stays empty if there is nothing to send.
+	// @param status - handshake status.
+	// @returns count of consumed bytes.
+	size_t Feed(_In_ const BYTE* data, _In_ size_t size, _Out_ AbstractSocks::RequestFrame& output, _Out_ AbstractSocks::HandshakeStatus& status)
+	{
+		output.Clear();
+		status = AbstractSocks::HandshakeStatus::Failed;
+
+		return Visit([&](auto& socks)
+		{
+			auto consumed = size_t{ 0 };
+
+			status = AbstractSocks::HandshakeStatus::Pending;
+
+			while (consumed < size && status == AbstractSocks::HandshakeStatus::Pending && output.Empty())
+			{
+				auto expected = socks.Expected();
+				auto chunk		= (std::min)(expected - m_Reply.Size(), size - consumed);
+
+				std::memcpy(m_Reply.Data() + m_Reply.Size(), data + consumed, chunk);
+				m_Reply.Resize(m_Reply.Size() + chunk);
+				consumed += chunk;
+
+				// Reply step is complete.
+				if (m_Reply.Size() == expected)
+				{
+					status = socks.OnReply(m_Reply.Data(), output);
+					m_Reply.Clear();
+				}
+			}
+
+			return consumed;
+		}, size_t{ 0 });
+	}
+
+	// Notifies the protocol that the proxy closed the connection before the handshake is complete.
+	void OnClosed()
+	{
+		Visit([](auto& socks) { socks.OnClosed(); return true; }, false);
+	}
+
+	// Sends request to socks server and waits for the handshake to complete.
+	// The socket must be in blocking mode.
+	// @returns true if success.
+	bool Request()
+	{
+		auto output = AbstractSocks::RequestFrame();
+		auto input	= AbstractSocks::ReplyFrame();
+		auto status = AbstractSocks::HandshakeStatus::Pending;
+
+		if (!Start(output))
+			return false;
+
+		return Visit([&](auto& socks)
+		{
+			while (status == AbstractSocks::HandshakeStatus::Pending)
+			{
+				// Sending request to socks server.
+				if (!output.Empty())
+				{
+					if (!socks.Send(output.Data(), static_cast<int>(output.Size())))
+					{
+						spdlog::error("Failed to send socks request message. WSAGetLastError={}", WSAGetLastError());
+						return false;
+					}
+				}
+
+				// Receiving response from socks server.
+				auto received = socks.Receive(input.Data(), static_cast<int>(Missing()));
+				if (received == SOCKET_ERROR || received == 0)
+				{
+					spdlog::error("Failed to read socks response. WSAGetLastError={}", WSAGetLastError());
+					socks.OnClosed();
+					return false;
+				}
+
+				Feed(input.Data(), received, output, status);
+			}
+
+			return status == AbstractSocks::HandshakeStatus::Complete;
+		}, false);
+	}
+
+private:
+	// Calls the function for the current protocol.
+	// @param function - function to call.
+	// @param empty - result for the empty protocol.
+	template <typename Function, typename Result>
+	Result Visit(_In_ Function&& function, _In_ Result empty)
+	{
+		return std::visit([&](auto& socks) -> Result
+		{
+			if constexpr (std::is_same_v<std::decay_t<decltype(socks)>, std::monostate>)	return empty;
+			else																																					return function(socks);
+		}, m_Protocol);
+	}
+
+	// Calls the function for the current protocol.
+	// @param function - function to call.
+	// @param empty - result for the empty protocol.
+	template <typename Function, typename Result>
+	Result Visit(_In_ Function&& function, _In_ Result empty) const
+	{
+		return std::visit([&](const auto& socks) -> Result
+		{
+			if constexpr (std::is_same_v<std::decay_t<decltype(socks)>, std::monostate>)	return empty;
+			else																																					return function(socks);
+		}, m_Protocol);
+	}
+
+	Protocol										m_Protocol;	// Current protocol.
+	AbstractSocks::ReplyFrame		m_Reply;		// Incomplete reply step.
+};
+
+#endif // !REDIRECTOR_SOCKS_PROTOCOL_HPP_
@@ -0,0 +1,241 @@
+#include "global.h"
+
+namespace
+{
+	// Interval between health probes of every upstream.
+	constexpr auto G_PROBE_INTERVAL_ = std::chrono::seconds(5);
+
+	// Count of consecutive failures after which the upstream is unhealthy.
+	constexpr DWORD G_MAX_FAILURES_ = 3;
+
+	// EWMA smoothing: the new sample contributes 1/2^G_EWMA_SHIFT_.
+	constexpr DWORD G_EWMA_SHIFT_ = 3;
+
+	// Failure rate of the failed handshake in 1/1000.
+	constexpr DWORD G_FAILURE_ = 1000;
+
+	// Latency assumed for the upstream that was not measured yet, in microseconds.
+	constexpr DWORD G_UNKNOWN_LATENCY_ = 1000000;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UpstreamBalancer::UpstreamBalancer(_In_ Probe probe) :
+	m_Probe{ std::move(probe) },
+	m_Generation{ 0 },
+	m_Stop{ false },
+	m_Thread{ &UpstreamBalancer::ProbeThread, this }
+{ }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+UpstreamBalancer::~UpstreamBalancer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+
+	m_Condition.notify_all();
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UpstreamBalancer::Configure(_In_ const BaseConfigManager::Config& config)
+{
+	auto addresses = std::vector<std::pair<const sockaddr*, BYTE>>();
+
+	// The config proxy server is the first upstream.
+	if (BaseConfigManager::Validate(config))
+		addresses.emplace_back(AbstractSocks::SelectProxyAddress(config), 1);
+
+	for (size_t i = 0; i < (std::min)(static_cast<size_t>(config.m_UpstreamsCount), BaseConfigManager::MAX_UPSTREAMS_); ++i)
+	{
+		const auto& upstream = config.m_Upstreams[i];
+
+		// Socks4 supports only IPv4.
+		if (upstream.m_Weight == 0 || (config.m_ProxyType == ProxyType::Socks4 && upstream.m_Address.si_family != AF_INET))
+			continue;
+
+		addresses.emplace_back(reinterpret_cast<const sockaddr*>(&upstream.m_Address), upstream.m_Weight);
+	}
+
+	auto upstreams = std::make_shared<Upstreams>(addresses.size());
+
+	for (size_t i = 0; i < addresses.size(); ++i)
+	{
+		auto& upstream = (*upstreams)[i];
+
+		std::memset(&upstream.m_Address, 0, sizeof(upstream.m_Address));
+		std::memcpy(&upstream.m_Address, addresses[i].first, addresses[i].first->sa_family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6));
+
+		upstream.m_Weight = addresses[i].second;
+		upstream.m_Latency.store(0, std::memory_order_relaxed);
+		upstream.m_FailureRate.store(0, std::memory_order_relaxed);
+		upstream.m_Failures.store(0, std::memory_order_relaxed);
+	}
+
+	m_Upstreams.Publish(std::move(upstreams));
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		++m_Generation;
+	}
+
+	// Measuring the new upstreams right away.
+	m_Condition.notify_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const UpstreamBalancer::Upstream> UpstreamBalancer::Select(_In_ int family) const
+{
+	thread_local auto random = std::minstd_rand(static_cast<unsigned>(GetCurrentThreadId() ^ GetTickCount()));
+
+	auto scope			= m_Upstreams.Read();
+	auto upstreams	= scope.Get();
+
+	if (!upstreams || upstreams->empty())
+		return nullptr;
+
+	// The selected upstream is shared, so it outlives the read section.
+	if (upstreams->size() == 1)
+	{
+		if (upstreams->front().m_Address.ss_family != family)
+			return nullptr;
+
+		return std::shared_ptr<const Upstream>(scope.Share(), &upstreams->front());
+	}
+
+	// Candidates are the healthy upstreams of the target family, and if all of them are down,
+	// any upstream of the family. An upstream of another family can not be connected by the app socket.
+	auto candidates = std::array<const Upstream*, BaseConfigManager::MAX_UPSTREAMS_ + 1>();
+	auto count			= size_t{ 0 };
+	auto total			= DWORD{ 0 };
+
+	auto collect = [&](auto&& filter)
+	{
+		count = 0;
+		total = 0;
+
+		for (const auto& upstream : *upstreams)
+		{
+			if (count < candidates.size() && filter(upstream))
+			{
+				candidates[count++] = &upstream;
+				total += upstream.m_Weight;
+			}
+		}
+
+		return count != 0;
+	};
+
+	if (!collect([&](const Upstream& upstream) { return IsHealthy(upstream) && upstream.m_Address.ss_family == family; }) &&
+			!collect([&](const Upstream& upstream) { return upstream.m_Address.ss_family == family; }))
+		return nullptr;
+
+	// Picking an upstream with the probability proportional to its weight.
+	auto pick = [&]()
+	{
+		auto point = std::uniform_int_distribution<DWORD>(0, total - 1)(random);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (point < candidates[i]->m_Weight)
+				return candidates[i];
+
+			point -= candidates[i]->m_Weight;
+		}
+
+		return candidates[count - 1];
+	};
+
+	auto first	= pick();
+	auto second = pick();
+	auto best		= GetCost(*second) < GetCost(*first) ? second : first;
+
+	return std::shared_ptr<const Upstream>(scope.Share(), best);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UpstreamBalancer::Report(_In_ const Upstream& upstream, _In_ std::chrono::microseconds latency, _In_ bool success) noexcept
+{
+	if (success)
+	{
+		auto sample = static_cast<DWORD>((std::min<long long>)(latency.count(), MAXDWORD));
+
+		// The first measurement replaces the unknown latency.
+		auto expected = DWORD{ 0 };
+		if (!upstream.m_Latency.compare_exchange_strong(expected, (std::max)(sample, DWORD{ 1 }), std::memory_order_relaxed))
+			Average(upstream.m_Latency, sample);
+
+		Average(upstream.m_FailureRate, 0);
+		upstream.m_Failures.store(0, std::memory_order_relaxed);
+	}
+	else
+	{
+		Average(upstream.m_FailureRate, G_FAILURE_);
+		upstream.m_Failures.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UpstreamBalancer::ProbeThread()
+{
+	auto lock = std::unique_lock<std::mutex>(m_Mutex);
+
+	while (!m_Stop)
+	{
+		auto generation = m_Generation;
+
+		// The upstreams are shared, so Configure does not wait for the probes.
+		auto upstreams = m_Upstreams.Read().Share();
+
+		// There is nothing to choose from a single upstream, so it is not probed.
+		if (upstreams.get() && upstreams->size() > 1)
+		{
+			lock.unlock();
+
+			for (const auto& upstream : *upstreams)
+			{
+				auto started	= std::chrono::steady_clock::now();
+				auto success	= m_Probe(upstream.GetAddress());
+				auto latency	= std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+
+				Report(upstream, latency, success);
+			}
+
+			lock.lock();
+		}
+
+		m_Condition.wait_for(lock, G_PROBE_INTERVAL_, [&] { return m_Stop || m_Generation != generation; });
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+double UpstreamBalancer::GetCost(_In_ const Upstream& upstream) noexcept
+{
+	auto measured = upstream.m_Latency.load(std::memory_order_relaxed);
+	auto latency	= static_cast<double>(measured ? measured : G_UNKNOWN_LATENCY_);
+	auto failure = static_cast<double>(upstream.m_FailureRate.load(std::memory_order_relaxed)) / G_FAILURE_;
+
+	// Failures are as bad as tenfold latency. The weight scales down the cost,
+	// so heavier upstreams win over lighter ones with the same latency.
+	return latency * (1.0 + 10.0 * failure) / upstream.m_Weight;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool UpstreamBalancer::IsHealthy(_In_ const Upstream& upstream) noexcept {
+	return upstream.m_Failures.load(std::memory_order_relaxed) < G_MAX_FAILURES_;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void UpstreamBalancer::Average(_Inout_ std::atomic<DWORD>& average, _In_ DWORD sample) noexcept
+{
+	auto current = average.load(std::memory_order_relaxed);
+
+	while (!average.compare_exchange_weak(
+		current,
+		static_cast<DWORD>(static_cast<long long>(current) + ((static_cast<long long>(sample) - current) >> G_EWMA_SHIFT_)),
+		std::memory_order_relaxed
+	));
+}
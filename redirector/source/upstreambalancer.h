@@ -0,0 +1,94 @@
+#ifndef REDIRECTOR_UPSTREAM_BALANCER_H_
+#define REDIRECTOR_UPSTREAM_BALANCER_H_
+
+// Selects the upstream proxy server for every proxied connect.
+// Each upstream keeps an EWMA of the handshake latency and of the failure rate,
+// updated by the connects and by background health probes. The upstream is
+// chosen with weighted power-of-two-choices: two upstreams are picked by weight,
+// and the one with the lower cost is used. Unhealthy upstreams are skipped
+// until a probe succeeds.
+class UpstreamBalancer
+{
+public:
+	// Upstream proxy server state.
+	// The published upstreams are immutable except for the statistics.
+	struct Upstream
+	{
+		sockaddr_storage							m_Address;			// Proxy server address.
+		BYTE													m_Weight;				// Selection weight.
+		mutable std::atomic<DWORD>		m_Latency;			// EWMA of the handshake latency in microseconds. 0 - not measured.
+		mutable std::atomic<DWORD>		m_FailureRate;	// EWMA of the failure rate in 1/1000.
+		mutable std::atomic<DWORD>		m_Failures;			// Count of consecutive failures.
+
+		// Returns proxy server address.
+		const sockaddr* GetAddress() const noexcept {
+			return reinterpret_cast<const sockaddr*>(&m_Address);
+		}
+	};
+
+	// Checks the upstream reachability.
+	// @param address - proxy server address.
+	// @returns true if the proxy server is reachable.
+	using Probe = std::function<bool(const sockaddr* address)>;
+
+	// Deleted default constructor.
+	UpstreamBalancer() = delete;
+	// Stops the probe thread.
+	~UpstreamBalancer();
+	// Deleted copy constructor.
+	UpstreamBalancer(const UpstreamBalancer&) = delete;
+	// Deleted copy assigment.
+	UpstreamBalancer& operator=(const UpstreamBalancer&) = delete;
+
+	// UpstreamBalancer constructor. There are no upstreams until Configure is called.
+	// @param probe - health probe. Called from the probe thread.
+	explicit UpstreamBalancer(_In_ Probe probe);
+
+	// Replaces the upstreams with the config proxy server and the config upstreams.
+	// The statistics of the previous upstreams are discarded.
+	// @param config - app config.
+	void Configure(_In_ const BaseConfigManager::Config& config);
+
+	// Selects the upstream for a connect. Does not lock, the upstreams are read with RCU.
+	// Only upstreams of the target address family are selected.
+	// @param family - target address family.
+	// @returns upstream or nullptr if there are no upstreams of the family.
+	// The upstream stays valid while it is referenced, even if the balancer is reconfigured.
+	std::shared_ptr<const Upstream> Select(_In_ int family) const;
+
+	// Updates the upstream statistics with the handshake result.
+	// @param upstream - upstream used for the handshake.
+	// @param latency - handshake latency.
+	// @param success - true if the handshake is complete.
+	static void Report(_In_ const Upstream& upstream, _In_ std::chrono::microseconds latency, _In_ bool success) noexcept;
+
+private:
+	// Upstreams list.
+	using Upstreams = std::vector<Upstream>;
+
+	// Probe thread routine.
+	void ProbeThread();
+
+	// Returns selection cost of the upstream. The lower is the better.
+	// @param upstream - upstream.
+	static double GetCost(_In_ const Upstream& upstream) noexcept;
+
+	// Returns true if the upstream is healthy.
+	// @param upstream - upstream.
+	static bool IsHealthy(_In_ const Upstream& upstream) noexcept;
+
+	// Moves the average to the sample.
+	// @param average - average value.
+	// @param sample - new sample.
+	static void Average(_Inout_ std::atomic<DWORD>& average, _In_ DWORD sample) noexcept;
+
+	Probe												m_Probe;			// Health probe.
+	RcuPointer<Upstreams>				m_Upstreams;	// Current upstreams.
+	std::mutex									m_Mutex;			// Locks probe thread state.
+	std::condition_variable			m_Condition;	// Wakes the probe thread.
+	size_t											m_Generation;	// Incremented on every Configure.
+	bool												m_Stop;				// true - the probe thread must exit.
+	std::thread									m_Thread;			// Probe thread.
+};
+
+#endif // !REDIRECTOR_UPSTREAM_BALANCER_H_
@@ -0,0 +1,15 @@
+#include "global.h"
+
+// The platform-neutral client sources. Their own global.h is skipped, see global.h.
+#include "processmatcher.cpp"
+#include "configdiff.cpp"
+#include "reportsink.cpp"
+#include "injectionqueue.cpp"
+#include "injectionpipeline.cpp"
+#include "eventloop.cpp"
+#include "sessiontracker.cpp"
+#include "sessionregistry.cpp"
+#include "sessionreaper.cpp"
+#include "server.cpp"
+#include "controlhandler.cpp"
+#include "controlserver.cpp"
@@ -0,0 +1,218 @@
+#include "global.h"
+
+namespace
+{
+	using namespace WinPipe;
+
+	// Sizes of the encoded messages: empty, shorter and longer than the header and the read size.
+	constexpr uint32_t G_SIZES_[] = { 0, 1, 5, 6, 7, 100, 4095, 4096, 4097, 10000, 0, 3 };
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the encoded messages. Every byte of a message depends on its id and offset.
+	std::vector<uint8_t> MakeStream(_In_ size_t repeats)
+	{
+		auto stream = std::vector<uint8_t>();
+		auto data		= std::vector<uint8_t>();
+		auto id			= uint16_t{ 0 };
+
+		for (size_t i = 0; i < repeats; ++i)
+		{
+			for (auto size : G_SIZES_)
+			{
+				data.resize(size);
+
+				for (uint32_t offset = 0; offset < size; ++offset)
+					data[offset] = static_cast<uint8_t>(id * 31 + offset);
+
+				Codec::Encode(stream, id++, data.data(), size);
+			}
+		}
+
+		return stream;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Checks the decoded messages against the encoded ones.
+	class Verifier
+	{
+	public:
+		// Checks the next message.
+		// @param message - decoded message.
+		// @returns true if the message is the expected one.
+		bool operator()(_In_ const Codec::MessageView& message)
+		{
+			auto valid = message.m_Id == m_Next && message.m_Size == G_SIZES_[m_Next % std::size(G_SIZES_)];
+
+			for (uint32_t offset = 0; valid && offset < message.m_Size; ++offset)
+				valid = message.m_Data[offset] == static_cast<uint8_t>(m_Next * 31 + offset);
+
+			if (!valid)
+				++m_Invalid;
+
+			++m_Next;
+			return true;
+		}
+
+		// Returns count of checked messages.
+		size_t GetCount() const noexcept {
+			return m_Next;
+		}
+
+		// Returns count of invalid messages.
+		size_t GetInvalid() const noexcept {
+			return m_Invalid;
+		}
+
+	private:
+		uint16_t	m_Next		= 0;	// Id of the next message.
+		size_t		m_Invalid	= 0;	// Count of invalid messages.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Reads the bytes into the decoder as a pipe read does: at most the free space at once.
+	// @returns false if the decoder refused to prepare the free space.
+	template <typename Function>
+	bool Feed(_Inout_ Codec::Decoder& decoder, _In_ const uint8_t* data, _In_ size_t size, _In_ Function&& function)
+	{
+		while (size != 0)
+		{
+			auto space	= size_t{ 0 };
+			auto buffer = decoder.Prepare(space);
+
+			if (!buffer || space == 0)
+				return false;
+
+			auto read = (std::min)(space, size);
+
+			std::memcpy(buffer, data, read);
+			decoder.Commit(read);
+			decoder.Decode(function);
+
+			data += read;
+			size -= read;
+		}
+
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSplit()
+	{
+		auto stream		= MakeStream(1);
+		auto failed		= size_t{ 0 };
+
+		// The stream is received in two reads split at every offset.
+		for (size_t split = 0; split <= stream.size(); ++split)
+		{
+			auto decoder	= Codec::Decoder();
+			auto verifier = Verifier();
+
+			auto fed = Feed(decoder, stream.data(), split, verifier) && Feed(decoder, stream.data() + split, stream.size() - split, verifier);
+
+			if (!fed || verifier.GetInvalid() != 0 || verifier.GetCount() != std::size(G_SIZES_) || !decoder.Empty())
+				++failed;
+		}
+
+		CHECK(failed == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestBytes()
+	{
+		auto stream		= MakeStream(2);
+		auto decoder	= Codec::Decoder();
+		auto verifier = Verifier();
+		auto fed			= true;
+
+		// Every byte is a separate read.
+		for (size_t i = 0; i < stream.size(); ++i)
+			fed = fed && Feed(decoder, stream.data() + i, 1, verifier);
+
+		CHECK(fed);
+		CHECK(verifier.GetInvalid() == 0 && verifier.GetCount() == 2 * std::size(G_SIZES_));
+		CHECK(decoder.Empty());
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestRefused()
+	{
+		auto stream		= MakeStream(1);
+		auto decoder	= Codec::Decoder();
+		auto verifier = Verifier();
+		auto refused	= size_t{ 0 };
+
+		// A refused message stays in the buffer and is handed out again by the next decode.
+		auto refuse = [&](const Codec::MessageView& message)
+		{
+			if (refused++ % 2 == 0)
+				return false;
+
+			return verifier(message);
+		};
+
+		CHECK(Feed(decoder, stream.data(), stream.size(), refuse));
+
+		while (!decoder.Empty())
+			decoder.Decode(refuse);
+
+		CHECK(verifier.GetInvalid() == 0 && verifier.GetCount() == std::size(G_SIZES_));
+		CHECK(decoder.Empty());
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestOversized()
+	{
+		auto header		= Codec::Header{ 1, Codec::MAX_MESSAGE_SIZE_ + 1 };
+		auto decoder	= Codec::Decoder();
+		auto space		= size_t{ 0 };
+		auto buffer		= decoder.Prepare(space);
+
+		CHECK(buffer != nullptr && space >= sizeof(header));
+
+		std::memcpy(buffer, &header, sizeof(header));
+		decoder.Commit(sizeof(header));
+
+		// The message larger than the limit is never buffered.
+		CHECK(decoder.Decode([](const Codec::MessageView&) { return true; }) == 0);
+		CHECK(decoder.Prepare(space) == nullptr);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkDecode()
+	{
+		auto stream = MakeStream(100);
+
+		// The reads are as large as the pipe reads, small messages and large ones.
+		for (auto read : { size_t{ 512 }, size_t{ 65536 } })
+		{
+			auto start		= std::chrono::steady_clock::now();
+			auto decoded	= size_t{ 0 };
+
+			for (size_t repeat = 0; repeat < 10; ++repeat)
+			{
+				auto decoder	= Codec::Decoder();
+				auto count		= [&](const Codec::MessageView&) { ++decoded; return true; };
+
+				for (size_t offset = 0; offset < stream.size(); offset += read)
+					Feed(decoder, stream.data() + offset, (std::min)(read, stream.size() - offset), count);
+			}
+
+			auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			CHECK(decoded == 10 * 100 * std::size(G_SIZES_));
+			std::printf("Codec::Decoder, %zu byte reads: %.1f MB/s, %.1f M messages/s.\n", read, 10 * stream.size() / elapsed / 1e6, decoded / elapsed / 1e6);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestSplit();
+	TestBytes();
+	TestRefused();
+	TestOversized();
+	BenchmarkDecode();
+
+	return Testing::Finish("codectest");
+}
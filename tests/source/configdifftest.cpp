@@ -0,0 +1,233 @@
+#include "global.h"
+
+namespace
+{
+	using Testing::MockSession;
+
+	// Count of sessions the reloaded config is rolled out to.
+	constexpr size_t G_SESSIONS_ = 500;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	BaseConfigManager::Config MakeConfig()
+	{
+		auto config = BaseConfigManager::Config{ };
+
+		config.m_ProxyType							= ProxyType::Socks5;
+		config.m_ProxyV4.sin_family			= AF_INET;
+		config.m_ProxyV4.sin_port				= htons(1080);
+		config.m_UpstreamsCount					= 1;
+		config.m_Upstreams[0].m_Weight	= 3;
+
+		config.m_Upstreams[0].m_Address.Ipv4.sin_family = AF_INET;
+		config.m_Upstreams[0].m_Address.Ipv4.sin_port		= htons(1081);
+
+		return config;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	BaseConfigManager::Rules MakeRules(_In_ size_t count)
+	{
+		auto rules = BaseConfigManager::Rules(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			rules[i].m_Family				= AF_INET;
+			rules[i].m_Address[0]		= static_cast<BYTE>(i);
+			rules[i].m_PrefixLength	= 8;
+			rules[i].m_PortFirst		= 0;
+			rules[i].m_PortLast			= USHRT_MAX;
+			rules[i].m_Action				= RuleAction::Direct;
+		}
+
+		return rules;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestUnchanged()
+	{
+		auto config		= MakeConfig();
+		auto rules		= MakeRules(10);
+		auto reloaded = config;
+
+		// The version changes with every rollout, it is not a change of the config.
+		reloaded.m_Version = 5;
+
+		auto diff = ConfigDiff::Compare(config, rules, reloaded, MakeRules(10));
+
+		CHECK(diff.Empty() && diff.ToString().empty());
+		CHECK(ConfigDiff::Compare(config, { }, config, { }).Empty());
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestRules()
+	{
+		auto config = MakeConfig();
+		auto rules	= MakeRules(10);
+		auto action = rules;
+		auto added	= MakeRules(11);
+
+		action[9].m_Action = RuleAction::Block;
+
+		auto diff = ConfigDiff::Compare(config, rules, config, action);
+
+		CHECK(diff.m_Rules && !diff.m_Proxy && !diff.m_Socks5 && !diff.m_Upstreams && !diff.m_Logging);
+		CHECK(diff.ToString() == "rules");
+
+		CHECK(ConfigDiff::Compare(config, rules, config, added).m_Rules);
+		CHECK(ConfigDiff::Compare(config, rules, config, { }).m_Rules);
+		CHECK(ConfigDiff::Compare(config, { }, config, rules).m_Rules);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestUpstreams()
+	{
+		auto config = MakeConfig();
+		auto weight = config;
+		auto added	= config;
+		auto proxy	= config;
+
+		weight.m_Upstreams[0].m_Weight = 4;
+
+		added.m_Upstreams[1]		= added.m_Upstreams[0];
+		added.m_UpstreamsCount	= 2;
+
+		proxy.m_ProxyV4.sin_port	= htons(1082);
+		proxy.m_LoggingEnable			= true;
+
+		auto diff = ConfigDiff::Compare(config, { }, weight, { });
+
+		CHECK(diff.m_Upstreams && !diff.m_Proxy && !diff.m_Rules);
+		CHECK(diff.ToString() == "upstreams");
+		CHECK(ConfigDiff::Compare(config, { }, added, { }).m_Upstreams);
+
+		// The unused upstream entries are not compared.
+		added.m_UpstreamsCount = 1;
+		CHECK(ConfigDiff::Compare(config, { }, added, { }).Empty());
+
+		CHECK(ConfigDiff::Compare(config, { }, proxy, { }).ToString() == "proxy, logging");
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Adds the sessions to the server, as the injected redirectors connect.
+	std::vector<std::shared_ptr<MockSession>> AddSessions(_In_ Server& server)
+	{
+		auto sessions = std::vector<std::shared_ptr<MockSession>>();
+
+		for (size_t i = 0; i < G_SESSIONS_; ++i)
+		{
+			sessions.push_back(std::make_shared<MockSession>(static_cast<DWORD>((i + 1) * 4)));
+			CHECK(server.AddSession(sessions.back()));
+		}
+
+		return sessions;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns true if all sessions have applied the config version.
+	bool Applied(_In_ const std::vector<std::shared_ptr<MockSession>>& sessions, _In_ DWORD version)
+	{
+		return std::all_of(sessions.begin(), sessions.end(), [version](const std::shared_ptr<MockSession>& session) {
+			return session->GetConfigVersion() == version;
+		});
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestReload()
+	{
+		auto server		= Server::Create();
+		auto sessions = AddSessions(*server);
+		auto config		= MakeConfig();
+		auto rules		= MakeRules(10);
+
+		// The first config is published even if it is the same as the empty running one.
+		server->UpdateConfig(config, rules);
+
+		CHECK(server->GetConfigVersion() == 1 && Applied(sessions, 1));
+
+		// A reload of the same file is not rolled out.
+		server->UpdateConfig(config, rules);
+		CHECK(server->GetConfigVersion() == 1);
+
+		// Changed rules are rolled out, the report transports are not prepared again.
+		auto prepared = sessions.front()->GetPrepared();
+
+		rules[0].m_Action = RuleAction::Block;
+		server->UpdateConfig(config, rules);
+
+		CHECK(server->GetConfigVersion() == 2 && Applied(sessions, 2));
+		CHECK(sessions.front()->GetPrepared() == prepared);
+
+		// Changed logging prepares the transports of every session before the rollout.
+		config.m_LoggingEnable = true;
+		server->UpdateConfig(config, rules);
+
+		CHECK(server->GetConfigVersion() == 3 && Applied(sessions, 3));
+		CHECK(std::all_of(sessions.begin(), sessions.end(), [prepared](const std::shared_ptr<MockSession>& session) {
+			return session->GetPrepared() == prepared + 1;
+		}));
+
+		// An invalid config is not published, the sessions keep the running one.
+		server->UpdateConfig(config, MakeRules(ConfigSection::MAX_RULES_ + 1));
+		CHECK(server->GetConfigVersion() == 3 && Applied(sessions, 3));
+
+		auto running			= BaseConfigManager::Config{ };
+		auto runningRules = BaseConfigManager::Rules();
+
+		server->GetConfig(running, runningRules);
+		CHECK(ConfigDiff::Compare(config, rules, running, runningRules).Empty());
+
+		// A stuck session does not keep the others on the old config.
+		sessions.back()->SetReady(false);
+		config.m_Upstreams[0].m_Weight = 4;
+		server->UpdateConfig(config, rules);
+
+		CHECK(sessions.front()->GetConfigVersion() == 4 && sessions.back()->GetConfigVersion() == 3);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Time from a reloaded config to its acknowledgement by all the sessions.
+	void BenchmarkReload()
+	{
+		auto server		= Server::Create();
+		auto sessions = AddSessions(*server);
+		auto config		= MakeConfig();
+		auto rules		= MakeRules(100);
+
+		server->UpdateConfig(config, rules);
+
+		Testing::Benchmark("Server::UpdateConfig, 500 sessions, unchanged", 1000, [&](size_t) {
+			server->UpdateConfig(config, rules);
+			return server->GetConfigVersion();
+		});
+
+		Testing::Benchmark("Server::UpdateConfig, 500 sessions, rules changed", 200, [&](size_t i) {
+			rules[0].m_Action = static_cast<RuleAction>(i % 2);
+			server->UpdateConfig(config, rules);
+			return server->GetConfigVersion();
+		});
+
+		Testing::Benchmark("Server::UpdateConfig, 500 sessions, logging changed", 200, [&](size_t i) {
+			config.m_LoggingEnable = i % 2 == 0;
+			server->UpdateConfig(config, rules);
+			return server->GetConfigVersion();
+		});
+
+		CHECK(Applied(sessions, server->GetConfigVersion()));
+
+		Testing::Benchmark("ConfigDiff::Compare, 100 rules", 1000000, [&](size_t) {
+			return ConfigDiff::Compare(config, rules, config, rules).Empty();
+		});
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestUnchanged();
+	TestRules();
+	TestUpstreams();
+	TestReload();
+	BenchmarkReload();
+
+	return Testing::Finish("configdifftest");
+}
@@ -0,0 +1,353 @@
+#include "global.h"
+
+namespace
+{
+	// Encoded section, the table entry is computed by Build.
+	struct Section
+	{
+		uint16_t							m_Type;		// Section type.
+		uint16_t							m_Stride;	// Size of the section struct or of the array element.
+		std::vector<uint8_t>	m_Data;		// Section data.
+	};
+
+	// Count of mutated inputs of the fuzz test.
+	constexpr size_t G_MUTATIONS_ = 100000;
+
+	// Type of a section unknown to the reader.
+	constexpr uint16_t G_UNKNOWN_SECTION_ = 0x7F;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	BaseConfigManager::Config MakeConfig()
+	{
+		auto config = BaseConfigManager::Config{ };
+
+		config.m_ProxyType							= ProxyType::Socks5;
+		config.m_ProxyV4.sin_family			= AF_INET;
+		config.m_ProxyV4.sin_port				= htons(1080);
+		config.m_LoggingEnable					= true;
+		config.m_UpstreamsCount					= 1;
+		config.m_Upstreams[0].m_Weight	= 3;
+		config.m_ReportPolicy						= ReportPolicy::DropOldest;
+		config.m_Version								= 7;
+
+		config.m_Upstreams[0].m_Address.Ipv4.sin_family = AF_INET;
+		config.m_Upstreams[0].m_Address.Ipv4.sin_port		= htons(1081);
+
+		return config;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	BaseConfigManager::Rules MakeRules(_In_ size_t count)
+	{
+		auto rules = BaseConfigManager::Rules(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto& rule = rules[i];
+
+			rule.m_Family				= AF_INET;
+			rule.m_PrefixLength = static_cast<BYTE>(8 + i % 25);
+			rule.m_PortFirst		= static_cast<WORD>(i);
+			rule.m_PortLast			= USHRT_MAX;
+			rule.m_Action				= static_cast<RuleAction>(i % 3);
+
+			std::memcpy(rule.m_Address, &i, (std::min)(sizeof(i), sizeof(rule.m_Address)));
+		}
+
+		return rules;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	std::vector<uint8_t> GetBytes(_In_ const T& value, _In_ size_t size = sizeof(T))
+	{
+		auto bytes = std::vector<uint8_t>(size);
+
+		std::memcpy(bytes.data(), &value, (std::min)(size, sizeof(value)));
+		return bytes;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the rules encoded with the stride. A longer stride appends zero fields, a shorter one cuts them.
+	std::vector<uint8_t> GetBytes(_In_ const BaseConfigManager::Rules& rules, _In_ size_t stride)
+	{
+		auto bytes = std::vector<uint8_t>(rules.size() * stride);
+
+		for (size_t i = 0; i < rules.size(); ++i)
+			std::memcpy(bytes.data() + i * stride, &rules[i], (std::min)(stride, sizeof(rules[i])));
+
+		return bytes;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Encodes the sections as a writer of another format revision does.
+	std::vector<uint8_t> Build(_In_ const std::vector<Section>& sections)
+	{
+		auto data		= std::vector<uint8_t>(sizeof(ConfigFormat::Header) + sections.size() * sizeof(ConfigFormat::Entry));
+		auto offset = data.size();
+
+		for (size_t i = 0; i < sections.size(); ++i)
+		{
+			const auto& section = sections[i];
+
+			auto entry = ConfigFormat::Entry{ section.m_Type, section.m_Stride, static_cast<uint32_t>(offset), static_cast<uint32_t>(section.m_Data.size()) };
+
+			std::memcpy(data.data() + sizeof(ConfigFormat::Header) + i * sizeof(entry), &entry, sizeof(entry));
+			data.insert(data.end(), section.m_Data.begin(), section.m_Data.end());
+			offset += section.m_Data.size();
+		}
+
+		auto header = ConfigFormat::Header{ ConfigFormat::FORMAT_MAGIC_, ConfigFormat::FORMAT_VERSION_, static_cast<uint16_t>(sections.size()), static_cast<uint32_t>(data.size()) };
+
+		std::memcpy(data.data(), &header, sizeof(header));
+		return data;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	template <typename T>
+	void Put(_Inout_ std::vector<uint8_t>& data, _In_ size_t offset, _In_ T value) {
+		std::memcpy(data.data() + offset, &value, sizeof(value));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Parses a heap copy of exactly the data size, so a read past the data is caught by the memory checkers.
+	bool Parse(_In_ const std::vector<uint8_t>& data, _Out_ BaseConfigManager::Config& config, _Out_ BaseConfigManager::Rules& rules)
+	{
+		auto copy = std::make_unique<uint8_t[]>(data.size());
+		auto view = ConfigFormat::View();
+
+		std::copy(data.begin(), data.end(), copy.get());
+
+		if (!view.Parse(copy.get(), data.size()))
+			return false;
+
+		// Every rule takes a byte at least, so the count is bounded by the data.
+		CHECK(view.IsValid());
+		CHECK(view.GetRuleCount() <= data.size());
+
+		view.GetConfig(config);
+		view.GetRules(rules);
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	bool IsEqual(_In_ const BaseConfigManager::Config& first, _In_ const BaseConfigManager::Config& second) {
+		return std::memcmp(&first, &second, sizeof(first)) == 0;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	bool IsEqual(_In_ const BaseConfigManager::Rules& first, _In_ const BaseConfigManager::Rules& second) {
+		return first.size() == second.size() && (first.empty() || std::memcmp(first.data(), second.data(), first.size() * sizeof(first[0])) == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestRoundTrip()
+	{
+		auto config = MakeConfig();
+
+		for (auto count : { size_t{ 0 }, size_t{ 1 }, size_t{ 5000 } })
+		{
+			auto rules		= MakeRules(count);
+			auto data			= std::vector<uint8_t>();
+			auto parsed		= BaseConfigManager::Config();
+			auto decoded	= BaseConfigManager::Rules();
+
+			ConfigFormat::Encode(config, rules, data);
+
+			CHECK(data.size() == ConfigFormat::GetSize(count));
+			CHECK(Parse(data, parsed, decoded));
+			CHECK(IsEqual(parsed, config));
+			CHECK(IsEqual(decoded, rules));
+
+			// The bytes after the encoded data are not read.
+			data.resize(data.size() + 16, 0xCC);
+			CHECK(Parse(data, parsed, decoded) && IsEqual(decoded, rules));
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestCompatibility()
+	{
+		auto config		= MakeConfig();
+		auto rules		= MakeRules(10);
+		auto parsed		= BaseConfigManager::Config();
+		auto decoded	= BaseConfigManager::Rules();
+
+		const auto configType = static_cast<uint16_t>(ConfigFormat::Section::Config);
+		const auto rulesType	= static_cast<uint16_t>(ConfigFormat::Section::Rules);
+		const auto configSize = static_cast<uint16_t>(sizeof(config));
+		const auto ruleSize		= static_cast<uint16_t>(sizeof(rules[0]));
+
+		// A newer writer appends sections and fields, the reader skips them.
+		auto newer = Build({
+			{ G_UNKNOWN_SECTION_, 4, std::vector<uint8_t>(12, 0xAB) },
+			{ rulesType, static_cast<uint16_t>(ruleSize + 4), GetBytes(rules, ruleSize + 4) },
+			{ configType, static_cast<uint16_t>(configSize + 8), GetBytes(config, configSize + 8) } });
+
+		CHECK(Parse(newer, parsed, decoded));
+		CHECK(IsEqual(parsed, config));
+		CHECK(IsEqual(decoded, rules));
+
+		// An older writer does not know the last fields, they are zero.
+		auto knownConfig	= static_cast<uint16_t>(offsetof(BaseConfigManager::Config, m_UpstreamsCount));
+		auto knownRule		= static_cast<uint16_t>(offsetof(BaseConfigManager::Rule, m_Action));
+		auto older				= Build({
+			{ configType, knownConfig, GetBytes(config, knownConfig) },
+			{ rulesType, knownRule, GetBytes(rules, knownRule) } });
+
+		CHECK(Parse(older, parsed, decoded));
+		CHECK(std::memcmp(&parsed, &config, knownConfig) == 0);
+		CHECK(parsed.m_UpstreamsCount == 0 && parsed.m_Version == 0);
+		CHECK(decoded.size() == rules.size());
+
+		for (size_t i = 0; i < decoded.size(); ++i)
+			CHECK(std::memcmp(&decoded[i], &rules[i], knownRule) == 0 && decoded[i].m_Action == RuleAction::Proxy);
+
+		// The rules section is optional.
+		CHECK(Parse(Build({ { configType, configSize, GetBytes(config) } }), parsed, decoded));
+		CHECK(IsEqual(parsed, config) && decoded.empty());
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the corpus of the malformed inputs, every one must be refused.
+	std::vector<std::pair<const char*, std::vector<uint8_t>>> MakeCorpus()
+	{
+		auto config = MakeConfig();
+		auto rules	= MakeRules(4);
+		auto valid	= std::vector<uint8_t>();
+
+		ConfigFormat::Encode(config, rules, valid);
+
+		const auto header			= sizeof(ConfigFormat::Header);
+		const auto entry			= sizeof(ConfigFormat::Entry);
+		const auto configType = static_cast<uint16_t>(ConfigFormat::Section::Config);
+		const auto rulesType	= static_cast<uint16_t>(ConfigFormat::Section::Rules);
+		const auto configSize = static_cast<uint16_t>(sizeof(config));
+		const auto ruleSize		= static_cast<uint16_t>(sizeof(rules[0]));
+
+		auto corpus = std::vector<std::pair<const char*, std::vector<uint8_t>>>();
+		auto mutate = [&](const char* name, auto&& function)
+		{
+			auto data = valid;
+			function(data);
+			corpus.emplace_back(name, std::move(data));
+		};
+
+		corpus.emplace_back("empty", std::vector<uint8_t>());
+		corpus.emplace_back("short header", std::vector<uint8_t>(valid.begin(), valid.begin() + header - 1));
+
+		mutate("magic", [&](auto& data) { Put<uint32_t>(data, 0, ConfigFormat::FORMAT_MAGIC_ + 1); });
+		mutate("version", [&](auto& data) { Put<uint16_t>(data, 4, ConfigFormat::FORMAT_VERSION_ + 1); });
+		mutate("truncated", [&](auto& data) { data.pop_back(); });
+		mutate("size past data", [&](auto& data) { Put<uint32_t>(data, 8, static_cast<uint32_t>(data.size() + 1)); });
+		mutate("table past size", [&](auto& data) { Put<uint16_t>(data, 6, static_cast<uint16_t>(data.size() / entry)); });
+		mutate("count overflow", [&](auto& data) { Put<uint16_t>(data, 6, UINT16_MAX); });
+		mutate("offset past size", [&](auto& data) { Put<uint32_t>(data, header + 4, static_cast<uint32_t>(data.size() + 1)); });
+		mutate("section past size", [&](auto& data) { Put<uint32_t>(data, header + entry + 8, static_cast<uint32_t>(5 * ruleSize)); });
+		mutate("section size overflow", [&](auto& data) { Put<uint32_t>(data, header + entry + 4, static_cast<uint32_t>(data.size() - 1)); Put<uint32_t>(data, header + entry + 8, UINT32_MAX); });
+		mutate("config stride zero", [&](auto& data) { Put<uint16_t>(data, header + 2, 0); });
+		mutate("config size not stride", [&](auto& data) { Put<uint16_t>(data, header + 2, configSize - 1); });
+		mutate("rules stride zero", [&](auto& data) { Put<uint16_t>(data, header + entry + 2, 0); });
+		mutate("rules size not multiple", [&](auto& data) { Put<uint16_t>(data, header + entry + 2, ruleSize + 1); });
+		mutate("duplicate config", [&](auto& data) { Put<uint16_t>(data, header + entry, configType); });
+		mutate("duplicate rules", [&](auto& data) { Put<uint16_t>(data, header, rulesType); });
+		mutate("no config", [&](auto& data) { Put<uint16_t>(data, header, G_UNKNOWN_SECTION_); });
+
+		return corpus;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestCorpus()
+	{
+		auto parsed		= BaseConfigManager::Config();
+		auto decoded	= BaseConfigManager::Rules();
+
+		for (const auto& [name, data] : MakeCorpus())
+		{
+			if (Parse(data, parsed, decoded))
+			{
+				std::printf("Malformed config \"%s\" is parsed.\n", name);
+				CHECK(false);
+			}
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestFuzz()
+	{
+		auto random		= std::mt19937(20);
+		auto seeds		= std::vector<std::vector<uint8_t>>();
+		auto parsed		= BaseConfigManager::Config();
+		auto decoded	= BaseConfigManager::Rules();
+		auto accepted = size_t{ 0 };
+
+		for (auto count : { size_t{ 0 }, size_t{ 3 } })
+		{
+			seeds.emplace_back();
+			ConfigFormat::Encode(MakeConfig(), MakeRules(count), seeds.back());
+		}
+
+		for (const auto& [name, data] : MakeCorpus())
+			seeds.push_back(data);
+
+		// The mutations keep the data mostly valid, so they reach the checks past the header.
+		for (size_t i = 0; i < G_MUTATIONS_; ++i)
+		{
+			auto data = seeds[random() % seeds.size()];
+
+			for (auto mutations = 1 + random() % 4; mutations != 0; --mutations)
+			{
+				auto offset = data.empty() ? 0 : random() % data.size();
+
+				switch (random() % 5)
+				{
+					case 0: if (!data.empty()) data[offset] ^= static_cast<uint8_t>(1 << random() % 8); break;
+					case 1: if (!data.empty()) data[offset] = static_cast<uint8_t>(random()); break;
+					case 2: data.resize(offset); break;
+					case 3: data.insert(data.begin() + offset, static_cast<uint8_t>(random())); break;
+					case 4: if (data.size() >= offset + sizeof(uint32_t)) Put<uint32_t>(data, offset, static_cast<uint32_t>(random() % (data.size() + 2))); break;
+				}
+			}
+
+			accepted += Parse(data, parsed, decoded) ? 1 : 0;
+		}
+
+		std::printf("ConfigFormat: %zu of %zu mutated inputs are parsed.\n", accepted, G_MUTATIONS_);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkParse()
+	{
+		auto data		= std::vector<uint8_t>();
+		auto rules	= BaseConfigManager::Rules();
+
+		ConfigFormat::Encode(MakeConfig(), MakeRules(5000), data);
+
+		Testing::Benchmark("ConfigFormat::View::Parse, 5000 rules", 1000000, [&](size_t)
+		{
+			auto view = ConfigFormat::View();
+			return view.Parse(data.data(), data.size());
+		});
+
+		Testing::Benchmark("ConfigFormat::View::Parse + GetRules, 5000 rules", 10000, [&](size_t)
+		{
+			auto view = ConfigFormat::View();
+
+			view.Parse(data.data(), data.size());
+			view.GetRules(rules);
+			return rules.size();
+		});
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestRoundTrip();
+	TestCompatibility();
+	TestCorpus();
+	TestFuzz();
+	BenchmarkParse();
+
+	return Testing::Finish("configformattest");
+}
@@ -0,0 +1,324 @@
+#include "global.h"
+
+namespace
+{
+	using Testing::MockSession;
+
+	// Process that fails to be injected.
+	constexpr DWORD G_FAILING_PID_ = 13;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Sends the whole buffer to the blocking socket.
+	bool SendAll(_In_ SOCKET socket, _In_ const void* data, _In_ size_t size)
+	{
+		for (size_t sent = 0; sent < size; )
+		{
+			auto result = send(socket, static_cast<const char*>(data) + sent, static_cast<int>(size - sent), 0);
+			if (result <= 0)
+				return false;
+
+			sent += static_cast<size_t>(result);
+		}
+
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Receives the whole buffer from the blocking socket.
+	bool ReceiveAll(_In_ SOCKET socket, _Out_ void* data, _In_ size_t size)
+	{
+		for (size_t received = 0; received < size; )
+		{
+			auto result = recv(socket, static_cast<char*>(data) + received, static_cast<int>(size - received), 0);
+			if (result <= 0)
+				return false;
+
+			received += static_cast<size_t>(result);
+		}
+
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Sends the text prefixed with its size, as a single message.
+	bool SendText(_In_ SOCKET socket, _In_ const std::string& text)
+	{
+		auto size = static_cast<DWORD>(text.size());
+		return SendAll(socket, &size, sizeof(size)) && SendAll(socket, text.data(), text.size());
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Receives the text sent by SendText.
+	bool ReceiveText(_In_ SOCKET socket, _Out_ std::string& text)
+	{
+		auto size = DWORD{ 0 };
+
+		text.clear();
+
+		if (!ReceiveAll(socket, &size, sizeof(size)))
+			return false;
+
+		text.resize(size);
+		return ReceiveAll(socket, &text[0], size);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Control client connected over a local stream socket. Every command and every reply is a message.
+	class SocketControlChannel final : public AbstractControlChannel
+	{
+	public:
+		// SocketControlChannel constructor.
+		// @param socket - connected socket, closed by the channel.
+		explicit SocketControlChannel(_In_ SOCKET socket) :
+			m_Socket{ socket }
+		{ }
+
+		// Closes the socket.
+		~SocketControlChannel() {
+			closesocket(m_Socket);
+		}
+
+		// Reads the command message.
+		WinPipe::WinError Receive(_Out_ std::string& command) override {
+			return ReceiveText(m_Socket, command) ? ERROR_SUCCESS : WSAECONNRESET;
+		}
+
+		// Writes the reply message.
+		WinPipe::WinError Send(_In_ const std::string& reply) override {
+			return SendText(m_Socket, reply) ? ERROR_SUCCESS : WSAECONNRESET;
+		}
+
+	private:
+		SOCKET	m_Socket;	// Connected socket.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Control endpoint whose clients are connected by the test over socket pairs, AF_UNIX ones where supported.
+	class SocketControlListener final : public AbstractControlListener
+	{
+	public:
+		// SocketControlListener constructor.
+		SocketControlListener() :
+			m_Stopped{ false }
+		{ }
+
+		// Closes the sockets of the clients that are not accepted.
+		~SocketControlListener()
+		{
+			for (auto socket : m_Pending)
+				closesocket(socket);
+		}
+
+		// Waits for a client connected by Connect.
+		WinPipe::WinError Accept(_Out_ std::unique_ptr<AbstractControlChannel>& channel) override
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			m_Condition.wait(lock, [this] { return m_Stopped || !m_Pending.empty(); });
+
+			if (m_Stopped)
+				return ERROR_INVALID_HANDLE;
+
+			channel = std::make_unique<SocketControlChannel>(m_Pending.front());
+			m_Pending.pop_front();
+
+			return ERROR_SUCCESS;
+		}
+
+		// Wakes the pending Accept call.
+		void Stop() override
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Stopped = true;
+			}
+
+			m_Condition.notify_all();
+		}
+
+		// Connects a client.
+		// @returns socket of the client.
+		SOCKET Connect()
+		{
+			SOCKET sockets[2] = { };
+
+			CHECK(Testing::CreateSocketPair(sockets, false));
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Pending.push_back(sockets[1]);
+			}
+
+			m_Condition.notify_all();
+			return sockets[0];
+		}
+
+	private:
+		std::mutex							m_Mutex;			// Locks the listener.
+		std::condition_variable	m_Condition;	// Signaled when a client is connected or the listener is stopped.
+		std::deque<SOCKET>			m_Pending;		// Sockets of the clients that are not accepted.
+		bool										m_Stopped;		// true - the listener is stopped.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Core over the live server whose injection is a mock session.
+	class MockCore final : public AbstractCore
+	{
+	public:
+		// MockCore constructor.
+		MockCore() :
+			m_Server{ Server::Create() }
+		{ }
+
+		// Waits for the sessions.
+		void Wait(_In_opt_ DWORD timeout = INFINITE) override {
+			m_Server->Wait(timeout);
+		}
+
+		// Rolls out the config.
+		void UpdateConfig(_In_ const BaseConfigManager::Config& config, _In_ const BaseConfigManager::Rules& rules) override {
+			m_Server->UpdateConfig(config, rules);
+		}
+
+		// Returns count of sessions.
+		size_t GetSessionsCount() const override {
+			return m_Server->CountOfSessions();
+		}
+
+		// Adds the session of the process, as the injected redirector connects.
+		bool Attach(_In_ DWORD pid) override {
+			return pid != G_FAILING_PID_ && m_Server->AddSession(std::make_shared<MockSession>(pid, pid * 10));
+		}
+
+		// Stops and deletes the session.
+		bool Detach(_In_ DWORD pid) override
+		{
+			auto session = m_Server->GetSession(pid);
+			if (!session)
+				return false;
+
+			session->Stop();
+			m_Server->DeleteSession(pid);
+
+			return true;
+		}
+
+		// Returns fixed statistics.
+		InjectionQueue::Statistics GetInjectionStatistics() const override {
+			return InjectionQueue::Statistics{ 3, 1, 2, 40, 90 };
+		}
+
+		// Returns the server.
+		std::shared_ptr<AbstractServer> GetServer() const noexcept override {
+			return m_Server;
+		}
+
+	private:
+		std::shared_ptr<Server>	m_Server;	// Live server.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Accepts the single "valid" argument, which is the config with the proxy port 1080.
+	bool ParseConfig(_In_ const std::vector<std::string>& arguments, _Out_ BaseConfigManager::Config& config, _Out_ BaseConfigManager::Rules& rules)
+	{
+		config	= BaseConfigManager::Config{ };
+		rules		= BaseConfigManager::Rules();
+
+		if (arguments != std::vector<std::string>{ "valid" })
+			return false;
+
+		config.m_ProxyType					= ProxyType::Socks5;
+		config.m_ProxyV4.sin_family	= AF_INET;
+		config.m_ProxyV4.sin_port		= htons(1080);
+
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Sends the command and returns the reply.
+	std::string Execute(_In_ SOCKET client, _In_ const std::string& command)
+	{
+		auto reply = std::string();
+
+		CHECK(SendText(client, command) && ReceiveText(client, reply));
+		return reply;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestCommands()
+	{
+		auto core			= MockCore();
+		auto listener = new SocketControlListener();
+		auto server		= ControlServer(std::unique_ptr<AbstractControlListener>(listener), core, ParseConfig);
+		auto client		= listener->Connect();
+
+		CHECK(Execute(client, "attach 4 8") == "ok\n4 attached\n8 attached");
+		CHECK(Execute(client, "attach 4 12") == "ok\n4 already attached\n12 attached");
+		CHECK(Execute(client, "attach 13 x 0 4294967296") == "error\n13 failed\nx invalid\n0 invalid\n4294967296 invalid");
+		CHECK(Execute(client, "attach") == "error");
+		CHECK(core.GetSessionsCount() == 3);
+
+		// The config is applied by the attached sessions, an invalid one keeps the running config.
+		CHECK(Execute(client, "config valid") == "ok\nconfig=1");
+		CHECK(Execute(client, "config --socks5") == "error\ninvalid config");
+		CHECK(Execute(client, "sessions") == "ok\n4 config=1 reports=40\n8 config=1 reports=80\n12 config=1 reports=120");
+
+		auto session = std::static_pointer_cast<MockSession>(core.GetServer()->GetSession(8));
+
+		CHECK(Execute(client, "detach 8 16") == "error\n8 detached\n16 not attached");
+		CHECK(session->GetStops() == 1 && !core.GetServer()->SessionExists(8));
+
+		CHECK(Execute(client, "stats") == "ok\nsessions=2\nconfig=1\nreaped=0\nreaped_reports=0"
+			"\nauto_injected=3\nauto_failed=1\nauto_dropped=2\nstart_to_proxy_p50_ms=40\nstart_to_proxy_p99_ms=90");
+		CHECK(Execute(client, "restart") == "error\nunknown command restart");
+
+		closesocket(client);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestClients()
+	{
+		auto core			= MockCore();
+		auto listener = new SocketControlListener();
+		auto server		= ControlServer(std::unique_ptr<AbstractControlListener>(listener), core, ParseConfig);
+		auto first		= listener->Connect();
+		auto second		= listener->Connect();
+
+		// The clients are served one by one, the second one is served when the first one is gone.
+		CHECK(Execute(first, "attach 4") == "ok\n4 attached");
+		closesocket(first);
+
+		CHECK(Execute(second, "sessions") == "ok\n4 config=0 reports=40");
+
+		// The shutdown reply is sent before the daemon stops.
+		CHECK(Execute(second, "shutdown") == "ok");
+		server.Wait();
+
+		closesocket(second);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkCommand()
+	{
+		auto core			= MockCore();
+		auto listener = new SocketControlListener();
+		auto server		= ControlServer(std::unique_ptr<AbstractControlListener>(listener), core, ParseConfig);
+		auto client		= listener->Connect();
+
+		Execute(client, "attach 4 8 12");
+
+		Testing::Benchmark("Control stats command, round trip", 10000, [&](size_t) { return Execute(client, "stats").size(); });
+		Testing::Benchmark("Control sessions command, round trip", 10000, [&](size_t) { return Execute(client, "sessions").size(); });
+
+		closesocket(client);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestCommands();
+	TestClients();
+	BenchmarkCommand();
+
+	return Testing::Finish("controltest");
+}
@@ -0,0 +1,193 @@
+#include "global.h"
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Counts the callbacks run by the loop.
+	class Counter
+	{
+	public:
+		// Counts the callback.
+		// @param status - callback status.
+		void Add(_In_ WinPipe::WinError status)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+
+				m_Statuses.push_back(status);
+				m_Threads.insert(std::this_thread::get_id());
+			}
+
+			m_Condition.notify_all();
+		}
+
+		// Waits for the callbacks.
+		// @param count - count of callbacks.
+		// @returns false if the callbacks are not run in time.
+		bool Wait(_In_ size_t count)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			return m_Condition.wait_for(lock, std::chrono::seconds(10), [this, count] { return m_Statuses.size() >= count; });
+		}
+
+		// Returns statuses of the run callbacks.
+		std::vector<WinPipe::WinError> GetStatuses()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Statuses;
+		}
+
+		// Returns the threads that ran the callbacks.
+		std::set<std::thread::id> GetThreads()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Threads;
+		}
+
+	private:
+		std::mutex											m_Mutex;			// Locks the counter.
+		std::condition_variable					m_Condition;	// Signaled when a callback is counted.
+		std::vector<WinPipe::WinError>	m_Statuses;		// Statuses of the run callbacks.
+		std::set<std::thread::id>				m_Threads;		// Threads that ran the callbacks.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestPost()
+	{
+		auto counter	= Counter();
+		auto loop			= EventLoop(2);
+
+		for (size_t i = 0; i < 1000; ++i)
+			CHECK(loop.Post([&](WinPipe::WinError status) { counter.Add(status); }));
+
+		CHECK(counter.Wait(1000));
+
+		// The callbacks run only on the loop threads.
+		auto statuses = counter.GetStatuses();
+		auto threads	= counter.GetThreads();
+
+		CHECK(std::all_of(statuses.begin(), statuses.end(), [](WinPipe::WinError status) { return status == ERROR_SUCCESS; }));
+		CHECK(threads.size() <= 2 && !threads.count(std::this_thread::get_id()));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestWait()
+	{
+		constexpr size_t G_OBJECTS_ = 1000;
+
+		auto counter	= Counter();
+		auto loop			= EventLoop(2);
+		auto events		= std::vector<HANDLE>();
+
+		// The loop waits for more objects than a single wait call takes.
+		for (size_t i = 0; i < G_OBJECTS_; ++i)
+		{
+			events.push_back(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+			CHECK(loop.Wait(events.back(), INFINITE, [&](WinPipe::WinError status) { counter.Add(status); }));
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		CHECK(counter.GetStatuses().empty());
+
+		for (auto event : events)
+			SetEvent(event);
+
+		CHECK(counter.Wait(G_OBJECTS_));
+
+		auto statuses = counter.GetStatuses();
+		CHECK(std::all_of(statuses.begin(), statuses.end(), [](WinPipe::WinError status) { return status == ERROR_SUCCESS; }));
+
+		for (auto event : events)
+			CloseHandle(event);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestTimeout()
+	{
+		auto counter	= Counter();
+		auto loop			= EventLoop(1);
+		auto event		= CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		auto start		= std::chrono::steady_clock::now();
+
+		CHECK(loop.Wait(event, 100, [&](WinPipe::WinError status) { counter.Add(status); }));
+		CHECK(counter.Wait(1));
+
+		CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+		CHECK(counter.GetStatuses() == std::vector<WinPipe::WinError>{ WAIT_TIMEOUT });
+
+		CloseHandle(event);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestRearm()
+	{
+		auto counter	= Counter();
+		auto loop			= EventLoop(2);
+		auto event		= CreateEventW(nullptr, FALSE, FALSE, nullptr);
+		auto rearm		= std::function<void(WinPipe::WinError)>();
+
+		// A session waits again for its object from the callback, as for every next message.
+		rearm = [&](WinPipe::WinError status)
+		{
+			counter.Add(status);
+
+			if (counter.GetStatuses().size() < 100)
+				CHECK(loop.Wait(event, INFINITE, rearm));
+		};
+
+		CHECK(loop.Wait(event, INFINITE, rearm));
+
+		for (size_t i = 0; i < 1000 && counter.GetStatuses().size() < 100; ++i)
+		{
+			SetEvent(event);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		CHECK(counter.Wait(100));
+		CloseHandle(event);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkPost()
+	{
+		auto counter	= std::atomic<size_t>{ 0 };
+		auto loop			= EventLoop(4);
+
+		Testing::Benchmark("EventLoop::Post", 1000000, [&](size_t) { return loop.Post([&](WinPipe::WinError) { counter++; }); });
+
+		while (counter.load() < 1000000)
+			std::this_thread::yield();
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkWait()
+	{
+		auto counter	= Counter();
+		auto loop			= EventLoop(4);
+		auto event		= CreateEventW(nullptr, FALSE, FALSE, nullptr);
+
+		// Time from the signal of the object to its callback.
+		Testing::Benchmark("EventLoop::Wait, signaled", 10000, [&](size_t i)
+		{
+			loop.Wait(event, INFINITE, [&](WinPipe::WinError status) { counter.Add(status); });
+			SetEvent(event);
+
+			return counter.Wait(i + 1);
+		});
+
+		CloseHandle(event);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestPost();
+	TestWait();
+	TestTimeout();
+	TestRearm();
+	BenchmarkPost();
+	BenchmarkWait();
+
+	return Testing::Finish("eventlooptest");
+}
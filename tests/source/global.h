@@ -0,0 +1,86 @@
+#ifndef TESTS_GLOBAL_H_
+#define TESTS_GLOBAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <memory>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <variant>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <set>
+#include <map>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <random>
+#include <utility>
+#include <iterator>
+#include <new>
+
+#include "platform.h"
+#include "logging.h"
+#include "testing.h"
+
+#include "winpipe/codec.hpp"
+#include "common/baseconfig.hpp"
+#include "common/objectnames.hpp"
+#include "common/seqlock.hpp"
+#include "common/configformat.hpp"
+#include "common/configsection.hpp"
+#include "common/reportring.hpp"
+
+#include "basesocks.h"
+#include "socks4.hpp"
+#include "socks5.hpp"
+#include "socksprotocol.hpp"
+#include "rcu.hpp"
+#include "routetable.h"
+#include "configsnapshot.h"
+#include "upstreambalancer.h"
+#include "handshakedriver.h"
+#include "reportqueue.h"
+#include "sockettable.hpp"
+
+#include "processmatcher.h"
+#include "reportsink.h"
+#include "configdiff.h"
+#include "injectionqueue.h"
+#include "baseprocesswatcher.h"
+#include "baseeventloop.h"
+#include "basesession.h"
+#include "baseserver.h"
+#include "basecore.h"
+#include "eventloop.h"
+#include "basesessiontracker.h"
+#include "sessiontracker.h"
+#include "sessionregistry.h"
+#include "sessionreaper.h"
+#include "server.h"
+#include "injectionpipeline.h"
+#include "basecontrol.h"
+#include "controlhandler.h"
+#include "controlserver.h"
+
+#include "mocksession.h"
+#include "netlinkprocesswatcher.h"
+
+// The redirector and the client sources include their own global.h, which needs the Windows SDK
+// and the hooking libraries. The tests build them with this header instead.
+#define REDIRECTOR_GLOBAL_H_
+#define CLIENT_GLOBAL_H_
+
+#endif // !TESTS_GLOBAL_H_
@@ -0,0 +1,332 @@
+#include "global.h"
+
+namespace
+{
+	// Replies of the pipelined socks5 handshake with an IPv4 bound address.
+	constexpr BYTE G_GRANTED_[]		= { 0x05, 0x00, 0x05, 0x00, 0x00, 0x01, 127, 0, 0, 1, 0x04, 0x38 };
+	constexpr BYTE G_REFUSED_[]		= { 0x05, 0x00, 0x05, 0x05, 0x00, 0x01, 127, 0, 0, 1, 0x04, 0x38 };
+
+	// Size of the pipelined greeting and CONNECT request of an IPv4 target.
+	constexpr size_t G_REQUEST_SIZE_ = 13;
+
+	// App data the proxy sends right after the final reply.
+	constexpr char G_APP_DATA_[] = "app data";
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Collects the results of the finished handshakes.
+	class Results
+	{
+	public:
+		// Adds the result. Called by the driver callback.
+		// @param handshake - finished handshake.
+		// @param error - handshake error.
+		void Add(_In_ const HandshakeDriver::Handshake& handshake, _In_ int error)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Errors.emplace_back(handshake.m_Socket, error);
+			}
+
+			m_Condition.notify_all();
+		}
+
+		// Waits for the results.
+		// @param count - count of results.
+		// @returns false if the results are not added in time.
+		bool Wait(_In_ size_t count)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			return m_Condition.wait_for(lock, std::chrono::seconds(5), [this, count] { return m_Errors.size() >= count; });
+		}
+
+		// Returns the added results, sockets with their errors.
+		std::vector<std::pair<SOCKET, int>> Get()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Errors;
+		}
+
+		// Removes the added results.
+		void Clear()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Errors.clear();
+		}
+
+	private:
+		std::mutex													m_Mutex;			// Locks the results.
+		std::condition_variable							m_Condition;	// Signaled when a result is added.
+		std::vector<std::pair<SOCKET, int>>	m_Errors;			// Sockets with their errors.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns socks5 config of the handshakes.
+	// A proxy closing the connection is marked sequential for the whole process, so it has its own port.
+	BaseConfigManager::Config MakeConfig(_In_ WORD port)
+	{
+		auto config = BaseConfigManager::Config{ };
+
+		config.m_ProxyType					= ProxyType::Socks5;
+		config.m_ProxyV4.sin_family = AF_INET;
+		config.m_ProxyV4.sin_port		= htons(port);
+		config.m_Socks5Pipelining		= true;
+
+		return config;
+	}
+
+	// Config of the handshakes with the proxy keeping the connection.
+	const auto G_CONFIG_ = MakeConfig(1080);
+
+	// Config of the handshakes with the proxy closing the connection.
+	const auto G_CLOSING_CONFIG_ = MakeConfig(1081);
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the handshake of the socket connected to the proxy.
+	// @param config - handshake config, must outlive the handshake.
+	std::unique_ptr<HandshakeDriver::Handshake> MakeHandshake(_In_ SOCKET socket, _In_ const BaseConfigManager::Config& config = G_CONFIG_)
+	{
+		auto target = sockaddr_in{ };
+
+		target.sin_family = AF_INET;
+		target.sin_port		= htons(80);
+
+		auto handshake = std::make_unique<HandshakeDriver::Handshake>(socket, reinterpret_cast<const sockaddr*>(&target), static_cast<int>(sizeof(target)));
+
+		handshake->m_Socks.Create(config, handshake->m_Socket, handshake->GetAddress(), AbstractSocks::SelectProxyAddress(config));
+		return handshake;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Reads the count of bytes from the blocking socket.
+	bool ReceiveAll(_In_ SOCKET socket, _In_ size_t size)
+	{
+		char buffer[64];
+
+		while (size > 0)
+		{
+			auto received = recv(socket, buffer, static_cast<int>((std::min)(size, sizeof(buffer))), 0);
+			if (received == SOCKET_ERROR || received == 0)
+				return false;
+
+			size -= received;
+		}
+
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Serves the handshake: reads the request and answers with the data.
+	// The driver event is set as the socket event would be.
+	void Serve(_In_ HandshakeDriver& driver, _In_ SOCKET socket, _In_ const void* data, _In_ size_t size)
+	{
+		CHECK(ReceiveAll(socket, G_REQUEST_SIZE_));
+		CHECK(send(socket, static_cast<const char*>(data), static_cast<int>(size), 0) == static_cast<int>(size));
+
+		SetEvent(driver.GetEvent());
+	}
+
+	// Reports the connect to the proxy as refused.
+	int RefusedNetworkEvents(_In_ SOCKET socket, _In_ HANDLE event, _Out_ WSANETWORKEVENTS* events)
+	{
+		std::memset(events, 0, sizeof(*events));
+
+		events->lNetworkEvents								= FD_CONNECT;
+		events->iErrorCode[FD_CONNECT_BIT]	= WSAECONNREFUSED;
+		return 0;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestGranted()
+	{
+		auto		results = Results();
+		auto		driver	= HandshakeDriver([&](const auto& handshake, int error) { results.Add(handshake, error); }, &WSAEnumNetworkEvents);
+		SOCKET	sockets[2];
+
+		if (!CHECK(Testing::CreateSocketPair(sockets, true)))
+			return;
+
+		// The proxy sends the app data right after the replies.
+		auto reply = std::vector<BYTE>(std::begin(G_GRANTED_), std::end(G_GRANTED_));
+		reply.insert(reply.end(), std::begin(G_APP_DATA_), std::end(G_APP_DATA_));
+
+		driver.Add(MakeHandshake(sockets[0]));
+		Serve(driver, sockets[1], reply.data(), reply.size());
+
+		CHECK(results.Wait(1));
+		CHECK(results.Get() == (std::vector<std::pair<SOCKET, int>>{ { sockets[0], 0 } }));
+
+		// The data after the final reply is left to the app.
+		char data[sizeof(G_APP_DATA_) + 1];
+		CHECK(recv(sockets[0], data, sizeof(data), 0) == static_cast<int>(sizeof(G_APP_DATA_)));
+		CHECK(std::memcmp(data, G_APP_DATA_, sizeof(G_APP_DATA_)) == 0);
+
+		closesocket(sockets[0]);
+		closesocket(sockets[1]);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSplitReplies()
+	{
+		auto		results = Results();
+		auto		driver	= HandshakeDriver([&](const auto& handshake, int error) { results.Add(handshake, error); }, &WSAEnumNetworkEvents);
+		SOCKET	sockets[2];
+
+		if (!CHECK(Testing::CreateSocketPair(sockets, true)))
+			return;
+
+		driver.Add(MakeHandshake(sockets[0]));
+		CHECK(ReceiveAll(sockets[1], G_REQUEST_SIZE_));
+
+		// Every reply byte comes alone, the handshake waits for the next one.
+		for (auto byte : G_GRANTED_)
+		{
+			CHECK(results.Get().empty());
+			CHECK(send(sockets[1], reinterpret_cast<const char*>(&byte), 1, 0) == 1);
+
+			SetEvent(driver.GetEvent());
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		CHECK(results.Wait(1));
+		CHECK(results.Get() == (std::vector<std::pair<SOCKET, int>>{ { sockets[0], 0 } }));
+
+		closesocket(sockets[0]);
+		closesocket(sockets[1]);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestFailures()
+	{
+		auto		results = Results();
+		auto		driver	= HandshakeDriver([&](const auto& handshake, int error) { results.Add(handshake, error); }, &WSAEnumNetworkEvents);
+		SOCKET	sockets[2];
+
+		// The rejected request refuses the connect.
+		if (CHECK(Testing::CreateSocketPair(sockets, true)))
+		{
+			driver.Add(MakeHandshake(sockets[0]));
+			Serve(driver, sockets[1], G_REFUSED_, sizeof(G_REFUSED_));
+
+			CHECK(results.Wait(1));
+			CHECK(results.Get() == (std::vector<std::pair<SOCKET, int>>{ { sockets[0], WSAECONNREFUSED } }));
+
+			closesocket(sockets[0]);
+			closesocket(sockets[1]);
+		}
+
+		results.Clear();
+
+		// The proxy closes the connection in the middle of the replies.
+		if (CHECK(Testing::CreateSocketPair(sockets, true)))
+		{
+			driver.Add(MakeHandshake(sockets[0], G_CLOSING_CONFIG_));
+			Serve(driver, sockets[1], G_GRANTED_, 4);
+			closesocket(sockets[1]);
+			SetEvent(driver.GetEvent());
+
+			CHECK(results.Wait(1));
+			CHECK(results.Get() == (std::vector<std::pair<SOCKET, int>>{ { sockets[0], WSAECONNRESET } }));
+
+			closesocket(sockets[0]);
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestConnectFailure()
+	{
+		auto		results = Results();
+		auto		driver	= HandshakeDriver([&](const auto& handshake, int error) { results.Add(handshake, error); }, &RefusedNetworkEvents);
+		SOCKET	sockets[2];
+
+		if (!CHECK(Testing::CreateSocketPair(sockets, true)))
+			return;
+
+		// The failed connect to the proxy is reported without a request.
+		driver.Add(MakeHandshake(sockets[0]));
+
+		CHECK(results.Wait(1));
+		CHECK(results.Get() == (std::vector<std::pair<SOCKET, int>>{ { sockets[0], WSAECONNREFUSED } }));
+
+		closesocket(sockets[0]);
+		closesocket(sockets[1]);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestRemoveAndAbort()
+	{
+		auto		results = Results();
+		SOCKET	removed[2];
+		SOCKET	aborted[2];
+
+		if (!CHECK(Testing::CreateSocketPair(removed, true) && Testing::CreateSocketPair(aborted, true)))
+			return;
+
+		{
+			auto driver = HandshakeDriver([&](const auto& handshake, int error) { results.Add(handshake, error); }, &WSAEnumNetworkEvents);
+
+			driver.Add(MakeHandshake(removed[0]));
+			driver.Add(MakeHandshake(aborted[0]));
+
+			CHECK(ReceiveAll(removed[1], G_REQUEST_SIZE_));
+			CHECK(ReceiveAll(aborted[1], G_REQUEST_SIZE_));
+
+			// The removed handshake is not completed, even when its replies come.
+			driver.Remove(removed[0]);
+			CHECK(send(removed[1], reinterpret_cast<const char*>(G_GRANTED_), sizeof(G_GRANTED_), 0) == sizeof(G_GRANTED_));
+			SetEvent(driver.GetEvent());
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			CHECK(results.Get().empty());
+		}
+
+		// The pending handshakes are aborted by the stopped driver.
+		CHECK(results.Get() == (std::vector<std::pair<SOCKET, int>>{ { aborted[0], WSAECONNABORTED } }));
+
+		for (auto socket : { removed[0], removed[1], aborted[0], aborted[1] })
+			closesocket(socket);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkHandshake()
+	{
+		auto results	= Results();
+		auto driver		= HandshakeDriver([&](const auto& handshake, int error) { results.Add(handshake, error); }, &WSAEnumNetworkEvents);
+		auto failed		= size_t{ 0 };
+
+		// The replies are written before the handshake is added, so a handshake is completed by one pass of the driver.
+		Testing::Benchmark("HandshakeDriver socks5 handshake", 10000, [&](size_t i)
+		{
+			SOCKET sockets[2];
+
+			if (!Testing::CreateSocketPair(sockets, true))
+				return 0;
+
+			send(sockets[1], reinterpret_cast<const char*>(G_GRANTED_), sizeof(G_GRANTED_), 0);
+			driver.Add(MakeHandshake(sockets[0]));
+
+			if (!results.Wait(i + 1))
+				++failed;
+
+			closesocket(sockets[0]);
+			closesocket(sockets[1]);
+			return 1;
+		});
+
+		auto granted = results.Get();
+		CHECK(failed == 0 && granted.size() == 10000);
+		CHECK(std::all_of(granted.begin(), granted.end(), [](const auto& result) { return result.second == 0; }));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestGranted();
+	TestSplitReplies();
+	TestFailures();
+	TestConnectFailure();
+	TestRemoveAndAbort();
+	BenchmarkHandshake();
+
+	return Testing::Finish("handshakedrivertest");
+}
@@ -0,0 +1,221 @@
+#include "global.h"
+
+namespace
+{
+	using Stage = InjectionPipeline::Stage;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Backend that records the stages run for every process.
+	class MockBackend
+	{
+	public:
+		// MockBackend constructor.
+		// @param delay - time every Load stage takes, as the redirector is loaded.
+		explicit MockBackend(_In_ std::chrono::microseconds delay) :
+			m_Delay{ delay },
+			m_Running{ 0 },
+			m_MaxRunning{ 0 }
+		{ }
+
+		// Creates the injection of the process. The process 0 is skipped,
+		// the process whose id ends with 1 to 4 fails at the Open to Configured stage.
+		std::unique_ptr<InjectionPipeline::AbstractInjection> Create(_In_ DWORD pid)
+		{
+			if (pid == 0)
+				return nullptr;
+
+			return std::make_unique<Injection>(*this, pid);
+		}
+
+		// Returns the stages run for the process in order.
+		std::vector<Stage> GetStages(_In_ DWORD pid)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Stages[pid];
+		}
+
+		// Returns count of processes that have been injected at once at most.
+		size_t GetMaxRunning() const noexcept {
+			return m_MaxRunning;
+		}
+
+	private:
+		// Injection of a process, the process counts as running from its Open stage to its last stage.
+		class Injection final : public InjectionPipeline::AbstractInjection
+		{
+		public:
+			// Injection constructor.
+			// @param backend - owner backend.
+			// @param pid - process id.
+			Injection(_In_ MockBackend& backend, _In_ DWORD pid) :
+				m_Backend{ backend },
+				m_Pid{ pid },
+				m_Running{ false }
+			{ }
+
+			// Ends the running process.
+			~Injection()
+			{
+				if (m_Running)
+					--m_Backend.m_Running;
+			}
+
+			// Records the stage and fails it for the process whose id ends with its number.
+			bool Run(_In_ Stage stage) override
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_Backend.m_Mutex);
+					m_Backend.m_Stages[m_Pid].push_back(stage);
+				}
+
+				if (stage == Stage::Open)
+				{
+					auto running = ++m_Backend.m_Running;
+
+					for (auto max = m_Backend.m_MaxRunning.load(); max < running && !m_Backend.m_MaxRunning.compare_exchange_weak(max, running); );
+					m_Running = true;
+				}
+
+				if (stage == Stage::Load)
+					std::this_thread::sleep_for(m_Backend.m_Delay);
+
+				return m_Pid % 10 != static_cast<DWORD>(stage) + 1;
+			}
+
+		private:
+			MockBackend&	m_Backend;	// Owner backend.
+			DWORD					m_Pid;			// Process id.
+			bool					m_Running;	// true - the process is counted as running.
+		};
+
+		std::chrono::microseconds											m_Delay;			// Time every Load stage takes.
+		std::mutex																		m_Mutex;			// Locks the stages.
+		std::unordered_map<DWORD, std::vector<Stage>>	m_Stages;			// Stages run for every process.
+		std::atomic<size_t>														m_Running;		// Count of running injections.
+		std::atomic<size_t>														m_MaxRunning;	// Count of injections that have run at once at most.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Injects the processes on the mock backend.
+	// @returns results ordered by the process id.
+	std::vector<InjectionPipeline::Result> Inject(_In_ MockBackend& backend, _In_ size_t workers, _In_ const std::unordered_set<DWORD>& pids)
+	{
+		auto pipeline = InjectionPipeline(workers, [&](DWORD pid) { return backend.Create(pid); });
+		auto results	= pipeline.Run(pids);
+
+		std::sort(results.begin(), results.end(), [](const auto& left, const auto& right) { return left.m_Pid < right.m_Pid; });
+		return results;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestStages()
+	{
+		auto backend	= MockBackend(std::chrono::microseconds(0));
+		auto results	= Inject(backend, 2, { 0, 1, 2, 3, 4, 5, 15 });
+		auto all			= std::vector<Stage>{ Stage::Open, Stage::Load, Stage::Ready, Stage::Configured };
+
+		// The skipped process has no result.
+		CHECK(results.size() == 6);
+
+		// The stages are run in order, the failed one is the last one run.
+		for (DWORD pid = 1; pid <= 4; ++pid)
+		{
+			auto& result	= results[pid - 1];
+			auto run			= static_cast<size_t>(pid);
+
+			CHECK(result.m_Pid == pid && !result.m_Succeeded);
+			CHECK(result.m_Stage == static_cast<Stage>(pid - 1));
+			CHECK(backend.GetStages(pid) == std::vector<Stage>(all.begin(), all.begin() + run));
+
+			for (size_t i = run; i < InjectionPipeline::STAGES_; ++i)
+				CHECK(result.m_Timings[i] == 0);
+		}
+
+		for (auto index : { 4, 5 })
+		{
+			CHECK(results[index].m_Succeeded && results[index].m_Stage == Stage::Configured);
+			CHECK(backend.GetStages(results[index].m_Pid) == all);
+		}
+
+		CHECK(backend.GetStages(0).empty());
+		CHECK(Inject(backend, 2, { }).empty());
+
+		CHECK(std::strcmp(InjectionPipeline::GetStageName(Stage::Open), "open") == 0);
+		CHECK(std::strcmp(InjectionPipeline::GetStageName(Stage::Configured), "configured") == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestTimings()
+	{
+		auto backend = MockBackend(std::chrono::milliseconds(20));
+		auto results = Inject(backend, 1, { 5, 13 });
+
+		// Every stage is timed on its own, the slow Load stage does not count in the others.
+		for (auto& result : results)
+		{
+			auto load = result.m_Timings[static_cast<size_t>(Stage::Load)];
+
+			CHECK(load >= 20000 && load < 2000000);
+			CHECK(result.m_Timings[static_cast<size_t>(Stage::Open)] < 20000);
+		}
+
+		// The process 13 fails at the Ready stage, which is timed, the Configured one is not run.
+		CHECK(results[1].m_Timings[static_cast<size_t>(Stage::Configured)] == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestConcurrency()
+	{
+		auto pids = std::unordered_set<DWORD>();
+
+		for (DWORD pid = 1; pid <= 32; ++pid)
+			pids.insert(pid * 10);
+
+		// The processes are injected at once, but no more than the workers.
+		for (auto workers : { 1, 4, 64 })
+		{
+			auto backend	= MockBackend(std::chrono::milliseconds(10));
+			auto start		= std::chrono::steady_clock::now();
+			auto results	= Inject(backend, workers, pids);
+			auto elapsed	= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+			auto limit		= (std::min)(static_cast<size_t>(workers), pids.size());
+
+			CHECK(results.size() == pids.size());
+			CHECK(std::all_of(results.begin(), results.end(), [](const auto& result) { return result.m_Succeeded; }));
+			CHECK(backend.GetMaxRunning() <= limit && backend.GetMaxRunning() >= (std::min)(limit, size_t{ 2 }));
+
+			std::printf("InjectionPipeline, %d workers: 32 processes with a 10 ms load in %lld ms, %zu at once.\n",
+				workers, static_cast<long long>(elapsed), backend.GetMaxRunning());
+		}
+
+		// A pipeline without the workers injects on the calling thread.
+		auto backend = MockBackend(std::chrono::microseconds(0));
+		CHECK(Inject(backend, 0, pids).size() == pids.size() && backend.GetMaxRunning() == 1);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Measures the scheduling cost of the pipeline, the stages do nothing.
+	void BenchmarkPipeline()
+	{
+		auto backend	= MockBackend(std::chrono::microseconds(0));
+		auto pids			= std::unordered_set<DWORD>();
+
+		for (DWORD pid = 1; pid <= 1000; ++pid)
+			pids.insert(pid * 10);
+
+		auto pipeline = InjectionPipeline(8, [&](DWORD pid) { return backend.Create(pid); });
+
+		Testing::Benchmark("InjectionPipeline, 8 workers, run of 1000 processes", 100, [&](size_t) { return pipeline.Run(pids).size(); });
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestStages();
+	TestTimings();
+	TestConcurrency();
+	BenchmarkPipeline();
+
+	return Testing::Finish("injectionpipelinetest");
+}
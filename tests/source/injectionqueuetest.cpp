@@ -0,0 +1,315 @@
+#include "global.h"
+
+#ifdef __linux__
+#	include <sys/types.h>
+#	include <sys/wait.h>
+#	include <unistd.h>
+#	include <signal.h>
+#endif
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Injector that records the processes, it holds the injections until they are released.
+	class Injector
+	{
+	public:
+		// Injector constructor.
+		// @param hold - true if the injections wait for Release.
+		explicit Injector(_In_ bool hold) :
+			m_Hold{ hold },
+			m_Running{ 0 },
+			m_MaxRunning{ 0 }
+		{ }
+
+		// Records the process and returns true for the even ids.
+		bool Inject(_In_ DWORD pid)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			m_Pids.push_back(pid);
+			m_MaxRunning = (std::max)(m_MaxRunning, ++m_Running);
+			m_Condition.notify_all();
+
+			m_Condition.wait(lock, [this] { return !m_Hold; });
+
+			--m_Running;
+			m_Condition.notify_all();
+
+			return pid % 2 == 0;
+		}
+
+		// Releases the injections.
+		void Release()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Hold = false;
+			}
+
+			m_Condition.notify_all();
+		}
+
+		// Waits for the injections to start.
+		// @param count - count of started injections.
+		// @param running - count of injections running at once.
+		bool Wait(_In_ size_t count, _In_ size_t running = 0)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			return m_Condition.wait_for(lock, std::chrono::seconds(10), [this, count, running] { return m_Pids.size() >= count && m_Running == running; });
+		}
+
+		// Returns ids of the injected processes in order.
+		std::vector<DWORD> GetPids()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Pids;
+		}
+
+		// Returns count of injections that have run at once at most.
+		size_t GetMaxRunning()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_MaxRunning;
+		}
+
+	private:
+		std::mutex							m_Mutex;			// Locks the injector.
+		std::condition_variable	m_Condition;	// Signaled when an injection starts, ends or is released.
+		bool										m_Hold;				// true - the injections wait for Release.
+		std::vector<DWORD>			m_Pids;				// Ids of the injected processes.
+		size_t									m_Running;		// Count of running injections.
+		size_t									m_MaxRunning;	// Count of injections that have run at once at most.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Waits for the statistics of the processes.
+	// @param count - count of injected and failed processes.
+	bool WaitDone(_In_ const InjectionQueue& queue, _In_ size_t count)
+	{
+		for (size_t i = 0; i < 10000; ++i)
+		{
+			auto statistics = queue.GetStatistics();
+
+			if (statistics.m_Injected + statistics.m_Failed >= count)
+				return true;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return false;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestDedupe()
+	{
+		auto injector = Injector(true);
+		auto queue		= InjectionQueue(16, 1, [&](DWORD pid) { return injector.Inject(pid); });
+		auto created	= std::chrono::system_clock::now();
+
+		// A process is queued once while it is queued or being injected.
+		CHECK(queue.Push(4, created));
+		CHECK(injector.Wait(1, 1));
+		CHECK(!queue.Push(4, created));
+
+		CHECK(queue.Push(8, created));
+		CHECK(!queue.Push(8, created));
+
+		// A reused id is a new process with another creation time.
+		CHECK(queue.Push(4, created + std::chrono::milliseconds(10)));
+
+		injector.Release();
+
+		CHECK(WaitDone(queue, 3));
+		CHECK(injector.GetPids() == std::vector<DWORD>({ 4, 8, 4 }));
+
+		// An injected process is queued again, e.g. when it is detached and restarted.
+		CHECK(queue.Push(8, created));
+		CHECK(WaitDone(queue, 4));
+
+		auto statistics = queue.GetStatistics();
+		CHECK(statistics.m_Injected == 4 && statistics.m_Failed == 0 && statistics.m_Dropped == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestFull()
+	{
+		auto injector = Injector(true);
+		auto queue		= InjectionQueue(4, 2, [&](DWORD pid) { return injector.Inject(pid); });
+		auto created	= std::chrono::system_clock::now();
+
+		// Two processes are being injected, the next four fill the queue, the rest are dropped.
+		for (DWORD pid = 1; pid <= 2; ++pid)
+			CHECK(queue.Push(pid, created));
+
+		CHECK(injector.Wait(2, 2));
+
+		for (DWORD pid = 3; pid <= 10; ++pid)
+			CHECK(queue.Push(pid, created) == (pid <= 6));
+
+		auto statistics = queue.GetStatistics();
+		CHECK(statistics.m_Dropped == 4 && statistics.m_Injected == 0);
+
+		// A dropped process is not pending, so it is queued when the queue has room.
+		injector.Release();
+
+		CHECK(WaitDone(queue, 6));
+		CHECK(queue.Push(7, created));
+		CHECK(WaitDone(queue, 7));
+
+		statistics = queue.GetStatistics();
+		CHECK(statistics.m_Injected == 3 && statistics.m_Failed == 4 && statistics.m_Dropped == 4);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestConcurrency()
+	{
+		auto injector = Injector(true);
+		auto queue		= InjectionQueue(64, 4, [&](DWORD pid) { return injector.Inject(pid); });
+		auto created	= std::chrono::system_clock::now();
+
+		for (DWORD pid = 0; pid < 32; ++pid)
+			CHECK(queue.Push(pid, created));
+
+		// The workers inject at once, but no more than their count.
+		CHECK(injector.Wait(4, 4));
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		CHECK(injector.GetPids().size() == 4);
+
+		injector.Release();
+
+		CHECK(WaitDone(queue, 32));
+		CHECK(injector.GetMaxRunning() == 4);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestPercentiles()
+	{
+		auto injector = Injector(false);
+		auto queue		= InjectionQueue(256, 1, [&](DWORD pid) { return injector.Inject(pid); });
+		auto now			= std::chrono::system_clock::now();
+
+		CHECK(queue.GetStatistics().m_P50 == 0 && queue.GetStatistics().m_P99 == 0);
+
+		// The processes have started from 1 to 100 seconds ago, the failed ones are not counted.
+		for (DWORD i = 1; i <= 100; ++i)
+			CHECK(queue.Push(i * 2, now - std::chrono::seconds(i)));
+
+		CHECK(queue.Push(1, now - std::chrono::hours(1)));
+		CHECK(WaitDone(queue, 101));
+
+		auto statistics = queue.GetStatistics();
+
+		CHECK(statistics.m_Injected == 100 && statistics.m_Failed == 1);
+		CHECK(statistics.m_P50 / 1000 == 51);
+		CHECK(statistics.m_P99 / 1000 == 100);
+	}
+
+#ifdef __linux__
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Starts the program, which exits after the time.
+	// @returns process id, 0 if the process is not started.
+	pid_t Start(_In_ const char* program, _In_ const char* seconds)
+	{
+		auto pid = ::fork();
+
+		if (pid == 0)
+		{
+			::execlp(program, program, seconds, static_cast<char*>(nullptr));
+			::_exit(127);
+		}
+
+		return pid < 0 ? 0 : pid;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Watches the started processes as the core does: they are matched by name and queued.
+	void TestWatcher()
+	{
+		auto injector = Injector(false);
+		auto queue		= InjectionQueue(256, 2, [&](DWORD pid) { return injector.Inject(pid); });
+		auto matcher	= ProcessMatcher({ "slee?" });
+		auto watcher	= std::unique_ptr<AbstractProcessWatcher>();
+
+		try
+		{
+			watcher = std::make_unique<NetlinkProcessWatcher>([&](DWORD pid, std::chrono::system_clock::time_point created)
+			{
+				auto name = std::string();
+
+				if (NetlinkProcessWatcher::GetProcessName(pid, name) && matcher.Match(name.c_str()))
+					queue.Push(pid, created);
+			});
+		}
+		catch (const std::runtime_error& error)
+		{
+			std::printf("NetlinkProcessWatcher is skipped: %s.\n", error.what());
+			return;
+		}
+
+		auto started	= std::vector<pid_t>();
+		auto pids			= std::vector<DWORD>();
+
+		// The watcher subscribes before the processes start, so none of them is missed.
+		for (size_t i = 0; i < 4; ++i)
+			started.push_back(Start("sleep", "1"));
+
+		auto other = Start("true", "1");
+
+		for (size_t i = 0; i < 1000 && injector.GetPids().size() < started.size(); ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		pids = injector.GetPids();
+
+		for (auto pid : started)
+			CHECK(pid != 0 && std::count(pids.begin(), pids.end(), static_cast<DWORD>(pid)) == 1);
+
+		CHECK(std::find(pids.begin(), pids.end(), static_cast<DWORD>(other)) == pids.end());
+
+		watcher->Stop();
+		CHECK(watcher->Wait(1000));
+
+		for (auto pid : started)
+			::waitpid(pid, nullptr, 0);
+
+		::waitpid(other, nullptr, 0);
+
+		auto statistics = queue.GetStatistics();
+		std::printf("NetlinkProcessWatcher: %zu processes queued, start to injection p50=%lld ms p99=%lld ms.\n",
+			pids.size(), statistics.m_P50, statistics.m_P99);
+	}
+#endif
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkQueue()
+	{
+		constexpr size_t G_PROCESSES_ = 200000;
+
+		auto queue		= InjectionQueue(G_PROCESSES_, 4, [](DWORD pid) { return true; });
+		auto created	= std::chrono::system_clock::now();
+		auto start		= std::chrono::steady_clock::now();
+
+		for (DWORD pid = 0; pid < G_PROCESSES_; ++pid)
+			queue.Push(pid, created);
+
+		CHECK(WaitDone(queue, G_PROCESSES_));
+
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::printf("InjectionQueue, 4 workers: %.1f K processes/s queued and injected.\n", G_PROCESSES_ / elapsed / 1e3);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestDedupe();
+	TestFull();
+	TestConcurrency();
+	TestPercentiles();
+#ifdef __linux__
+	TestWatcher();
+#endif
+	BenchmarkQueue();
+
+	return Testing::Finish("injectionqueuetest");
+}
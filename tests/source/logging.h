@@ -0,0 +1,24 @@
+#ifndef TESTS_LOGGING_H_
+#define TESTS_LOGGING_H_
+
+// The spdlog functions used by the tested sources.
+// spdlog is built only with the Windows projects, the tests discard the messages.
+namespace spdlog
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	template <typename... Args>
+	void info(_In_ const char* format, _In_ const Args&... args) noexcept
+	{ }
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	template <typename... Args>
+	void warn(_In_ const char* format, _In_ const Args&... args) noexcept
+	{ }
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	template <typename... Args>
+	void error(_In_ const char* format, _In_ const Args&... args) noexcept
+	{ }
+}
+
+#endif // !TESTS_LOGGING_H_
@@ -0,0 +1,97 @@
+#ifndef TESTS_MOCK_SESSION_H_
+#define TESTS_MOCK_SESSION_H_
+
+namespace Testing
+{
+	// Session without a client, it counts the calls of the server.
+	// The process handle is the emulated one of platform.h, which the tests signal to exit the process.
+	class MockSession : public AbstractSession
+	{
+	public:
+		// Deleted default constructor.
+		MockSession() = delete;
+		// Default destructor.
+		~MockSession() = default;
+		// Deleted copy constructor.
+		MockSession(const MockSession&) = delete;
+		// Deleted copy assigment.
+		MockSession& operator=(const MockSession&) = delete;
+
+		// MockSession constructor.
+		// @param id - session id.
+		// @param reports - count of received connection reports.
+		explicit MockSession(_In_ DWORD id, _In_ size_t reports = 0) :
+			AbstractSession{ id, std::weak_ptr<AbstractServer>(), std::wstring() },
+			m_Reports{ reports },
+			m_Stops{ 0 },
+			m_Prepared{ 0 },
+			m_Version{ 0 },
+			m_Ready{ true }
+		{ }
+
+		// Counts the stop.
+		void Stop() override {
+			m_Stops++;
+		}
+
+		// Counts the prepared config.
+		void PrepareConfig(_In_ const BaseConfigManager::Config& config) override {
+			m_Prepared++;
+		}
+
+		// Returns the readiness set by the test.
+		bool WaitReady() override {
+			return m_Ready;
+		}
+
+		// Acknowledges the config version at once, if the session is ready.
+		bool WaitConfig(_In_ DWORD version, _In_ DWORD timeout = INFINITE) override
+		{
+			if (!m_Ready)
+				return false;
+
+			m_Version = (std::max)(m_Version.load(), version);
+			return true;
+		}
+
+		// Returns version of the last acknowledged config.
+		DWORD GetConfigVersion() const noexcept override {
+			return m_Version;
+		}
+
+		// Returns count of received connection reports.
+		size_t GetReportCount() const noexcept override {
+			return m_Reports;
+		}
+
+		// Sets the readiness of the client.
+		// @param ready - false if the client never gets ready.
+		void SetReady(_In_ bool ready) noexcept {
+			m_Ready = ready;
+		}
+
+		// Simulates the exit of the session process.
+		void Exit() {
+			SetEvent(m_Process.get());
+		}
+
+		// Returns count of stops.
+		size_t GetStops() const noexcept {
+			return m_Stops;
+		}
+
+		// Returns count of prepared configs.
+		size_t GetPrepared() const noexcept {
+			return m_Prepared;
+		}
+
+	private:
+		size_t							m_Reports;	// Count of received connection reports.
+		std::atomic<size_t>	m_Stops;		// Count of stops.
+		std::atomic<size_t>	m_Prepared;	// Count of prepared configs.
+		std::atomic<DWORD>	m_Version;	// Version of the last acknowledged config.
+		std::atomic<bool>		m_Ready;		// Readiness of the client.
+	};
+}
+
+#endif // !TESTS_MOCK_SESSION_H_
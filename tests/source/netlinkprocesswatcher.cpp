@@ -0,0 +1,211 @@
+#ifdef __linux__
+#	include <cstdint>
+#	include <cstring>
+#	include <memory>
+#	include <thread>
+#	include <chrono>
+#	include <functional>
+#	include <mutex>
+#	include <condition_variable>
+#	include <string>
+#	include <fstream>
+#	include <sstream>
+#	include <stdexcept>
+#	include <ctime>
+#	include <sys/socket.h>
+#	include <sys/eventfd.h>
+#	include <poll.h>
+#	include <unistd.h>
+#	include <linux/netlink.h>
+#	include <linux/connector.h>
+#	include <linux/cn_proc.h>
+
+#	define TESTS_SYSTEM_SOCKETS_
+#	include "platform.h"
+#	include "baseprocesswatcher.h"
+#	include "netlinkprocesswatcher.h"
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Subscribes to the process events or unsubscribes from them.
+	// The message is the netlink header, the connector header and the operation.
+	bool Subscribe(_In_ int socket, _In_ proc_cn_mcast_op operation)
+	{
+		constexpr size_t G_SIZE_ = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+
+		alignas(NLMSG_ALIGNTO) char buffer[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))] = { };
+
+		auto header		= reinterpret_cast<nlmsghdr*>(buffer);
+		auto message	= static_cast<cn_msg*>(NLMSG_DATA(header));
+
+		header->nlmsg_len		= G_SIZE_;
+		header->nlmsg_type	= NLMSG_DONE;
+		header->nlmsg_pid		= static_cast<uint32_t>(getpid());
+		message->id.idx			= CN_IDX_PROC;
+		message->id.val			= CN_VAL_PROC;
+		message->len				= sizeof(operation);
+
+		std::memcpy(message->data, &operation, sizeof(operation));
+
+		return ::send(socket, static_cast<const void*>(buffer), G_SIZE_, 0) == static_cast<ssize_t>(G_SIZE_);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+NetlinkProcessWatcher::NetlinkProcessWatcher(_In_ Callback callback) :
+	m_Callback{ callback },
+	m_Socket{ ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR) },
+	m_StopEvent{ ::eventfd(0, EFD_CLOEXEC) },
+	m_Stopped{ false }
+{
+	auto address = sockaddr_nl{ };
+
+	address.nl_family = AF_NETLINK;
+	address.nl_groups = CN_IDX_PROC;
+
+	if (m_Socket < 0 || m_StopEvent < 0 ||
+			::bind(m_Socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+			!Subscribe(m_Socket, PROC_CN_MCAST_LISTEN))
+	{
+		auto error = errno;
+
+		if (m_Socket >= 0)
+			::close(m_Socket);
+
+		if (m_StopEvent >= 0)
+			::close(m_StopEvent);
+
+		throw std::runtime_error("Failed to subscribe to process connector, errno " + std::to_string(error));
+	}
+
+	m_Thread = std::thread(&NetlinkProcessWatcher::WatchThread, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+NetlinkProcessWatcher::~NetlinkProcessWatcher()
+{
+	Stop();
+
+	Subscribe(m_Socket, PROC_CN_MCAST_IGNORE);
+
+	::close(m_Socket);
+	::close(m_StopEvent);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void NetlinkProcessWatcher::Stop()
+{
+	auto value = uint64_t{ 1 };
+
+	if (::write(m_StopEvent, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value)))
+		return;
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool NetlinkProcessWatcher::Wait(_In_ DWORD timeout)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (timeout == INFINITE)
+	{
+		m_Condition.wait(lock, [this] { return m_Stopped; });
+		return true;
+	}
+
+	return m_Condition.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return m_Stopped; });
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool NetlinkProcessWatcher::GetProcessName(_In_ DWORD pid, _Out_ std::string& name)
+{
+	auto file = std::ifstream("/proc/" + std::to_string(pid) + "/comm");
+
+	name.clear();
+	return static_cast<bool>(std::getline(file, name));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void NetlinkProcessWatcher::WatchThread()
+{
+	alignas(NLMSG_ALIGNTO) char buffer[8192];
+	pollfd descriptors[] = { { m_StopEvent, POLLIN, 0 }, { m_Socket, POLLIN, 0 } };
+
+	while (::poll(descriptors, 2, -1) > 0 && !(descriptors[0].revents & POLLIN))
+	{
+		auto received = ::recv(m_Socket, static_cast<void*>(buffer), sizeof(buffer), 0);
+
+		// The events lost by an overflow of the socket buffer are skipped.
+		if (received < 0 && errno == ENOBUFS)
+			continue;
+
+		if (received <= 0)
+			break;
+
+		for (auto header = reinterpret_cast<nlmsghdr*>(buffer); NLMSG_OK(header, received); header = NLMSG_NEXT(header, received))
+		{
+			auto message	= static_cast<const cn_msg*>(NLMSG_DATA(header));
+			auto event		= reinterpret_cast<const proc_event*>(message->data);
+			auto created	= std::chrono::system_clock::time_point();
+
+			if (message->id.idx != CN_IDX_PROC || event->what != proc_event::PROC_EVENT_EXEC)
+				continue;
+
+			// A process that has already exited is not injected anyway.
+			auto pid = static_cast<DWORD>(event->event_data.exec.process_tgid);
+
+			if (GetCreationTime(pid, created))
+				m_Callback(pid, created);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopped = true;
+	}
+
+	m_Condition.notify_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool NetlinkProcessWatcher::GetCreationTime(_In_ DWORD pid, _Out_ std::chrono::system_clock::time_point& created)
+{
+	// The start time counts the clock ticks since the boot. The boot time is computed once,
+	// so the start time of a process is the same on every call.
+	static auto boot = []()
+	{
+		auto uptime = timespec{ };
+
+		::clock_gettime(CLOCK_BOOTTIME, &uptime);
+		return std::chrono::system_clock::now() - std::chrono::seconds(uptime.tv_sec) - std::chrono::nanoseconds(uptime.tv_nsec);
+	}();
+
+	auto file = std::ifstream("/proc/" + std::to_string(pid) + "/stat");
+	auto line = std::string();
+
+	created = std::chrono::system_clock::time_point();
+
+	// The name in parentheses may hold spaces, the start time is the 20th field after it.
+	if (!std::getline(file, line) || line.rfind(')') == std::string::npos)
+		return false;
+
+	auto fields = std::istringstream(line.substr(line.rfind(')') + 1));
+	auto field	= std::string();
+	auto ticks	= 0ULL;
+
+	for (size_t i = 0; i < 20 && fields >> field; ++i)
+	{
+		if (i == 19)
+			ticks = std::stoull(field);
+	}
+
+	if (ticks == 0)
+		return false;
+
+	created = boot + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(static_cast<double>(ticks) / ::sysconf(_SC_CLK_TCK)));
+	return true;
+}
+#endif
@@ -0,0 +1,61 @@
+#ifndef TESTS_NETLINK_PROCESS_WATCHER_H_
+#define TESTS_NETLINK_PROCESS_WATCHER_H_
+
+#ifdef __linux__
+// Linux backend of the process watcher, over the netlink process connector.
+// A process is reported when it executes its image, as the ETW backend reports a process created
+// with its image. The creation time is the start time of the process, which does not change
+// on the next executions, so a process is deduplicated by the queue the same way as on Windows.
+// Requires CAP_NET_ADMIN.
+class NetlinkProcessWatcher : public AbstractProcessWatcher
+{
+public:
+	// Deleted default constructor.
+	NetlinkProcessWatcher() = delete;
+	// Stops the watcher.
+	~NetlinkProcessWatcher();
+	// Deleted copy constructor.
+	NetlinkProcessWatcher(const NetlinkProcessWatcher&) = delete;
+	// Deleted copy assigment.
+	NetlinkProcessWatcher& operator=(const NetlinkProcessWatcher&) = delete;
+
+	// NetlinkProcessWatcher constructor.
+	// Throws runtime_error if the process connector is not subscribed.
+	// @param callback - started process callback.
+	explicit NetlinkProcessWatcher(_In_ Callback callback);
+
+	// Stops the watcher thread.
+	void Stop() override;
+
+	// Waits for the watcher thread to exit.
+	// @param timeout - time in milliseconds.
+	// @returns true if the watcher has stopped.
+	bool Wait(_In_ DWORD timeout) override;
+
+	// Reads the name of the process, as the Windows process snapshot reports it.
+	// @param pid - process id.
+	// @param name - process name.
+	// @returns false if the process has exited.
+	static bool GetProcessName(_In_ DWORD pid, _Out_ std::string& name);
+
+private:
+	// Watcher thread routine.
+	void WatchThread();
+
+	// Reads the start time of the process.
+	// @param pid - process id.
+	// @param created - process start time.
+	// @returns false if the process has exited.
+	static bool GetCreationTime(_In_ DWORD pid, _Out_ std::chrono::system_clock::time_point& created);
+
+	Callback								m_Callback;		// Started process callback.
+	int											m_Socket;			// Connector socket.
+	int											m_StopEvent;	// Stops the watcher thread.
+	std::mutex							m_Mutex;			// Locks the stopped flag.
+	std::condition_variable	m_Condition;	// Signaled when the watcher thread exits.
+	bool										m_Stopped;		// true - the watcher thread has exited.
+	std::thread							m_Thread;			// Watcher thread.
+};
+#endif
+
+#endif // !TESTS_NETLINK_PROCESS_WATCHER_H_
@@ -0,0 +1,702 @@
+#ifdef _WIN32
+#	include "global.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Testing::CreateSocketPair(_Out_ SOCKET (&sockets)[2], _In_ bool nonBlocking)
+{
+	static auto started = []() { auto data = WSADATA{ }; return WSAStartup(MAKEWORD(2, 2), &data) == 0; }();
+
+	auto listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	auto address	= sockaddr_in{ AF_INET };
+	auto length		= static_cast<int>(sizeof(address));
+	auto mode			= u_long{ nonBlocking ? 1ul : 0ul };
+
+	sockets[0] = sockets[1] = INVALID_SOCKET;
+	address.sin_addr.S_un.S_addr = htonl(INADDR_LOOPBACK);
+
+	auto created = started && listener != INVALID_SOCKET &&
+		bind(listener, reinterpret_cast<const sockaddr*>(&address), length) == 0 &&
+		listen(listener, 1) == 0 &&
+		getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0 &&
+		(sockets[0] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) != INVALID_SOCKET &&
+		connect(sockets[0], reinterpret_cast<const sockaddr*>(&address), length) == 0 &&
+		(sockets[1] = accept(listener, nullptr, nullptr)) != INVALID_SOCKET &&
+		ioctlsocket(sockets[0], FIONBIO, &mode) == 0;
+
+	closesocket(listener);
+	return created;
+}
+#else
+#	include <cstdint>
+#	include <cstring>
+#	include <cerrno>
+#	include <memory>
+#	include <atomic>
+#	include <thread>
+#	include <chrono>
+#	include <functional>
+#	include <mutex>
+#	include <condition_variable>
+#	include <deque>
+#	include <map>
+#	include <string>
+#	include <unordered_set>
+#	include <vector>
+#	include <algorithm>
+#	include <sys/socket.h>
+#	include <arpa/inet.h>
+#	include <poll.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+
+#	define TESTS_SYSTEM_SOCKETS_
+#	include "platform.h"
+#	include "testing.h"
+
+namespace
+{
+	// Socket address families of the tested sources.
+	constexpr int G_FAMILY_INET_	= 2;
+	constexpr int G_FAMILY_INET6_	= 23;
+
+	// Count of the thread pool threads.
+	constexpr size_t G_POOL_THREADS_ = 4;
+
+	// Size of the memory pages.
+	constexpr size_t G_PAGE_SIZE_ = 4096;
+
+	struct Wait;
+
+	// Memory page of a section, the views are aligned to the pages as on Windows.
+	struct alignas(G_PAGE_SIZE_) Page
+	{
+		BYTE	m_Bytes[G_PAGE_SIZE_];
+	};
+
+	// Section memory.
+	using Section = std::vector<Page>;
+
+	// Completion packet.
+	struct Packet
+	{
+		DWORD				m_Transferred;	// Transferred bytes.
+		ULONG_PTR		m_Key;					// Completion key.
+		OVERLAPPED*	m_Overlapped;		// Overlapped operation.
+	};
+
+	// Waitable object: an event, a process or a completion port, or a section.
+	struct Object
+	{
+		bool											m_ManualReset;	// false - a satisfied wait resets the object.
+		bool											m_Signaled;			// Object state.
+		std::vector<Wait*>				m_Waits;				// Thread pool waits of the object.
+		std::deque<Packet>				m_Packets;			// Queued packets of the completion port.
+		std::shared_ptr<Section>	m_Section;			// Memory of the section.
+	};
+
+	// Timers of the thread pool waits by their deadlines.
+	using Timers = std::multimap<std::chrono::steady_clock::time_point, Wait*>;
+
+	// Thread pool wait.
+	struct Wait
+	{
+		Object*							m_Object;		// Waited object.
+		WAITORTIMERCALLBACK	m_Callback;	// Wait callback.
+		PVOID								m_Context;	// Callback context.
+		DWORD								m_Timeout;	// Wait timeout in milliseconds.
+		bool								m_Once;			// true - the wait is executed once.
+		bool								m_Armed;		// true - the wait is not executed yet.
+		bool								m_Running;	// true - the callback is running.
+		bool								m_Released;	// true - the wait is released by the running callback.
+		std::thread::id			m_Thread;		// Thread running the callback.
+		Timers::iterator		m_Timer;		// Timer of the wait. Valid if the wait is armed and has a timeout.
+	};
+
+	// Executed wait.
+	struct Fired
+	{
+		Wait*	m_Wait;			// Wait.
+		bool	m_TimedOut;	// true - the wait has timed out.
+	};
+
+	// The objects share one lock and one condition, a signal wakes every waiter.
+	struct State
+	{
+		std::mutex																						m_Mutex;				// Locks the objects and the waits.
+		std::condition_variable																m_Condition;		// Signaled when an object or a wait changes.
+		std::deque<Fired>																			m_Fired;				// Waits whose callbacks must run.
+		Timers																								m_Timers;				// Timers of the armed waits.
+		bool																									m_Started;			// true - the thread pool is started.
+		std::mutex																						m_SocketsMutex;	// Locks the connected sockets.
+		std::unordered_set<int>																m_Connected;		// Sockets whose connect is reported.
+		std::map<std::wstring, std::weak_ptr<Section>>				m_Sections;			// Named sections.
+		std::multimap<const void*, std::shared_ptr<Section>>	m_Views;				// Mapped views by address.
+	};
+
+	thread_local DWORD	t_LastError		= ERROR_SUCCESS;
+	thread_local int		t_SocketError	= 0;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// The state outlives the pool threads, which are never joined.
+	State& GetState()
+	{
+		static auto state = new State{ };
+		return *state;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the object of the handle, nullptr for the invalid handles.
+	Object* GetObject(_In_ HANDLE handle) noexcept
+	{
+		if (!handle || handle == INVALID_HANDLE_VALUE)
+		{
+			t_LastError = ERROR_INVALID_HANDLE;
+			return nullptr;
+		}
+
+		return static_cast<Object*>(handle);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Takes the signal of the object for a satisfied wait.
+	// @returns true if the object was signaled.
+	bool Acquire(_Inout_ Object& object) noexcept
+	{
+		if (!object.m_Signaled)
+			return false;
+
+		if (!object.m_ManualReset)
+			object.m_Signaled = false;
+
+		return true;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Disarms the wait and queues its callback. Called with the state locked.
+	void Fire(_Inout_ State& state, _Inout_ Wait& wait, _In_ bool timedOut)
+	{
+		if (wait.m_Timer != state.m_Timers.end())
+		{
+			state.m_Timers.erase(wait.m_Timer);
+			wait.m_Timer = state.m_Timers.end();
+		}
+
+		wait.m_Armed = false;
+		state.m_Fired.push_back(Fired{ &wait, timedOut });
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Arms the wait. Called with the state locked.
+	void Arm(_Inout_ State& state, _Inout_ Wait& wait)
+	{
+		wait.m_Armed = true;
+
+		if (Acquire(*wait.m_Object))
+		{
+			Fire(state, wait, false);
+			return;
+		}
+
+		if (wait.m_Timeout != INFINITE)
+			wait.m_Timer = state.m_Timers.emplace(std::chrono::steady_clock::now() + std::chrono::milliseconds(wait.m_Timeout), &wait);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Signals the object and queues its armed waits. Called with the state locked.
+	void Signal(_Inout_ State& state, _Inout_ Object& object)
+	{
+		object.m_Signaled = true;
+
+		for (auto wait : object.m_Waits)
+		{
+			if (wait->m_Armed && Acquire(object))
+				Fire(state, *wait, false);
+		}
+
+		state.m_Condition.notify_all();
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Thread pool thread routine. Runs the callbacks of the fired waits and times the waits out.
+	void PoolThread()
+	{
+		auto& state = GetState();
+		auto	lock	= std::unique_lock<std::mutex>(state.m_Mutex);
+
+		for (;;)
+		{
+			auto now = std::chrono::steady_clock::now();
+
+			while (!state.m_Timers.empty() && state.m_Timers.begin()->first <= now)
+				Fire(state, *state.m_Timers.begin()->second, true);
+
+			if (state.m_Fired.empty())
+			{
+				if (state.m_Timers.empty())
+					state.m_Condition.wait(lock);
+				else
+					state.m_Condition.wait_until(lock, state.m_Timers.begin()->first);
+
+				continue;
+			}
+
+			auto fired	= state.m_Fired.front();
+			auto wait		= fired.m_Wait;
+
+			state.m_Fired.pop_front();
+
+			wait->m_Running = true;
+			wait->m_Thread	= std::this_thread::get_id();
+
+			lock.unlock();
+			wait->m_Callback(wait->m_Context, fired.m_TimedOut);
+			lock.lock();
+
+			wait->m_Running = false;
+
+			if (wait->m_Released)
+				delete wait;
+			else if (!wait->m_Once)
+				Arm(state, *wait);
+
+			state.m_Condition.notify_all();
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the Windows error of the system socket error.
+	int GetSocketError(_In_ int error) noexcept
+	{
+		switch (error)
+		{
+			case EAGAIN:				return WSAEWOULDBLOCK;
+			case EALREADY:			return WSAEALREADY;
+			case EAFNOSUPPORT:	return WSAEAFNOSUPPORT;
+			case ECONNABORTED:	return WSAECONNABORTED;
+			case EPIPE:
+			case ECONNRESET:		return WSAECONNRESET;
+			case ECONNREFUSED:	return WSAECONNREFUSED;
+		}
+
+		return 10000 + error;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int send(SOCKET socket, const char* data, int size, int flags)
+{
+	auto sent = ::send(static_cast<int>(socket), static_cast<const void*>(data), static_cast<size_t>(size), flags | MSG_NOSIGNAL);
+	if (sent < 0)
+	{
+		t_SocketError = GetSocketError(errno);
+		return SOCKET_ERROR;
+	}
+
+	return static_cast<int>(sent);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int recv(SOCKET socket, char* data, int size, int flags)
+{
+	auto received = ::recv(static_cast<int>(socket), static_cast<void*>(data), static_cast<size_t>(size), flags);
+	if (received < 0)
+	{
+		t_SocketError = GetSocketError(errno);
+		return SOCKET_ERROR;
+	}
+
+	return static_cast<int>(received);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int closesocket(SOCKET socket)
+{
+	auto& state = GetState();
+	{
+		std::lock_guard<std::mutex> lock(state.m_SocketsMutex);
+		state.m_Connected.erase(static_cast<int>(socket));
+	}
+
+	return ::close(static_cast<int>(socket)) == 0 ? 0 : SOCKET_ERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int WSAGetLastError()
+{
+	return t_SocketError;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int WSAEnumNetworkEvents(SOCKET socket, HANDLE event, WSANETWORKEVENTS* events)
+{
+	auto& state = GetState();
+	auto	fd		= pollfd{ static_cast<int>(socket), POLLIN | POLLOUT, 0 };
+
+	std::memset(events, 0, sizeof(*events));
+
+	if (event)
+		ResetEvent(event);
+
+	if (::poll(&fd, 1, 0) < 0 || (fd.revents & POLLNVAL))
+	{
+		t_SocketError = GetSocketError(fd.revents & POLLNVAL ? EBADF : errno);
+		return SOCKET_ERROR;
+	}
+
+	// The pairs are connected at once, so the connect is reported by the first writable state.
+	if (fd.revents & POLLOUT)
+	{
+		std::lock_guard<std::mutex> lock(state.m_SocketsMutex);
+
+		if (state.m_Connected.insert(fd.fd).second)
+			events->lNetworkEvents |= FD_CONNECT;
+	}
+
+	if (fd.revents & POLLIN)
+		events->lNetworkEvents |= FD_READ;
+
+	if (fd.revents & POLLOUT)
+		events->lNetworkEvents |= FD_WRITE;
+
+	if (fd.revents & (POLLHUP | POLLERR))
+		events->lNetworkEvents |= FD_CLOSE;
+
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* inet_ntop(int family, const void* address, char* buffer, size_t size)
+{
+	if (family != G_FAMILY_INET_ && family != G_FAMILY_INET6_)
+		return nullptr;
+
+	return ::inet_ntop(family == G_FAMILY_INET_ ? AF_INET : AF_INET6, address, buffer, static_cast<socklen_t>(size));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HANDLE CreateEventW(void* attributes, BOOL manualReset, BOOL initialState, const wchar_t* name)
+{
+	return new Object{ manualReset != FALSE, initialState != FALSE };
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HANDLE OpenProcess(DWORD access, BOOL inherit, DWORD pid)
+{
+	return new Object{ true, false };
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BOOL SetEvent(HANDLE event)
+{
+	auto& state		= GetState();
+	auto	object	= GetObject(event);
+
+	if (!object)
+		return FALSE;
+
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	Signal(state, *object);
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BOOL ResetEvent(HANDLE event)
+{
+	auto& state		= GetState();
+	auto	object	= GetObject(event);
+
+	if (!object)
+		return FALSE;
+
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	object->m_Signaled = false;
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BOOL CloseHandle(HANDLE handle)
+{
+	auto object = GetObject(handle);
+	if (!object)
+		return FALSE;
+
+	delete object;
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+DWORD WaitForSingleObject(HANDLE handle, DWORD timeout)
+{
+	return WaitForMultipleObjects(1, &handle, FALSE, timeout);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD timeout)
+{
+	auto& state		= GetState();
+	auto	objects = std::vector<Object*>(count);
+	auto	index		= DWORD{ 0 };
+
+	for (DWORD i = 0; i < count; ++i)
+	{
+		if (!(objects[i] = GetObject(handles[i])))
+			return WAIT_FAILED;
+	}
+
+	auto lock				= std::unique_lock<std::mutex>(state.m_Mutex);
+	auto satisfied	= [&]()
+	{
+		if (waitAll)
+		{
+			if (!std::all_of(objects.begin(), objects.end(), [](const Object* object) { return object->m_Signaled; }))
+				return false;
+
+			for (auto object : objects)
+				Acquire(*object);
+
+			return true;
+		}
+
+		for (index = 0; index < count; ++index)
+		{
+			if (Acquire(*objects[index]))
+				return true;
+		}
+
+		return false;
+	};
+
+	if (timeout == INFINITE)
+		state.m_Condition.wait(lock, satisfied);
+	else if (!state.m_Condition.wait_for(lock, std::chrono::milliseconds(timeout), satisfied))
+		return WAIT_TIMEOUT;
+
+	return WAIT_OBJECT_0 + (waitAll ? 0 : index);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+DWORD GetLastError()
+{
+	return t_LastError;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HANDLE CreateFileMappingW(HANDLE file, void* attributes, DWORD protect, DWORD sizeHigh, DWORD sizeLow, const wchar_t* name)
+{
+	auto& state = GetState();
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	auto section = name ? state.m_Sections[name].lock() : nullptr;
+
+	t_LastError = section ? ERROR_ALREADY_EXISTS : ERROR_SUCCESS;
+
+	if (!section)
+	{
+		auto size = (static_cast<uint64_t>(sizeHigh) << 32) | sizeLow;
+
+		section = std::make_shared<Section>(static_cast<size_t>((size + G_PAGE_SIZE_ - 1) / G_PAGE_SIZE_));
+
+		if (name)
+			state.m_Sections[name] = section;
+	}
+
+	return new Object{ true, false, { }, { }, section };
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HANDLE OpenFileMappingW(DWORD access, BOOL inherit, const wchar_t* name)
+{
+	auto& state = GetState();
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	auto iter			= state.m_Sections.find(name);
+	auto section	= iter == state.m_Sections.end() ? nullptr : iter->second.lock();
+
+	if (!section)
+	{
+		t_LastError = ERROR_FILE_NOT_FOUND;
+		return nullptr;
+	}
+
+	return new Object{ true, false, { }, { }, section };
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+PVOID MapViewOfFile(HANDLE section, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T size)
+{
+	auto& state		= GetState();
+	auto	object	= GetObject(section);
+
+	if (!object || !object->m_Section)
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	// The views of a section share its memory, so they have the same address.
+	auto view = static_cast<PVOID>(object->m_Section->data());
+
+	state.m_Views.emplace(view, object->m_Section);
+	return view;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BOOL UnmapViewOfFile(const void* view)
+{
+	auto& state = GetState();
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	auto iter = state.m_Views.find(view);
+	if (iter == state.m_Views.end())
+		return FALSE;
+
+	state.m_Views.erase(iter);
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+SIZE_T VirtualQuery(const void* address, MEMORY_BASIC_INFORMATION* information, SIZE_T size)
+{
+	auto& state = GetState();
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	auto iter = state.m_Views.find(address);
+	if (iter == state.m_Views.end())
+		return 0;
+
+	std::memset(information, 0, sizeof(*information));
+
+	information->BaseAddress	= const_cast<PVOID>(address);
+	information->RegionSize		= iter->second->size() * G_PAGE_SIZE_;
+
+	return sizeof(*information);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BOOL RegisterWaitForSingleObject(HANDLE* wait, HANDLE object, WAITORTIMERCALLBACK callback, PVOID context, ULONG timeout, ULONG flags)
+{
+	auto& state		= GetState();
+	auto	waited	= GetObject(object);
+
+	if (!waited)
+		return FALSE;
+
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	if (!state.m_Started)
+	{
+		for (size_t i = 0; i < G_POOL_THREADS_; ++i)
+			std::thread(&PoolThread).detach();
+
+		state.m_Started = true;
+	}
+
+	auto registered = new Wait{ waited, callback, context, timeout, (flags & WT_EXECUTEONLYONCE) != 0, false, false, false, { }, state.m_Timers.end() };
+
+	waited->m_Waits.push_back(registered);
+	Arm(state, *registered);
+
+	*wait = registered;
+	state.m_Condition.notify_all();
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BOOL UnregisterWaitEx(HANDLE wait, HANDLE completionEvent)
+{
+	auto& state				= GetState();
+	auto	registered	= static_cast<Wait*>(wait);
+	auto	lock				= std::unique_lock<std::mutex>(state.m_Mutex);
+	auto& waits				= registered->m_Object->m_Waits;
+
+	waits.erase(std::remove(waits.begin(), waits.end(), registered), waits.end());
+
+	if (registered->m_Timer != state.m_Timers.end())
+		state.m_Timers.erase(registered->m_Timer);
+
+	state.m_Fired.erase(std::remove_if(state.m_Fired.begin(), state.m_Fired.end(), [registered](const Fired& fired) {
+		return fired.m_Wait == registered;
+	}), state.m_Fired.end());
+
+	// The callback may release its own wait, it is deleted when the callback returns.
+	if (registered->m_Running && registered->m_Thread != std::this_thread::get_id() && completionEvent == INVALID_HANDLE_VALUE)
+		state.m_Condition.wait(lock, [registered] { return !registered->m_Running; });
+
+	if (registered->m_Running)
+		registered->m_Released = true;
+	else
+		delete registered;
+
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+HANDLE CreateIoCompletionPort(HANDLE file, HANDLE port, ULONG_PTR key, DWORD threads)
+{
+	return new Object{ true, false };
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BOOL PostQueuedCompletionStatus(HANDLE port, DWORD transferred, ULONG_PTR key, OVERLAPPED* overlapped)
+{
+	auto& state		= GetState();
+	auto	object	= GetObject(port);
+
+	if (!object)
+		return FALSE;
+
+	std::lock_guard<std::mutex> lock(state.m_Mutex);
+
+	object->m_Packets.push_back(Packet{ transferred, key, overlapped });
+	state.m_Condition.notify_all();
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+BOOL GetQueuedCompletionStatus(HANDLE port, DWORD* transferred, ULONG_PTR* key, OVERLAPPED** overlapped, DWORD timeout)
+{
+	auto& state		= GetState();
+	auto	object	= GetObject(port);
+
+	*overlapped = nullptr;
+
+	if (!object)
+		return FALSE;
+
+	auto lock				= std::unique_lock<std::mutex>(state.m_Mutex);
+	auto available	= [object] { return !object->m_Packets.empty(); };
+
+	if (timeout == INFINITE)
+		state.m_Condition.wait(lock, available);
+	else if (!state.m_Condition.wait_for(lock, std::chrono::milliseconds(timeout), available))
+	{
+		t_LastError = WAIT_TIMEOUT;
+		return FALSE;
+	}
+
+	auto packet = object->m_Packets.front();
+	object->m_Packets.pop_front();
+
+	*transferred	= packet.m_Transferred;
+	*key					= packet.m_Key;
+	*overlapped		= packet.m_Overlapped;
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool Testing::CreateSocketPair(_Out_ SOCKET (&sockets)[2], _In_ bool nonBlocking)
+{
+	int descriptors[2] = { -1, -1 };
+
+	if (::socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) != 0)
+		return false;
+
+	if (nonBlocking)
+		::fcntl(descriptors[0], F_SETFL, ::fcntl(descriptors[0], F_GETFL) | O_NONBLOCK);
+
+	sockets[0] = static_cast<SOCKET>(descriptors[0]);
+	sockets[1] = static_cast<SOCKET>(descriptors[1]);
+	return true;
+}
+#endif
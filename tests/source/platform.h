@@ -0,0 +1,234 @@
+#ifndef TESTS_PLATFORM_H_
+#define TESTS_PLATFORM_H_
+
+// Windows definitions used by the platform-neutral sources.
+// On other systems only the used subset is defined, with the Windows layouts,
+// so the tests build everywhere. The byte order helpers assume a little-endian host, as Windows.
+// The declared functions are emulated by platform.cpp: the events, the waits of the thread pool,
+// the completion ports and the sections run in the test process, the sockets are the system ones.
+// The process handles are events, which the tests signal to simulate the process exit.
+#ifdef _WIN32
+#	include <winsock2.h>
+#	include <ws2tcpip.h>
+#	include <Windows.h>
+#	include "winpipe/basepipe.hpp"
+#else
+#	define _In_
+#	define _In_opt_
+#	define _Out_
+#	define _Inout_
+#	define _Inout_opt_
+
+#	define VOID									void
+#	define CALLBACK
+#	define TRUE									1
+#	define FALSE								0
+#	define SOCKET_ERROR					(-1)
+#	define MAXDWORD							0xFFFFFFFF
+#	define INFINITE							0xFFFFFFFF
+#	define INVALID_HANDLE_VALUE	(reinterpret_cast<HANDLE>(-1))
+#	define SYNCHRONIZE					0x00100000
+#	define WT_EXECUTEONLYONCE		0x00000008
+#	define PAGE_READWRITE				0x04
+#	define FILE_MAP_WRITE				0x0002
+#	define FILE_MAP_READ				0x0004
+
+#	define ERROR_SUCCESS				0
+#	define ERROR_FILE_NOT_FOUND	2
+#	define ERROR_INVALID_HANDLE	6
+#	define ERROR_ALREADY_EXISTS	183
+#	define WAIT_OBJECT_0				0
+#	define WAIT_TIMEOUT					258
+#	define WAIT_FAILED					0xFFFFFFFF
+
+#	define WSAEWOULDBLOCK				10035
+#	define WSAEALREADY					10037
+#	define WSAEAFNOSUPPORT			10047
+#	define WSAECONNABORTED			10053
+#	define WSAECONNRESET				10054
+#	define WSAECONNREFUSED			10061
+
+#	define FD_READ							0x01
+#	define FD_WRITE							0x02
+#	define FD_CONNECT						0x10
+#	define FD_CLOSE							0x20
+#	define FD_CONNECT_BIT				4
+#	define FD_MAX_EVENTS				10
+
+using BYTE						= uint8_t;
+using WORD						= uint16_t;
+using DWORD						= uint32_t;
+using ULONG						= uint32_t;
+using ULONG_PTR				= uintptr_t;
+using SIZE_T					= size_t;
+using BOOL						= int;
+using BOOLEAN					= uint8_t;
+using PVOID						= void*;
+using HANDLE					= void*;
+using SOCKET					= uintptr_t;
+using ADDRESS_FAMILY	= uint16_t;
+
+// Callback of the thread pool waits.
+using WAITORTIMERCALLBACK = VOID (CALLBACK*)(PVOID context, BOOLEAN timedOut);
+
+// Overlapped operation, only carried by the completion packets.
+struct OVERLAPPED
+{
+	ULONG_PTR	Internal;
+	ULONG_PTR	InternalHigh;
+	PVOID			Pointer;
+	HANDLE		hEvent;
+};
+
+// Memory region of a section view, only its size is filled.
+struct MEMORY_BASIC_INFORMATION
+{
+	PVOID		BaseAddress;
+	PVOID		AllocationBase;
+	DWORD		AllocationProtect;
+	SIZE_T	RegionSize;
+	DWORD		State;
+	DWORD		Protect;
+	DWORD		Type;
+};
+
+// Network events of a socket.
+struct WSANETWORKEVENTS
+{
+	long	lNetworkEvents;
+	int		iErrorCode[FD_MAX_EVENTS];
+};
+
+// The system socket headers define their own address structures,
+// so platform.cpp, which calls the system sockets, skips these ones.
+#	ifndef TESTS_SYSTEM_SOCKETS_
+#		define AF_INET						2
+#		define AF_INET6						23
+#		define INET6_ADDRSTRLEN		65
+
+struct in_addr
+{
+	union
+	{
+		struct { BYTE s_b1, s_b2, s_b3, s_b4; }	S_un_b;
+		DWORD																		S_addr;
+	} S_un;
+};
+
+struct in6_addr
+{
+	union
+	{
+		BYTE	Byte[16];
+		WORD	Word[8];
+	} u;
+};
+
+struct sockaddr
+{
+	ADDRESS_FAMILY	sa_family;
+	char						sa_data[14];
+};
+
+struct sockaddr_in
+{
+	ADDRESS_FAMILY	sin_family;
+	WORD						sin_port;
+	in_addr					sin_addr;
+	char						sin_zero[8];
+};
+
+struct sockaddr_in6
+{
+	ADDRESS_FAMILY	sin6_family;
+	WORD						sin6_port;
+	DWORD						sin6_flowinfo;
+	in6_addr				sin6_addr;
+	DWORD						sin6_scope_id;
+};
+
+struct sockaddr_storage
+{
+	ADDRESS_FAMILY	ss_family;
+	char						ss_pad1[6];
+	int64_t					ss_align;
+	char						ss_pad2[112];
+};
+
+union SOCKADDR_INET
+{
+	sockaddr_in			Ipv4;
+	sockaddr_in6		Ipv6;
+	ADDRESS_FAMILY	si_family;
+};
+
+inline WORD htons(WORD value) noexcept {
+	return static_cast<WORD>((value << 8) | (value >> 8));
+}
+
+inline WORD ntohs(WORD value) noexcept {
+	return htons(value);
+}
+#	endif
+
+// Sockets.
+int send(SOCKET socket, const char* data, int size, int flags);
+int recv(SOCKET socket, char* data, int size, int flags);
+int closesocket(SOCKET socket);
+int WSAGetLastError();
+int WSAEnumNetworkEvents(SOCKET socket, HANDLE event, WSANETWORKEVENTS* events);
+const char* inet_ntop(int family, const void* address, char* buffer, size_t size);
+
+// Events and processes.
+HANDLE CreateEventW(void* attributes, BOOL manualReset, BOOL initialState, const wchar_t* name);
+HANDLE OpenProcess(DWORD access, BOOL inherit, DWORD pid);
+BOOL SetEvent(HANDLE event);
+BOOL ResetEvent(HANDLE event);
+BOOL CloseHandle(HANDLE object);
+DWORD WaitForSingleObject(HANDLE object, DWORD timeout);
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* objects, BOOL waitAll, DWORD timeout);
+DWORD GetLastError();
+
+// Sections. A named section is shared by the handles of the test process,
+// its memory is freed when the last handle is closed and the last view is unmapped.
+HANDLE CreateFileMappingW(HANDLE file, void* attributes, DWORD protect, DWORD sizeHigh, DWORD sizeLow, const wchar_t* name);
+HANDLE OpenFileMappingW(DWORD access, BOOL inherit, const wchar_t* name);
+PVOID MapViewOfFile(HANDLE section, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T size);
+BOOL UnmapViewOfFile(const void* view);
+SIZE_T VirtualQuery(const void* address, MEMORY_BASIC_INFORMATION* information, SIZE_T size);
+
+// Thread pool waits.
+BOOL RegisterWaitForSingleObject(HANDLE* wait, HANDLE object, WAITORTIMERCALLBACK callback, PVOID context, ULONG timeout, ULONG flags);
+BOOL UnregisterWaitEx(HANDLE wait, HANDLE completionEvent);
+
+// Completion ports.
+HANDLE CreateIoCompletionPort(HANDLE file, HANDLE port, ULONG_PTR key, DWORD threads);
+BOOL PostQueuedCompletionStatus(HANDLE port, DWORD transferred, ULONG_PTR key, OVERLAPPED* overlapped);
+BOOL GetQueuedCompletionStatus(HANDLE port, DWORD* transferred, ULONG_PTR* key, OVERLAPPED** overlapped, DWORD timeout);
+
+inline DWORD GetCurrentThreadId() noexcept {
+	return static_cast<DWORD>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+inline DWORD GetTickCount() noexcept {
+	return static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// The handle owner of winpipe/basepipe.hpp, which needs the Windows pipes.
+namespace WinPipe
+{
+	struct DefaultHandleDeleter
+	{
+		void operator()(_In_ HANDLE _Handle)
+		{
+			if (_Handle && _Handle != INVALID_HANDLE_VALUE)
+				CloseHandle(_Handle);
+		}
+	};
+
+	using WinHandle = std::unique_ptr<std::remove_pointer_t<HANDLE>, DefaultHandleDeleter>;
+	using WinError	= DWORD;
+}
+#endif
+
+#endif // !TESTS_PLATFORM_H_
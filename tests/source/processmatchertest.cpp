@@ -0,0 +1,167 @@
+#include "global.h"
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns true if the only pattern matches the name.
+	bool Matches(_In_ const std::string& pattern, _In_ const char* name) {
+		return ProcessMatcher({ pattern }).Match(name);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestLiterals()
+	{
+		// The names are compared without the case, as Windows does.
+		CHECK(Matches("Chrome.exe", "chrome.EXE"));
+		CHECK(Matches("chrome.exe", "CHROME.EXE"));
+		CHECK(!Matches("chrome.exe", "chrome.exe "));
+		CHECK(!Matches("chrome.exe", "chrome"));
+		CHECK(Matches("", ""));
+		CHECK(!Matches("", "a"));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestWildcards()
+	{
+		// '*' matches any sequence, the empty one too.
+		CHECK(Matches("*", ""));
+		CHECK(Matches("*", "any.exe"));
+		CHECK(Matches("*.exe", ".exe"));
+		CHECK(Matches("*.EXE", "steam.exe"));
+		CHECK(Matches("steam*", "SteamWebHelper.exe"));
+		CHECK(Matches("**", "a"));
+
+		// '?' matches exactly one character.
+		CHECK(Matches("fire?ox.exe", "Firefox.exe"));
+		CHECK(!Matches("fire?ox.exe", "firefx.exe"));
+		CHECK(!Matches("fire?ox.exe", "fireefox.exe"));
+		CHECK(Matches("???", "abc"));
+		CHECK(!Matches("???", "ab"));
+		CHECK(Matches("?*?", "ab"));
+		CHECK(!Matches("?*?", "a"));
+
+		// The middle segments are matched in order, without overlapping each other or the ends.
+		CHECK(Matches("a*b*c", "abc"));
+		CHECK(Matches("a*b*c", "aXXbYYc"));
+		CHECK(!Matches("a*b*c", "acb"));
+		CHECK(Matches("*ab*ab*", "abab"));
+		CHECK(!Matches("*ab*ab*", "aba"));
+		CHECK(!Matches("ab*ba", "aba"));
+		CHECK(Matches("*a?c*", "xxabcxx"));
+		CHECK(Matches("*x*x*x*", "axbxcxd"));
+		CHECK(!Matches("*x*x*x*", "axbxcd"));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestAnchors()
+	{
+		// The first and the last segments are anchored to the ends of the name.
+		CHECK(!Matches("chrome*", "xchrome.exe"));
+		CHECK(Matches("*chrome*", "xchrome.exe"));
+		CHECK(!Matches("*.exe", "setup.exe.bak"));
+		CHECK(Matches("*.exe*", "setup.exe.bak"));
+		CHECK(!Matches("a*", "ba"));
+		CHECK(!Matches("*a", "ab"));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestPatterns()
+	{
+		auto matcher	= ProcessMatcher({ "chrome.exe", "Chrome.exe", "*.exe", "chrom?.exe", "firefox.exe" });
+		auto matched	= std::vector<bool>();
+		auto indexes	= std::set<std::string>();
+		auto expected	= std::set<std::string>{ "chrome.exe", "Chrome.exe", "*.exe", "chrom?.exe" };
+
+		CHECK(matcher.GetCount() == 5);
+
+		// Every matched pattern is reported, the literals that differ only by the case too.
+		CHECK(matcher.Match("CHROME.exe", &matched));
+		CHECK(matched.size() == 5);
+
+		for (size_t i = 0; i < matched.size(); ++i)
+		{
+			if (matched[i])
+				indexes.insert(matcher.GetPattern(i));
+		}
+
+		CHECK(indexes == expected);
+
+		// The flags are kept over the names of a process table walk.
+		CHECK(!matcher.Match("chrome.dll", &matched));
+		CHECK(matcher.Match("firefox.exe", &matched));
+		CHECK(std::count(matched.begin(), matched.end(), true) == 5);
+
+		matched.clear();
+
+		CHECK(!matcher.Match("chrome.dll", &matched));
+		CHECK(std::none_of(matched.begin(), matched.end(), [](bool value) { return value; }));
+
+		CHECK(matcher.Match("notepad.exe"));
+		CHECK(!ProcessMatcher(std::unordered_set<std::string>()).Match("notepad.exe"));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Matches the synthetic process table of a busy host against the patterns of a large deployment.
+	void BenchmarkTable()
+	{
+		constexpr size_t G_NAMES_			= 50000;
+		constexpr size_t G_PATTERNS_	= 100;
+
+		auto random		= std::mt19937(7);
+		auto names		= std::vector<std::string>();
+		auto patterns = std::unordered_set<std::string>();
+		auto matched	= std::vector<bool>();
+		auto count		= size_t{ 0 };
+
+		// A quarter of the patterns of every kind: exact names, prefixes, suffixes and '?' in the middle.
+		for (size_t i = 0; i < G_PATTERNS_; ++i)
+		{
+			auto name = "App" + std::to_string(i * 37);
+
+			switch (i % 4)
+			{
+				case 0: patterns.insert(name + ".exe");										break;
+				case 1: patterns.insert(name + "*");											break;
+				case 2: patterns.insert("*" + name + ".EXE");							break;
+				case 3: patterns.insert("app?" + name.substr(4) + "*helper.exe");	break;
+			}
+		}
+
+		for (size_t i = 0; i < G_NAMES_; ++i)
+		{
+			auto name = "app" + std::to_string(random() % 4000);
+
+			if (i % 3 == 0)
+				name += "Helper";
+
+			names.push_back(name + ".exe");
+		}
+
+		auto matcher = ProcessMatcher(patterns);
+
+		Testing::Benchmark("ProcessMatcher, 100 patterns, every match of a name", G_NAMES_, [&](size_t i)
+		{
+			auto result = matcher.Match(names[i].c_str(), &matched);
+			count += result;
+
+			return result;
+		});
+
+		Testing::Benchmark("ProcessMatcher, 100 patterns, first match of a name", G_NAMES_, [&](size_t i) { return matcher.Match(names[i].c_str()); });
+
+		std::printf("ProcessMatcher: %zu of %zu names are matched.\n", count, G_NAMES_);
+		CHECK(count != 0 && count < G_NAMES_);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestLiterals();
+	TestWildcards();
+	TestAnchors();
+	TestPatterns();
+	BenchmarkTable();
+
+	return Testing::Finish("processmatchertest");
+}
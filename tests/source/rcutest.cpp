@@ -0,0 +1,112 @@
+#include "global.h"
+
+namespace
+{
+	// Published value. Its fields are consistent while it is alive and poisoned when it is released.
+	struct Value
+	{
+		long m_First;		// Publication number.
+		long m_Second;	// Twice the publication number.
+
+		// Poisons the fields, so a reader of a released value sees it.
+		~Value() {
+			m_First		= -1;
+			m_Second	= -1;
+		}
+	};
+
+	// Count of concurrent readers.
+	constexpr size_t G_READERS_ = 4;
+
+	// Count of publications while the readers run.
+	constexpr long G_PUBLICATIONS_ = 20000;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestEmpty()
+	{
+		auto pointer	= RcuPointer<Value>();
+		auto scope		= pointer.Read();
+
+		CHECK(scope.Get() == nullptr);
+		CHECK(scope.Share() == nullptr);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestShare()
+	{
+		auto pointer = RcuPointer<Value>();
+		pointer.Publish(std::make_shared<const Value>(Value{ 1, 2 }));
+
+		auto shared = pointer.Read().Share();
+		pointer.Publish(std::make_shared<const Value>(Value{ 2, 4 }));
+
+		// The shared value outlives the publication of the next one.
+		CHECK(shared->m_First == 1 && shared->m_Second == 2);
+		CHECK(pointer.Read()->m_First == 2);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestConcurrentReaders()
+	{
+		auto pointer	= RcuPointer<Value>();
+		auto stop			= std::atomic<bool>{ false };
+		auto torn			= std::atomic<size_t>{ 0 };
+		auto readers	= std::vector<std::thread>();
+
+		pointer.Publish(std::make_shared<const Value>(Value{ 0, 0 }));
+
+		for (size_t i = 0; i < G_READERS_; ++i)
+		{
+			readers.emplace_back([&]()
+			{
+				auto last = long{ 0 };
+
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					auto scope = pointer.Read();
+					auto first = scope->m_First;
+
+					std::this_thread::yield();
+
+					// The value stays alive and unchanged during the read section, and the values are published in order.
+					if (scope->m_First != first || scope->m_Second != first * 2 || first < last)
+						torn.fetch_add(1, std::memory_order_relaxed);
+
+					last = first;
+				}
+			});
+		}
+
+		for (long i = 1; i <= G_PUBLICATIONS_; ++i)
+			pointer.Publish(std::make_shared<const Value>(Value{ i, i * 2 }));
+
+		stop = true;
+
+		for (auto& reader : readers)
+			reader.join();
+
+		CHECK(torn.load() == 0);
+		CHECK(pointer.Read()->m_First == G_PUBLICATIONS_);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkRead()
+	{
+		auto pointer = RcuPointer<Value>();
+		pointer.Publish(std::make_shared<const Value>(Value{ 1, 2 }));
+
+		Testing::Benchmark("RcuPointer::Read", 10000000, [&](size_t) { return pointer.Read()->m_First; });
+		Testing::Benchmark("RcuPointer::Read + Share", 1000000, [&](size_t) { return pointer.Read().Share()->m_First; });
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestEmpty();
+	TestShare();
+	TestConcurrentReaders();
+	BenchmarkRead();
+
+	return Testing::Finish("rcutest");
+}
@@ -0,0 +1,7 @@
+#include "global.h"
+
+// The platform-neutral redirector sources. Their own global.h is skipped, see global.h.
+#include "routetable.cpp"
+#include "upstreambalancer.cpp"
+#include "handshakedriver.cpp"
+#include "reportqueue.cpp"
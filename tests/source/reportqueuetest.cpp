@@ -0,0 +1,231 @@
+#include "global.h"
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Batch writer that keeps the written ids. The writes block while the writer is held.
+	class Writer
+	{
+	public:
+		// Writes the batch.
+		// @param records - reports.
+		// @param count - count of reports.
+		// @returns the write result set by the test.
+		bool Write(_In_ const ReportRecord* records, _In_ size_t count)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			m_Condition.wait(lock, [this] { return !m_Held; });
+
+			for (size_t i = 0; i < count; ++i)
+				m_Ids.push_back(records[i].m_Id);
+
+			m_Batches++;
+			m_Condition.notify_all();
+			return m_Succeeded;
+		}
+
+		// Holds or releases the writes.
+		// @param held - true if the writes must wait.
+		void Hold(_In_ bool held)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Held = held;
+			}
+
+			m_Condition.notify_all();
+		}
+
+		// Sets the result of the next writes.
+		// @param succeeded - write result.
+		void SetResult(_In_ bool succeeded)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Succeeded = succeeded;
+		}
+
+		// Waits for the ids to be written.
+		// @param count - count of ids.
+		// @returns false if the ids are not written in time.
+		bool Wait(_In_ size_t count)
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			return m_Condition.wait_for(lock, std::chrono::seconds(10), [this, count] { return m_Ids.size() >= count; });
+		}
+
+		// Returns the written ids.
+		std::vector<WORD> GetIds()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Ids;
+		}
+
+		// Returns count of written batches.
+		size_t GetBatches()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Batches;
+		}
+
+	private:
+		std::mutex							m_Mutex;						// Locks the writer.
+		std::condition_variable	m_Condition;				// Signaled when the writer changes.
+		std::vector<WORD>				m_Ids;							// Written ids.
+		size_t									m_Batches = 0;			// Count of written batches.
+		bool										m_Held = false;			// true - the writes wait.
+		bool										m_Succeeded = true;	// Write result.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the queue writing into the writer.
+	std::unique_ptr<ReportQueue> MakeQueue(_In_ size_t capacity, _In_ Writer& writer)
+	{
+		return std::make_unique<ReportQueue>(capacity, [&writer](const ReportRecord* records, size_t count) { return writer.Write(records, count); });
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Waits for the queue to count the written reports, after the writer returns.
+	// @returns false if the reports are not written in time.
+	bool WaitWritten(_In_ const ReportQueue& queue, _In_ size_t count)
+	{
+		for (size_t i = 0; i < 10000 && queue.GetWritten() < count; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		return queue.GetWritten() == count;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestOrder()
+	{
+		auto writer = Writer();
+		auto queue	= MakeQueue(64, writer);
+		BYTE data[40] = { };
+
+		// The reports of a thread are written in order, the long data is truncated.
+		queue->SetPolicy(ReportPolicy::Block);
+
+		for (WORD id = 0; id < 1000; ++id)
+			CHECK(queue->Push(id, data, sizeof(data)));
+
+		CHECK(WaitWritten(*queue, 1000));
+
+		auto ids = writer.GetIds();
+		CHECK(ids.size() == 1000);
+
+		for (WORD id = 0; id < ids.size(); ++id)
+			CHECK(ids[id] == id);
+
+		CHECK(queue->GetDropped() == 0 && queue->GetLost() == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestPolicies()
+	{
+		for (auto policy : { ReportPolicy::DropNew, ReportPolicy::DropOldest })
+		{
+			auto writer = Writer();
+			auto queue	= MakeQueue(4, writer);
+
+			queue->SetPolicy(policy);
+			writer.Hold(true);
+
+			// The writer holds the first batch, the ring of 4 cells is filled by the next reports.
+			CHECK(queue->Push(0, nullptr, 0));
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+			for (WORD id = 1; id <= 10; ++id)
+				queue->Push(id, nullptr, 0);
+
+			CHECK(queue->GetDropped() == 6);
+
+			writer.Hold(false);
+			CHECK(writer.Wait(5));
+
+			// DropNew keeps the oldest reports, DropOldest keeps the newest ones.
+			auto ids			= writer.GetIds();
+			auto expected = policy == ReportPolicy::DropNew ? std::vector<WORD>{ 0, 1, 2, 3, 4 } : std::vector<WORD>{ 0, 7, 8, 9, 10 };
+
+			CHECK(ids == expected);
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestLost()
+	{
+		auto writer = Writer();
+		auto queue	= MakeQueue(64, writer);
+
+		// The reports of a failed write are counted as lost.
+		writer.SetResult(false);
+
+		CHECK(queue->Push(1, nullptr, 0));
+		CHECK(writer.Wait(1));
+
+		for (size_t i = 0; i < 1000 && queue->GetLost() == 0; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		CHECK(queue->GetLost() == 1 && queue->GetWritten() == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Pushes the reports from the app threads and waits until the drain thread writes all of them.
+	// @param threads - count of app threads.
+	void BenchmarkPushDrain(_In_ size_t threads)
+	{
+		constexpr size_t G_REPORTS_ = 1000000;
+
+		auto writer		= Writer();
+		auto queue		= MakeQueue(4096, writer);
+		auto report		= sockaddr_in6{ };
+		auto pushers	= std::vector<std::thread>();
+		auto count		= G_REPORTS_ / threads * threads;
+
+		// The app threads wait while the ring is full, so every report is written.
+		queue->SetPolicy(ReportPolicy::Block);
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (size_t thread = 0; thread < threads; ++thread)
+		{
+			pushers.emplace_back([&]()
+			{
+				for (size_t i = 0; i < G_REPORTS_ / threads; ++i)
+					queue->Push(AF_INET6, reinterpret_cast<const BYTE*>(&report), sizeof(report));
+			});
+		}
+
+		for (auto& pusher : pushers)
+			pusher.join();
+
+		CHECK(WaitWritten(*queue, count));
+
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::printf("ReportQueue, %zu pushing threads: %.1f M reports/s drained in %zu batches.\n", threads, count / elapsed / 1e6, writer.GetBatches());
+		CHECK(queue->GetDropped() == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkPush()
+	{
+		auto writer = Writer();
+		auto queue	= MakeQueue(4096, writer);
+		auto report = sockaddr_in{ };
+
+		Testing::Benchmark("ReportQueue::Push", 1000000, [&](size_t) { return queue->Push(AF_INET, reinterpret_cast<const BYTE*>(&report), sizeof(report)); });
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestOrder();
+	TestPolicies();
+	TestLost();
+	BenchmarkPushDrain(1);
+	BenchmarkPushDrain(4);
+	BenchmarkPush();
+
+	return Testing::Finish("reportqueuetest");
+}
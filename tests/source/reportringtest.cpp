@@ -0,0 +1,202 @@
+#include "global.h"
+
+namespace
+{
+	// Count of records of the tested rings.
+	constexpr uint32_t G_CAPACITY_ = 256;
+
+	// Count of records passed between the threads.
+	constexpr size_t G_RECORDS_ = 1000000;
+
+	// Count of records pushed or popped at once.
+	constexpr size_t G_BATCH_ = 64;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	ReportRecord MakeRecord(_In_ uint64_t index)
+	{
+		auto record = ReportRecord{ };
+
+		record.m_Id		= AF_INET;
+		record.m_Size = sizeof(index);
+
+		std::memcpy(record.m_Data, &index, sizeof(index));
+		return record;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	uint64_t GetIndex(_In_ const ReportRecord& record)
+	{
+		auto index = uint64_t{ 0 };
+
+		std::memcpy(&index, record.m_Data, sizeof(index));
+		return index;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestOpen()
+	{
+		auto size		= ReportRing::GetSize(G_CAPACITY_);
+		auto memory = Testing::AllocateShared(size);
+		auto failed = false;
+
+		// The capacity must be a power of two.
+		try { ReportRing(memory.get(), size, G_CAPACITY_ - 1); } catch (const std::runtime_error&) { failed = true; }
+		CHECK(failed);
+
+		// The memory without a ring is refused.
+		failed = false;
+		try { ReportRing(memory.get(), size); } catch (const std::runtime_error&) { failed = true; }
+		CHECK(failed);
+
+		auto producer = ReportRing(memory.get(), size, G_CAPACITY_);
+		auto consumer = ReportRing(memory.get(), size);
+
+		CHECK(consumer.GetCapacity() == G_CAPACITY_);
+
+		// The memory smaller than the ring is refused.
+		failed = false;
+		try { ReportRing(memory.get(), size - 1); } catch (const std::runtime_error&) { failed = true; }
+		CHECK(failed);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestPushPop()
+	{
+		auto size			= ReportRing::GetSize(G_CAPACITY_);
+		auto memory		= Testing::AllocateShared(size);
+		auto producer = ReportRing(memory.get(), size, G_CAPACITY_);
+		auto consumer = ReportRing(memory.get(), size);
+		auto records	= std::vector<ReportRecord>(G_CAPACITY_ + 10);
+
+		for (size_t i = 0; i < records.size(); ++i)
+			records[i] = MakeRecord(i);
+
+		// The full ring takes only the records it holds.
+		CHECK(producer.Push(records.data(), records.size()) == G_CAPACITY_);
+		CHECK(producer.Push(records.data(), 1) == 0);
+
+		auto popped = std::vector<ReportRecord>(records.size());
+
+		CHECK(consumer.Pop(popped.data(), 10) == 10);
+		CHECK(GetIndex(popped[0]) == 0 && GetIndex(popped[9]) == 9);
+
+		// The pushed records wrap around the end of the ring.
+		CHECK(producer.Push(records.data() + G_CAPACITY_, 10) == 10);
+		CHECK(consumer.Pop(popped.data(), popped.size()) == G_CAPACITY_);
+
+		for (size_t i = 0; i < G_CAPACITY_; ++i)
+			CHECK(GetIndex(popped[i]) == i + 10);
+
+		CHECK(consumer.Pop(popped.data(), popped.size()) == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestWait()
+	{
+		auto size			= ReportRing::GetSize(G_CAPACITY_);
+		auto memory		= Testing::AllocateShared(size);
+		auto producer = ReportRing(memory.get(), size, G_CAPACITY_);
+		auto consumer = ReportRing(memory.get(), size);
+		auto record		= MakeRecord(1);
+
+		// The producer wakes the waiting consumer once.
+		CHECK(!producer.TakeWaiting());
+		CHECK(consumer.PrepareWait());
+		CHECK(producer.Push(&record, 1) == 1);
+		CHECK(producer.TakeWaiting());
+		CHECK(!producer.TakeWaiting());
+
+		// The consumer does not sleep while the ring has records.
+		CHECK(!consumer.PrepareWait());
+		CHECK(!producer.TakeWaiting());
+
+		CHECK(consumer.Pop(&record, 1) == 1);
+		CHECK(consumer.PrepareWait());
+		consumer.CancelWait();
+		CHECK(!producer.TakeWaiting());
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestConcurrent()
+	{
+		auto size			= ReportRing::GetSize(G_CAPACITY_);
+		auto memory		= Testing::AllocateShared(size);
+		auto consumer = ReportRing(memory.get(), size, G_CAPACITY_);
+		auto start		= std::chrono::steady_clock::now();
+
+		auto thread = std::thread([&]()
+		{
+			auto producer = ReportRing(memory.get(), size);
+			auto batch		= std::array<ReportRecord, G_BATCH_>();
+
+			for (size_t pushed = 0; pushed < G_RECORDS_;)
+			{
+				auto count = (std::min)(batch.size(), G_RECORDS_ - pushed);
+
+				for (size_t i = 0; i < count; ++i)
+					batch[i] = MakeRecord(pushed + i);
+
+				for (size_t done = 0; done < count;)
+				{
+					auto added = producer.Push(batch.data() + done, count - done);
+					if (added == 0)
+						std::this_thread::yield();
+
+					done += added;
+				}
+
+				pushed += count;
+			}
+		});
+
+		auto batch		= std::array<ReportRecord, G_BATCH_>();
+		auto popped		= size_t{ 0 };
+		auto disorder = size_t{ 0 };
+
+		while (popped < G_RECORDS_)
+		{
+			auto count = consumer.Pop(batch.data(), batch.size());
+			if (count == 0)
+				std::this_thread::yield();
+
+			// The records come in the pushed order, none is lost or repeated.
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (GetIndex(batch[i]) != popped + i)
+					++disorder;
+			}
+
+			popped += count;
+		}
+
+		thread.join();
+
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		CHECK(disorder == 0);
+		std::printf("ReportRing: %.1f M records/s between two threads.\n", G_RECORDS_ / elapsed / 1e6);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkPushPop()
+	{
+		auto size			= ReportRing::GetSize(G_CAPACITY_);
+		auto memory		= Testing::AllocateShared(size);
+		auto ring			= ReportRing(memory.get(), size, G_CAPACITY_);
+		auto record		= MakeRecord(1);
+
+		Testing::Benchmark("ReportRing::Push + Pop", 10000000, [&](size_t) { return ring.Push(&record, 1) + ring.Pop(&record, 1); });
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestOpen();
+	TestPushPop();
+	TestWait();
+	TestConcurrent();
+	BenchmarkPushPop();
+
+	return Testing::Finish("reportringtest");
+}
@@ -0,0 +1,99 @@
+#include "global.h"
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the connection reports a session reads from its transport.
+	std::vector<ReportRecord> MakeRecords(_In_ size_t count)
+	{
+		auto records = std::vector<ReportRecord>(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto address = sockaddr_in{ };
+
+			address.sin_family	= AF_INET;
+			address.sin_port		= htons(static_cast<WORD>(i));
+
+			records[i].m_Id		= AF_INET;
+			records[i].m_Size = sizeof(address);
+			std::memcpy(records[i].m_Data, &address, sizeof(address));
+		}
+
+		return records;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestCapacity()
+	{
+		auto sink			= ReportSink(100);
+		auto records	= MakeRecords(250);
+
+		// A batch is queued with one lock, the reports past the capacity are dropped.
+		auto queued = sink.Push(1, records.data(), records.size());
+
+		CHECK(queued == 100);
+		CHECK(sink.GetDropped() == 150);
+
+		// The sink thread takes the whole queue, so the next report is queued.
+		auto taken = false;
+
+		for (size_t i = 0; i < 1000 && !taken; ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			taken = sink.Push(2, records.data(), 1) == 1;
+		}
+
+		CHECK(taken);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Replays the report batches of the sessions, as their transports hand them over.
+	// @param sessions - count of sessions pushing at once.
+	// @param batch - count of reports in a batch.
+	void BenchmarkReplay(_In_ size_t sessions, _In_ size_t batch)
+	{
+		constexpr size_t G_REPORTS_ = 2000000;
+
+		auto records	= MakeRecords(batch);
+		auto pushers	= std::vector<std::thread>();
+		auto queued		= std::atomic<size_t>{ 0 };
+		auto dropped	= size_t{ 0 };
+		auto start		= std::chrono::steady_clock::now();
+
+		{
+			auto sink = ReportSink(65536);
+
+			for (DWORD session = 0; session < sessions; ++session)
+			{
+				pushers.emplace_back([&, session]()
+				{
+					for (size_t i = 0; i < G_REPORTS_ / sessions / batch; ++i)
+						queued += sink.Push(session, records.data(), records.size());
+				});
+			}
+
+			for (auto& pusher : pushers)
+				pusher.join();
+
+			dropped = sink.GetDropped();
+		}
+
+		// The sink is destroyed when all the queued reports are logged.
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::printf("ReportSink, %zu sessions, batches of %zu: %.1f M reports/s queued and logged, %zu dropped.\n", sessions, batch, queued.load() / elapsed / 1e6, dropped);
+		CHECK(queued.load() + dropped == G_REPORTS_ / sessions / batch * sessions * batch);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestCapacity();
+	BenchmarkReplay(1, 1);
+	BenchmarkReplay(1, 64);
+	BenchmarkReplay(16, 64);
+
+	return Testing::Finish("reportsinktest");
+}
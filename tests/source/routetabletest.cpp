@@ -0,0 +1,148 @@
+#include "global.h"
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	BaseConfigManager::Rule MakeRule(_In_ std::initializer_list<BYTE> address, _In_ BYTE length, _In_ WORD portFirst, _In_ WORD portLast, _In_ RuleAction action)
+	{
+		auto rule = BaseConfigManager::Rule{ };
+
+		rule.m_Family				= address.size() == 4 ? AF_INET : AF_INET6;
+		rule.m_PrefixLength = length;
+		rule.m_PortFirst		= portFirst;
+		rule.m_PortLast			= portLast;
+		rule.m_Action				= action;
+
+		std::copy(address.begin(), address.end(), rule.m_Address);
+		return rule;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	sockaddr_in MakeV4(_In_ std::array<BYTE, 4> address, _In_ WORD port)
+	{
+		auto result = sockaddr_in{ };
+
+		result.sin_family = AF_INET;
+		result.sin_port		= htons(port);
+
+		std::memcpy(&result.sin_addr, address.data(), address.size());
+		return result;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	sockaddr_in6 MakeV6(_In_ std::array<BYTE, 16> address, _In_ WORD port)
+	{
+		auto result = sockaddr_in6{ };
+
+		result.sin6_family	= AF_INET6;
+		result.sin6_port		= htons(port);
+
+		std::memcpy(&result.sin6_addr, address.data(), address.size());
+		return result;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	template <typename Address>
+	RuleAction Match(_In_ const RouteTable& table, _In_ const Address& address) {
+		return table.Match(reinterpret_cast<const sockaddr*>(&address));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestMatch()
+	{
+		auto rules = BaseConfigManager::Rules
+		{
+			MakeRule({ 10, 0, 0, 0 }, 8, 0, USHRT_MAX, RuleAction::Direct),
+			MakeRule({ 10, 1, 0, 0 }, 16, 443, 443, RuleAction::Block),
+			MakeRule({ 10, 1, 0, 0 }, 16, 0, USHRT_MAX, RuleAction::Proxy),
+			MakeRule({ 10, 1, 2, 0 }, 24, 8000, 8080, RuleAction::Block),
+			MakeRule({ 192, 168, 1, 128 }, 25, 0, USHRT_MAX, RuleAction::Block),
+			MakeRule({ 127, 0, 0, 0 }, 8, 0, USHRT_MAX, RuleAction::Proxy),
+			MakeRule({ 0xFD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 8, 0, USHRT_MAX, RuleAction::Direct),
+			MakeRule({ 1, 2, 3, 4 }, 33, 0, USHRT_MAX, RuleAction::Block)
+		};
+
+		auto table = RouteTable(rules);
+
+		// The invalid rule is skipped, the loopback rules are added.
+		CHECK(table.Size() == rules.size() - 1 + 2);
+
+		// The longest prefix wins, and its rules are checked in order.
+		CHECK(Match(table, MakeV4({ 10, 2, 3, 4 }, 80)) == RuleAction::Direct);
+		CHECK(Match(table, MakeV4({ 10, 1, 3, 4 }, 443)) == RuleAction::Block);
+		CHECK(Match(table, MakeV4({ 10, 1, 3, 4 }, 80)) == RuleAction::Proxy);
+		CHECK(Match(table, MakeV4({ 10, 1, 2, 3 }, 8000)) == RuleAction::Block);
+
+		// The port is out of the /24 range, the /16 rules are checked.
+		CHECK(Match(table, MakeV4({ 10, 1, 2, 3 }, 443)) == RuleAction::Block);
+		CHECK(Match(table, MakeV4({ 10, 1, 2, 3 }, 80)) == RuleAction::Proxy);
+
+		CHECK(Match(table, MakeV4({ 192, 168, 1, 200 }, 1)) == RuleAction::Block);
+		CHECK(Match(table, MakeV4({ 192, 168, 1, 100 }, 1)) == RuleAction::Proxy);
+		CHECK(Match(table, MakeV4({ 8, 8, 8, 8 }, 53)) == RuleAction::Proxy);
+		CHECK(Match(table, MakeV6({ 0xFD, 0x12, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }, 1)) == RuleAction::Direct);
+		CHECK(Match(table, MakeV6({ 0x20, 0x01, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }, 1)) == RuleAction::Proxy);
+
+		// The rule of the loopback prefix overrides the default one.
+		CHECK(Match(table, MakeV4({ 127, 0, 0, 1 }, 5)) == RuleAction::Proxy);
+		CHECK(Match(table, MakeV6({ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }, 5)) == RuleAction::Direct);
+
+		// IPv4-mapped addresses are matched with the IPv4 rules.
+		CHECK(Match(table, MakeV6({ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 10, 2, 3, 4 }, 5)) == RuleAction::Direct);
+		CHECK(Match(table, MakeV6({ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 127, 0, 0, 1 }, 5)) == RuleAction::Proxy);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestEmpty()
+	{
+		auto table = RouteTable(BaseConfigManager::Rules());
+
+		CHECK(Match(table, MakeV4({ 127, 0, 0, 1 }, 80)) == RuleAction::Direct);
+		CHECK(Match(table, MakeV4({ 10, 0, 0, 1 }, 80)) == RuleAction::Proxy);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkMatch()
+	{
+		auto random = std::mt19937(1);
+
+		for (auto count : { size_t{ 10000 }, size_t{ 100000 } })
+		{
+			auto rules = BaseConfigManager::Rules();
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				auto address = static_cast<uint32_t>(random());
+				auto bytes	 = reinterpret_cast<const BYTE*>(&address);
+
+				rules.push_back(MakeRule({ bytes[0], bytes[1], bytes[2], bytes[3] }, static_cast<BYTE>(8 + random() % 25), 0, USHRT_MAX, RuleAction::Direct));
+			}
+
+			auto start		= std::chrono::steady_clock::now();
+			auto table		= RouteTable(rules);
+			auto elapsed	= std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			auto addresses = std::vector<sockaddr_in>(4096);
+			for (auto& address : addresses)
+			{
+				auto value = static_cast<uint32_t>(random());
+				address = MakeV4({ static_cast<BYTE>(value), static_cast<BYTE>(value >> 8), static_cast<BYTE>(value >> 16), static_cast<BYTE>(value >> 24) }, 80);
+			}
+
+			auto name = "RouteTable::Match, " + std::to_string(count) + " rules";
+			std::printf("RouteTable, %zu rules: compiled in %.1f ms.\n", count, elapsed);
+
+			Testing::Benchmark(name.c_str(), 1000000, [&](size_t i) { return Match(table, addresses[i % addresses.size()]) == RuleAction::Direct; });
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestMatch();
+	TestEmpty();
+	BenchmarkMatch();
+
+	return Testing::Finish("routetabletest");
+}
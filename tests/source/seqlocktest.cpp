@@ -0,0 +1,135 @@
+#include "global.h"
+
+namespace
+{
+	// Capacity of the tested buffers in bytes, not a multiple of the word size.
+	constexpr uint32_t G_CAPACITY_ = 1021;
+
+	// Count of writes while the readers run.
+	constexpr size_t G_WRITES_ = 20000;
+
+	// Count of concurrent readers.
+	constexpr size_t G_READERS_ = 3;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns data of the write: its size and every byte depend on the write number.
+	std::vector<uint8_t> MakeData(_In_ size_t write)
+	{
+		auto data = std::vector<uint8_t>(1 + write * 7 % G_CAPACITY_);
+
+		std::fill(data.begin(), data.end(), static_cast<uint8_t>(write));
+		return data;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestOpen()
+	{
+		auto size		= SharedSeqLock::GetSize(G_CAPACITY_);
+		auto memory = Testing::AllocateShared(size);
+
+		// The reader opens the buffer initialized by the writer and sees its writes.
+		auto writer = SharedSeqLock(memory.get(), size, G_CAPACITY_);
+		auto reader = SharedSeqLock(memory.get(), size);
+		auto data		= std::vector<uint8_t>();
+
+		CHECK(reader.GetCapacity() == G_CAPACITY_);
+		CHECK(reader.GetGeneration() == 0);
+		CHECK(reader.Read(data) == 0 && data.empty());
+
+		CHECK(writer.Write("config", 6));
+		CHECK(reader.Read(data) == 1 && std::string(data.begin(), data.end()) == "config");
+
+		// The data larger than the capacity is not written.
+		auto large = std::vector<uint8_t>(G_CAPACITY_ + 1);
+		CHECK(!writer.Write(large.data(), large.size()));
+		CHECK(reader.GetGeneration() == 1);
+
+		// The memory smaller than the buffer or without the buffer is refused.
+		auto failed = false;
+		try { SharedSeqLock(memory.get(), size - 1); } catch (const std::runtime_error&) { failed = true; }
+		CHECK(failed);
+
+		auto empty = Testing::AllocateShared(size);
+
+		failed = false;
+		try { SharedSeqLock(empty.get(), size); } catch (const std::runtime_error&) { failed = true; }
+		CHECK(failed);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestConcurrentReads()
+	{
+		auto size			= SharedSeqLock::GetSize(G_CAPACITY_);
+		auto memory		= Testing::AllocateShared(size);
+		auto writer		= SharedSeqLock(memory.get(), size, G_CAPACITY_);
+		auto stop			= std::atomic<bool>{ false };
+		auto torn			= std::atomic<size_t>{ 0 };
+		auto retried	= std::atomic<size_t>{ 0 };
+		auto readers	= std::vector<std::thread>();
+
+		for (size_t i = 0; i < G_READERS_; ++i)
+		{
+			readers.emplace_back([&]()
+			{
+				auto reader = SharedSeqLock(memory.get(), size);
+				auto data		= std::vector<uint8_t>();
+				auto last		= uint64_t{ 0 };
+
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					auto generation = uint64_t{ 0 };
+
+					if (!reader.TryRead(data, generation))
+					{
+						retried.fetch_add(1, std::memory_order_relaxed);
+						continue;
+					}
+
+					// A complete copy is the data of its generation, and the generations do not go back.
+					if (generation < last || (generation != 0 && data != MakeData(static_cast<size_t>(generation))))
+						torn.fetch_add(1, std::memory_order_relaxed);
+
+					last = generation;
+				}
+			});
+		}
+
+		for (size_t i = 1; i <= G_WRITES_; ++i)
+		{
+			auto data = MakeData(i);
+			writer.Write(data.data(), data.size());
+		}
+
+		stop = true;
+
+		for (auto& reader : readers)
+			reader.join();
+
+		CHECK(torn.load() == 0);
+		CHECK(writer.GetGeneration() == G_WRITES_);
+
+		std::printf("SharedSeqLock: %zu reads retried during %zu writes.\n", retried.load(), G_WRITES_);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkReadWrite()
+	{
+		auto size		= SharedSeqLock::GetSize(G_CAPACITY_);
+		auto memory = Testing::AllocateShared(size);
+		auto lock		= SharedSeqLock(memory.get(), size, G_CAPACITY_);
+		auto data		= std::vector<uint8_t>(G_CAPACITY_);
+
+		Testing::Benchmark("SharedSeqLock::Write, 1 KB", 200000, [&](size_t) { return lock.Write(data.data(), data.size()); });
+		Testing::Benchmark("SharedSeqLock::Read, 1 KB", 200000, [&](size_t) { return lock.Read(data); });
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestOpen();
+	TestConcurrentReads();
+	BenchmarkReadWrite();
+
+	return Testing::Finish("seqlocktest");
+}
@@ -0,0 +1,202 @@
+#include "global.h"
+
+namespace
+{
+	using Testing::MockSession;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Tracker whose sessions are completed by the test.
+	class MockTracker : public AbstractSessionTracker
+	{
+	public:
+		// MockTracker constructor.
+		MockTracker() :
+			m_Calls{ 0 },
+			m_TakenCall{ 0 }
+		{ }
+
+		// Tracks the session.
+		bool Track(_In_ DWORD id, _In_ HANDLE object) override
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Tracked.insert(id).second;
+		}
+
+		// Counts the untracked session.
+		void Untrack(_In_ DWORD id) override
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			m_Tracked.erase(id);
+			m_Untracked.push_back(id);
+		}
+
+		// Not waited for by the reaper.
+		bool WaitAll(_In_opt_ DWORD timeout = INFINITE) override {
+			return false;
+		}
+
+		// Takes a session completed by the test.
+		bool WaitAny(_Out_ DWORD& id, _In_opt_ DWORD timeout = INFINITE) override
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			// The previously taken session is handled when the reaper waits again.
+			m_Calls++;
+			m_Condition.notify_all();
+
+			if (!m_Condition.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return !m_Completed.empty(); }))
+				return false;
+
+			id = m_Completed.front();
+
+			m_Completed.pop_front();
+			m_TakenCall = m_Calls;
+
+			return true;
+		}
+
+		// Returns count of tracked sessions.
+		size_t GetRunning() const override
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Tracked.size();
+		}
+
+		// Completes the session.
+		// @param id - session id.
+		void Complete(_In_ DWORD id)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Completed.push_back(id);
+			}
+
+			m_Condition.notify_all();
+		}
+
+		// Waits for the reaper to handle all completed sessions.
+		// @returns false if the sessions are not handled in time.
+		bool WaitHandled()
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			return m_Condition.wait_for(lock, std::chrono::seconds(10), [this] { return m_Completed.empty() && m_Calls > m_TakenCall; });
+		}
+
+		// Returns ids of the untracked sessions.
+		std::vector<DWORD> GetUntracked()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			return m_Untracked;
+		}
+
+	private:
+		mutable std::mutex			m_Mutex;			// Locks the tracker.
+		std::condition_variable	m_Condition;	// Signaled when a session is completed or the reaper waits.
+		std::set<DWORD>					m_Tracked;		// Tracked sessions.
+		std::deque<DWORD>				m_Completed;	// Completed sessions not taken by the reaper.
+		std::vector<DWORD>			m_Untracked;	// Untracked sessions in order.
+		size_t									m_Calls;			// Count of WaitAny calls.
+		size_t									m_TakenCall;	// WaitAny call that took the last session.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Registers and tracks the session.
+	std::shared_ptr<MockSession> Add(_In_ SessionRegistry& sessions, _In_ MockTracker& tracker, _In_ DWORD id, _In_ size_t reports)
+	{
+		auto session = std::make_shared<MockSession>(id, reports);
+
+		CHECK(sessions.Insert(session, [](const std::shared_ptr<AbstractSession>&) { return true; }));
+		CHECK(tracker.Track(id, session->GetProcess().get()));
+
+		return session;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestReap()
+	{
+		auto sessions = SessionRegistry();
+		auto tracker	= MockTracker();
+		auto reaper		= SessionReaper(sessions, tracker);
+		auto first		= Add(sessions, tracker, 4, 10);
+		auto second		= Add(sessions, tracker, 8, 20);
+
+		// The session of an exited process is stopped, deleted and untracked.
+		first->Exit();
+		tracker.Complete(4);
+
+		CHECK(tracker.WaitHandled());
+		CHECK(first->GetStops() == 1 && second->GetStops() == 0);
+		CHECK(!sessions.Contains(4) && sessions.Contains(8));
+		CHECK(tracker.GetUntracked() == std::vector<DWORD>{ 4 });
+		CHECK(tracker.GetRunning() == 1);
+
+		second->Exit();
+		tracker.Complete(8);
+
+		CHECK(tracker.WaitHandled());
+		CHECK(sessions.Size() == 0 && tracker.GetRunning() == 0);
+
+		auto totals = reaper.GetTotals();
+		CHECK(totals.m_Sessions == 2 && totals.m_Reports == 30);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestReplaced()
+	{
+		auto sessions = SessionRegistry();
+		auto tracker	= MockTracker();
+		auto reaper		= SessionReaper(sessions, tracker);
+		auto first		= Add(sessions, tracker, 4, 10);
+
+		// The session of a new process with the same id replaces the completed one before it is reaped.
+		first->Exit();
+		tracker.Untrack(4);
+
+		auto second = Add(sessions, tracker, 4, 20);
+
+		tracker.Complete(4);
+
+		CHECK(tracker.WaitHandled());
+		CHECK(first->GetStops() == 0 && second->GetStops() == 0);
+		CHECK(sessions.Find(4) == second && tracker.GetRunning() == 1);
+
+		// A completed session that is not registered anymore is skipped.
+		tracker.Complete(12);
+
+		CHECK(tracker.WaitHandled());
+		CHECK(tracker.GetUntracked() == std::vector<DWORD>{ 4 });
+
+		auto totals = reaper.GetTotals();
+		CHECK(totals.m_Sessions == 0 && totals.m_Reports == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestStop()
+	{
+		auto sessions = SessionRegistry();
+		auto tracker	= MockTracker();
+		auto session	= Add(sessions, tracker, 4, 10);
+
+		// The reaper thread exits without reaping the running sessions.
+		{
+			auto reaper = SessionReaper(sessions, tracker);
+			CHECK(tracker.WaitHandled());
+		}
+
+		session->Exit();
+		tracker.Complete(4);
+
+		CHECK(session->GetStops() == 0 && sessions.Contains(4));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestReap();
+	TestReplaced();
+	TestStop();
+
+	return Testing::Finish("sessionreapertest");
+}
@@ -0,0 +1,127 @@
+#include "global.h"
+
+namespace
+{
+	using Testing::MockSession;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Inserts the session, the registered session of the same id is kept.
+	bool Insert(_In_ SessionRegistry& registry, _In_ const std::shared_ptr<AbstractSession>& session) {
+		return registry.Insert(session, [](const std::shared_ptr<AbstractSession>&) { return false; });
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestRegistry()
+	{
+		auto registry = SessionRegistry();
+		auto first		= std::make_shared<MockSession>(4);
+		auto second		= std::make_shared<MockSession>(4);
+
+		CHECK(Insert(registry, first));
+		CHECK(!Insert(registry, second));
+		CHECK(registry.Find(4) == first && registry.Contains(4) && registry.Size() == 1);
+		CHECK(registry.Find(8) == nullptr && !registry.Contains(8));
+
+		// The session of an exited process is replaced by the session of a new process with the same id.
+		first->Exit();
+
+		CHECK(registry.Insert(second, [](const std::shared_ptr<AbstractSession>& session) {
+			return WaitForSingleObject(session->GetProcess().get(), 0) == WAIT_OBJECT_0;
+		}));
+
+		CHECK(registry.Find(4) == second && registry.Size() == 1);
+
+		// The replaced session is not erased by its owner.
+		CHECK(!registry.Erase(4, first));
+		CHECK(registry.Erase(4, second));
+		CHECK(!registry.Erase(4));
+		CHECK(registry.Size() == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSnapshot()
+	{
+		auto registry = SessionRegistry();
+		auto ids			= std::set<DWORD>();
+
+		// Process ids are multiples of 4 and fill all the shards.
+		for (DWORD id = 4; id <= 4000; id += 4)
+			CHECK(Insert(registry, std::make_shared<MockSession>(id)));
+
+		auto snapshot = registry.GetSnapshot();
+
+		for (const auto& session : snapshot)
+			ids.insert(session->GetId());
+
+		CHECK(snapshot.size() == 1000 && ids.size() == 1000);
+		CHECK(*ids.begin() == 4 && *ids.rbegin() == 4000);
+
+		// The snapshot keeps the erased sessions alive.
+		for (DWORD id = 4; id <= 4000; id += 4)
+			CHECK(registry.Erase(id));
+
+		CHECK(registry.Size() == 0 && registry.GetSnapshot().empty());
+		CHECK(snapshot.front()->GetId() != 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Inserts, looks up and broadcasts to the sessions from the threads at once.
+	// Every thread owns its sessions, so the checks do not depend on the thread order.
+	// @param threads - count of threads.
+	void BenchmarkConcurrent(_In_ size_t threads)
+	{
+		constexpr size_t G_SESSIONS_		= 1000;
+		constexpr size_t G_OPERATIONS_	= 200000;
+
+		auto registry		= SessionRegistry();
+		auto sessions		= std::vector<std::shared_ptr<AbstractSession>>();
+		auto workers		= std::vector<std::thread>();
+		auto broadcasts = std::atomic<size_t>{ 0 };
+
+		for (size_t i = 0; i < G_SESSIONS_ * threads; ++i)
+			sessions.push_back(std::make_shared<MockSession>(static_cast<DWORD>((i + 1) * 4)));
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (size_t thread = 0; thread < threads; ++thread)
+		{
+			workers.emplace_back([&, thread]()
+			{
+				auto first = thread * G_SESSIONS_;
+
+				for (size_t i = 0; i < G_OPERATIONS_; ++i)
+				{
+					auto& session = sessions[first + i % G_SESSIONS_];
+
+					// Every 1000th operation is a broadcast, as a config update, the rest are lookups.
+					if (i < G_SESSIONS_)
+						CHECK(Insert(registry, session));
+					else if (i % 1000 == 0)
+						broadcasts += registry.GetSnapshot().size();
+					else
+						CHECK(registry.Find(session->GetId()) == session);
+				}
+			});
+		}
+
+		for (auto& worker : workers)
+			worker.join();
+
+		auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+		std::printf("SessionRegistry, %zu threads: %.1f ns/op, %zu sessions broadcast.\n", threads, elapsed / G_OPERATIONS_, broadcasts.load());
+		CHECK(registry.Size() == G_SESSIONS_ * threads);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestRegistry();
+	TestSnapshot();
+	BenchmarkConcurrent(1);
+	BenchmarkConcurrent(4);
+	BenchmarkConcurrent(8);
+
+	return Testing::Finish("sessionregistrytest");
+}
@@ -0,0 +1,130 @@
+#include "global.h"
+
+namespace
+{
+	// Count of tracked sessions, far more than a single wait call takes.
+	constexpr size_t G_SESSIONS_ = 10000;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the events standing for the session processes. The exit of a process is the signal of its event.
+	std::vector<HANDLE> MakeProcesses(_In_ size_t count)
+	{
+		auto processes = std::vector<HANDLE>(count);
+
+		for (auto& process : processes)
+			process = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+		return processes;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestTrack()
+	{
+		auto processes	= MakeProcesses(G_SESSIONS_);
+		auto completed	= std::set<DWORD>();
+		auto id					= DWORD{ 0 };
+
+		{
+			auto tracker = SessionTracker();
+
+			for (DWORD i = 0; i < G_SESSIONS_; ++i)
+				CHECK(tracker.Track(i, processes[i]));
+
+			// A session is tracked once.
+			CHECK(!tracker.Track(0, processes[0]));
+			CHECK(tracker.GetRunning() == G_SESSIONS_);
+			CHECK(!tracker.WaitAll(10));
+			CHECK(!tracker.WaitAny(id, 10));
+
+			// The exited processes complete their sessions.
+			for (DWORD i = 0; i < G_SESSIONS_; i += 2)
+				SetEvent(processes[i]);
+
+			for (size_t i = 0; i < G_SESSIONS_ / 2; ++i)
+			{
+				if (CHECK(tracker.WaitAny(id, 10000)))
+					completed.insert(id);
+			}
+
+			CHECK(completed.size() == G_SESSIONS_ / 2 && std::all_of(completed.begin(), completed.end(), [](DWORD id) { return id % 2 == 0; }));
+			CHECK(tracker.GetRunning() == G_SESSIONS_ / 2);
+
+			// The untracked sessions are not running anymore and never complete.
+			for (DWORD i = 1; i < G_SESSIONS_; i += 4)
+				tracker.Untrack(i);
+
+			CHECK(tracker.GetRunning() == G_SESSIONS_ / 4);
+
+			for (DWORD i = 1; i < G_SESSIONS_; i += 2)
+				SetEvent(processes[i]);
+
+			CHECK(tracker.WaitAll(10000));
+			CHECK(tracker.GetRunning() == 0);
+
+			completed.clear();
+
+			while (tracker.WaitAny(id, 0))
+				completed.insert(id);
+
+			CHECK(completed.size() == G_SESSIONS_ / 4 && std::all_of(completed.begin(), completed.end(), [](DWORD id) { return id % 4 == 3; }));
+		}
+
+		for (auto process : processes)
+			CloseHandle(process);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestDestroy()
+	{
+		auto processes = MakeProcesses(G_SESSIONS_);
+
+		// The running sessions are untracked by the destroyed tracker, while they complete.
+		{
+			auto tracker = SessionTracker();
+
+			for (DWORD i = 0; i < G_SESSIONS_; ++i)
+				CHECK(tracker.Track(i, processes[i]));
+
+			for (size_t i = 0; i < G_SESSIONS_; i += 3)
+				SetEvent(processes[i]);
+		}
+
+		for (auto process : processes)
+			CloseHandle(process);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkLifetime()
+	{
+		auto processes	= MakeProcesses(G_SESSIONS_);
+		auto tracker		= SessionTracker();
+		auto id					= DWORD{ 0 };
+
+		// A session is tracked, its process exits and the reaper takes it.
+		Testing::Benchmark("SessionTracker session lifetime", G_SESSIONS_, [&](size_t i)
+		{
+			tracker.Track(static_cast<DWORD>(i), processes[i]);
+			SetEvent(processes[i]);
+
+			return tracker.WaitAny(id, 10000) && id == i;
+		});
+
+		CHECK(tracker.GetRunning() == 0);
+
+		for (size_t i = 0; i < G_SESSIONS_; ++i)
+			tracker.Untrack(static_cast<DWORD>(i));
+
+		for (auto process : processes)
+			CloseHandle(process);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestTrack();
+	TestDestroy();
+	BenchmarkLifetime();
+
+	return Testing::Finish("sessiontrackertest");
+}
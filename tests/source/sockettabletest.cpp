@@ -0,0 +1,117 @@
+#include "global.h"
+
+namespace
+{
+	// Socket state.
+	struct State
+	{
+		size_t	m_Updates;	// Count of updates.
+		bool		m_Flag;			// Any flag.
+	};
+
+	// Count of threads updating the table at once.
+	constexpr size_t G_THREADS_ = 4;
+
+	// Count of sockets of every thread.
+	constexpr size_t G_SOCKETS_ = 1024;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSingleSocket()
+	{
+		auto table	= SocketTable<State>();
+		auto socket = SOCKET{ 0x104 };
+
+		CHECK(!table.Find(socket, [](State&) { }));
+		CHECK(!table.Erase(socket));
+
+		// A new socket state is default constructed.
+		CHECK(table.Update(socket, [](State& state) { return ++state.m_Updates; }) == 1);
+		CHECK(table.Update(socket, [](State& state) { state.m_Flag = true; return ++state.m_Updates; }) == 2);
+
+		auto found = State{ };
+		CHECK(table.Find(socket, [&](State& state) { found = state; }));
+		CHECK(found.m_Updates == 2 && found.m_Flag);
+		CHECK(table.Size() == 1);
+
+		CHECK(table.Erase(socket));
+		CHECK(table.Size() == 0);
+		CHECK(!table.Find(socket, [](State&) { }));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestConcurrentSockets()
+	{
+		auto table		= SocketTable<State>();
+		auto missing	= std::atomic<size_t>{ 0 };
+		auto threads	= std::vector<std::thread>();
+
+		// Socket handles are multiples of 4, every thread owns its sockets.
+		auto getSocket = [](size_t thread, size_t index) { return static_cast<SOCKET>((thread * G_SOCKETS_ + index + 1) * 4); };
+
+		for (size_t thread = 0; thread < G_THREADS_; ++thread)
+		{
+			threads.emplace_back([&, thread]()
+			{
+				for (size_t round = 0; round < 100; ++round)
+				{
+					for (size_t i = 0; i < G_SOCKETS_; ++i)
+						table.Update(getSocket(thread, i), [](State& state) { ++state.m_Updates; });
+
+					for (size_t i = 0; i < G_SOCKETS_; ++i)
+					{
+						if (!table.Find(getSocket(thread, i), [&](State& state) { state.m_Flag = state.m_Updates == round + 1; }))
+							missing.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+
+				// Every other socket is closed.
+				for (size_t i = 0; i < G_SOCKETS_; i += 2)
+					table.Erase(getSocket(thread, i));
+			});
+		}
+
+		for (auto& thread : threads)
+			thread.join();
+
+		CHECK(missing.load() == 0);
+		CHECK(table.Size() == G_THREADS_ * G_SOCKETS_ / 2);
+
+		for (size_t thread = 0; thread < G_THREADS_; ++thread)
+		{
+			for (size_t i = 1; i < G_SOCKETS_; i += 2)
+				CHECK(table.Find(getSocket(thread, i), [](State& state) { CHECK(state.m_Updates == 100 && state.m_Flag); }));
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkTable()
+	{
+		auto table = SocketTable<State>();
+
+		for (size_t i = 0; i < G_SOCKETS_; ++i)
+			table.Update(static_cast<SOCKET>((i + 1) * 4), [](State&) { });
+
+		Testing::Benchmark("SocketTable::Find", 10000000, [&](size_t i)
+		{
+			return table.Find(static_cast<SOCKET>((i % G_SOCKETS_ + 1) * 4), [](State& state) { ++state.m_Updates; });
+		});
+
+		Testing::Benchmark("SocketTable::Update + Erase", 1000000, [&](size_t i)
+		{
+			auto socket = static_cast<SOCKET>((G_SOCKETS_ + i % G_SOCKETS_ + 1) * 4);
+
+			table.Update(socket, [](State& state) { state.m_Flag = true; });
+			return table.Erase(socket);
+		});
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestSingleSocket();
+	TestConcurrentSockets();
+	BenchmarkTable();
+
+	return Testing::Finish("sockettabletest");
+}
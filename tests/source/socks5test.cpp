@@ -0,0 +1,214 @@
+#include "global.h"
+
+namespace
+{
+	// Socks5 greeting with the single NoAuth method.
+	constexpr BYTE G_GREETING_[] = { 0x05, 0x01, 0x00 };
+
+	// Size of the CONNECT request of an IPv4 target.
+	constexpr size_t G_REQUEST_SIZE_ = 10;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Stand-in socks5 server, serves one handshake on its end of a socket pair.
+	// A round trip is a read of the client bytes answered by one write.
+	class Server
+	{
+	public:
+		// Deleted default constructor.
+		Server() = delete;
+		// Waits for the handshake to finish.
+		~Server() {
+			Wait();
+		}
+		// Deleted copy constructor.
+		Server(const Server&) = delete;
+		// Deleted copy assigment.
+		Server& operator=(const Server&) = delete;
+
+		// Server constructor. Starts serving the handshake.
+		// @param socket - server end of the socket pair.
+		// @param rejectPipelined - true if the greeting followed by other bytes is rejected.
+		Server(_In_ SOCKET socket, _In_ bool rejectPipelined) :
+			m_Socket{ socket },
+			m_RejectPipelined{ rejectPipelined },
+			m_RoundTrips{ 0 },
+			m_Thread{ &Server::Serve, this }
+		{ }
+
+		// Waits for the handshake to finish.
+		// @returns count of round trips of the handshake.
+		size_t Wait()
+		{
+			if (m_Thread.joinable())
+				m_Thread.join();
+
+			return m_RoundTrips;
+		}
+
+	private:
+		// Server thread routine.
+		void Serve()
+		{
+			auto input		= std::vector<BYTE>();
+			auto greeted	= false;
+			auto done			= false;
+
+			while (!done)
+			{
+				BYTE	buffer[64];
+				auto	received	= recv(m_Socket, reinterpret_cast<char*>(buffer), sizeof(buffer), 0);
+				auto	output		= std::vector<BYTE>();
+
+				if (received == SOCKET_ERROR || received == 0)
+					return;
+
+				input.insert(input.end(), buffer, buffer + received);
+
+				if (!greeted && input.size() >= sizeof(G_GREETING_))
+				{
+					CHECK(std::equal(G_GREETING_, G_GREETING_ + sizeof(G_GREETING_), input.begin()));
+
+					// The rejected bytes are dropped, the client sends the greeting again.
+					if (m_RejectPipelined && input.size() > sizeof(G_GREETING_))
+					{
+						output	= { 0x05, 0xFF };
+						input.clear();
+					}
+					else
+					{
+						output	= { 0x05, 0x00 };
+						greeted	= true;
+						input.erase(input.begin(), input.begin() + sizeof(G_GREETING_));
+					}
+				}
+
+				if (greeted && input.size() >= G_REQUEST_SIZE_)
+				{
+					CHECK(input[0] == 0x05 && input[1] == 0x01 && input[3] == 0x01);
+
+					output.insert(output.end(), { 0x05, 0x00, 0x00, 0x01, 127, 0, 0, 1, 0x04, 0x38 });
+					done = true;
+				}
+
+				if (!output.empty())
+				{
+					CHECK(send(m_Socket, reinterpret_cast<const char*>(output.data()), static_cast<int>(output.size()), 0) == static_cast<int>(output.size()));
+					++m_RoundTrips;
+				}
+			}
+		}
+
+		SOCKET				m_Socket;						// Server end of the socket pair.
+		bool					m_RejectPipelined;	// true - the pipelined greeting is rejected.
+		size_t				m_RoundTrips;				// Count of round trips.
+		std::thread		m_Thread;						// Server thread.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns socks5 config. Every test uses its own proxy port, as the sequential proxies are shared.
+	BaseConfigManager::Config MakeConfig(_In_ WORD port, _In_ bool pipelining)
+	{
+		auto config = BaseConfigManager::Config{ };
+
+		config.m_ProxyType						= ProxyType::Socks5;
+		config.m_ProxyV4.sin_family		= AF_INET;
+		config.m_ProxyV4.sin_port			= htons(port);
+		config.m_Socks5Pipelining			= pipelining;
+
+		return config;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Connects through the stand-in server with the blocking handshake.
+	// @param roundTrips - count of round trips of the handshake.
+	// @returns true if the handshake is complete.
+	bool Connect(_In_ const BaseConfigManager::Config& config, _In_ bool rejectPipelined, _Out_ size_t& roundTrips)
+	{
+		SOCKET	sockets[2];
+		auto		target		= sockaddr_in{ };
+		auto		protocol	= SocksProtocol();
+		auto		complete	= false;
+
+		roundTrips = 0;
+
+		if (!CHECK(Testing::CreateSocketPair(sockets, false)))
+			return false;
+
+		target.sin_family	= AF_INET;
+		target.sin_port		= htons(80);
+
+		{
+			auto server = Server(sockets[1], rejectPipelined);
+
+			CHECK(protocol.Create(config, sockets[0], reinterpret_cast<const sockaddr*>(&target), AbstractSocks::SelectProxyAddress(config)));
+			complete = protocol.Request();
+
+			// The server finishes when the client end is closed.
+			closesocket(sockets[0]);
+			roundTrips = server.Wait();
+		}
+
+		closesocket(sockets[1]);
+		return complete;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestRoundTrips()
+	{
+		auto roundTrips = size_t{ 0 };
+
+		// The pipelined greeting and CONNECT request are answered in one round trip.
+		CHECK(Connect(MakeConfig(1, true), false, roundTrips));
+		CHECK(roundTrips == 1);
+
+		CHECK(Connect(MakeConfig(2, false), false, roundTrips));
+		CHECK(roundTrips == 2);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestFallback()
+	{
+		auto config			= MakeConfig(3, true);
+		auto roundTrips = size_t{ 0 };
+
+		// The rejected pipelined greeting is sent again alone on the same connection.
+		CHECK(Connect(config, true, roundTrips));
+		CHECK(roundTrips == 3);
+
+		// Next handshakes with the proxy are sequential from the start.
+		CHECK(Connect(config, true, roundTrips));
+		CHECK(roundTrips == 2);
+
+		// Other proxies still use the pipelined handshake.
+		CHECK(Connect(MakeConfig(4, true), false, roundTrips));
+		CHECK(roundTrips == 1);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestRejected()
+	{
+		auto config = MakeConfig(5, false);
+		auto target = sockaddr_in{ AF_INET };
+		auto socket = SOCKET{ 0 };
+		auto socks	= Socks5(config, socket, reinterpret_cast<const sockaddr*>(&target), AbstractSocks::SelectProxyAddress(config));
+		auto output = AbstractSocks::RequestFrame();
+
+		BYTE rejected[] = { 0x05, 0xFF };
+
+		// A sequential greeting is not retried.
+		CHECK(socks.Start(output));
+		CHECK(output.Size() == sizeof(G_GREETING_));
+		CHECK(socks.OnReply(rejected, output) == AbstractSocks::HandshakeStatus::Failed);
+		CHECK(output.Empty());
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestRoundTrips();
+	TestFallback();
+	TestRejected();
+
+	return Testing::Finish("socks5test");
+}
@@ -0,0 +1,272 @@
+#include "global.h"
+
+namespace
+{
+	using Status = AbstractSocks::HandshakeStatus;
+
+	// Socks5 method reply of the NoAuth method.
+	const std::vector<BYTE> G_METHOD_ = { 0x05, 0x00 };
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	BaseConfigManager::Config MakeConfig(_In_ ProxyType type, _In_ bool pipelining)
+	{
+		auto config = BaseConfigManager::Config{ };
+
+		config.m_ProxyType					= type;
+		config.m_ProxyV4.sin_family = AF_INET;
+		config.m_ProxyV4.sin_port		= htons(1080);
+		config.m_Socks5Pipelining		= pipelining;
+
+		return config;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the socks4 reply with the status.
+	std::vector<BYTE> MakeSocks4Reply(_In_ BYTE status) {
+		return { 0x00, status, 0x04, 0x38, 127, 0, 0, 1 };
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the pipelined socks5 replies with the bound address of the type.
+	// @param type - bound address type.
+	// @param address - bound address, the domain name is prefixed with its length.
+	std::vector<BYTE> MakeSocks5Reply(_In_ BYTE type, _In_ const std::vector<BYTE>& address)
+	{
+		auto reply = G_METHOD_;
+
+		reply.insert(reply.end(), { 0x05, 0x00, 0x00, type });
+		reply.insert(reply.end(), address.begin(), address.end());
+		reply.insert(reply.end(), { 0x04, 0x38 });
+
+		return reply;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Returns the bound domain name of the length, prefixed with the length.
+	std::vector<BYTE> MakeDomain(_In_ BYTE length)
+	{
+		auto domain = std::vector<BYTE>(length + 1, 'a');
+
+		domain[0] = length;
+		return domain;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Protocol started for an IPv4 target.
+	class Handshake
+	{
+	public:
+		// Handshake constructor. Starts the protocol.
+		// @param type - proxy type.
+		// @param pipelining - true if the socks5 request is pipelined.
+		Handshake(_In_ ProxyType type, _In_ bool pipelining) :
+			m_Config{ MakeConfig(type, pipelining) },
+			m_Socket{ 0 },
+			m_Target{ }
+		{
+			m_Target.sin_family = AF_INET;
+			m_Target.sin_port		= htons(80);
+
+			CHECK(m_Protocol.Create(m_Config, m_Socket, reinterpret_cast<const sockaddr*>(&m_Target), AbstractSocks::SelectProxyAddress(m_Config)));
+			CHECK(m_Protocol.Start(m_Output));
+		}
+
+		// Feeds the bytes to the protocol.
+		// @param data - received bytes.
+		// @param status - handshake status.
+		// @returns count of consumed bytes.
+		size_t Feed(_In_ const std::vector<BYTE>& data, _Out_ Status& status) {
+			return m_Protocol.Feed(data.data(), data.size(), m_Output, status);
+		}
+
+		// Feeds the bytes in two parts, as two reads would return them.
+		// Every part is read by the missing counts, so a read never takes bytes past the replies.
+		// @param data - received bytes.
+		// @param split - size of the first part.
+		// @returns handshake status.
+		Status FeedSplit(_In_ const std::vector<BYTE>& data, _In_ size_t split)
+		{
+			auto status = Status::Pending;
+			auto offset = size_t{ 0 };
+
+			for (auto end : { split, data.size() })
+			{
+				while (offset < end && status == Status::Pending)
+				{
+					auto missing = m_Protocol.Missing();
+					if (!CHECK(missing > 0 && missing <= AbstractSocks::MAX_REPLY_SIZE_))
+						return Status::Failed;
+
+					auto size			= (std::min)(missing, end - offset);
+					auto consumed = m_Protocol.Feed(data.data() + offset, size, m_Output, status);
+
+					CHECK(consumed == size);
+					offset += consumed;
+				}
+			}
+
+			return status;
+		}
+
+		// Returns protocol.
+		SocksProtocol& GetProtocol() noexcept {
+			return m_Protocol;
+		}
+
+		// Returns the frame to send.
+		const AbstractSocks::RequestFrame& GetOutput() const noexcept {
+			return m_Output;
+		}
+
+	private:
+		BaseConfigManager::Config		m_Config;		// Handshake config.
+		SOCKET											m_Socket;		// Not connected socket.
+		sockaddr_in									m_Target;		// Target app address.
+		SocksProtocol								m_Protocol;	// Tested protocol.
+		AbstractSocks::RequestFrame	m_Output;		// Frame to send.
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Feeds the reply split at every offset, the handshake is complete only with the last byte.
+	void CheckSplits(_In_ ProxyType type, _In_ const std::vector<BYTE>& reply)
+	{
+		for (size_t split = 0; split <= reply.size(); ++split)
+		{
+			auto handshake = Handshake(type, true);
+
+			CHECK(handshake.FeedSplit(reply, split) == Status::Complete);
+			CHECK(handshake.GetOutput().Empty());
+		}
+
+		// A reply short of a byte is pending.
+		auto handshake	= Handshake(type, true);
+		auto truncated	= std::vector<BYTE>(reply.begin(), reply.end() - 1);
+		auto status			= Status::Failed;
+
+		CHECK(handshake.Feed(truncated, status) == truncated.size());
+		CHECK(status == Status::Pending && handshake.GetProtocol().Missing() == 1);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSplits()
+	{
+		CheckSplits(ProxyType::Socks4, MakeSocks4Reply(90));
+		CheckSplits(ProxyType::Socks5, MakeSocks5Reply(0x01, { 127, 0, 0, 1 }));
+		CheckSplits(ProxyType::Socks5, MakeSocks5Reply(0x04, std::vector<BYTE>(16, 0xFE)));
+		CheckSplits(ProxyType::Socks5, MakeSocks5Reply(0x03, MakeDomain(11)));
+
+		// The longest bound domain name fits the reply frame.
+		CheckSplits(ProxyType::Socks5, MakeSocks5Reply(0x03, MakeDomain(UCHAR_MAX)));
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestOversized()
+	{
+		auto status = Status::Failed;
+
+		// The bytes after the final reply are not consumed, they are the app data.
+		for (auto [type, reply] : { std::make_pair(ProxyType::Socks4, MakeSocks4Reply(90)), std::make_pair(ProxyType::Socks5, MakeSocks5Reply(0x03, MakeDomain(3))) })
+		{
+			auto handshake	= Handshake(type, true);
+			auto oversized	= reply;
+
+			oversized.insert(oversized.end(), 100, 0xAA);
+
+			CHECK(handshake.Feed(oversized, status) == reply.size());
+			CHECK(status == Status::Complete);
+		}
+
+		// The bytes after a rejected reply are not consumed either.
+		auto handshake	= Handshake(ProxyType::Socks4, true);
+		auto rejected		= MakeSocks4Reply(91);
+
+		rejected.push_back(0xAA);
+
+		CHECK(handshake.Feed(rejected, status) == rejected.size() - 1);
+		CHECK(status == Status::Failed);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSequential()
+	{
+		auto handshake	= Handshake(ProxyType::Socks5, false);
+		auto reply			= MakeSocks5Reply(0x01, { 127, 0, 0, 1 });
+		auto status			= Status::Failed;
+
+		// Only the greeting is sent first.
+		CHECK(handshake.GetOutput().Size() == 3);
+		CHECK(handshake.GetProtocol().Missing() == G_METHOD_.size());
+
+		// The method reply stops the parsing, the CONNECT request must be sent before the next reply.
+		CHECK(handshake.Feed(reply, status) == G_METHOD_.size());
+		CHECK(status == Status::Pending && handshake.GetOutput().Size() == 10);
+
+		reply.erase(reply.begin(), reply.begin() + G_METHOD_.size());
+
+		CHECK(handshake.Feed(reply, status) == reply.size());
+		CHECK(status == Status::Complete && handshake.GetOutput().Empty());
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestFailedReplies()
+	{
+		auto status = Status::Pending;
+
+		// Socks4 rejections.
+		for (BYTE code : { 91, 92, 93, 0 })
+		{
+			auto handshake = Handshake(ProxyType::Socks4, true);
+
+			handshake.Feed(MakeSocks4Reply(code), status);
+			CHECK(status == Status::Failed);
+		}
+
+		// Socks5 rejected request, wrong version and unknown bound address type.
+		for (auto reply : { std::vector<BYTE>{ 0x05, 0x00, 0x05, 0x05, 0x00, 0x01 }, std::vector<BYTE>{ 0x05, 0x00, 0x04, 0x00, 0x00, 0x01 }, std::vector<BYTE>{ 0x05, 0x00, 0x05, 0x00, 0x00, 0x02 } })
+		{
+			auto handshake = Handshake(ProxyType::Socks5, false);
+
+			handshake.Feed(G_METHOD_, status);
+			CHECK(status == Status::Pending);
+
+			reply.erase(reply.begin(), reply.begin() + G_METHOD_.size());
+
+			CHECK(handshake.Feed(reply, status) == reply.size());
+			CHECK(status == Status::Failed);
+		}
+
+		// The empty protocol fails at once.
+		auto protocol = SocksProtocol();
+		auto output		= AbstractSocks::RequestFrame();
+
+		CHECK(protocol.Missing() == 0);
+		CHECK(protocol.Feed(G_METHOD_.data(), G_METHOD_.size(), output, status) == 0);
+		CHECK(status == Status::Failed);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkFeed()
+	{
+		auto reply = MakeSocks5Reply(0x04, std::vector<BYTE>(16, 0xFE));
+
+		Testing::Benchmark("SocksProtocol start and feed of socks5 IPv6 replies", 1000000, [&](size_t)
+		{
+			auto handshake	= Handshake(ProxyType::Socks5, true);
+			auto status			= Status::Pending;
+
+			return handshake.Feed(reply, status);
+		});
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestSplits();
+	TestOversized();
+	TestSequential();
+	TestFailedReplies();
+	BenchmarkFeed();
+
+	return Testing::Finish("socksfeedtest");
+}
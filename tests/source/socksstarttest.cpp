@@ -0,0 +1,120 @@
+#include "global.h"
+
+namespace
+{
+	// Count of allocations of the test process.
+	std::atomic<size_t> s_Allocations{ 0 };
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void* operator new(size_t size)
+{
+	s_Allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (auto memory = std::malloc(size ? size : 1))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	BaseConfigManager::Config MakeConfig(_In_ ProxyType type)
+	{
+		auto config = BaseConfigManager::Config{ };
+
+		config.m_ProxyType					= type;
+		config.m_ProxyV4.sin_family = AF_INET;
+		config.m_ProxyV4.sin_port		= htons(1080);
+		config.m_Socks5Pipelining		= true;
+
+		return config;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Creates the protocol and writes its first frame, as the hooked connect does.
+	// Prints the time of a start and checks that it does not allocate.
+	// @param name - benchmark name.
+	// @param type - proxy type.
+	// @param target - target app address.
+	// @param size - expected size of the first frame.
+	void BenchmarkStart(_In_ const char* name, _In_ ProxyType type, _In_ const sockaddr* target, _In_ size_t size)
+	{
+		auto config		= MakeConfig(type);
+		auto socket		= SOCKET{ 0 };
+		auto protocol = SocksProtocol();
+		auto output		= AbstractSocks::RequestFrame();
+
+		CHECK(protocol.Create(config, socket, target, AbstractSocks::SelectProxyAddress(config)));
+		CHECK(protocol.Start(output) && output.Size() == size);
+
+		auto allocations = s_Allocations.load();
+
+		Testing::Benchmark(name, 1000000, [&](size_t)
+		{
+			protocol.Create(config, socket, target, AbstractSocks::SelectProxyAddress(config));
+			protocol.Start(output);
+
+			return output.Size();
+		});
+
+		allocations = s_Allocations.load() - allocations;
+
+		std::printf("%s: %zu allocations.\n", name, allocations);
+		CHECK(allocations == 0);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkStarts()
+	{
+		auto v4 = sockaddr_in{ };
+		auto v6 = sockaddr_in6{ };
+
+		v4.sin_family		= AF_INET;
+		v4.sin_port			= htons(80);
+		v6.sin6_family	= AF_INET6;
+		v6.sin6_port		= htons(80);
+
+		BenchmarkStart("Socks4 start IPv4", ProxyType::Socks4, reinterpret_cast<const sockaddr*>(&v4), 9);
+		BenchmarkStart("Socks5 start IPv4", ProxyType::Socks5, reinterpret_cast<const sockaddr*>(&v4), 13);
+		BenchmarkStart("Socks5 start IPv6", ProxyType::Socks5, reinterpret_cast<const sockaddr*>(&v6), 25);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSocks4IPv6()
+	{
+		auto config		= MakeConfig(ProxyType::Socks4);
+		auto socket		= SOCKET{ 0 };
+		auto target		= sockaddr_in6{ };
+		auto protocol = SocksProtocol();
+		auto output		= AbstractSocks::RequestFrame();
+
+		target.sin6_family = AF_INET6;
+
+		// Socks4 supports only IPv4, the IPv6 start fails without a frame.
+		CHECK(protocol.Create(config, socket, reinterpret_cast<const sockaddr*>(&target), AbstractSocks::SelectProxyAddress(config)));
+		CHECK(!protocol.Start(output) && output.Empty());
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestSocks4IPv6();
+	BenchmarkStarts();
+
+	return Testing::Finish("socksstarttest");
+}
@@ -0,0 +1,90 @@
+#ifndef TESTS_TESTING_H_
+#define TESTS_TESTING_H_
+
+// Checks the condition. A failed check is printed and fails the test, the test goes on.
+#define CHECK(condition) Testing::Check((condition), #condition, __FILE__, __LINE__)
+
+namespace Testing
+{
+	// Cache line, the unit of the shared memory buffers.
+	struct alignas(64) CacheLine
+	{
+		uint8_t m_Data[64];	// Line bytes.
+	};
+
+	// Returns count of failed checks.
+	inline std::atomic<size_t>& GetFailures() noexcept
+	{
+		static std::atomic<size_t> failures{ 0 };
+		return failures;
+	}
+
+	// Counts the failed check. Called by CHECK, from any thread.
+	// @param passed - check result.
+	// @param condition - checked condition.
+	// @param file - source file.
+	// @param line - source line.
+	// @returns the check result.
+	inline bool Check(_In_ bool passed, _In_ const char* condition, _In_ const char* file, _In_ int line)
+	{
+		if (!passed)
+		{
+			GetFailures().fetch_add(1, std::memory_order_relaxed);
+			std::printf("%s(%d): check failed: %s\n", file, line, condition);
+		}
+
+		return passed;
+	}
+
+	// Returns zeroed memory aligned to the cache line, as the shared memory views are.
+	// @param size - size of the memory in bytes.
+	inline std::unique_ptr<CacheLine[]> AllocateShared(_In_ size_t size) {
+		return std::make_unique<CacheLine[]>((size + sizeof(CacheLine) - 1) / sizeof(CacheLine));
+	}
+
+	// Creates a pair of connected stream sockets. Defined in platform.cpp.
+	// @param sockets - connected sockets, closed with closesocket.
+	// @param nonBlocking - true if the first socket must be non-blocking.
+	// @returns false if the sockets are not created.
+	bool CreateSocketPair(_Out_ SOCKET (&sockets)[2], _In_ bool nonBlocking);
+
+	// Calls the function the count of times and prints the time of a call.
+	// @param name - benchmark name.
+	// @param iterations - count of calls.
+	// @param function - called with the iteration index, returns a value that is kept.
+	template <typename Function>
+	void Benchmark(_In_ const char* name, _In_ size_t iterations, _In_ Function&& function)
+	{
+		static volatile size_t sink = 0;
+
+		auto start		= std::chrono::steady_clock::now();
+		auto result		= size_t{ 0 };
+
+		for (size_t i = 0; i < iterations; ++i)
+			result += static_cast<size_t>(function(i));
+
+		auto elapsed	= std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+		sink = sink + result;
+		std::printf("%s: %.1f ns/op, %zu ops.\n", name, elapsed / iterations, iterations);
+	}
+
+	// Prints the test result.
+	// @param name - test name.
+	// @returns exit code of the test.
+	inline int Finish(_In_ const char* name)
+	{
+		auto failures = GetFailures().load();
+
+		if (failures != 0)
+		{
+			std::printf("%s: %zu checks failed.\n", name, failures);
+			return 1;
+		}
+
+		std::printf("%s: passed.\n", name);
+		return 0;
+	}
+}
+
+#endif // !TESTS_TESTING_H_
@@ -0,0 +1,190 @@
+#include "global.h"
+
+namespace
+{
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void SetV4(_Out_ SOCKADDR_INET& address, _In_ WORD port)
+	{
+		std::memset(&address, 0, sizeof(address));
+
+		address.Ipv4.sin_family = AF_INET;
+		address.Ipv4.sin_port		= htons(port);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void SetV6(_Out_ SOCKADDR_INET& address, _In_ WORD port)
+	{
+		std::memset(&address, 0, sizeof(address));
+
+		address.Ipv6.sin6_family	= AF_INET6;
+		address.Ipv6.sin6_port		= htons(port);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	WORD GetPort(_In_ const UpstreamBalancer::Upstream& upstream)
+	{
+		const auto address = upstream.GetAddress();
+
+		return ntohs(address->sa_family == AF_INET ? reinterpret_cast<const sockaddr_in*>(address)->sin_port : reinterpret_cast<const sockaddr_in6*>(address)->sin6_port);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	BaseConfigManager::Config MakeConfig()
+	{
+		auto config = BaseConfigManager::Config{ };
+
+		// The config proxy server is the upstream on port 1.
+		config.m_ProxyType								= ProxyType::Socks5;
+		config.m_ProxyV4.sin_family				= AF_INET;
+		config.m_ProxyV4.sin_port					= htons(1);
+		config.m_UpstreamsCount						= 3;
+		config.m_Upstreams[0].m_Weight		= 1;
+		config.m_Upstreams[1].m_Weight		= 1;
+		config.m_Upstreams[2].m_Weight		= 1;
+
+		SetV4(config.m_Upstreams[0].m_Address, 2);
+		SetV6(config.m_Upstreams[1].m_Address, 3);
+		SetV6(config.m_Upstreams[2].m_Address, 4);
+
+		return config;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Selects upstreams of the family, and counts the selections of every port.
+	std::map<WORD, size_t> Count(_In_ const UpstreamBalancer& balancer, _In_ int family, _In_ size_t selections)
+	{
+		auto counts = std::map<WORD, size_t>();
+
+		for (size_t i = 0; i < selections; ++i)
+		{
+			auto upstream = balancer.Select(family);
+			counts[upstream ? GetPort(*upstream) : 0]++;
+		}
+
+		return counts;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSelect()
+	{
+		auto probes		= std::atomic<size_t>{ 0 };
+		auto balancer = UpstreamBalancer([&](const sockaddr*) { probes++; return true; });
+
+		// There are no upstreams until the balancer is configured.
+		CHECK(balancer.Select(AF_INET) == nullptr);
+
+		balancer.Configure(MakeConfig());
+
+		// The new upstreams are probed right away. The next probes are seconds later.
+		for (size_t i = 0; i < 1000 && probes.load() < 4; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		CHECK(probes.load() == 4);
+
+		// Only the upstreams of the target family are selected.
+		auto v4 = Count(balancer, AF_INET, 1000);
+		auto v6 = Count(balancer, AF_INET6, 1000);
+
+		CHECK(v4.size() == 2 && v4.count(1) && v4.count(2));
+		CHECK(v6.size() == 2 && v6.count(3) && v6.count(4));
+
+		// An unhealthy upstream is skipped while the family has a healthy one.
+		auto unhealthy = std::shared_ptr<const UpstreamBalancer::Upstream>();
+		for (size_t i = 0; !unhealthy || GetPort(*unhealthy) != 3; ++i)
+			unhealthy = balancer.Select(AF_INET6);
+
+		for (size_t i = 0; i < 3; ++i)
+			UpstreamBalancer::Report(*unhealthy, std::chrono::microseconds(0), false);
+
+		v6 = Count(balancer, AF_INET6, 1000);
+		CHECK(v6.size() == 1 && v6.count(4));
+
+		// If all the upstreams of the family are down, any of them is used.
+		auto other = balancer.Select(AF_INET6);
+		for (size_t i = 0; i < 3; ++i)
+			UpstreamBalancer::Report(*other, std::chrono::microseconds(0), false);
+
+		v6 = Count(balancer, AF_INET6, 1000);
+		CHECK(v6.size() == 2 && v6.count(3) && v6.count(4));
+
+		// A successful handshake makes the upstream healthy again.
+		UpstreamBalancer::Report(*unhealthy, std::chrono::microseconds(100), true);
+
+		v6 = Count(balancer, AF_INET6, 1000);
+		CHECK(v6.size() == 1 && v6.count(3));
+
+		// The selected upstream stays valid after the balancer is reconfigured.
+		balancer.Configure(BaseConfigManager::Config{ });
+		CHECK(GetPort(*unhealthy) == 3);
+		CHECK(balancer.Select(AF_INET6) == nullptr);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestSingleUpstream()
+	{
+		auto balancer = UpstreamBalancer([](const sockaddr*) { return true; });
+		auto config		= MakeConfig();
+
+		config.m_UpstreamsCount = 0;
+		balancer.Configure(config);
+
+		// A single upstream is used even if it is unhealthy, but never for another family.
+		auto upstream = balancer.Select(AF_INET);
+		CHECK(upstream && GetPort(*upstream) == 1);
+		CHECK(balancer.Select(AF_INET6) == nullptr);
+
+		for (size_t i = 0; i < 3; ++i)
+			UpstreamBalancer::Report(*upstream, std::chrono::microseconds(0), false);
+
+		CHECK(balancer.Select(AF_INET) == upstream);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void TestLatency()
+	{
+		auto balancer	= UpstreamBalancer([](const sockaddr*) { return true; });
+		auto config		= MakeConfig();
+
+		config.m_UpstreamsCount = 1;
+		balancer.Configure(config);
+
+		auto fast = std::shared_ptr<const UpstreamBalancer::Upstream>();
+		auto slow = std::shared_ptr<const UpstreamBalancer::Upstream>();
+
+		while (!fast || !slow)
+		{
+			auto upstream = balancer.Select(AF_INET);
+			(GetPort(*upstream) == 1 ? fast : slow) = upstream;
+		}
+
+		for (size_t i = 0; i < 100; ++i)
+		{
+			UpstreamBalancer::Report(*fast, std::chrono::microseconds(1000), true);
+			UpstreamBalancer::Report(*slow, std::chrono::microseconds(50000), true);
+		}
+
+		// The faster upstream wins every pair it is picked into.
+		auto counts = Count(balancer, AF_INET, 10000);
+		CHECK(counts[1] > counts[2] * 2);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	void BenchmarkSelect()
+	{
+		auto balancer = UpstreamBalancer([](const sockaddr*) { return true; });
+		balancer.Configure(MakeConfig());
+
+		Testing::Benchmark("UpstreamBalancer::Select", 1000000, [&](size_t) { return GetPort(*balancer.Select(AF_INET)); });
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+	TestSelect();
+	TestSingleUpstream();
+	TestLatency();
+	BenchmarkSelect();
+
+	return Testing::Finish("upstreambalancertest");
+}
@@ -6,6 +6,8 @@
 #include <vector>
 #include <iostream>
 
+#include "codec.hpp"
+
 namespace WinPipe
 {
 	struct DefaultHandleDeleter
@@ -22,21 +24,16 @@ namespace WinPipe
 
 	class BaseNamedPipe
 	{
+	public:
+		// Default time in milliseconds a pipe I/O waits to complete.
 		static constexpr DWORD PIPE_WAIT_TIMEOUT_ = 10000;
 
-#		pragma pack(push, 1)
-		struct Message
-		{
-			WORD	id;
-			DWORD size;
-		};
-#		pragma pack(pop)
-
-	public:
 		// Deleted default constructor.
 		BaseNamedPipe() = delete;
-		// Default virtual destructor.
-		virtual ~BaseNamedPipe() = default;
+		// Cancels the pending read started by BeginRead.
+		virtual ~BaseNamedPipe() {
+			CancelRead();
+		}
 
 		// Deleted copy constructor.
 		BaseNamedPipe(const BaseNamedPipe&) = delete;
@@ -48,7 +45,9 @@ namespace WinPipe
 		// @param pipe - pipe handle. can be nullptr.
 		BaseNamedPipe(_In_ WinHandle& stopEvent, _In_opt_ WinHandle pipe = nullptr) :
 			m_PipeHandle{ std::move(pipe) },
-			m_StopEvent{ stopEvent }
+			m_StopEvent{ stopEvent },
+			m_ReadOverlapped{ 0 },
+			m_Reading{ false }
 		{ }
 
 		// Returns true if named pipe connected.
@@ -91,24 +90,34 @@ namespace WinPipe
 		// @reutnrs ERROR_SUCCESS if success.
 		WinError WriteMessage(_In_ WORD id, _In_ const BYTE* data, _In_ DWORD size)
 		{
-			auto dataToSend = std::vector<BYTE>();
-			auto header			= Message{ id, static_cast<uint32_t>(size) };
+			auto message = Codec::MessageView{ id, data, size };
+			return WriteMessages(&message, 1);
+		}
+
+		// Writes the messages to pipe with a single write.
+		// The write buffer is reused, so the pipe must have a single writer.
+		// @param messages - messages to send.
+		// @param count - count of messages.
+		// @reutnrs ERROR_SUCCESS if success.
+		WinError WriteMessages(_In_ const Codec::MessageView* messages, _In_ size_t count)
+		{
+			m_WriteBuffer.clear();
 
-			// Insert message header.
-			dataToSend.insert(
-				dataToSend.begin(),
-				reinterpret_cast<BYTE*>(&header), 
-				reinterpret_cast<BYTE*>(&header) + sizeof(header)
-			);
+			for (size_t i = 0; i < count; ++i)
+				Codec::Encode(m_WriteBuffer, messages[i].m_Id, messages[i].m_Data, messages[i].m_Size);
 
-			// Insert message data.
-			dataToSend.insert(
-				(dataToSend.begin() + sizeof(header)), 
-				data, 
-				data + size
-			);
+			return WriteRaw(m_WriteBuffer.data(), static_cast<DWORD>(m_WriteBuffer.size()));
+		}
 
-			return WriteRaw(dataToSend.data(), static_cast<DWORD>(dataToSend.size()));
+		// Appends the message to the buffer.
+		// Several appended messages can be written with a single WriteRaw
+		// and are read back one by one with ReadMessage.
+		// @param buffer - buffer to append to.
+		// @parma id - message id.
+		// @param data - message data.
+		// @param size - size of data.
+		static void AppendMessage(_Inout_ std::vector<BYTE>& buffer, _In_ WORD id, _In_ const BYTE* data, _In_ DWORD size) {
+			Codec::Encode(buffer, id, data, size);
 		}
 
 		// Allocates memory and reads the message from the pipe.
@@ -116,11 +125,13 @@ namespace WinPipe
 		// @parma id - message id.
 		// @param data - buffer.
 		// @param size - buffer size.
-		// @reutnrs ERROR_SUCCESS if success.
-		WinError ReadMessage(_Out_ WORD& id, _Out_ BYTE** data, _Out_ DWORD& size)
+		// @param timeout - time in milliseconds each read waits to complete. by default is PIPE_WAIT_TIMEOUT_.
+		// @reutnrs ERROR_SUCCESS if success, WAIT_TIMEOUT if the message did not come in time.
+		WinError ReadMessage(_Out_ WORD& id, _Out_ BYTE** data, _Out_ DWORD& size, _In_opt_ DWORD timeout = PIPE_WAIT_TIMEOUT_)
 		{
-			auto message	= Message{};
-			auto status		= Read(message);
+			auto message			= Codec::Header{};
+			auto transferred	= DWORD{ 0 };
+			auto status				= PipeIO(reinterpret_cast<BYTE*>(&message), sizeof(message), false, false, transferred, timeout);
 
 			id		= 0;
 			*data = nullptr;
@@ -129,7 +140,7 @@ namespace WinPipe
 			if (status == ERROR_SUCCESS) 
 			{
 				*data = new BYTE[message.size];
-				if ((status = ReadRaw(*data, message.size)) == ERROR_SUCCESS) 
+				if ((status = PipeIO(*data, message.size, false, false, transferred, timeout)) == ERROR_SUCCESS) 
 				{
 					id		= message.id;
 					size	= message.size;
@@ -141,58 +152,226 @@ namespace WinPipe
 			return status;
 		}
 
+		// Reads the messages available in the pipe.
+		// Reads as many bytes as the pipe has with a single read and hands out the complete
+		// messages as views into the read buffer, so the message data is neither allocated nor copied.
+		// Reads ahead, so it must not be mixed with the other reads on the same pipe.
+		// @param function - called with const Codec::MessageView&, the view is valid until the call returns.
+		// Returns false if the message is not taken, it is handed out again by the next call.
+		// The first message must be taken.
+		// @reutnrs ERROR_SUCCESS if at least one message is taken.
+		template <typename Function>
+		WinError ReadMessages(_In_ Function&& function)
+		{
+			while (m_Decoder.Decode(function) == 0)
+			{
+				auto free		= size_t{ 0 };
+				auto buffer = m_Decoder.Prepare(free);
+
+				if (!buffer)
+					return ERROR_INVALID_DATA;
+
+				auto transferred	= DWORD{ 0 };
+				auto status				= PipeIO(buffer, static_cast<DWORD>(free), false, true, transferred);
+
+				m_Decoder.Commit(transferred);
+
+				if (status != ERROR_SUCCESS)
+					return status;
+			}
+
+			return ERROR_SUCCESS;
+		}
+
+		// Starts reading the available bytes without blocking, for the event loops.
+		// The read bytes are buffered and handed out by DecodeMessages, so the same
+		// rules as for ReadMessages apply. Starting a read while one is pending does nothing.
+		// @param event - event signaled when the read is complete.
+		// @reutnrs ERROR_SUCCESS if the read is started.
+		WinError BeginRead(_Out_ HANDLE& event)
+		{
+			event = nullptr;
+
+			// Creating overlapped event.
+			if (!m_ReadEvent.get())
+			{
+				m_ReadEvent = WinHandle(CreateEventW(nullptr, true, false, nullptr));
+				if (!m_ReadEvent.get())
+					return GetLastError();
+			}
+
+			event = m_ReadEvent.get();
+
+			if (m_Reading)
+				return ERROR_SUCCESS;
+
+			auto free		= size_t{ 0 };
+			auto buffer = m_Decoder.Prepare(free);
+
+			if (!buffer)
+				return ERROR_INVALID_DATA;
+
+			m_ReadOverlapped				= OVERLAPPED{ 0 };
+			m_ReadOverlapped.hEvent = m_ReadEvent.get();
+
+			// The event is signaled even if the read completes at once.
+			if (!ReadFile(m_PipeHandle.get(), buffer, static_cast<DWORD>(free), nullptr, &m_ReadOverlapped))
+			{
+				auto status = GetLastError();
+				if (status != ERROR_IO_PENDING)
+					return status;
+			}
+
+			m_Reading = true;
+			return ERROR_SUCCESS;
+		}
+
+		// Completes the read started by BeginRead without blocking.
+		// @reutnrs ERROR_SUCCESS if the read is complete, ERROR_IO_INCOMPLETE if it is still pending.
+		WinError EndRead()
+		{
+			auto transferred = DWORD{ 0 };
+
+			if (!m_Reading)
+				return ERROR_SUCCESS;
+
+			if (!GetOverlappedResult(m_PipeHandle.get(), &m_ReadOverlapped, &transferred, FALSE))
+			{
+				auto status = GetLastError();
+				if (status != ERROR_IO_INCOMPLETE)
+					m_Reading = false;
+
+				return status;
+			}
+
+			m_Reading = false;
+
+			if (transferred == 0)
+				return ERROR_BROKEN_PIPE;
+
+			m_Decoder.Commit(transferred);
+			return ERROR_SUCCESS;
+		}
+
+		// Hands out the buffered messages, see ReadMessages. Does not read.
+		// @param function - called with const Codec::MessageView&.
+		// @returns count of taken messages.
+		template <typename Function>
+		size_t DecodeMessages(_In_ Function&& function) {
+			return m_Decoder.Decode(function);
+		}
+
+		// Cancels the pending I/O of all threads without waiting, e.g. to wake the event loop waiting
+		// for BeginRead. The aborted operations complete with ERROR_OPERATION_ABORTED.
+		void AbortIo() {
+			CancelIoEx(m_PipeHandle.get(), nullptr);
+		}
+
 		// Closes the named pipe.
-		void Close() { m_PipeHandle.reset(); }
+		void Close() 
+		{ 
+			CancelRead();
+			m_PipeHandle.reset(); 
+		}
 
 	private:
+		// Cancels the read started by BeginRead and waits for it, so the buffer may be released.
+		void CancelRead()
+		{
+			auto transferred = DWORD{ 0 };
+
+			if (m_Reading)
+			{
+				CancelIo(m_PipeHandle.get());
+				GetOverlappedResult(m_PipeHandle.get(), &m_ReadOverlapped, &transferred, TRUE);
+				m_Reading = false;
+			}
+		}
+
 		WinError PipeIO(BYTE* data, DWORD size, bool write = true)
 		{
-			OVERLAPPED	overlapped{ 0 };
-			WinError		status			= ERROR_SUCCESS;
-			DWORD				transferred = 0, originalSize = size;
+			auto transferred = DWORD{ 0 };
+			return PipeIO(data, size, write, false, transferred);
+		}
+
+		// Transfers the data with the overlapped I/O.
+		// The event of the direction is created once and reused by the next calls.
+		// @param data - buffer.
+		// @param size - size of buffer.
+		// @param write - true - write, false - read.
+		// @param partial - true - completes when some bytes are transferred, false - when all bytes are transferred.
+		// @param total - count of transferred bytes.
+		// @param timeout - time in milliseconds each transfer waits to complete.
+		// @reutnrs ERROR_SUCCESS if success, WAIT_TIMEOUT if the I/O did not complete in time.
+		WinError PipeIO(BYTE* data, DWORD size, bool write, bool partial, DWORD& total, DWORD timeout = PIPE_WAIT_TIMEOUT_)
+		{
+			auto& event = write ? m_WriteEvent : m_ReadEvent;
+
+			total = 0;
 
 			// Creating overlapped event.
-			if ((overlapped.hEvent = CreateEventW(nullptr, true, false, nullptr)))
+			if (!event.get())
 			{
-				do
+				event = WinHandle(CreateEventW(nullptr, true, false, nullptr));
+				if (!event.get())
+					return GetLastError();
+			}
+
+			while (total < size)
+			{
+				OVERLAPPED	overlapped{ 0 };
+				DWORD				transferred = 0;
+				BOOL				success			= FALSE;
+
+				overlapped.hEvent = event.get();
+
+				if (write)	success = WriteFile(m_PipeHandle.get(), data + total, size - total, &transferred, &overlapped);
+				else				success = ReadFile(m_PipeHandle.get(), data + total, size - total, &transferred, &overlapped);
+
+				if (success == FALSE)
 				{
-					if (write)	status = WriteFile(m_PipeHandle.get(), (data + (originalSize - size)), size, &transferred, &overlapped);
-					else				status = ReadFile(m_PipeHandle.get(), (data + (originalSize - size)), size, &transferred, &overlapped);
+					HANDLE objects[] = { m_StopEvent.get(), overlapped.hEvent };
+
+					auto status = GetLastError();
+					if (status != ERROR_IO_PENDING)
+						return status;
 
-					if (status == FALSE)
+					// Waiting for the timeout to complete.
+					status = WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, FALSE, timeout);
+					if (status != (WAIT_OBJECT_0 + 1)) 
 					{
-						HANDLE objects[] = { m_StopEvent.get(), overlapped.hEvent };
+						// The buffer and the event are reused, so the cancelled I/O must be finished.
+						CancelIo(m_PipeHandle.get());
+						GetOverlappedResult(m_PipeHandle.get(), &overlapped, &transferred, TRUE);
 
-						if ((status = GetLastError()) != ERROR_IO_PENDING)
-							break;
+						return status == WAIT_OBJECT_0 ? ERROR_OPERATION_ABORTED : status;
+					}
 
-						// Waiting for PIPE_WAIT_TIMEOUT_ seconds to complete.
-						status = WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, FALSE, PIPE_WAIT_TIMEOUT_);
-						if (status != (WAIT_OBJECT_0 + 1)) 
-						{
-							CancelIo(m_PipeHandle.get());
-							break;
-						}
+					if (!GetOverlappedResult(m_PipeHandle.get(), &overlapped, &transferred, FALSE))
+						return GetLastError();
+				}
 
-						GetOverlappedResult(m_PipeHandle.get(), &overlapped, &transferred, FALSE);
-					}
-					size -= transferred;
-				} while (size);
+				if (transferred == 0)
+					return ERROR_BROKEN_PIPE;
 
-				if (!size)
-					status = ERROR_SUCCESS;
+				total += transferred;
 
-				CloseHandle(overlapped.hEvent);
+				if (partial)
+					break;
 			}
-			else
-				status = GetLastError();
 
-			return status;
+			return ERROR_SUCCESS;
 		}
 
 	protected:
-		WinHandle&	m_StopEvent;	// Stop event.
-		WinHandle		m_PipeHandle;	// Pipe handle.
+		WinHandle&					m_StopEvent;		// Stop event.
+		WinHandle						m_PipeHandle;		// Pipe handle.
+		WinHandle						m_ReadEvent;		// Overlapped event of the reads.
+		WinHandle						m_WriteEvent;		// Overlapped event of the writes.
+		std::vector<BYTE>		m_WriteBuffer;	// Buffer of the framed messages.
+		Codec::Decoder			m_Decoder;			// Decoder of the read ahead messages.
+		OVERLAPPED					m_ReadOverlapped;	// Overlapped of the read started by BeginRead.
+		bool								m_Reading;			// true - the read started by BeginRead is pending.
 	};
 }
 
@@ -0,0 +1,142 @@
+#ifndef WINPIPE_CODEC_H_
+#define WINPIPE_CODEC_H_
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace WinPipe
+{
+	// Framing of pipe messages: a packed header with the message id and the
+	// data size, followed by the data. Does not depend on Windows.
+	namespace Codec
+	{
+		// Maximal size of the message data.
+		static constexpr uint32_t MAX_MESSAGE_SIZE_ = 64 * 1024 * 1024;
+
+#		pragma pack(push, 1)
+		// Message header.
+		struct Header
+		{
+			uint16_t id;		// Message id.
+			uint32_t size;	// Size of the message data.
+		};
+#		pragma pack(pop)
+
+		// Message that refers to its data.
+		struct MessageView
+		{
+			uint16_t				m_Id;		// Message id.
+			const uint8_t*	m_Data;	// Message data.
+			uint32_t				m_Size;	// Size of the message data.
+		};
+
+		// Appends the framed message to the buffer.
+		// @param buffer - buffer to append to.
+		// @param id - message id.
+		// @param data - message data.
+		// @param size - size of data.
+		inline void Encode(std::vector<uint8_t>& buffer, uint16_t id, const uint8_t* data, uint32_t size)
+		{
+			auto header = Header{ id, size };
+			auto offset = buffer.size();
+
+			buffer.resize(offset + sizeof(header) + size);
+			std::memcpy(buffer.data() + offset, &header, sizeof(header));
+
+			if (size != 0)
+				std::memcpy(buffer.data() + offset + sizeof(header), data, size);
+		}
+
+		// Decodes framed messages from a byte stream.
+		// Bytes are read straight into the decoder buffer, and the complete messages
+		// are handed out as views into it, so the message data is not copied.
+		class Decoder
+		{
+			// Minimal free space for a read.
+			static constexpr size_t READ_SIZE_ = 4096;
+
+		public:
+			// Returns the free space for the next read. The views of the decoded
+			// messages are invalidated. Grows the buffer to fit the pending message.
+			// @param size - size of the free space.
+			// @returns free space or nullptr if the pending message is larger than MAX_MESSAGE_SIZE_.
+			uint8_t* Prepare(size_t& size)
+			{
+				auto pending = m_End - m_Begin;
+				auto needed	 = READ_SIZE_;
+
+				if (pending >= sizeof(Header))
+				{
+					auto header = Header();
+					std::memcpy(&header, m_Buffer.data() + m_Begin, sizeof(header));
+
+					if (header.size > MAX_MESSAGE_SIZE_)
+						return nullptr;
+
+					if (sizeof(header) + header.size > pending + needed)
+						needed = sizeof(header) + header.size - pending;
+				}
+
+				// Moving the pending bytes to the beginning.
+				if (m_Begin != 0)
+				{
+					std::memmove(m_Buffer.data(), m_Buffer.data() + m_Begin, pending);
+					m_Begin = 0;
+					m_End		= pending;
+				}
+
+				if (m_Buffer.size() < m_End + needed)
+					m_Buffer.resize(m_End + needed);
+
+				size = m_Buffer.size() - m_End;
+				return m_Buffer.data() + m_End;
+			}
+
+			// Adds the bytes read into the free space.
+			// @param size - count of read bytes.
+			void Commit(size_t size) noexcept {
+				m_End += size;
+			}
+
+			// Hands out the complete messages.
+			// @param function - called with const MessageView&. Returns false if the message
+			// is not taken, it stays in the buffer and decoding stops.
+			// @returns count of taken messages.
+			template <typename Function>
+			size_t Decode(Function&& function)
+			{
+				auto taken = size_t{ 0 };
+
+				while (m_End - m_Begin >= sizeof(Header))
+				{
+					auto header = Header();
+					std::memcpy(&header, m_Buffer.data() + m_Begin, sizeof(header));
+
+					if (m_End - m_Begin - sizeof(header) < header.size)
+						break;
+
+					if (!function(MessageView{ header.id, m_Buffer.data() + m_Begin + sizeof(header), header.size }))
+						break;
+
+					m_Begin += sizeof(header) + header.size;
+					taken++;
+				}
+
+				return taken;
+			}
+
+			// Returns true if there are no buffered bytes.
+			bool Empty() const noexcept {
+				return m_Begin == m_End;
+			}
+
+		private:
+			std::vector<uint8_t>	m_Buffer;				// Read bytes.
+			size_t								m_Begin = 0;		// Offset of the first pending byte.
+			size_t								m_End		= 0;		// Offset after the last read byte.
+		};
+	}
+}
+
+#endif // !WINPIPE_CODEC_H_
@@ -14,8 +14,17 @@ namespace WinPipe
 	public:
 		// Deleted default constructor.
 		NamedPipeServer()	= delete;
-		// Default destructor.
-		~NamedPipeServer() = default;
+		// Cancels the pending connection started by BeginConnect.
+		~NamedPipeServer() 
+		{
+			auto transferred = DWORD{ 0 };
+
+			if (m_Connecting)
+			{
+				CancelIo(m_PipeHandle.get());
+				GetOverlappedResult(m_PipeHandle.get(), &m_ConnectOverlapped, &transferred, TRUE);
+			}
+		}
 		// Deleted copy constructor.
 		NamedPipeServer(const NamedPipeServer&) = delete;
 		// Deleted copy assigment.
@@ -25,20 +34,22 @@ namespace WinPipe
 		// @param stopEvent - reference to stop event.
 		// @param name - if not empty, creates a named pipe.
 		NamedPipeServer(_In_ WinHandle& stopEvent, _In_opt_ const std::wstring& name = std::wstring()) :
-			BaseNamedPipe{ stopEvent }
+			BaseNamedPipe{ stopEvent },
+			m_ConnectOverlapped{ 0 },
+			m_Connecting{ false }
 		{
 			if (!name.empty()) 
 				Create(name);
 		}
 
-		// Creates a named pipe.
+		// Creates a named pipe. The pipe is local, remote clients are rejected.
 		// @param name - pipe name.
 		// @returns ERROR_SUCCESS if success.
 		WinError Create(_In_ const std::wstring& name)
 		{
 			WinError status = ERROR_SUCCESS;
 
-			m_PipeHandle = WinHandle(CreateNamedPipeW(name.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED, PIPE_READMODE_BYTE | PIPE_WAIT,
+			m_PipeHandle = WinHandle(CreateNamedPipeW(name.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED, PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
 				PIPE_UNLIMITED_INSTANCES, PIPE_BUFFER_SIZE_, PIPE_BUFFER_SIZE_, 0, nullptr));
 
 			if (m_PipeHandle.get() == INVALID_HANDLE_VALUE)
@@ -48,14 +59,16 @@ namespace WinPipe
 		}
 		
 		// Waiting for client connection.
-		// @returns ERROR_SUCCESS or ERROR_PIPE_CONNECTED if success.
-		WinError Connect() 
+		// @param timeout - waiting timeout. by default is INFINITE.
+		// @returns ERROR_SUCCESS or ERROR_PIPE_CONNECTED if success, WAIT_TIMEOUT if no client is connected in time.
+		WinError Connect(_In_opt_ DWORD timeout = INFINITE) 
 		{
 			OVERLAPPED	overlapped{ 0 };
 			WinError		status = ERROR_SUCCESS;
+			WinHandle		event{ CreateEventW(nullptr, false, false, nullptr) };
 
 			// Creating overlapped event.
-			if ((overlapped.hEvent = CreateEventW(nullptr, false, false, nullptr)))
+			if ((overlapped.hEvent = event.get()))
 			{
 				status = ConnectNamedPipe(m_PipeHandle.get(), &overlapped);
 				if (status == FALSE)
@@ -73,11 +86,19 @@ namespace WinPipe
 					{
 						// Now we need to waiting someone event.
 						HANDLE objects[] = { m_StopEvent.get(), overlapped.hEvent };
-						status = WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, false, INFINITE);
+						status = WaitForMultipleObjects(sizeof(objects) / sizeof(objects[0]), objects, false, timeout);
 
-						// m_StopEvent fired or other error.
+						// m_StopEvent fired, timeout or other error.
+						// The overlapped is on the stack, so the cancelled connection must be finished.
 						if (status != (WAIT_OBJECT_0 + 1))
-							status = ERROR_INVALID_HANDLE;
+						{
+							auto transferred = DWORD{ 0 };
+
+							CancelIo(m_PipeHandle.get());
+							GetOverlappedResult(m_PipeHandle.get(), &overlapped, &transferred, TRUE);
+
+							status = status == WAIT_TIMEOUT ? WAIT_TIMEOUT : ERROR_INVALID_HANDLE;
+						}
 						else
 							status = ERROR_SUCCESS;
 					}
@@ -90,6 +111,66 @@ namespace WinPipe
 
 			return status;
 		}
+
+		// Starts waiting for client connection without blocking, for the event loops.
+		// Starting while the connection is awaited does nothing.
+		// @param event - event signaled when the client connects.
+		// @returns ERROR_IO_PENDING if the connection is awaited, ERROR_SUCCESS or ERROR_PIPE_CONNECTED if the client is connected.
+		WinError BeginConnect(_Out_ HANDLE& event)
+		{
+			event = nullptr;
+
+			// Creating overlapped event.
+			if (!m_ConnectEvent.get())
+			{
+				m_ConnectEvent = WinHandle(CreateEventW(nullptr, true, false, nullptr));
+				if (!m_ConnectEvent.get())
+					return GetLastError();
+			}
+
+			event = m_ConnectEvent.get();
+
+			if (m_Connecting)
+				return ERROR_IO_PENDING;
+
+			m_ConnectOverlapped					= OVERLAPPED{ 0 };
+			m_ConnectOverlapped.hEvent	= m_ConnectEvent.get();
+
+			if (ConnectNamedPipe(m_PipeHandle.get(), &m_ConnectOverlapped))
+				return ERROR_SUCCESS;
+
+			auto status		= GetLastError();
+			m_Connecting	= status == ERROR_IO_PENDING;
+
+			return status;
+		}
+
+		// Completes the connection started by BeginConnect without blocking.
+		// @returns ERROR_SUCCESS if the client is connected, ERROR_IO_INCOMPLETE if it is still awaited.
+		WinError EndConnect()
+		{
+			auto transferred = DWORD{ 0 };
+
+			if (!m_Connecting)
+				return ERROR_SUCCESS;
+
+			if (!GetOverlappedResult(m_PipeHandle.get(), &m_ConnectOverlapped, &transferred, FALSE))
+			{
+				auto status = GetLastError();
+				if (status != ERROR_IO_INCOMPLETE)
+					m_Connecting = false;
+
+				return status;
+			}
+
+			m_Connecting = false;
+			return ERROR_SUCCESS;
+		}
+
+	private:
+		WinHandle		m_ConnectEvent;				// Overlapped event of BeginConnect.
+		OVERLAPPED	m_ConnectOverlapped;	// Overlapped of BeginConnect.
+		bool				m_Connecting;					// true - the connection started by BeginConnect is awaited.
 	};
 }
 